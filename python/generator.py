@@ -456,6 +456,16 @@ skip_function = (
     'virConnectListAllDomains', #overridden in virConnect.py
     'virDomainListAllSnapshots', # overridden in virDomain.py
     'virDomainSnapshotListAllChildren', # overridden in virDomainSnapshot.py
+    'virConnectListAllStoragePools', # overridden in virConnect.py
+    'virStoragePoolListAllVolumes', # overridden in virStoragePool.py
+    'virConnectListAllNodeDevices', # overridden in virConnect.py
+
+    # Callers would need to keep output buffers alive across the callback
+    'virDomainLookupByNameAsync',
+    'virDomainLookupByUUIDAsync',
+    'virDomainGetInfoAsync',
+    'virDomainBlockStatsAsync',
+    'virDomainInterfaceStatsAsync',
 
     'virStreamRecvAll', # Pure python libvirt-override-virStream.py
     'virStreamSendAll', # Pure python libvirt-override-virStream.py
@@ -783,6 +783,26 @@ virDomainObjPtr virDomainFindByUUID(const virDomainObjListPtr doms,
     return obj;
 }
 
+/*
+ * Like virDomainFindByUUID, but returns a reference on the published
+ * definition of the domain without locking the domain object. The
+ * caller must hold the lock protecting @doms. Returns NULL if there
+ * is no such domain or it has no published definition.
+ */
+virDomainPublishedDefPtr
+virDomainFindPublishedDefByUUID(const virDomainObjListPtr doms,
+                                const unsigned char *uuid)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virDomainObjPtr obj;
+
+    virUUIDFormat(uuid, uuidstr);
+
+    if (!(obj = virHashLookup(doms->objs, uuidstr)))
+        return NULL;
+    return virDomainObjGetPublishedDef(obj);
+}
+
 static int virDomainObjListSearchName(const void *payload,
                                       const void *name ATTRIBUTE_UNUSED,
                                       const void *data)
@@ -1645,11 +1665,13 @@ static void virDomainObjFree(virDomainObjPtr dom)
     VIR_DEBUG("obj=%p", dom);
     virDomainDefFree(dom->def);
     virDomainDefFree(dom->newDef);
+    virDomainPublishedDefRelease(dom->published);
 
     if (dom->privateDataFreeFunc)
         (dom->privateDataFreeFunc)(dom->privateData);
 
     virMutexDestroy(&dom->lock);
+    virMutexDestroy(&dom->publishedLock);
 
     virDomainSnapshotObjListDeinit(&dom->snapshots);
 
@@ -1675,6 +1697,166 @@ int virDomainObjUnref(virDomainObjPtr dom)
     return dom->refs;
 }
 
+
+void virDomainPublishedDefRelease(virDomainPublishedDefPtr pub)
+{
+    size_t i;
+
+    if (!pub)
+        return;
+
+    if (virAtomicIntDec(&pub->refs) > 0)
+        return;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(pub->formatted) ; i++)
+        VIR_FREE(pub->formatted[i]);
+    virMutexDestroy(&pub->formattedLock);
+    virDomainDefFree(pub->def);
+    VIR_FREE(pub);
+}
+
+
+verify(VIR_DOMAIN_XML_SECURE == 1 && VIR_DOMAIN_XML_INACTIVE == 2);
+
+/*
+ * Format the published definition @pub like virDomainDefFormat. Since
+ * @pub never changes, the result is cached on it for the flags that
+ * affect the output, and only rebuilt once a new definition has been
+ * published.
+ */
+char *virDomainPublishedDefFormat(virDomainPublishedDefPtr pub,
+                                  unsigned int flags)
+{
+    unsigned int idx;
+    char *ret = NULL;
+
+    /* CPU updates depend on the host, so never cache them */
+    if (flags & VIR_DOMAIN_XML_UPDATE_CPU)
+        return virDomainDefFormat(pub->def, flags);
+
+    virCheckFlags(VIR_DOMAIN_XML_SECURE |
+                  VIR_DOMAIN_XML_INACTIVE, NULL);
+    idx = flags & (VIR_DOMAIN_XML_SECURE | VIR_DOMAIN_XML_INACTIVE);
+
+    virMutexLock(&pub->formattedLock);
+    if (!pub->formatted[idx] &&
+        !(pub->formatted[idx] = virDomainDefFormat(pub->def, flags)))
+        goto cleanup;
+
+    if (!(ret = strdup(pub->formatted[idx])))
+        virReportOOMError();
+
+cleanup:
+    virMutexUnlock(&pub->formattedLock);
+    return ret;
+}
+
+
+/*
+ * Publish a read-only copy of the live definition of @dom, unless
+ * one is already published. Drivers call this from the readers of
+ * the copy, and drop the copy with virDomainObjUnpublishDef whenever
+ * they change the live definition.
+ *
+ * The caller must hold the lock on @dom.
+ *
+ * Returns 0 on success, -1 on failure
+ */
+int virDomainObjPublishDef(virCapsPtr caps,
+                           virDomainObjPtr dom)
+{
+    unsigned int flags = (VIR_DOMAIN_XML_SECURE |
+                          VIR_DOMAIN_XML_INTERNAL_ACTUAL_NET |
+                          VIR_DOMAIN_XML_INTERNAL_PCI_ORIG_STATES);
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    virDomainPublishedDefPtr pub = NULL;
+    char *xml = NULL;
+
+    /* Only ever replaced under the domain lock, which we hold */
+    if (dom->published)
+        return 0;
+
+    if (virDomainDefFormatInternal(dom->def, flags, &buf) < 0)
+        goto error;
+    if (virBufferError(&buf))
+        goto no_memory;
+    xml = virBufferContentAndReset(&buf);
+
+    if (VIR_ALLOC(pub) < 0)
+        goto no_memory;
+
+    if (virAtomicIntInit(&pub->refs) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "%s", _("cannot initialize mutex"));
+        VIR_FREE(pub);
+        goto error;
+    }
+    virAtomicIntSet(&pub->refs, 1);
+
+    if (virMutexInit(&pub->formattedLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "%s", _("cannot initialize mutex"));
+        VIR_FREE(pub);
+        goto error;
+    }
+
+    if (!(pub->def = virDomainDefParseString(caps, xml, -1,
+                                             flags & ~VIR_DOMAIN_XML_SECURE)))
+        goto error;
+    VIR_FREE(xml);
+
+    virMutexLock(&dom->publishedLock);
+    dom->published = pub;
+    virMutexUnlock(&dom->publishedLock);
+
+    return 0;
+
+no_memory:
+    virReportOOMError();
+error:
+    virBufferFreeAndReset(&buf);
+    virDomainPublishedDefRelease(pub);
+    VIR_FREE(xml);
+    return -1;
+}
+
+
+/*
+ * Drop the published copy of the definition of @dom, because the
+ * live definition changed or the domain stopped running. Holders of
+ * the copy keep using it until they release it.
+ */
+void virDomainObjUnpublishDef(virDomainObjPtr dom)
+{
+    virDomainPublishedDefPtr old;
+
+    virMutexLock(&dom->publishedLock);
+    old = dom->published;
+    dom->published = NULL;
+    virMutexUnlock(&dom->publishedLock);
+
+    virDomainPublishedDefRelease(old);
+}
+
+
+/*
+ * Get a reference on the published definition of @dom, if any. The
+ * caller does not need to hold the lock on @dom, but must guarantee
+ * it stays alive for the duration of the call. Release the result
+ * with virDomainPublishedDefRelease.
+ */
+virDomainPublishedDefPtr virDomainObjGetPublishedDef(virDomainObjPtr dom)
+{
+    virDomainPublishedDefPtr pub;
+
+    virMutexLock(&dom->publishedLock);
+    if ((pub = dom->published))
+        virAtomicIntInc(&pub->refs);
+    virMutexUnlock(&dom->publishedLock);
+
+    return pub;
+}
+
 static virDomainObjPtr virDomainObjNew(virCapsPtr caps)
 {
     virDomainObjPtr domain;
@@ -1701,6 +1883,16 @@ static virDomainObjPtr virDomainObjNew(virCapsPtr caps)
         return NULL;
     }
 
+    if (virMutexInit(&domain->publishedLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "%s", _("cannot initialize mutex"));
+        virMutexDestroy(&domain->lock);
+        if (domain->privateDataFreeFunc)
+            (domain->privateDataFreeFunc)(domain->privateData);
+        VIR_FREE(domain);
+        return NULL;
+    }
+
     virDomainObjLock(domain);
     virDomainObjSetState(domain, VIR_DOMAIN_SHUTOFF,
                                  VIR_DOMAIN_SHUTOFF_UNKNOWN);
@@ -7098,20 +7290,16 @@ static int virDomainLifecycleParseXML(xmlXPathContextPtr ctxt,
     return 0;
 }
 
-virDomainDeviceDefPtr virDomainDeviceDefParse(virCapsPtr caps,
-                                              const virDomainDefPtr def,
-                                              const char *xmlStr,
-                                              unsigned int flags)
+static virDomainDeviceDefPtr
+virDomainDeviceDefParseNode(virCapsPtr caps,
+                            const virDomainDefPtr def,
+                            xmlNodePtr node,
+                            xmlXPathContextPtr ctxt,
+                            unsigned int flags)
 {
-    xmlDocPtr xml;
-    xmlNodePtr node;
-    xmlXPathContextPtr ctxt = NULL;
     virDomainDeviceDefPtr dev = NULL;
 
-    if (!(xml = virXMLParseStringCtxt(xmlStr, _("(device_definition)"), &ctxt))) {
-        goto error;
-    }
-    node = ctxt->node;
+    ctxt->node = node;
 
     if (VIR_ALLOC(dev) < 0) {
         virReportOOMError();
@@ -7180,15 +7368,101 @@ virDomainDeviceDefPtr virDomainDeviceDefParse(virCapsPtr caps,
         goto error;
     }
 
+    return dev;
+
+  error:
+    VIR_FREE(dev);
+    return NULL;
+}
+
+virDomainDeviceDefPtr virDomainDeviceDefParse(virCapsPtr caps,
+                                              const virDomainDefPtr def,
+                                              const char *xmlStr,
+                                              unsigned int flags)
+{
+    xmlDocPtr xml;
+    xmlXPathContextPtr ctxt = NULL;
+    virDomainDeviceDefPtr dev = NULL;
+
+    if ((xml = virXMLParseStringCtxt(xmlStr, _("(device_definition)"), &ctxt)))
+        dev = virDomainDeviceDefParseNode(caps, def, ctxt->node, ctxt, flags);
+
     xmlFreeDoc(xml);
     xmlXPathFreeContext(ctxt);
     return dev;
+}
 
-  error:
+/*
+ * Parse either the XML of a single device, or a <devices> element
+ * holding any number of them, into a newly allocated array stored
+ * in @devs.
+ *
+ * Returns the number of devices parsed, or -1 on error.
+ */
+int virDomainDeviceDefParseList(virCapsPtr caps,
+                                const virDomainDefPtr def,
+                                const char *xmlStr,
+                                unsigned int flags,
+                                virDomainDeviceDefPtr **devs)
+{
+    xmlDocPtr xml;
+    xmlNodePtr root;
+    xmlNodePtr cur;
+    xmlXPathContextPtr ctxt = NULL;
+    virDomainDeviceDefPtr *list = NULL;
+    size_t nlist = 0;
+    size_t i;
+    int ret = -1;
+
+    *devs = NULL;
+
+    if (!(xml = virXMLParseStringCtxt(xmlStr, _("(device_definition)"), &ctxt)))
+        goto cleanup;
+    root = ctxt->node;
+
+    if (!xmlStrEqual(root->name, BAD_CAST "devices")) {
+        if (VIR_ALLOC_N(list, 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        if (!(list[0] = virDomainDeviceDefParseNode(caps, def, root,
+                                                    ctxt, flags)))
+            goto cleanup;
+        nlist = 1;
+    } else {
+        for (cur = root->children; cur; cur = cur->next) {
+            if (cur->type != XML_ELEMENT_NODE)
+                continue;
+
+            if (VIR_EXPAND_N(list, nlist, 1) < 0) {
+                virReportOOMError();
+                goto cleanup;
+            }
+            if (!(list[nlist - 1] = virDomainDeviceDefParseNode(caps, def, cur,
+                                                                ctxt, flags)))
+                goto cleanup;
+        }
+
+        if (!nlist) {
+            virReportError(VIR_ERR_XML_ERROR, "%s",
+                           _("no devices in device list"));
+            goto cleanup;
+        }
+    }
+
+    *devs = list;
+    list = NULL;
+    ret = nlist;
+
+cleanup:
+    if (list) {
+        for (i = 0 ; i < nlist ; i++)
+            virDomainDeviceDefFree(list[i]);
+        VIR_FREE(list);
+    }
     xmlFreeDoc(xml);
     xmlXPathFreeContext(ctxt);
-    VIR_FREE(dev);
-    return NULL;
+    return ret;
 }
 
 
@@ -13267,6 +13541,9 @@ int virDomainSaveStatus(virCapsPtr caps,
     int ret = -1;
     char *xml;
 
+    /* Status is saved after most changes of the live definition */
+    virDomainObjUnpublishDef(obj);
+
     if (!(xml = virDomainObjFormat(caps, obj, flags)))
         goto cleanup;
 
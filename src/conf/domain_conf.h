@@ -34,6 +34,7 @@
 # include "cpu_conf.h"
 # include "util.h"
 # include "threads.h"
+# include "viratomic.h"
 # include "virhash.h"
 # include "virsocketaddr.h"
 # include "nwfilter_params.h"
@@ -1804,6 +1805,21 @@ struct _virDomainStateReason {
     int reason;
 };
 
+/* Read-only copy of the live definition of a running domain. It is
+ * never modified once published, so holders of a reference can use
+ * it without the domain object lock */
+typedef struct _virDomainPublishedDef virDomainPublishedDef;
+typedef virDomainPublishedDef *virDomainPublishedDefPtr;
+struct _virDomainPublishedDef {
+    virAtomicInt refs;
+    virDomainDefPtr def;
+
+    /* Public XML formats of @def, indexed by the combination of
+     * VIR_DOMAIN_XML_SECURE and VIR_DOMAIN_XML_INACTIVE flags */
+    virMutex formattedLock;
+    char *formatted[4];
+};
+
 typedef struct _virDomainObj virDomainObj;
 typedef virDomainObj *virDomainObjPtr;
 struct _virDomainObj {
@@ -1820,6 +1836,9 @@ struct _virDomainObj {
     virDomainDefPtr def; /* The current definition */
     virDomainDefPtr newDef; /* New definition to activate at shutdown */
 
+    virMutex publishedLock; /* Only protects @published, never held long */
+    virDomainPublishedDefPtr published; /* Copy of @def while running */
+
     virDomainSnapshotObjList snapshots;
     virDomainSnapshotObjPtr current_snapshot;
 
@@ -1911,6 +1930,17 @@ void virDomainObjRef(virDomainObjPtr vm);
 /* Returns 1 if the object was freed, 0 if more refs exist */
 int virDomainObjUnref(virDomainObjPtr vm) ATTRIBUTE_RETURN_CHECK;
 
+int virDomainObjPublishDef(virCapsPtr caps,
+                           virDomainObjPtr vm);
+void virDomainObjUnpublishDef(virDomainObjPtr vm);
+virDomainPublishedDefPtr virDomainObjGetPublishedDef(virDomainObjPtr vm);
+virDomainPublishedDefPtr
+virDomainFindPublishedDefByUUID(const virDomainObjListPtr doms,
+                                const unsigned char *uuid);
+void virDomainPublishedDefRelease(virDomainPublishedDefPtr pub);
+char *virDomainPublishedDefFormat(virDomainPublishedDefPtr pub,
+                                  unsigned int flags);
+
 virDomainChrDefPtr virDomainChrDefNew(void);
 
 /* live == true means def describes an active domain (being migrated or
@@ -1945,6 +1975,11 @@ virDomainDeviceDefPtr virDomainDeviceDefParse(virCapsPtr caps,
                                               const virDomainDefPtr def,
                                               const char *xmlStr,
                                               unsigned int flags);
+int virDomainDeviceDefParseList(virCapsPtr caps,
+                                const virDomainDefPtr def,
+                                const char *xmlStr,
+                                unsigned int flags,
+                                virDomainDeviceDefPtr **devs);
 virDomainDefPtr virDomainDefParseString(virCapsPtr caps,
                                         const char *xmlStr,
                                         unsigned int expectedVirtTypes,
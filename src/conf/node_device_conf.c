@@ -52,6 +52,11 @@ VIR_ENUM_IMPL(virNodeDevCap, VIR_NODE_DEV_CAP_LAST,
               "scsi",
               "storage")
 
+/* virConnectListAllNodeDevices flags are indexed by capability type */
+verify(VIR_CONNECT_LIST_NODE_DEVICES_CAP_STORAGE ==
+       (1 << VIR_NODE_DEV_CAP_STORAGE));
+verify(VIR_NODE_DEV_CAP_LAST == VIR_NODE_DEV_CAP_STORAGE + 1);
+
 VIR_ENUM_IMPL(virNodeDevNetCap, VIR_NODE_DEV_CAP_NET_LAST,
               "80203",
               "80211")
@@ -87,38 +92,122 @@ int virNodeDeviceHasCap(const virNodeDeviceObjPtr dev, const char *cap)
 }
 
 
-virNodeDeviceObjPtr
-virNodeDeviceFindBySysfsPath(const virNodeDeviceObjListPtr devs,
-                             const char *sysfs_path)
+/*
+ * Add @dev to the name, sysfs path and capability indexes of @devs.
+ * The name must not be indexed yet; if another device already claims
+ * the sysfs path it keeps it, so lookups keep returning the first
+ * matching device in the list.
+ */
+static int
+virNodeDeviceObjListIndex(virNodeDeviceObjListPtr devs,
+                          virNodeDeviceObjPtr dev)
 {
+    virNodeDeviceDefPtr def = dev->def;
+    virNodeDevCapsDefPtr caps;
+
+    if ((!devs->names && !(devs->names = virHashCreate(50, NULL))) ||
+        (!devs->sysfs_paths && !(devs->sysfs_paths = virHashCreate(50, NULL))))
+        return -1;
+
+    if (virHashAddEntry(devs->names, def->name, dev) < 0)
+        return -1;
+
+    if (def->sysfs_path &&
+        !virHashLookup(devs->sysfs_paths, def->sysfs_path) &&
+        virHashAddEntry(devs->sysfs_paths, def->sysfs_path, dev) < 0)
+        goto error;
+
+    for (caps = def->caps ; caps ; caps = caps->next) {
+        virHashTablePtr *table = &devs->caps[caps->type];
+
+        if (!*table && !(*table = virHashCreate(20, NULL)))
+            goto error;
+
+        if (virHashLookup(*table, def->name))
+            continue;
+
+        if (virHashAddEntry(*table, def->name, dev) < 0)
+            goto error;
+    }
+
+    return 0;
+
+error:
+    virHashRemoveEntry(devs->names, def->name);
+    if (def->sysfs_path &&
+        virHashLookup(devs->sysfs_paths, def->sysfs_path) == dev)
+        virHashRemoveEntry(devs->sysfs_paths, def->sysfs_path);
+    for (caps = def->caps ; caps ; caps = caps->next) {
+        if (devs->caps[caps->type])
+            virHashRemoveEntry(devs->caps[caps->type], def->name);
+    }
+    return -1;
+}
+
+/*
+ * Drop the index entries which point to @dev.  If another device in
+ * the list has the same sysfs path, it takes over the index entry.
+ */
+static void
+virNodeDeviceObjListUnindex(virNodeDeviceObjListPtr devs,
+                            virNodeDeviceObjPtr dev)
+{
+    virNodeDeviceDefPtr def = dev->def;
     unsigned int i;
+    int type;
 
-    for (i = 0; i < devs->count; i++) {
-        virNodeDeviceObjLock(devs->objs[i]);
-        if ((devs->objs[i]->def->sysfs_path != NULL) &&
-            (STREQ(devs->objs[i]->def->sysfs_path, sysfs_path))) {
-            return devs->objs[i];
+    if (devs->names && virHashLookup(devs->names, def->name) == dev)
+        virHashRemoveEntry(devs->names, def->name);
+
+    for (type = 0 ; type < VIR_NODE_DEV_CAP_LAST ; type++) {
+        if (devs->caps[type] && virHashLookup(devs->caps[type], def->name) == dev)
+            virHashRemoveEntry(devs->caps[type], def->name);
+    }
+
+    if (!def->sysfs_path || !devs->sysfs_paths ||
+        virHashLookup(devs->sysfs_paths, def->sysfs_path) != dev)
+        return;
+
+    virHashRemoveEntry(devs->sysfs_paths, def->sysfs_path);
+
+    for (i = 0 ; i < devs->count ; i++) {
+        const char *other = devs->objs[i]->def->sysfs_path;
+
+        if (devs->objs[i] != dev && other && STREQ(other, def->sysfs_path)) {
+            ignore_value(virHashAddEntry(devs->sysfs_paths, other,
+                                         devs->objs[i]));
+            break;
         }
-        virNodeDeviceObjUnlock(devs->objs[i]);
     }
+}
 
-    return NULL;
+
+virNodeDeviceObjPtr
+virNodeDeviceFindBySysfsPath(const virNodeDeviceObjListPtr devs,
+                             const char *sysfs_path)
+{
+    virNodeDeviceObjPtr dev;
+
+    if (!devs->sysfs_paths ||
+        !(dev = virHashLookup(devs->sysfs_paths, sysfs_path)))
+        return NULL;
+
+    virNodeDeviceObjLock(dev);
+    return dev;
 }
 
 
 virNodeDeviceObjPtr virNodeDeviceFindByName(const virNodeDeviceObjListPtr devs,
                                             const char *name)
 {
-    unsigned int i;
+    virNodeDeviceObjPtr dev;
 
-    for (i = 0; i < devs->count; i++) {
-        virNodeDeviceObjLock(devs->objs[i]);
-        if (STREQ(devs->objs[i]->def->name, name))
-            return devs->objs[i];
-        virNodeDeviceObjUnlock(devs->objs[i]);
-    }
+    if (!devs->names ||
+        !(dev = virHashLookup(devs->names, name)))
+        return NULL;
 
-    return NULL;
+    virNodeDeviceObjLock(dev);
+    return dev;
 }
 
 
@@ -166,6 +255,14 @@ void virNodeDeviceObjListFree(virNodeDeviceObjListPtr devs)
         virNodeDeviceObjFree(devs->objs[i]);
     VIR_FREE(devs->objs);
     devs->count = 0;
+    virHashFree(devs->names);
+    virHashFree(devs->sysfs_paths);
+    devs->names = NULL;
+    devs->sysfs_paths = NULL;
+    for (i = 0 ; i < VIR_NODE_DEV_CAP_LAST ; i++) {
+        virHashFree(devs->caps[i]);
+        devs->caps[i] = NULL;
+    }
 }
 
 virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
@@ -174,8 +271,18 @@ virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
     virNodeDeviceObjPtr device;
 
     if ((device = virNodeDeviceFindByName(devs, def->name))) {
-        virNodeDeviceDefFree(device->def);
+        virNodeDeviceDefPtr olddef = device->def;
+
+        virNodeDeviceObjListUnindex(devs, device);
         device->def = def;
+        if (virNodeDeviceObjListIndex(devs, device) < 0) {
+            device->def = olddef;
+            ignore_value(virNodeDeviceObjListIndex(devs, device));
+            virNodeDeviceObjUnlock(device);
+            virReportOOMError();
+            return NULL;
+        }
+        virNodeDeviceDefFree(olddef);
         return device;
     }
 
@@ -193,7 +300,8 @@ virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
     virNodeDeviceObjLock(device);
     device->def = def;
 
-    if (VIR_REALLOC_N(devs->objs, devs->count+1) < 0) {
+    if (VIR_REALLOC_N(devs->objs, devs->count+1) < 0 ||
+        virNodeDeviceObjListIndex(devs, device) < 0) {
         device->def = NULL;
         virNodeDeviceObjUnlock(device);
         virNodeDeviceObjFree(device);
@@ -216,6 +324,7 @@ void virNodeDeviceObjRemove(virNodeDeviceObjListPtr devs,
     for (i = 0; i < devs->count; i++) {
         virNodeDeviceObjLock(dev);
         if (devs->objs[i] == dev) {
+            virNodeDeviceObjListUnindex(devs, dev);
             virNodeDeviceObjUnlock(dev);
             virNodeDeviceObjFree(devs->objs[i]);
 
@@ -234,6 +343,124 @@ void virNodeDeviceObjRemove(virNodeDeviceObjListPtr devs,
     }
 }
 
+/*
+ * virNodeDeviceObjUpdateCaps:
+ *
+ * Refresh the capability indexes of @devs after capabilities were
+ * added to or removed from the definition of @dev, which must be
+ * locked.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNodeDeviceObjUpdateCaps(virNodeDeviceObjListPtr devs,
+                               virNodeDeviceObjPtr dev)
+{
+    virNodeDevCapsDefPtr caps;
+    int type;
+
+    for (type = 0 ; type < VIR_NODE_DEV_CAP_LAST ; type++) {
+        if (devs->caps[type] &&
+            virHashLookup(devs->caps[type], dev->def->name) == dev)
+            virHashRemoveEntry(devs->caps[type], dev->def->name);
+    }
+
+    for (caps = dev->def->caps ; caps ; caps = caps->next) {
+        virHashTablePtr *table = &devs->caps[caps->type];
+
+        if (!*table && !(*table = virHashCreate(20, NULL)))
+            return -1;
+
+        if (virHashLookup(*table, dev->def->name))
+            continue;
+
+        if (virHashAddEntry(*table, dev->def->name, dev) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Return the index of devices with capability @cap, or NULL if no
+ * device has it or @cap is not a known capability.
+ */
+static virHashTablePtr
+virNodeDeviceObjListCapIndex(virNodeDeviceObjListPtr devs,
+                             const char *cap)
+{
+    int type;
+
+    if ((type = virNodeDevCapTypeFromString(cap)) < 0)
+        return NULL;
+
+    return devs->caps[type];
+}
+
+/*
+ * virNodeDeviceObjListNumOfDevices:
+ *
+ * Count the devices in @devs, or only those with capability @cap
+ * if it is non-NULL.
+ */
+int virNodeDeviceObjListNumOfDevices(virNodeDeviceObjListPtr devs,
+                                     const char *cap)
+{
+    virHashTablePtr table;
+
+    if (!cap)
+        return devs->count;
+
+    if (!(table = virNodeDeviceObjListCapIndex(devs, cap)))
+        return 0;
+
+    return virHashSize(table);
+}
+
+/*
+ * virNodeDeviceObjListGetNames:
+ *
+ * Fill @names with up to @maxnames device names from @devs, only
+ * considering devices with capability @cap if it is non-NULL. Names
+ * come in list order, the capability index only tells which devices
+ * qualify.
+ *
+ * Returns the number of names filled in, or -1 on error.
+ */
+int virNodeDeviceObjListGetNames(virNodeDeviceObjListPtr devs,
+                                 const char *cap,
+                                 char **const names,
+                                 int maxnames)
+{
+    virHashTablePtr table = NULL;
+    int ndevs = 0;
+    int i;
+
+    if (cap && !(table = virNodeDeviceObjListCapIndex(devs, cap)))
+        return 0;
+
+    for (i = 0 ; i < devs->count && ndevs < maxnames ; i++) {
+        virNodeDeviceObjPtr dev = devs->objs[i];
+
+        virNodeDeviceObjLock(dev);
+        if (!table || virHashLookup(table, dev->def->name) == dev) {
+            if (!(names[ndevs] = strdup(dev->def->name))) {
+                virNodeDeviceObjUnlock(dev);
+                goto no_memory;
+            }
+            ndevs++;
+        }
+        virNodeDeviceObjUnlock(dev);
+    }
+
+    return ndevs;
+
+no_memory:
+    virReportOOMError();
+    for (i = 0 ; i < ndevs ; i++)
+        VIR_FREE(names[i]);
+    return -1;
+}
+
 char *virNodeDeviceDefFormat(const virNodeDeviceDefPtr def)
 {
     virBuffer buf = VIR_BUFFER_INITIALIZER;
@@ -1360,6 +1587,99 @@ out:
     return ret;
 }
 
+
+/*
+ * virNodeDeviceList:
+ *
+ * Build an array of device objects for the devices in @devobjs which
+ * have any of the capabilities selected by @flags, or for all devices
+ * if no capability flag is set.  Devices come in list order, each one
+ * once even if it has several of the selected capabilities.  The
+ * per-capability indexes bound the size of the result up front and
+ * answer whether a device qualifies without walking its capabilities.
+ * If @devices is NULL only the number of matching devices is returned.
+ *
+ * Returns the number of devices, or -1 on error.
+ */
+int
+virNodeDeviceList(virConnectPtr conn,
+                  virNodeDeviceObjListPtr devobjs,
+                  virNodeDevicePtr **devices,
+                  unsigned int flags)
+{
+    virNodeDevicePtr *tmp_devices = NULL;
+    unsigned int filter = flags & VIR_CONNECT_LIST_NODE_DEVICES_FILTERS_CAP;
+    size_t ndevices = 0;
+    int count = 0;
+    int ret = -1;
+    int i;
+    int type;
+
+    if (!filter) {
+        ndevices = devobjs->count;
+    } else {
+        for (type = 0 ; type < VIR_NODE_DEV_CAP_LAST ; type++) {
+            if ((filter & (1 << type)) && devobjs->caps[type])
+                ndevices += virHashSize(devobjs->caps[type]);
+        }
+    }
+
+    if (devices) {
+        if (VIR_ALLOC_N(tmp_devices, ndevices + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+    }
+
+    /* No device has any of the selected capabilities */
+    if (!ndevices)
+        goto done;
+
+    for (i = 0 ; i < devobjs->count ; i++) {
+        virNodeDeviceObjPtr obj = devobjs->objs[i];
+        bool match = !filter;
+
+        virNodeDeviceObjLock(obj);
+        for (type = 0 ; type < VIR_NODE_DEV_CAP_LAST && !match ; type++) {
+            if ((filter & (1 << type)) &&
+                devobjs->caps[type] &&
+                virHashLookup(devobjs->caps[type], obj->def->name) == obj)
+                match = true;
+        }
+
+        if (match && tmp_devices) {
+            if (!(tmp_devices[count] = virGetNodeDevice(conn,
+                                                        obj->def->name))) {
+                virNodeDeviceObjUnlock(obj);
+                goto cleanup;
+            }
+        }
+        virNodeDeviceObjUnlock(obj);
+
+        if (match)
+            count++;
+    }
+
+done:
+    if (tmp_devices) {
+        /* trim the array to the final size */
+        ignore_value(VIR_REALLOC_N(tmp_devices, count + 1));
+        *devices = tmp_devices;
+        tmp_devices = NULL;
+    }
+
+    ret = count;
+
+cleanup:
+    if (tmp_devices) {
+        for (i = 0 ; i < count ; i++)
+            virNodeDeviceFree(tmp_devices[i]);
+    }
+
+    VIR_FREE(tmp_devices);
+    return ret;
+}
+
 void virNodeDevCapsDefFree(virNodeDevCapsDefPtr caps)
 {
     int i = 0;
@@ -28,6 +28,7 @@
 # include "internal.h"
 # include "util.h"
 # include "threads.h"
+# include "virhash.h"
 
 # include <libxml/tree.h>
 
@@ -201,6 +202,12 @@ typedef virNodeDeviceObjList *virNodeDeviceObjListPtr;
 struct _virNodeDeviceObjList {
     unsigned int count;
     virNodeDeviceObjPtr *objs;
+
+    /* Lookup indexes over objs; they don't own the objects */
+    virHashTablePtr names;              /* device name -> obj */
+    virHashTablePtr sysfs_paths;        /* sysfs path -> obj */
+    virHashTablePtr caps[VIR_NODE_DEV_CAP_LAST]; /* per capability type,
+                                                    device name -> obj */
 };
 
 typedef struct _virDeviceMonitorState virDeviceMonitorState;
@@ -228,6 +235,16 @@ virNodeDeviceObjPtr virNodeDeviceAssignDef(virNodeDeviceObjListPtr devs,
 void virNodeDeviceObjRemove(virNodeDeviceObjListPtr devs,
                             const virNodeDeviceObjPtr dev);
 
+int virNodeDeviceObjUpdateCaps(virNodeDeviceObjListPtr devs,
+                               virNodeDeviceObjPtr dev);
+
+int virNodeDeviceObjListNumOfDevices(virNodeDeviceObjListPtr devs,
+                                     const char *cap);
+int virNodeDeviceObjListGetNames(virNodeDeviceObjListPtr devs,
+                                 const char *cap,
+                                 char **const names,
+                                 int maxnames);
+
 char *virNodeDeviceDefFormat(const virNodeDeviceDefPtr def);
 
 virNodeDeviceDefPtr virNodeDeviceDefParseString(const char *str,
@@ -261,4 +278,20 @@ void virNodeDevCapsDefFree(virNodeDevCapsDefPtr caps);
 void virNodeDeviceObjLock(virNodeDeviceObjPtr obj);
 void virNodeDeviceObjUnlock(virNodeDeviceObjPtr obj);
 
+# define VIR_CONNECT_LIST_NODE_DEVICES_FILTERS_CAP                 \
+                (VIR_CONNECT_LIST_NODE_DEVICES_CAP_SYSTEM        | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_PCI_DEV       | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_USB_DEV       | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_USB_INTERFACE | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_NET           | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI_HOST     | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI_TARGET   | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI          | \
+                 VIR_CONNECT_LIST_NODE_DEVICES_CAP_STORAGE)
+
+int virNodeDeviceList(virConnectPtr conn,
+                      virNodeDeviceObjListPtr devobjs,
+                      virNodeDevicePtr **devices,
+                      unsigned int flags);
+
 #endif /* __VIR_NODE_DEVICE_CONF_H__ */
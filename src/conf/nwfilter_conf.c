@@ -1775,6 +1775,46 @@ static const virAttributes virAttr[] = {
     PROTOCOL_ENTRY_LAST
 };
 
+/**
+ * virNWFilterRuleDefVarAccessUsedOnlyBy:
+ * @rule: the rule
+ * @varAccess: one of the variable accesses of @rule
+ * @item: an attribute of @rule
+ *
+ * Returns true if @item is the only attribute of @rule through which
+ * the variable is accessed with @varAccess, false otherwise.
+ */
+bool
+virNWFilterRuleDefVarAccessUsedOnlyBy(virNWFilterRuleDefPtr rule,
+                                      virNWFilterVarAccessPtr varAccess,
+                                      const nwItemDesc *item)
+{
+    const virXMLAttr2Struct *att = NULL;
+    int i;
+
+    for (i = 0; virAttr[i].id; i++) {
+        if (virAttr[i].prtclType == rule->prtclType) {
+            att = virAttr[i].att;
+            break;
+        }
+    }
+
+    if (!att)
+        return false;
+
+    for (i = 0; att[i].name; i++) {
+        const nwItemDesc *other;
+
+        other = (const nwItemDesc *)((const char *)rule + att[i].dataIdx);
+        if (other != item &&
+            (other->flags & NWFILTER_ENTRY_ITEM_FLAG_HAS_VAR) &&
+            other->varAccess == varAccess)
+            return false;
+    }
+
+    return true;
+}
+
 static int
 virNWFilterRuleDetailsParse(xmlNodePtr node,
                             virNWFilterRuleDefPtr nwf,
@@ -2863,6 +2903,7 @@ virNWFilterInstFiltersOnAllVMs(virConnectPtr conn)
         .err = 0, /* ignored here */
         .step = STEP_APPLY_CURRENT,
         .skipInterfaces = NULL, /* not needed */
+        .affectedFilters = NULL, /* all of them */
     };
 
     for (i = 0; i < nCallbackDriver; i++)
@@ -2873,21 +2914,175 @@ virNWFilterInstFiltersOnAllVMs(virConnectPtr conn)
     return 0;
 }
 
+typedef struct _virNWFilterReferrers virNWFilterReferrers;
+typedef virNWFilterReferrers *virNWFilterReferrersPtr;
+struct _virNWFilterReferrers {
+    size_t nnames;
+    const char **names; /* owned by the filter definitions */
+};
+
+static void
+virNWFilterReferrersFree(void *payload, const void *name ATTRIBUTE_UNUSED)
+{
+    virNWFilterReferrersPtr referrers = payload;
+
+    if (!referrers)
+        return;
+
+    VIR_FREE(referrers->names);
+    VIR_FREE(referrers);
+}
+
+/*
+ * Build the reverse dependency index of @nwfilters: a table mapping
+ * the name of each referenced filter to the names of the filters
+ * which reference it directly.
+ */
+static virHashTablePtr
+virNWFilterBuildReferrersIndex(virNWFilterObjListPtr nwfilters)
+{
+    virHashTablePtr index;
+    int i, j;
+
+    if (!(index = virHashCreate(nwfilters->count, virNWFilterReferrersFree)))
+        return NULL;
+
+    for (i = 0; i < nwfilters->count; i++) {
+        virNWFilterObjPtr obj = nwfilters->objs[i];
+        virNWFilterDefPtr def;
+
+        virNWFilterObjLock(obj);
+        def = obj->def;
+
+        for (j = 0; j < def->nentries; j++) {
+            virNWFilterIncludeDefPtr inc = def->filterEntries[j]->include;
+            virNWFilterReferrersPtr referrers;
+
+            if (!inc)
+                continue;
+
+            if (!(referrers = virHashLookup(index, inc->filterref))) {
+                if (VIR_ALLOC(referrers) < 0 ||
+                    virHashAddEntry(index, inc->filterref, referrers) < 0) {
+                    VIR_FREE(referrers);
+                    virNWFilterObjUnlock(obj);
+                    goto no_memory;
+                }
+            }
+
+            if (VIR_EXPAND_N(referrers->names, referrers->nnames, 1) < 0) {
+                virNWFilterObjUnlock(obj);
+                goto no_memory;
+            }
+            referrers->names[referrers->nnames - 1] = def->name;
+        }
+
+        virNWFilterObjUnlock(obj);
+    }
+
+    return index;
+
+no_memory:
+    virReportOOMError();
+    virHashFree(index);
+    return NULL;
+}
+
+/*
+ * virNWFilterGetAffectedFilters:
+ * @nwfilters: the list of all filters
+ * @filtername: the name of the filter being changed or removed
+ *
+ * Collect the names of the filters whose trees include @filtername,
+ * directly or through other filters, including @filtername itself.
+ * Only interfaces referencing one of these need to be rebuilt.
+ *
+ * Returns the set of names, or NULL on error.
+ */
+static virHashTablePtr
+virNWFilterGetAffectedFilters(virNWFilterObjListPtr nwfilters,
+                              const char *filtername)
+{
+    virHashTablePtr index;
+    virHashTablePtr affected = NULL;
+    const char **queue = NULL;
+    size_t nqueue = 0;
+    size_t i;
+
+    if (!(index = virNWFilterBuildReferrersIndex(nwfilters)))
+        return NULL;
+
+    if (!(affected = virHashCreate(0, NULL)))
+        goto cleanup;
+
+    if (VIR_ALLOC_N(queue, 1) < 0)
+        goto no_memory;
+    queue[nqueue++] = filtername;
+    if (virHashAddEntry(affected, filtername, (void *)~0) < 0)
+        goto error;
+
+    /* Breadth first walk up the reverse dependencies; the definitions
+     * are known to be free of loops, and the set stops revisits */
+    for (i = 0; i < nqueue; i++) {
+        virNWFilterReferrersPtr referrers;
+        size_t j;
+
+        if (!(referrers = virHashLookup(index, queue[i])))
+            continue;
+
+        for (j = 0; j < referrers->nnames; j++) {
+            if (virHashLookup(affected, referrers->names[j]))
+                continue;
+
+            if (virHashAddEntry(affected, referrers->names[j],
+                                (void *)~0) < 0)
+                goto error;
+
+            if (VIR_EXPAND_N(queue, nqueue, 1) < 0)
+                goto no_memory;
+            queue[nqueue - 1] = referrers->names[j];
+        }
+    }
+
+cleanup:
+    VIR_FREE(queue);
+    virHashFree(index);
+    return affected;
+
+no_memory:
+    virReportOOMError();
+error:
+    virHashFree(affected);
+    affected = NULL;
+    goto cleanup;
+}
+
+/*
+ * Rebuild the filters of the interfaces whose filter tree includes
+ * @filtername, which is about to be changed or removed.
+ */
 static int
-virNWFilterTriggerVMFilterRebuild(virConnectPtr conn)
+virNWFilterTriggerVMFilterRebuild(virConnectPtr conn,
+                                  virNWFilterObjListPtr nwfilters,
+                                  const char *filtername)
 {
     int i;
-    int err;
+    int err = -1;
     struct domUpdateCBStruct cb = {
         .conn = conn,
         .err = 0,
         .step = STEP_APPLY_NEW,
         .skipInterfaces = virHashCreate(0, NULL),
+        .affectedFilters = NULL,
     };
 
     if (!cb.skipInterfaces)
         return -1;
 
+    if (!(cb.affectedFilters = virNWFilterGetAffectedFilters(nwfilters,
+                                                             filtername)))
+        goto cleanup;
+
     for (i = 0; i < nCallbackDriver; i++) {
         callbackDrvArray[i]->vmFilterRebuild(conn,
                                              virNWFilterDomainFWUpdateCB,
@@ -2913,6 +3108,8 @@ virNWFilterTriggerVMFilterRebuild(virConnectPtr conn)
                                                  &cb);
     }
 
+cleanup:
+    virHashFree(cb.affectedFilters);
     virHashFree(cb.skipInterfaces);
 
     return err;
@@ -2921,13 +3118,15 @@ virNWFilterTriggerVMFilterRebuild(virConnectPtr conn)
 
 int
 virNWFilterTestUnassignDef(virConnectPtr conn,
+                           virNWFilterObjListPtr nwfilters,
                            virNWFilterObjPtr nwfilter)
 {
     int rc = 0;
 
     nwfilter->wantRemoved = 1;
     /* trigger the update on VMs referencing the filter */
-    if (virNWFilterTriggerVMFilterRebuild(conn))
+    if (virNWFilterTriggerVMFilterRebuild(conn, nwfilters,
+                                          nwfilter->def->name))
         rc = -1;
 
     nwfilter->wantRemoved = 0;
@@ -3005,7 +3204,7 @@ virNWFilterObjAssignDef(virConnectPtr conn,
 
         nwfilter->newDef = def;
         /* trigger the update on VMs referencing the filter */
-        if (virNWFilterTriggerVMFilterRebuild(conn)) {
+        if (virNWFilterTriggerVMFilterRebuild(conn, nwfilters, def->name)) {
             nwfilter->newDef = NULL;
             virNWFilterUnlockFilterUpdates();
             virNWFilterObjUnlock(nwfilter);
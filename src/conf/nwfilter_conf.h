@@ -591,6 +591,10 @@ struct domUpdateCBStruct {
     enum UpdateStep step;
     int err;
     virHashTablePtr skipInterfaces;
+    /* Names of the filters whose trees include the changed filter;
+     * interfaces using any other filter are left alone. NULL if
+     * every interface is to be updated. */
+    virHashTablePtr affectedFilters;
 };
 
 
@@ -694,6 +698,7 @@ virNWFilterObjPtr virNWFilterObjAssignDef(virConnectPtr conn,
                                           virNWFilterDefPtr def);
 
 int virNWFilterTestUnassignDef(virConnectPtr conn,
+                               virNWFilterObjListPtr nwfilters,
                                virNWFilterObjPtr nwfilter);
 
 virNWFilterDefPtr virNWFilterDefParseNode(xmlDocPtr xml,
@@ -755,6 +760,10 @@ void virNWFilterCallbackDriversUnlock(void);
 void virNWFilterPrintTCPFlags(virBufferPtr buf, uint8_t mask,
                               char sep, uint8_t flags);
 
+bool virNWFilterRuleDefVarAccessUsedOnlyBy(virNWFilterRuleDefPtr rule,
+                                           virNWFilterVarAccessPtr varAccess,
+                                           const nwItemDesc *item);
+
 
 VIR_ENUM_DECL(virNWFilterRuleAction);
 VIR_ENUM_DECL(virNWFilterRuleDirection);
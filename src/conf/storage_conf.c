@@ -351,12 +351,17 @@ virStoragePoolDefFree(virStoragePoolDefPtr def) {
 }
 
 
+static void virStorageVolIndexFree(virStorageVolIndexPtr volindex);
+
 void
 virStoragePoolObjFree(virStoragePoolObjPtr obj) {
     if (!obj)
         return;
 
     virStoragePoolObjClearVols(obj);
+    virHashFree(obj->volumes.names);
+    virHashFree(obj->volumes.keys);
+    virHashFree(obj->volumes.paths);
 
     virStoragePoolDefFree(obj->def);
     virStoragePoolDefFree(obj->newDef);
@@ -376,6 +381,12 @@ void virStoragePoolObjListFree(virStoragePoolObjListPtr pools)
         virStoragePoolObjFree(pools->objs[i]);
     VIR_FREE(pools->objs);
     pools->count = 0;
+    virHashFree(pools->uuids);
+    virHashFree(pools->names);
+    pools->uuids = NULL;
+    pools->names = NULL;
+    virStorageVolIndexFree(pools->vols);
+    pools->vols = NULL;
 }
 
 void
@@ -389,6 +400,12 @@ virStoragePoolObjRemove(virStoragePoolObjListPtr pools,
     for (i = 0 ; i < pools->count ; i++) {
         virStoragePoolObjLock(pools->objs[i]);
         if (pools->objs[i] == pool) {
+            char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+            virUUIDFormat(pool->def->uuid, uuidstr);
+            virHashRemoveEntry(pools->uuids, uuidstr);
+            virHashRemoveEntry(pools->names, pool->def->name);
+
             virStoragePoolObjUnlock(pools->objs[i]);
             virStoragePoolObjFree(pools->objs[i]);
 
@@ -1371,31 +1388,31 @@ virStorageVolDefFormat(virStoragePoolDefPtr pool,
 virStoragePoolObjPtr
 virStoragePoolObjFindByUUID(virStoragePoolObjListPtr pools,
                             const unsigned char *uuid) {
-    unsigned int i;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virStoragePoolObjPtr pool;
 
-    for (i = 0 ; i < pools->count ; i++) {
-        virStoragePoolObjLock(pools->objs[i]);
-        if (!memcmp(pools->objs[i]->def->uuid, uuid, VIR_UUID_BUFLEN))
-            return pools->objs[i];
-        virStoragePoolObjUnlock(pools->objs[i]);
-    }
+    if (!pools->uuids)
+        return NULL;
 
-    return NULL;
+    virUUIDFormat(uuid, uuidstr);
+    if (!(pool = virHashLookup(pools->uuids, uuidstr)))
+        return NULL;
+
+    virStoragePoolObjLock(pool);
+    return pool;
 }
 
 virStoragePoolObjPtr
 virStoragePoolObjFindByName(virStoragePoolObjListPtr pools,
                             const char *name) {
-    unsigned int i;
+    virStoragePoolObjPtr pool;
 
-    for (i = 0 ; i < pools->count ; i++) {
-        virStoragePoolObjLock(pools->objs[i]);
-        if (STREQ(pools->objs[i]->def->name, name))
-            return pools->objs[i];
-        virStoragePoolObjUnlock(pools->objs[i]);
-    }
+    if (!pools->names ||
+        !(pool = virHashLookup(pools->names, name)))
+        return NULL;
 
-    return NULL;
+    virStoragePoolObjLock(pool);
+    return pool;
 }
 
 virStoragePoolObjPtr
@@ -1413,60 +1430,478 @@ virStoragePoolSourceFindDuplicateDevices(virStoragePoolObjPtr pool,
     return NULL;
 }
 
+/*
+ * An entry of a virStorageVolIndex table counts the volumes with a
+ * given key or path and remembers their pool while they all belong to
+ * the same one.
+ */
+typedef struct _virStorageVolIndexEntry virStorageVolIndexEntry;
+typedef virStorageVolIndexEntry *virStorageVolIndexEntryPtr;
+struct _virStorageVolIndexEntry {
+    size_t count;
+    virStoragePoolObjPtr pool; /* NULL if spread over several pools */
+};
+
+static void
+virStorageVolIndexEntryFree(void *payload,
+                            const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(payload);
+}
+
+static virStorageVolIndexPtr
+virStorageVolIndexNew(void)
+{
+    virStorageVolIndexPtr volindex;
+
+    if (VIR_ALLOC(volindex) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    if (virMutexInit(&volindex->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "%s", _("cannot initialize mutex"));
+        VIR_FREE(volindex);
+        return NULL;
+    }
+
+    if (!(volindex->keys = virHashCreate(50, virStorageVolIndexEntryFree)) ||
+        !(volindex->paths = virHashCreate(50, virStorageVolIndexEntryFree))) {
+        virHashFree(volindex->keys);
+        virMutexDestroy(&volindex->lock);
+        VIR_FREE(volindex);
+        return NULL;
+    }
+
+    return volindex;
+}
+
+static void
+virStorageVolIndexFree(virStorageVolIndexPtr volindex)
+{
+    if (!volindex)
+        return;
+
+    virHashFree(volindex->keys);
+    virHashFree(volindex->paths);
+    virMutexDestroy(&volindex->lock);
+    VIR_FREE(volindex);
+}
+
+static int
+virStorageVolIndexAddOne(virHashTablePtr table,
+                         const char *name,
+                         virStoragePoolObjPtr pool)
+{
+    virStorageVolIndexEntryPtr entry;
+
+    if (!(entry = virHashLookup(table, name))) {
+        if (VIR_ALLOC(entry) < 0) {
+            virReportOOMError();
+            return -1;
+        }
+        entry->pool = pool;
+        if (virHashAddEntry(table, name, entry) < 0) {
+            VIR_FREE(entry);
+            return -1;
+        }
+    } else if (entry->pool != pool) {
+        entry->pool = NULL;
+    }
+
+    entry->count++;
+    return 0;
+}
+
+static void
+virStorageVolIndexRemoveOne(virHashTablePtr table,
+                            const char *name)
+{
+    virStorageVolIndexEntryPtr entry;
+
+    if (!(entry = virHashLookup(table, name)))
+        return;
+
+    if (--entry->count == 0)
+        virHashRemoveEntry(table, name);
+}
+
+/* Add @vol of @pool to the index shared by the pools of its list */
+static int
+virStorageVolIndexAdd(virStoragePoolObjPtr pool,
+                      virStorageVolDefPtr vol)
+{
+    virStorageVolIndexPtr volindex = pool->volumes.index;
+    int ret = -1;
+
+    if (!volindex)
+        return 0;
+
+    virMutexLock(&volindex->lock);
+    if (vol->key &&
+        virStorageVolIndexAddOne(volindex->keys, vol->key, pool) < 0)
+        goto cleanup;
+
+    if (vol->target.path &&
+        virStorageVolIndexAddOne(volindex->paths, vol->target.path, pool) < 0) {
+        if (vol->key)
+            virStorageVolIndexRemoveOne(volindex->keys, vol->key);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virMutexUnlock(&volindex->lock);
+    return ret;
+}
+
+static void
+virStorageVolIndexRemove(virStoragePoolObjPtr pool,
+                         virStorageVolDefPtr vol)
+{
+    virStorageVolIndexPtr volindex = pool->volumes.index;
+
+    if (!volindex)
+        return;
+
+    virMutexLock(&volindex->lock);
+    if (vol->key)
+        virStorageVolIndexRemoveOne(volindex->keys, vol->key);
+    if (vol->target.path)
+        virStorageVolIndexRemoveOne(volindex->paths, vol->target.path);
+    virMutexUnlock(&volindex->lock);
+}
+
 void
 virStoragePoolObjClearVols(virStoragePoolObjPtr pool)
 {
     unsigned int i;
-    for (i = 0 ; i < pool->volumes.count ; i++)
+    for (i = 0 ; i < pool->volumes.count ; i++) {
+        virStorageVolIndexRemove(pool, pool->volumes.objs[i]);
         virStorageVolDefFree(pool->volumes.objs[i]);
+    }
 
     VIR_FREE(pool->volumes.objs);
     pool->volumes.count = 0;
+
+    if (pool->volumes.names)
+        virHashRemoveAll(pool->volumes.names);
+    if (pool->volumes.keys)
+        virHashRemoveAll(pool->volumes.keys);
+    if (pool->volumes.paths)
+        virHashRemoveAll(pool->volumes.paths);
+}
+
+
+/* Volume attributes which are indexed in virStorageVolDefList */
+enum {
+    VIR_STORAGE_VOL_INDEX_NAME,
+    VIR_STORAGE_VOL_INDEX_KEY,
+    VIR_STORAGE_VOL_INDEX_PATH,
+
+    VIR_STORAGE_VOL_INDEX_LAST
+};
+
+static virHashTablePtr *
+virStorageVolDefListIndex(virStorageVolDefListPtr vols,
+                          int idx)
+{
+    switch (idx) {
+    case VIR_STORAGE_VOL_INDEX_NAME:
+        return &vols->names;
+    case VIR_STORAGE_VOL_INDEX_KEY:
+        return &vols->keys;
+    case VIR_STORAGE_VOL_INDEX_PATH:
+    default:
+        return &vols->paths;
+    }
+}
+
+static const char *
+virStorageVolDefIndexKey(virStorageVolDefPtr vol,
+                         int idx)
+{
+    switch (idx) {
+    case VIR_STORAGE_VOL_INDEX_NAME:
+        return vol->name;
+    case VIR_STORAGE_VOL_INDEX_KEY:
+        return vol->key;
+    case VIR_STORAGE_VOL_INDEX_PATH:
+    default:
+        return vol->target.path;
+    }
+}
+
+/*
+ * Drop the index entries which point to @vol.  If another volume in
+ * the list shares the same name, key or path (for example several SCSI
+ * LUNs reporting the same serial), it takes over the index entry so
+ * lookups keep returning the first matching volume in the list.
+ */
+static void
+virStorageVolDefListUnindex(virStorageVolDefListPtr vols,
+                            virStorageVolDefPtr vol)
+{
+    int idx;
+    unsigned int i;
+
+    for (idx = 0 ; idx < VIR_STORAGE_VOL_INDEX_LAST ; idx++) {
+        virHashTablePtr table = *virStorageVolDefListIndex(vols, idx);
+        const char *key = virStorageVolDefIndexKey(vol, idx);
+
+        if (!table || !key || virHashLookup(table, key) != vol)
+            continue;
+
+        virHashRemoveEntry(table, key);
+
+        for (i = 0 ; i < vols->count ; i++) {
+            const char *other;
+
+            if (vols->objs[i] == vol)
+                continue;
+
+            other = virStorageVolDefIndexKey(vols->objs[i], idx);
+            if (other && STREQ(other, key)) {
+                ignore_value(virHashAddEntry(table, key, vols->objs[i]));
+                break;
+            }
+        }
+    }
+}
+
+static int
+virStorageVolDefListIndexVol(virStorageVolDefListPtr vols,
+                             virStorageVolDefPtr vol)
+{
+    int idx;
+
+    for (idx = 0 ; idx < VIR_STORAGE_VOL_INDEX_LAST ; idx++) {
+        virHashTablePtr *table = virStorageVolDefListIndex(vols, idx);
+        const char *key = virStorageVolDefIndexKey(vol, idx);
+
+        if (!*table && !(*table = virHashCreate(50, NULL)))
+            goto error;
+
+        /* Keep the first volume registered under a given key */
+        if (!key || virHashLookup(*table, key))
+            continue;
+
+        if (virHashAddEntry(*table, key, vol) < 0)
+            goto error;
+    }
+
+    return 0;
+
+error:
+    virStorageVolDefListUnindex(vols, vol);
+    return -1;
+}
+
+/*
+ * virStoragePoolObjAddVol:
+ *
+ * Append @vol to the volumes of @pool, which must be locked, and add it
+ * to the lookup indexes.  The name, key and target path of @vol must
+ * already be filled in and must not change while it is in the list.
+ * On success the pool takes ownership of @vol.
+ *
+ * Returns 0 on success, -1 on error (with @pool left unchanged).
+ */
+int
+virStoragePoolObjAddVol(virStoragePoolObjPtr pool,
+                        virStorageVolDefPtr vol)
+{
+    virStorageVolDefListPtr vols = &pool->volumes;
+
+    if (VIR_REALLOC_N(vols->objs, vols->count + 1) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (virStorageVolDefListIndexVol(vols, vol) < 0)
+        return -1;
+
+    if (virStorageVolIndexAdd(pool, vol) < 0) {
+        virStorageVolDefListUnindex(vols, vol);
+        return -1;
+    }
+
+    vols->objs[vols->count++] = vol;
+    return 0;
+}
+
+/*
+ * virStoragePoolObjRemoveVol:
+ *
+ * Remove @vol from the volumes of @pool, which must be locked.  The
+ * caller gets back ownership of @vol.
+ */
+void
+virStoragePoolObjRemoveVol(virStoragePoolObjPtr pool,
+                           virStorageVolDefPtr vol)
+{
+    virStorageVolDefListPtr vols = &pool->volumes;
+    unsigned int i;
+
+    for (i = 0 ; i < vols->count ; i++) {
+        if (vols->objs[i] != vol)
+            continue;
+
+        if (i < (vols->count - 1))
+            memmove(vols->objs + i, vols->objs + i + 1,
+                    sizeof(*(vols->objs)) * (vols->count - (i + 1)));
+
+        if (VIR_REALLOC_N(vols->objs, vols->count - 1) < 0) {
+            ; /* Failure to reduce memory allocation isn't fatal */
+        }
+        vols->count--;
+
+        virStorageVolDefListUnindex(vols, vol);
+        virStorageVolIndexRemove(pool, vol);
+        break;
+    }
 }
 
 virStorageVolDefPtr
 virStorageVolDefFindByKey(virStoragePoolObjPtr pool,
                           const char *key) {
-    unsigned int i;
-
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->key, key))
-            return pool->volumes.objs[i];
+    if (!pool->volumes.keys)
+        return NULL;
 
-    return NULL;
+    return virHashLookup(pool->volumes.keys, key);
 }
 
 virStorageVolDefPtr
 virStorageVolDefFindByPath(virStoragePoolObjPtr pool,
                            const char *path) {
+    if (!pool->volumes.paths)
+        return NULL;
+
+    return virHashLookup(pool->volumes.paths, path);
+}
+
+/*
+ * Find the volume with key or target path @name, depending on @paths,
+ * among the active pools of @pools.  The shared index answers a
+ * lookup without a match, and points straight at the pool if only one
+ * holds such a volume; otherwise the pools are probed in list order.
+ */
+static virStorageVolDefPtr
+virStoragePoolObjListFindVol(virStoragePoolObjListPtr pools,
+                             const char *name,
+                             bool paths,
+                             virStoragePoolObjPtr *pool)
+{
+    virStorageVolDefPtr (*find)(virStoragePoolObjPtr, const char *) =
+        paths ? virStorageVolDefFindByPath : virStorageVolDefFindByKey;
+    virStoragePoolObjPtr hint = NULL;
+    virStorageVolDefPtr vol;
     unsigned int i;
 
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->target.path, path))
-            return pool->volumes.objs[i];
+    if (pools->vols) {
+        virStorageVolIndexEntryPtr entry;
+        bool found;
+
+        virMutexLock(&pools->vols->lock);
+        entry = virHashLookup(paths ? pools->vols->paths : pools->vols->keys,
+                              name);
+        found = entry != NULL;
+        if (entry)
+            hint = entry->pool;
+        virMutexUnlock(&pools->vols->lock);
+
+        if (!found)
+            return NULL;
+    }
+
+    if (hint) {
+        virStoragePoolObjLock(hint);
+        if (virStoragePoolObjIsActive(hint) &&
+            (vol = find(hint, name))) {
+            *pool = hint;
+            return vol;
+        }
+        virStoragePoolObjUnlock(hint);
+    }
+
+    for (i = 0 ; i < pools->count ; i++) {
+        virStoragePoolObjLock(pools->objs[i]);
+        if (virStoragePoolObjIsActive(pools->objs[i]) &&
+            (vol = find(pools->objs[i], name))) {
+            *pool = pools->objs[i];
+            return vol;
+        }
+        virStoragePoolObjUnlock(pools->objs[i]);
+    }
 
     return NULL;
 }
 
+/*
+ * virStoragePoolObjListFindVolByKey:
+ *
+ * Find the volume with key @key among the active pools of @pools,
+ * which the caller must keep from changing.  On success the pool
+ * holding the volume is returned locked in @pool.
+ */
+virStorageVolDefPtr
+virStoragePoolObjListFindVolByKey(virStoragePoolObjListPtr pools,
+                                  const char *key,
+                                  virStoragePoolObjPtr *pool)
+{
+    return virStoragePoolObjListFindVol(pools, key, false, pool);
+}
+
+/*
+ * virStoragePoolObjListFindVolByPath:
+ *
+ * Same as virStoragePoolObjListFindVolByKey for the target path @path.
+ */
+virStorageVolDefPtr
+virStoragePoolObjListFindVolByPath(virStoragePoolObjListPtr pools,
+                                   const char *path,
+                                   virStoragePoolObjPtr *pool)
+{
+    return virStoragePoolObjListFindVol(pools, path, true, pool);
+}
+
 virStorageVolDefPtr
 virStorageVolDefFindByName(virStoragePoolObjPtr pool,
                            const char *name) {
-    unsigned int i;
-
-    for (i = 0 ; i < pool->volumes.count ; i++)
-        if (STREQ(pool->volumes.objs[i]->name, name))
-            return pool->volumes.objs[i];
+    if (!pool->volumes.names)
+        return NULL;
 
-    return NULL;
+    return virHashLookup(pool->volumes.names, name);
 }
 
 virStoragePoolObjPtr
 virStoragePoolObjAssignDef(virStoragePoolObjListPtr pools,
                            virStoragePoolDefPtr def) {
     virStoragePoolObjPtr pool;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
 
     if ((pool = virStoragePoolObjFindByName(pools, def->name))) {
         if (!virStoragePoolObjIsActive(pool)) {
+            /* Keep the UUID index in sync if the new definition
+             * carries a different UUID */
+            if (memcmp(pool->def->uuid, def->uuid, VIR_UUID_BUFLEN) != 0) {
+                virUUIDFormat(def->uuid, uuidstr);
+                if (virHashLookup(pools->uuids, uuidstr)) {
+                    virReportError(VIR_ERR_OPERATION_FAILED,
+                                   _("pool with uuid %s is already defined"),
+                                   uuidstr);
+                    virStoragePoolObjUnlock(pool);
+                    return NULL;
+                }
+                if (virHashAddEntry(pools->uuids, uuidstr, pool) < 0) {
+                    virStoragePoolObjUnlock(pool);
+                    return NULL;
+                }
+                virUUIDFormat(pool->def->uuid, uuidstr);
+                virHashRemoveEntry(pools->uuids, uuidstr);
+            }
             virStoragePoolDefFree(pool->def);
             pool->def = def;
         } else {
@@ -1492,15 +1927,41 @@ virStoragePoolObjAssignDef(virStoragePoolObjListPtr pools,
     pool->def = def;
 
     if (VIR_REALLOC_N(pools->objs, pools->count+1) < 0) {
-        pool->def = NULL;
-        virStoragePoolObjUnlock(pool);
-        virStoragePoolObjFree(pool);
         virReportOOMError();
-        return NULL;
+        goto error;
+    }
+
+    if (!pools->vols && !(pools->vols = virStorageVolIndexNew()))
+        goto error;
+    pool->volumes.index = pools->vols;
+
+    if ((!pools->uuids && !(pools->uuids = virHashCreate(20, NULL))) ||
+        (!pools->names && !(pools->names = virHashCreate(20, NULL))))
+        goto error;
+
+    virUUIDFormat(def->uuid, uuidstr);
+    if (virHashLookup(pools->uuids, uuidstr)) {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("pool with uuid %s is already defined"), uuidstr);
+        goto error;
+    }
+
+    if (virHashAddEntry(pools->uuids, uuidstr, pool) < 0)
+        goto error;
+    if (virHashAddEntry(pools->names, def->name, pool) < 0) {
+        virHashRemoveEntry(pools->uuids, uuidstr);
+        goto error;
     }
+
     pools->objs[pools->count++] = pool;
 
     return pool;
+
+error:
+    pool->def = NULL;
+    virStoragePoolObjUnlock(pool);
+    virStoragePoolObjFree(pool);
+    return NULL;
 }
 
 static virStoragePoolObjPtr
@@ -1859,3 +2320,150 @@ void virStoragePoolObjUnlock(virStoragePoolObjPtr obj)
 {
     virMutexUnlock(&obj->lock);
 }
+
+
+verify(VIR_CONNECT_LIST_STORAGE_POOLS_SHEEPDOG ==
+       VIR_CONNECT_LIST_STORAGE_POOLS_DIR << VIR_STORAGE_POOL_SHEEPDOG);
+
+#define MATCH(FLAG) (flags & (FLAG))
+static bool
+virStoragePoolMatch(virStoragePoolObjPtr poolobj,
+                    unsigned int flags)
+{
+    /* filter by active state */
+    if (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ACTIVE) &&
+        !((MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_ACTIVE) &&
+           virStoragePoolObjIsActive(poolobj)) ||
+          (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_INACTIVE) &&
+           !virStoragePoolObjIsActive(poolobj))))
+        return false;
+
+    /* filter by persistence */
+    if (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_PERSISTENT) &&
+        !((MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_PERSISTENT) &&
+           poolobj->configFile) ||
+          (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_TRANSIENT) &&
+           !poolobj->configFile)))
+        return false;
+
+    /* filter by autostart option */
+    if (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_AUTOSTART) &&
+        !((MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_AUTOSTART) &&
+           poolobj->autostart) ||
+          (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_NO_AUTOSTART) &&
+           !poolobj->autostart)))
+        return false;
+
+    /* filter by pool type; the type flags are ordered the same way
+     * as enum virStoragePoolType */
+    if (MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_POOL_TYPE) &&
+        !MATCH(VIR_CONNECT_LIST_STORAGE_POOLS_DIR << poolobj->def->type))
+        return false;
+
+    return true;
+}
+#undef MATCH
+
+int
+virStoragePoolList(virConnectPtr conn,
+                   virStoragePoolObjListPtr poolobjs,
+                   virStoragePoolPtr **pools,
+                   unsigned int flags)
+{
+    virStoragePoolPtr *tmp_pools = NULL;
+    virStoragePoolPtr pool = NULL;
+    int npools = 0;
+    int ret = -1;
+    int i;
+
+    if (pools) {
+        if (VIR_ALLOC_N(tmp_pools, poolobjs->count + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+    }
+
+    for (i = 0 ; i < poolobjs->count ; i++) {
+        virStoragePoolObjPtr poolobj = poolobjs->objs[i];
+        virStoragePoolObjLock(poolobj);
+        if (virStoragePoolMatch(poolobj, flags)) {
+            if (pools) {
+                if (!(pool = virGetStoragePool(conn,
+                                               poolobj->def->name,
+                                               poolobj->def->uuid))) {
+                    virStoragePoolObjUnlock(poolobj);
+                    goto cleanup;
+                }
+                tmp_pools[npools] = pool;
+            }
+            npools++;
+        }
+        virStoragePoolObjUnlock(poolobj);
+    }
+
+    if (tmp_pools) {
+        /* trim the array to the final size */
+        ignore_value(VIR_REALLOC_N(tmp_pools, npools + 1));
+        *pools = tmp_pools;
+        tmp_pools = NULL;
+    }
+
+    ret = npools;
+
+cleanup:
+    if (tmp_pools) {
+        for (i = 0 ; i < npools ; i++) {
+            if (tmp_pools[i])
+                virStoragePoolFree(tmp_pools[i]);
+        }
+    }
+
+    VIR_FREE(tmp_pools);
+    return ret;
+}
+
+/*
+ * virStoragePoolObjListVolumes:
+ *
+ * Build an array of volume objects for every volume of @pool, which
+ * must be locked by the caller.  If @vols is NULL only the number of
+ * volumes is returned.
+ */
+int
+virStoragePoolObjListVolumes(virConnectPtr conn,
+                             virStoragePoolObjPtr pool,
+                             virStorageVolPtr **vols)
+{
+    virStorageVolPtr *tmp_vols = NULL;
+    int nvols = 0;
+    int ret = -1;
+    int i;
+
+    if (!vols)
+        return pool->volumes.count;
+
+    if (VIR_ALLOC_N(tmp_vols, pool->volumes.count + 1) < 0) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    for (i = 0 ; i < pool->volumes.count ; i++) {
+        virStorageVolDefPtr def = pool->volumes.objs[i];
+        if (!(tmp_vols[nvols] = virGetStorageVol(conn, pool->def->name,
+                                                 def->name, def->key)))
+            goto cleanup;
+        nvols++;
+    }
+
+    *vols = tmp_vols;
+    tmp_vols = NULL;
+    ret = nvols;
+
+cleanup:
+    if (tmp_vols) {
+        for (i = 0 ; i < nvols ; i++)
+            virStorageVolFree(tmp_vols[i]);
+        VIR_FREE(tmp_vols);
+    }
+    return ret;
+}
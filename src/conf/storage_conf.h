@@ -28,8 +28,11 @@
 # include "util.h"
 # include "storage_encryption_conf.h"
 # include "threads.h"
+# include "virhash.h"
 
 # include <libxml/tree.h>
+# include <sys/types.h>
+# include <time.h>
 
 /* Shared structs */
 
@@ -83,6 +86,21 @@ struct _virStorageVolTarget {
 };
 
 
+/*
+ * Identity of the file backing a volume at the time it was last
+ * probed, so file based pools can skip re-probing unchanged files
+ */
+typedef struct _virStorageVolStamp virStorageVolStamp;
+typedef virStorageVolStamp *virStorageVolStampPtr;
+struct _virStorageVolStamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    time_t ctime;
+    time_t probed; /* 0 if the volume was never probed */
+};
+
 typedef struct _virStorageVolDef virStorageVolDef;
 typedef virStorageVolDef *virStorageVolDefPtr;
 struct _virStorageVolDef {
@@ -98,6 +116,22 @@ struct _virStorageVolDef {
     virStorageVolSource source;
     virStorageVolTarget target;
     virStorageVolTarget backingStore;
+
+    virStorageVolStamp stamp;
+};
+
+/*
+ * Index of the volume keys and target paths of all pools in a
+ * virStoragePoolObjList, so a lookup by key or path need not probe
+ * every pool.  Volumes are added and removed under the lock of their
+ * own pool only, hence the mutex.
+ */
+typedef struct _virStorageVolIndex virStorageVolIndex;
+typedef virStorageVolIndex *virStorageVolIndexPtr;
+struct _virStorageVolIndex {
+    virMutex lock;
+    virHashTablePtr keys;
+    virHashTablePtr paths;
 };
 
 typedef struct _virStorageVolDefList virStorageVolDefList;
@@ -105,6 +139,15 @@ typedef virStorageVolDefList *virStorageVolDefListPtr;
 struct _virStorageVolDefList {
     unsigned int count;
     virStorageVolDefPtr *objs;
+
+    /* Lookup indexes over @objs, keyed by volume name, key and
+     * target path.  They do not own their payloads. */
+    virHashTablePtr names;
+    virHashTablePtr keys;
+    virHashTablePtr paths;
+
+    /* Shared with the other pools of the list the pool belongs to */
+    virStorageVolIndexPtr index;
 };
 
 
@@ -307,6 +350,13 @@ typedef virStoragePoolObjList *virStoragePoolObjListPtr;
 struct _virStoragePoolObjList {
     unsigned int count;
     virStoragePoolObjPtr *objs;
+
+    /* Lookup indexes over @objs, keyed by pool UUID string and
+     * pool name.  They do not own their payloads. */
+    virHashTablePtr uuids;
+    virHashTablePtr names;
+    /* Keys and target paths of the volumes of all pools */
+    virStorageVolIndexPtr vols;
 };
 
 
@@ -352,10 +402,20 @@ virStorageVolDefPtr virStorageVolDefFindByKey(virStoragePoolObjPtr pool,
                                               const char *key);
 virStorageVolDefPtr virStorageVolDefFindByPath(virStoragePoolObjPtr pool,
                                                const char *path);
+virStorageVolDefPtr virStoragePoolObjListFindVolByKey(virStoragePoolObjListPtr pools,
+                                                      const char *key,
+                                                      virStoragePoolObjPtr *pool);
+virStorageVolDefPtr virStoragePoolObjListFindVolByPath(virStoragePoolObjListPtr pools,
+                                                       const char *path,
+                                                       virStoragePoolObjPtr *pool);
 virStorageVolDefPtr virStorageVolDefFindByName(virStoragePoolObjPtr pool,
                                                const char *name);
 
 void virStoragePoolObjClearVols(virStoragePoolObjPtr pool);
+int virStoragePoolObjAddVol(virStoragePoolObjPtr pool,
+                            virStorageVolDefPtr vol);
+void virStoragePoolObjRemoveVol(virStoragePoolObjPtr pool,
+                                virStorageVolDefPtr vol);
 
 virStoragePoolDefPtr virStoragePoolDefParseString(const char *xml);
 virStoragePoolDefPtr virStoragePoolDefParseFile(const char *filename);
@@ -407,6 +467,45 @@ int virStoragePoolSourceFindDuplicate(virStoragePoolObjListPtr pools,
 void virStoragePoolObjLock(virStoragePoolObjPtr obj);
 void virStoragePoolObjUnlock(virStoragePoolObjPtr obj);
 
+# define VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ACTIVE   \
+                (VIR_CONNECT_LIST_STORAGE_POOLS_ACTIVE | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_INACTIVE)
+
+# define VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_PERSISTENT   \
+                (VIR_CONNECT_LIST_STORAGE_POOLS_PERSISTENT | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_TRANSIENT)
+
+# define VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_AUTOSTART    \
+                (VIR_CONNECT_LIST_STORAGE_POOLS_AUTOSTART |  \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_NO_AUTOSTART)
+
+# define VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_POOL_TYPE  \
+                (VIR_CONNECT_LIST_STORAGE_POOLS_DIR      | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_FS       | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_NETFS    | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_LOGICAL  | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_DISK     | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_ISCSI    | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_SCSI     | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_MPATH    | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_RBD      | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_SHEEPDOG)
+
+# define VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ALL                  \
+                (VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ACTIVE     | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_PERSISTENT | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_AUTOSTART  | \
+                 VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_POOL_TYPE)
+
+int virStoragePoolList(virConnectPtr conn,
+                       virStoragePoolObjListPtr poolobjs,
+                       virStoragePoolPtr **pools,
+                       unsigned int flags);
+
+int virStoragePoolObjListVolumes(virConnectPtr conn,
+                                 virStoragePoolObjPtr pool,
+                                 virStorageVolPtr **vols);
+
 
 enum virStoragePoolFormatFileSystem {
     VIR_STORAGE_POOL_FS_AUTO = 0,
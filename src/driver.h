@@ -393,6 +393,52 @@ typedef int
                     (virDomainPtr domain,
                      const char *path,
                      struct _virDomainInterfaceStats *stats);
+typedef int
+    (*virDrvDomainLookupByNameAsync)
+                    (virConnectPtr conn,
+                     const char *name,
+                     virDomainPtr *dom,
+                     virConnectAsyncCallback cb,
+                     void *opaque,
+                     virFreeCallback freecb,
+                     unsigned int flags);
+typedef int
+    (*virDrvDomainLookupByUUIDAsync)
+                    (virConnectPtr conn,
+                     const unsigned char *uuid,
+                     virDomainPtr *dom,
+                     virConnectAsyncCallback cb,
+                     void *opaque,
+                     virFreeCallback freecb,
+                     unsigned int flags);
+typedef int
+    (*virDrvDomainGetInfoAsync)
+                    (virDomainPtr domain,
+                     virDomainInfoPtr info,
+                     virConnectAsyncCallback cb,
+                     void *opaque,
+                     virFreeCallback freecb,
+                     unsigned int flags);
+typedef int
+    (*virDrvDomainBlockStatsAsync)
+                    (virDomainPtr domain,
+                     const char *path,
+                     virDomainBlockStatsPtr stats,
+                     size_t size,
+                     virConnectAsyncCallback cb,
+                     void *opaque,
+                     virFreeCallback freecb,
+                     unsigned int flags);
+typedef int
+    (*virDrvDomainInterfaceStatsAsync)
+                    (virDomainPtr domain,
+                     const char *path,
+                     virDomainInterfaceStatsPtr stats,
+                     size_t size,
+                     virConnectAsyncCallback cb,
+                     void *opaque,
+                     virFreeCallback freecb,
+                     unsigned int flags);
 typedef int
     (*virDrvDomainSetInterfaceParameters) (virDomainPtr dom,
                                           const char *device,
@@ -970,6 +1016,11 @@ struct _virDriver {
     virDrvDomainBlockStats              domainBlockStats;
     virDrvDomainBlockStatsFlags         domainBlockStatsFlags;
     virDrvDomainInterfaceStats          domainInterfaceStats;
+    virDrvDomainLookupByNameAsync       domainLookupByNameAsync;
+    virDrvDomainLookupByUUIDAsync       domainLookupByUUIDAsync;
+    virDrvDomainGetInfoAsync            domainGetInfoAsync;
+    virDrvDomainBlockStatsAsync         domainBlockStatsAsync;
+    virDrvDomainInterfaceStatsAsync     domainInterfaceStatsAsync;
     virDrvDomainSetInterfaceParameters  domainSetInterfaceParameters;
     virDrvDomainGetInterfaceParameters  domainGetInterfaceParameters;
     virDrvDomainMemoryStats             domainMemoryStats;
@@ -1231,6 +1282,10 @@ typedef int
     (*virDrvConnectListDefinedStoragePools)  (virConnectPtr conn,
                                               char **const names,
                                               int maxnames);
+typedef int
+    (*virDrvConnectListAllStoragePools)      (virConnectPtr conn,
+                                              virStoragePoolPtr **pools,
+                                              unsigned int flags);
 typedef char *
     (*virDrvConnectFindStoragePoolSources)   (virConnectPtr conn,
                                               const char *type,
@@ -1286,6 +1341,10 @@ typedef int
     (*virDrvStoragePoolListVolumes)          (virStoragePoolPtr pool,
                                               char **const names,
                                               int maxnames);
+typedef int
+    (*virDrvStoragePoolListAllVolumes)       (virStoragePoolPtr pool,
+                                              virStorageVolPtr **vols,
+                                              unsigned int flags);
 
 
 typedef virStorageVolPtr
@@ -1375,6 +1434,7 @@ struct _virStorageDriver {
     virDrvConnectListStoragePools           listPools;
     virDrvConnectNumOfDefinedStoragePools   numOfDefinedPools;
     virDrvConnectListDefinedStoragePools    listDefinedPools;
+    virDrvConnectListAllStoragePools        listAllPools;
     virDrvConnectFindStoragePoolSources     findPoolSources;
     virDrvStoragePoolLookupByName           poolLookupByName;
     virDrvStoragePoolLookupByUUID           poolLookupByUUID;
@@ -1393,6 +1453,7 @@ struct _virStorageDriver {
     virDrvStoragePoolSetAutostart           poolSetAutostart;
     virDrvStoragePoolNumOfVolumes           poolNumOfVolumes;
     virDrvStoragePoolListVolumes            poolListVolumes;
+    virDrvStoragePoolListAllVolumes         poolListAllVolumes;
 
     virDrvStorageVolLookupByName            volLookupByName;
     virDrvStorageVolLookupByKey             volLookupByKey;
@@ -1444,6 +1505,10 @@ typedef int (*virDevMonListDevices)(virConnectPtr conn,
                                     int maxnames,
                                     unsigned int flags);
 
+typedef int (*virDevMonListAllNodeDevices)(virConnectPtr conn,
+                                           virNodeDevicePtr **devices,
+                                           unsigned int flags);
+
 typedef virNodeDevicePtr (*virDevMonDeviceLookupByName)(virConnectPtr conn,
                                                         const char *name);
 
@@ -1476,6 +1541,7 @@ struct _virDeviceMonitor {
     virDrvClose                 close;
     virDevMonNumOfDevices       numOfDevices;
     virDevMonListDevices        listDevices;
+    virDevMonListAllNodeDevices listAllNodeDevices;
     virDevMonDeviceLookupByName deviceLookupByName;
     virDevMonDeviceGetXMLDesc   deviceGetXMLDesc;
     virDevMonDeviceGetParent    deviceGetParent;
@@ -1594,12 +1594,10 @@ esxDomainLookupByID(virConnectPtr conn, int id)
 {
     esxPrivate *priv = conn->privateData;
     esxVI_String *propertyNameList = NULL;
-    esxVI_ObjectContent *virtualMachineList = NULL;
     esxVI_ObjectContent *virtualMachine = NULL;
     esxVI_VirtualMachinePowerState powerState;
-    int id_candidate = -1;
-    char *name_candidate = NULL;
-    unsigned char uuid_candidate[VIR_UUID_BUFLEN];
+    char *name = NULL;
+    unsigned char uuid[VIR_UUID_BUFLEN];
     virDomainPtr domain = NULL;
 
     if (esxVI_EnsureSession(priv->primary) < 0) {
@@ -1611,54 +1609,44 @@ esxDomainLookupByID(virConnectPtr conn, int id)
                                            "name\0"
                                            "runtime.powerState\0"
                                            "config.uuid\0") < 0 ||
-        esxVI_LookupVirtualMachineList(priv->primary, propertyNameList,
-                                       &virtualMachineList) < 0) {
+        esxVI_LookupVirtualMachineByID(priv->primary, id, propertyNameList,
+                                       &virtualMachine,
+                                       esxVI_Occurrence_OptionalItem) < 0) {
         goto cleanup;
     }
 
-    for (virtualMachine = virtualMachineList; virtualMachine != NULL;
-         virtualMachine = virtualMachine->_next) {
-        if (esxVI_GetVirtualMachinePowerState(virtualMachine,
-                                              &powerState) < 0) {
-            goto cleanup;
-        }
-
-        /* Only running/suspended domains have an ID != -1 */
-        if (powerState == esxVI_VirtualMachinePowerState_PoweredOff) {
-            continue;
-        }
-
-        VIR_FREE(name_candidate);
-
-        if (esxVI_GetVirtualMachineIdentity(virtualMachine,
-                                            &id_candidate, &name_candidate,
-                                            uuid_candidate) < 0) {
-            goto cleanup;
-        }
-
-        if (id != id_candidate) {
-            continue;
-        }
-
-        domain = virGetDomain(conn, name_candidate, uuid_candidate);
+    if (virtualMachine == NULL) {
+        virReportError(VIR_ERR_NO_DOMAIN, _("No domain with ID %d"), id);
+        goto cleanup;
+    }
 
-        if (domain == NULL) {
-            goto cleanup;
-        }
+    if (esxVI_GetVirtualMachinePowerState(virtualMachine, &powerState) < 0) {
+        goto cleanup;
+    }
 
-        domain->id = id;
+    /* Only running/suspended domains have an ID != -1 */
+    if (powerState == esxVI_VirtualMachinePowerState_PoweredOff) {
+        virReportError(VIR_ERR_NO_DOMAIN, _("No domain with ID %d"), id);
+        goto cleanup;
+    }
 
-        break;
+    if (esxVI_GetVirtualMachineIdentity(virtualMachine, NULL, &name,
+                                        uuid) < 0) {
+        goto cleanup;
     }
 
+    domain = virGetDomain(conn, name, uuid);
+
     if (domain == NULL) {
-        virReportError(VIR_ERR_NO_DOMAIN, _("No domain with ID %d"), id);
+        goto cleanup;
     }
 
+    domain->id = id;
+
   cleanup:
     esxVI_String_Free(&propertyNameList);
-    esxVI_ObjectContent_Free(&virtualMachineList);
-    VIR_FREE(name_candidate);
+    esxVI_ObjectContent_Free(&virtualMachine);
+    VIR_FREE(name);
 
     return domain;
 }
@@ -41,6 +41,15 @@
 
 
 
+/*
+ * Number of seconds for which a successfully checked session is trusted
+ * without asking the server again. Sessions only expire after a long
+ * idle period, so this just saves a round trip per API call.
+ */
+#define ESX_VI__SESSION__CHECK_INTERVAL 30
+
+
+
 #define ESX_VI__SOAP__RESPONSE_XPATH(_type)                                   \
     ((char *)"/soapenv:Envelope/soapenv:Body/"                                \
                "vim:"_type"Response/vim:returnval")
@@ -754,6 +763,12 @@ esxVI_MultiCURL_Remove(esxVI_MultiCURL *multi, esxVI_CURL *curl)
  */
 
 /* esxVI_Context_Alloc */
+static void
+esxVI_FreeCacheEntry(void *payload, const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(payload);
+}
+
 ESX_VI__TEMPLATE__ALLOC(Context)
 
 /* esxVI_Context_Free */
@@ -763,6 +778,10 @@ ESX_VI__TEMPLATE__FREE(Context,
         virMutexDestroy(item->sessionLock);
     }
 
+    if (item->vmCacheLock != NULL) {
+        virMutexDestroy(item->vmCacheLock);
+    }
+
     esxVI_CURL_Free(&item->curl);
     VIR_FREE(item->url);
     VIR_FREE(item->ipAddress);
@@ -771,6 +790,10 @@ ESX_VI__TEMPLATE__FREE(Context,
     esxVI_ServiceContent_Free(&item->service);
     esxVI_UserSession_Free(&item->session);
     VIR_FREE(item->sessionLock);
+    virHashFree(item->vmByUuid);
+    virHashFree(item->vmByName);
+    virHashFree(item->vmById);
+    VIR_FREE(item->vmCacheLock);
     esxVI_Datacenter_Free(&item->datacenter);
     VIR_FREE(item->datacenterPath);
     esxVI_ComputeResource_Free(&item->computeResource);
@@ -814,6 +837,25 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
     if (virMutexInit(ctx->sessionLock) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Could not initialize session mutex"));
+        VIR_FREE(ctx->sessionLock);
+        return -1;
+    }
+
+    if (VIR_ALLOC(ctx->vmCacheLock) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (virMutexInit(ctx->vmCacheLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not initialize cache mutex"));
+        VIR_FREE(ctx->vmCacheLock);
+        return -1;
+    }
+
+    if ((ctx->vmByUuid = virHashCreate(64, esxVI_FreeCacheEntry)) == NULL ||
+        (ctx->vmByName = virHashCreate(64, esxVI_FreeCacheEntry)) == NULL ||
+        (ctx->vmById = virHashCreate(64, esxVI_FreeCacheEntry)) == NULL) {
         return -1;
     }
 
@@ -1954,6 +1996,12 @@ esxVI_EnsureSession(esxVI_Context *ctx)
         goto cleanup;
     }
 
+    if (ctx->sessionCheckTime != 0 &&
+        time(NULL) - ctx->sessionCheckTime < ESX_VI__SESSION__CHECK_INTERVAL) {
+        result = 0;
+        goto cleanup;
+    }
+
     if (ctx->hasSessionIsActive) {
         /*
          * Use SessionIsActive to check if there is an active session for this
@@ -2015,6 +2063,8 @@ esxVI_EnsureSession(esxVI_Context *ctx)
         }
     }
 
+    ctx->sessionCheckTime = time(NULL);
+
     result = 0;
 
   cleanup:
@@ -2741,17 +2791,278 @@ esxVI_LookupHostSystemProperties(esxVI_Context *ctx,
 
 
 
+/*
+ * Remember the managed object behind @virtualMachine under its ID and,
+ * if the respective properties were retrieved, its name and UUID. This
+ * lets later lookups fetch a single virtual machine directly instead of
+ * searching through the whole list. Cached entries are only hints and
+ * are verified against the retrieved properties on use.
+ */
+static void
+esxVI_CacheVirtualMachine(esxVI_Context *ctx,
+                          esxVI_ObjectContent *virtualMachine)
+{
+    esxVI_DynamicProperty *dynamicProperty;
+    const char *uuid_string = NULL;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    char uuid_key[VIR_UUID_STRING_BUFLEN];
+    char *name = NULL;
+    char *id_key = NULL;
+    int id;
+    char *value;
+
+    if (ctx->vmCacheLock == NULL ||
+        STRNEQ(virtualMachine->obj->type, "VirtualMachine")) {
+        return;
+    }
+
+    for (dynamicProperty = virtualMachine->propSet; dynamicProperty != NULL;
+         dynamicProperty = dynamicProperty->_next) {
+        if (STREQ(dynamicProperty->name, "config.uuid") &&
+            dynamicProperty->val->type == esxVI_Type_String) {
+            uuid_string = dynamicProperty->val->string;
+        } else if (STREQ(dynamicProperty->name, "name") &&
+                   dynamicProperty->val->type == esxVI_Type_String &&
+                   name == NULL) {
+            name = strdup(dynamicProperty->val->string);
+
+            if (name != NULL && virVMXUnescapeHexPercent(name) < 0) {
+                VIR_FREE(name);
+            }
+        }
+    }
+
+    if (esxUtil_ParseVirtualMachineIDString(virtualMachine->obj->value,
+                                            &id) == 0 &&
+        virAsprintf(&id_key, "%d", id) < 0) {
+        id_key = NULL;
+    }
+
+    virMutexLock(ctx->vmCacheLock);
+
+    if (uuid_string != NULL && virUUIDParse(uuid_string, uuid) == 0 &&
+        (value = strdup(virtualMachine->obj->value)) != NULL) {
+        virUUIDFormat(uuid, uuid_key);
+
+        if (virHashUpdateEntry(ctx->vmByUuid, uuid_key, value) < 0) {
+            VIR_FREE(value);
+        }
+    }
+
+    if (name != NULL && (value = strdup(virtualMachine->obj->value)) != NULL &&
+        virHashUpdateEntry(ctx->vmByName, name, value) < 0) {
+        VIR_FREE(value);
+    }
+
+    if (id_key != NULL && (value = strdup(virtualMachine->obj->value)) != NULL &&
+        virHashUpdateEntry(ctx->vmById, id_key, value) < 0) {
+        VIR_FREE(value);
+    }
+
+    virMutexUnlock(ctx->vmCacheLock);
+
+    /* Failing to cache is not an error, the next lookup is just slower */
+    virResetLastError();
+
+    VIR_FREE(name);
+    VIR_FREE(id_key);
+}
+
+
+
+static void
+esxVI_UncacheVirtualMachine(esxVI_Context *ctx, virHashTablePtr table,
+                            const char *key)
+{
+    virMutexLock(ctx->vmCacheLock);
+    virHashRemoveEntry(table, key);
+    virMutexUnlock(ctx->vmCacheLock);
+}
+
+
+
+/*
+ * Fetch the virtual machine cached under @key in @table directly. Unless
+ * it is NULL, the @checkProperty is added to the retrieved properties if
+ * necessary and must equal @key after being passed through @normalize,
+ * otherwise the entry is stale and dropped. On a miss *virtualMachine
+ * stays NULL.
+ */
+static int
+esxVI_LookupCachedVirtualMachine(esxVI_Context *ctx, virHashTablePtr table,
+                                 const char *key, const char *checkProperty,
+                                 int (*normalize)(const char *value,
+                                                  char **normalized),
+                                 esxVI_String *propertyNameList,
+                                 esxVI_ObjectContent **virtualMachine)
+{
+    int result = -1;
+    char *value = NULL;
+    esxVI_ManagedObjectReference *managedObjectReference = NULL;
+    esxVI_String *completePropertyNameList = NULL;
+    esxVI_String *propertyName;
+    bool addedProperty = checkProperty != NULL;
+    esxVI_DynamicProperty **dynamicProperty;
+    esxVI_DynamicProperty *checkValue = NULL;
+    char *normalized = NULL;
+
+    virMutexLock(ctx->vmCacheLock);
+    value = virHashLookup(table, key);
+
+    if (value != NULL) {
+        value = strdup(value);
+
+        if (value == NULL) {
+            virMutexUnlock(ctx->vmCacheLock);
+            virReportOOMError();
+            return -1;
+        }
+    }
+
+    virMutexUnlock(ctx->vmCacheLock);
+
+    if (value == NULL) {
+        return 0;
+    }
+
+    for (propertyName = propertyNameList;
+         propertyName != NULL && checkProperty != NULL;
+         propertyName = propertyName->_next) {
+        if (STREQ(propertyName->value, checkProperty)) {
+            addedProperty = false;
+            break;
+        }
+    }
+
+    if (esxVI_ManagedObjectReference_Alloc(&managedObjectReference) < 0 ||
+        esxVI_String_DeepCopyValue(&managedObjectReference->type,
+                                   "VirtualMachine") < 0 ||
+        esxVI_String_DeepCopyList(&completePropertyNameList,
+                                  propertyNameList) < 0 ||
+        (addedProperty &&
+         esxVI_String_AppendValueToList(&completePropertyNameList,
+                                        checkProperty) < 0)) {
+        goto cleanup;
+    }
+
+    managedObjectReference->value = value;
+    value = NULL;
+
+    if (esxVI_LookupObjectContentByType(ctx, managedObjectReference,
+                                        "VirtualMachine",
+                                        completePropertyNameList,
+                                        virtualMachine,
+                                        esxVI_Occurrence_RequiredItem) < 0) {
+        /* Most likely the virtual machine is gone, look it up the slow way */
+        VIR_DEBUG("Dropping stale cache entry '%s'", key);
+        virResetLastError();
+        esxVI_UncacheVirtualMachine(ctx, table, key);
+        result = 0;
+        goto cleanup;
+    }
+
+    if (checkProperty == NULL) {
+        result = 0;
+        goto cleanup;
+    }
+
+    for (dynamicProperty = &(*virtualMachine)->propSet;
+         *dynamicProperty != NULL;
+         dynamicProperty = &(*dynamicProperty)->_next) {
+        if (STREQ((*dynamicProperty)->name, checkProperty)) {
+            checkValue = *dynamicProperty;
+
+            if (addedProperty) {
+                /* Hide the property the caller didn't ask for */
+                *dynamicProperty = checkValue->_next;
+                checkValue->_next = NULL;
+            }
+
+            break;
+        }
+    }
+
+    if (checkValue == NULL ||
+        checkValue->val->type != esxVI_Type_String ||
+        normalize(checkValue->val->string, &normalized) < 0 ||
+        STRNEQ(normalized, key)) {
+        VIR_DEBUG("Dropping stale cache entry '%s'", key);
+        esxVI_UncacheVirtualMachine(ctx, table, key);
+        esxVI_ObjectContent_Free(virtualMachine);
+    }
+
+    result = 0;
+
+  cleanup:
+    if (addedProperty) {
+        esxVI_DynamicProperty_Free(&checkValue);
+    }
+
+    VIR_FREE(value);
+    VIR_FREE(normalized);
+    esxVI_ManagedObjectReference_Free(&managedObjectReference);
+    esxVI_String_Free(&completePropertyNameList);
+
+    return result;
+}
+
+
+
+static int
+esxVI_NormalizeUuid(const char *value, char **normalized)
+{
+    unsigned char uuid[VIR_UUID_BUFLEN];
+
+    if (virUUIDParse(value, uuid) < 0) {
+        return -1;
+    }
+
+    if (VIR_ALLOC_N(*normalized, VIR_UUID_STRING_BUFLEN) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    virUUIDFormat(uuid, *normalized);
+
+    return 0;
+}
+
+
+
+static int
+esxVI_NormalizeName(const char *value, char **normalized)
+{
+    if (esxVI_String_DeepCopyValue(normalized, value) < 0) {
+        return -1;
+    }
+
+    return virVMXUnescapeHexPercent(*normalized);
+}
+
+
+
 int
 esxVI_LookupVirtualMachineList(esxVI_Context *ctx,
                                esxVI_String *propertyNameList,
                                esxVI_ObjectContent **virtualMachineList)
 {
+    esxVI_ObjectContent *virtualMachine;
+
     /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
      *        for cluster support */
-    return esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
-                                           "VirtualMachine", propertyNameList,
-                                           virtualMachineList,
-                                           esxVI_Occurrence_OptionalList);
+    if (esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
+                                        "VirtualMachine", propertyNameList,
+                                        virtualMachineList,
+                                        esxVI_Occurrence_OptionalList) < 0) {
+        return -1;
+    }
+
+    for (virtualMachine = *virtualMachineList; virtualMachine != NULL;
+         virtualMachine = virtualMachine->_next) {
+        esxVI_CacheVirtualMachine(ctx, virtualMachine);
+    }
+
+    return 0;
 }
 
 
@@ -2765,6 +3076,7 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
     int result = -1;
     esxVI_ManagedObjectReference *managedObjectReference = NULL;
     char uuid_string[VIR_UUID_STRING_BUFLEN] = "";
+    char *value;
 
     if (virtualMachine == NULL || *virtualMachine != NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Invalid argument"));
@@ -2773,6 +3085,17 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
 
     virUUIDFormat(uuid, uuid_string);
 
+    if (esxVI_LookupCachedVirtualMachine(ctx, ctx->vmByUuid, uuid_string,
+                                         "config.uuid", esxVI_NormalizeUuid,
+                                         propertyNameList,
+                                         virtualMachine) < 0) {
+        return -1;
+    }
+
+    if (*virtualMachine != NULL) {
+        return 0;
+    }
+
     if (esxVI_FindByUuid(ctx, ctx->datacenter->_reference, uuid_string,
                          esxVI_Boolean_True, &managedObjectReference) < 0) {
         return -1;
@@ -2798,6 +3121,16 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
         goto cleanup;
     }
 
+    virMutexLock(ctx->vmCacheLock);
+
+    if ((value = strdup(managedObjectReference->value)) != NULL &&
+        virHashUpdateEntry(ctx->vmByUuid, uuid_string, value) < 0) {
+        VIR_FREE(value);
+        virResetLastError();
+    }
+
+    virMutexUnlock(ctx->vmCacheLock);
+
     result = 0;
 
   cleanup:
@@ -2808,6 +3141,84 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
 
 
 
+int
+esxVI_LookupVirtualMachineByID(esxVI_Context *ctx, int id,
+                               esxVI_String *propertyNameList,
+                               esxVI_ObjectContent **virtualMachine,
+                               esxVI_Occurrence occurrence)
+{
+    int result = -1;
+    esxVI_ObjectContent *virtualMachineList = NULL;
+    esxVI_ObjectContent *candidate = NULL;
+    int id_candidate;
+    char *id_key = NULL;
+
+    if (virtualMachine == NULL || *virtualMachine != NULL) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Invalid argument"));
+        return -1;
+    }
+
+    if (virAsprintf(&id_key, "%d", id) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    /* The ID is part of the managed object reference, so a successful
+     * lookup of the cached reference needs no further verification */
+    if (esxVI_LookupCachedVirtualMachine(ctx, ctx->vmById, id_key, NULL, NULL,
+                                         propertyNameList,
+                                         virtualMachine) < 0) {
+        goto cleanup;
+    }
+
+    if (*virtualMachine != NULL) {
+        result = 0;
+        goto cleanup;
+    }
+
+    if (esxVI_LookupVirtualMachineList(ctx, propertyNameList,
+                                       &virtualMachineList) < 0) {
+        goto cleanup;
+    }
+
+    for (candidate = virtualMachineList; candidate != NULL;
+         candidate = candidate->_next) {
+        if (esxUtil_ParseVirtualMachineIDString(candidate->obj->value,
+                                                &id_candidate) < 0 ||
+            id != id_candidate) {
+            continue;
+        }
+
+        if (esxVI_ObjectContent_DeepCopy(virtualMachine, candidate) < 0) {
+            goto cleanup;
+        }
+
+        break;
+    }
+
+    if (*virtualMachine == NULL) {
+        if (occurrence == esxVI_Occurrence_OptionalItem) {
+            result = 0;
+
+            goto cleanup;
+        } else {
+            virReportError(VIR_ERR_NO_DOMAIN,
+                           _("Could not find domain with ID %d"), id);
+            goto cleanup;
+        }
+    }
+
+    result = 0;
+
+  cleanup:
+    esxVI_ObjectContent_Free(&virtualMachineList);
+    VIR_FREE(id_key);
+
+    return result;
+}
+
+
+
 int
 esxVI_LookupVirtualMachineByName(esxVI_Context *ctx, const char *name,
                                  esxVI_String *propertyNameList,
@@ -2827,8 +3238,23 @@ esxVI_LookupVirtualMachineByName(esxVI_Context *ctx, const char *name,
 
     if (esxVI_String_DeepCopyList(&completePropertyNameList,
                                   propertyNameList) < 0 ||
-        esxVI_String_AppendValueToList(&completePropertyNameList, "name") < 0 ||
-        esxVI_LookupVirtualMachineList(ctx, completePropertyNameList,
+        esxVI_String_AppendValueToList(&completePropertyNameList, "name") < 0) {
+        goto cleanup;
+    }
+
+    if (esxVI_LookupCachedVirtualMachine(ctx, ctx->vmByName, name, "name",
+                                         esxVI_NormalizeName,
+                                         completePropertyNameList,
+                                         virtualMachine) < 0) {
+        goto cleanup;
+    }
+
+    if (*virtualMachine != NULL) {
+        result = 0;
+        goto cleanup;
+    }
+
+    if (esxVI_LookupVirtualMachineList(ctx, completePropertyNameList,
                                        &virtualMachineList) < 0) {
         goto cleanup;
     }
@@ -33,6 +33,7 @@
 # include "datatypes.h"
 # include "esx_vi_types.h"
 # include "esx_util.h"
+# include "virhash.h"
 
 
 # define ESX_VI__SOAP__REQUEST_HEADER                                         \
@@ -215,6 +216,11 @@ struct _esxVI_Context {
     esxVI_ProductVersion productVersion;
     esxVI_UserSession *session; /* ... except the session ... */
     virMutexPtr sessionLock; /* ... that is protected by this mutex */
+    time_t sessionCheckTime; /* last successful check, under sessionLock */
+    virHashTablePtr vmByUuid; /* moref values of virtual machines by UUID, */
+    virHashTablePtr vmByName; /* by name and by ID, learned from lookups */
+    virHashTablePtr vmById;   /* and protected by vmCacheLock */
+    virMutexPtr vmCacheLock;
     esxVI_Datacenter *datacenter;
     char *datacenterPath; /* including folders */
     esxVI_ComputeResource *computeResource;
@@ -411,6 +417,11 @@ int esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx,
                                      esxVI_ObjectContent **virtualMachine,
                                      esxVI_Occurrence occurrence);
 
+int esxVI_LookupVirtualMachineByID(esxVI_Context *ctx, int id,
+                                   esxVI_String *propertyNameList,
+                                   esxVI_ObjectContent **virtualMachine,
+                                   esxVI_Occurrence occurrence);
+
 int esxVI_LookupVirtualMachineByName(esxVI_Context *ctx, const char *name,
                                      esxVI_String *propertyNameList,
                                      esxVI_ObjectContent **virtualMachine,
@@ -7229,6 +7229,316 @@ virDomainInterfaceStats (virDomainPtr dom, const char *path,
 
     virLibDomainError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
 
+error:
+    virDispatchError(dom->conn);
+    return -1;
+}
+
+/**
+ * virDomainLookupByNameAsync:
+ * @conn: pointer to the hypervisor connection
+ * @name: name for the domain
+ * @dom: where to store the domain object
+ * @cb: callback to invoke once the lookup completed
+ * @opaque: user data to pass to @cb
+ * @freecb: optional function to free @opaque once @cb returned
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Submit a lookup of a domain by its name without waiting for the
+ * reply. Once the lookup completed @cb is invoked from the event
+ * loop; on success *@dom holds a new domain object which the caller
+ * must release with virDomainFree(). @dom must stay valid until @cb
+ * is invoked. An event loop must have been registered with
+ * virEventRegisterImpl() and must be run by the application.
+ *
+ * Returns 0 if the call was submitted, in which case @cb will be
+ * invoked exactly once, or -1 if it could not be submitted.
+ */
+int
+virDomainLookupByNameAsync(virConnectPtr conn,
+                           const char *name,
+                           virDomainPtr *dom,
+                           virConnectAsyncCallback cb,
+                           void *opaque,
+                           virFreeCallback freecb,
+                           unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, name=%s, dom=%p, cb=%p, opaque=%p, flags=%x",
+              conn, NULLSTR(name), dom, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(name, error);
+    virCheckNonNullArgGoto(dom, error);
+    virCheckNonNullArgGoto(cb, error);
+
+    if (conn->driver->domainLookupByNameAsync) {
+        int ret;
+        ret = conn->driver->domainLookupByNameAsync(conn, name, dom,
+                                                    cb, opaque, freecb,
+                                                    flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
+/**
+ * virDomainLookupByUUIDAsync:
+ * @conn: pointer to the hypervisor connection
+ * @uuid: the raw UUID for the domain
+ * @dom: where to store the domain object
+ * @cb: callback to invoke once the lookup completed
+ * @opaque: user data to pass to @cb
+ * @freecb: optional function to free @opaque once @cb returned
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous variant of virDomainLookupByUUID(), see
+ * virDomainLookupByNameAsync() for the calling convention.
+ *
+ * Returns 0 if the call was submitted, in which case @cb will be
+ * invoked exactly once, or -1 if it could not be submitted.
+ */
+int
+virDomainLookupByUUIDAsync(virConnectPtr conn,
+                           const unsigned char *uuid,
+                           virDomainPtr *dom,
+                           virConnectAsyncCallback cb,
+                           void *opaque,
+                           virFreeCallback freecb,
+                           unsigned int flags)
+{
+    VIR_UUID_DEBUG(conn, uuid);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(uuid, error);
+    virCheckNonNullArgGoto(dom, error);
+    virCheckNonNullArgGoto(cb, error);
+
+    if (conn->driver->domainLookupByUUIDAsync) {
+        int ret;
+        ret = conn->driver->domainLookupByUUIDAsync(conn, uuid, dom,
+                                                    cb, opaque, freecb,
+                                                    flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
+/**
+ * virDomainGetInfoAsync:
+ * @domain: a domain object
+ * @info: pointer to a virDomainInfo structure allocated by the user
+ * @cb: callback to invoke once the call completed
+ * @opaque: user data to pass to @cb
+ * @freecb: optional function to free @opaque once @cb returned
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous variant of virDomainGetInfo(). @info is filled in
+ * before @cb is invoked from the event loop and must stay valid
+ * until then.
+ *
+ * Returns 0 if the call was submitted, in which case @cb will be
+ * invoked exactly once, or -1 if it could not be submitted.
+ */
+int
+virDomainGetInfoAsync(virDomainPtr domain,
+                      virDomainInfoPtr info,
+                      virConnectAsyncCallback cb,
+                      void *opaque,
+                      virFreeCallback freecb,
+                      unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "info=%p, cb=%p, opaque=%p, flags=%x",
+                     info, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN(domain)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(info, error);
+    virCheckNonNullArgGoto(cb, error);
+
+    memset(info, 0, sizeof(virDomainInfo));
+
+    conn = domain->conn;
+
+    if (conn->driver->domainGetInfoAsync) {
+        int ret;
+        ret = conn->driver->domainGetInfoAsync(domain, info,
+                                               cb, opaque, freecb, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+/**
+ * virDomainBlockStatsAsync:
+ * @dom: pointer to the domain object
+ * @disk: path to the block device, or device shorthand
+ * @stats: block device stats (returned)
+ * @size: size of stats structure
+ * @cb: callback to invoke once the call completed
+ * @opaque: user data to pass to @cb
+ * @freecb: optional function to free @opaque once @cb returned
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous variant of virDomainBlockStats(). @stats is filled in
+ * before @cb is invoked from the event loop and must stay valid
+ * until then.
+ *
+ * Returns 0 if the call was submitted, in which case @cb will be
+ * invoked exactly once, or -1 if it could not be submitted.
+ */
+int
+virDomainBlockStatsAsync(virDomainPtr dom,
+                         const char *disk,
+                         virDomainBlockStatsPtr stats,
+                         size_t size,
+                         virConnectAsyncCallback cb,
+                         void *opaque,
+                         virFreeCallback freecb,
+                         unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(dom, "disk=%s, stats=%p, size=%zi, cb=%p, opaque=%p, "
+                     "flags=%x", disk, stats, size, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN (dom)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(disk, error);
+    virCheckNonNullArgGoto(stats, error);
+    virCheckNonNullArgGoto(cb, error);
+    if (size > sizeof(struct _virDomainBlockStats)) {
+        virReportInvalidArg(size,
+                            _("size in %s must not exceed %zu"),
+                            __FUNCTION__, sizeof(struct _virDomainBlockStats));
+        goto error;
+    }
+    conn = dom->conn;
+
+    if (conn->driver->domainBlockStatsAsync) {
+        int ret;
+        ret = conn->driver->domainBlockStatsAsync(dom, disk, stats, size,
+                                                  cb, opaque, freecb, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibDomainError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(dom->conn);
+    return -1;
+}
+
+/**
+ * virDomainInterfaceStatsAsync:
+ * @dom: pointer to the domain object
+ * @path: path to the interface
+ * @stats: network interface stats (returned)
+ * @size: size of stats structure
+ * @cb: callback to invoke once the call completed
+ * @opaque: user data to pass to @cb
+ * @freecb: optional function to free @opaque once @cb returned
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Asynchronous variant of virDomainInterfaceStats(). @stats is
+ * filled in before @cb is invoked from the event loop and must stay
+ * valid until then.
+ *
+ * Returns 0 if the call was submitted, in which case @cb will be
+ * invoked exactly once, or -1 if it could not be submitted.
+ */
+int
+virDomainInterfaceStatsAsync(virDomainPtr dom,
+                             const char *path,
+                             virDomainInterfaceStatsPtr stats,
+                             size_t size,
+                             virConnectAsyncCallback cb,
+                             void *opaque,
+                             virFreeCallback freecb,
+                             unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(dom, "path=%s, stats=%p, size=%zi, cb=%p, opaque=%p, "
+                     "flags=%x", path, stats, size, cb, opaque, flags);
+
+    virResetLastError();
+
+    if (!VIR_IS_CONNECTED_DOMAIN (dom)) {
+        virLibDomainError(VIR_ERR_INVALID_DOMAIN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+    virCheckNonNullArgGoto(path, error);
+    virCheckNonNullArgGoto(stats, error);
+    virCheckNonNullArgGoto(cb, error);
+    if (size > sizeof(struct _virDomainInterfaceStats)) {
+        virReportInvalidArg(size,
+                            _("size in %s must not exceed %zu"),
+                            __FUNCTION__,
+                            sizeof(struct _virDomainInterfaceStats));
+        goto error;
+    }
+    conn = dom->conn;
+
+    if (conn->driver->domainInterfaceStatsAsync) {
+        int ret;
+        ret = conn->driver->domainInterfaceStatsAsync(dom, path, stats, size,
+                                                      cb, opaque, freecb,
+                                                      flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibDomainError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
 error:
     virDispatchError(dom->conn);
     return -1;
@@ -9241,6 +9551,9 @@ error:
  * in an existing CDROM/Floppy device, however, applications are
  * recommended to use the virDomainUpdateDeviceFlag method instead.
  *
+ * As with virDomainAttachDeviceFlags(), @xml may hold a <devices>
+ * element listing several devices on hypervisors supporting it.
+ *
  * Returns 0 in case of success, -1 in case of failure.
  */
 int
@@ -9303,6 +9616,11 @@ error:
  * in an existing CDROM/Floppy device, however, applications are
  * recommended to use the virDomainUpdateDeviceFlag method instead.
  *
+ * Some hypervisors (currently QEMU) also accept a <devices> element
+ * holding several devices in @xml, which are then attached within a
+ * single operation. If attaching one of them to the running domain
+ * fails, the devices preceding it remain attached.
+ *
  * Returns 0 in case of success, -1 in case of failure.
  */
 int
@@ -9352,6 +9670,9 @@ error:
  * Destroy a virtual device attachment to backend.  This function,
  * having hot-unplug semantics, is only allowed on an active domain.
  *
+ * As with virDomainAttachDeviceFlags(), @xml may hold a <devices>
+ * element listing several devices on hypervisors supporting it.
+ *
  * Returns 0 in case of success, -1 in case of failure.
  */
 int
@@ -9414,6 +9735,9 @@ error:
  * block copy operation on the device being detached; in that case,
  * use virDomainBlockJobAbort() to stop the block copy first.
  *
+ * As with virDomainAttachDeviceFlags(), @xml may hold a <devices>
+ * element listing several devices on hypervisors supporting it.
+ *
  * Returns 0 in case of success, -1 in case of failure.
  */
 int
@@ -9477,6 +9801,9 @@ error:
  * media, altering the graphics configuration such as password,
  * reconfiguring the NIC device backend connectivity, etc.
  *
+ * As with virDomainAttachDeviceFlags(), @xml may hold a <devices>
+ * element listing several devices on hypervisors supporting it.
+ *
  * Returns 0 in case of success, -1 in case of failure.
  */
 int
@@ -11391,6 +11718,91 @@ error:
 }
 
 
+/**
+ * virConnectListAllStoragePools:
+ * @conn: Pointer to the hypervisor connection.
+ * @pools: Pointer to a variable to store the array containing storage pool
+ *         objects or NULL if the list is not required (just returns number
+ *         of pools).
+ * @flags: bitwise-OR of virConnectListAllStoragePoolsFlags.
+ *
+ * Collect the list of storage pools, and allocate an array to store those
+ * objects. This API solves the race inherent between
+ * virConnectListStoragePools and virConnectListDefinedStoragePools, and
+ * saves the virStoragePoolLookupByName round trip needed for each name.
+ *
+ * Normally, all storage pools are returned; however, @flags can be used to
+ * filter the results for a smaller list of targeted pools.  The valid
+ * flags are divided into groups, where each group contains bits that
+ * describe mutually exclusive attributes of a pool, and where all bits
+ * within a group describe all possible pools.
+ *
+ * The first group of @flags is VIR_CONNECT_LIST_STORAGE_POOLS_ACTIVE (online)
+ * and VIR_CONNECT_LIST_STORAGE_POOLS_INACTIVE (offline) to filter the pools
+ * by state.
+ *
+ * The second group of @flags is VIR_CONNECT_LIST_STORAGE_POOLS_PERSISTENT
+ * (defined) and VIR_CONNECT_LIST_STORAGE_POOLS_TRANSIENT (running but not
+ * defined), to filter the pools by whether they have persistent config or not.
+ *
+ * The third group of @flags is VIR_CONNECT_LIST_STORAGE_POOLS_AUTOSTART
+ * and VIR_CONNECT_LIST_STORAGE_POOLS_NO_AUTOSTART, to filter the pools by
+ * whether they are marked as autostart or not.
+ *
+ * The last group of @flags is provided to filter the pools by the types,
+ * the flags include:
+ * VIR_CONNECT_LIST_STORAGE_POOLS_DIR
+ * VIR_CONNECT_LIST_STORAGE_POOLS_FS
+ * VIR_CONNECT_LIST_STORAGE_POOLS_NETFS
+ * VIR_CONNECT_LIST_STORAGE_POOLS_LOGICAL
+ * VIR_CONNECT_LIST_STORAGE_POOLS_DISK
+ * VIR_CONNECT_LIST_STORAGE_POOLS_ISCSI
+ * VIR_CONNECT_LIST_STORAGE_POOLS_SCSI
+ * VIR_CONNECT_LIST_STORAGE_POOLS_MPATH
+ * VIR_CONNECT_LIST_STORAGE_POOLS_RBD
+ * VIR_CONNECT_LIST_STORAGE_POOLS_SHEEPDOG
+ *
+ * Returns the number of storage pools found or -1 and sets @pools to
+ * NULL in case of error.  On success, the array stored into @pools is
+ * guaranteed to have an extra allocated element set to NULL but not included
+ * in the return count, to make iteration easier.  The caller is responsible
+ * for calling virStoragePoolFree() on each array element, then calling
+ * free() on @pools.
+ */
+int
+virConnectListAllStoragePools(virConnectPtr conn,
+                              virStoragePoolPtr **pools,
+                              unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, pools=%p, flags=%x", conn, pools, flags);
+
+    virResetLastError();
+
+    if (pools)
+        *pools = NULL;
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (conn->storageDriver &&
+        conn->storageDriver->listAllPools) {
+        int ret;
+        ret = conn->storageDriver->listAllPools(conn, pools, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
 /**
  * virConnectFindStoragePoolSources:
  * @conn: pointer to hypervisor connection
@@ -12399,6 +12811,59 @@ error:
 }
 
 
+/**
+ * virStoragePoolListAllVolumes:
+ * @pool: Pointer to storage pool
+ * @vols: Pointer to a variable to store the array containing storage volume
+ *        objects or NULL if the list is not required (just returns number
+ *        of volumes).
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Collect the list of storage volumes, and allocate an array to store those
+ * objects.  This saves the virStorageVolLookupByName round trip needed for
+ * each name returned by virStoragePoolListVolumes.
+ *
+ * Returns the number of storage volumes found or -1 and sets @vols to
+ * NULL in case of error.  On success, the array stored into @vols is
+ * guaranteed to have an extra allocated element set to NULL but not included
+ * in the return count, to make iteration easier.  The caller is responsible
+ * for calling virStorageVolFree() on each array element, then calling
+ * free() on @vols.
+ */
+int
+virStoragePoolListAllVolumes(virStoragePoolPtr pool,
+                             virStorageVolPtr **vols,
+                             unsigned int flags)
+{
+    VIR_DEBUG("pool=%p, vols=%p, flags=%x", pool, vols, flags);
+
+    virResetLastError();
+
+    if (vols)
+        *vols = NULL;
+
+    if (!VIR_IS_STORAGE_POOL(pool)) {
+        virLibConnError(VIR_ERR_INVALID_STORAGE_POOL, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (pool->conn->storageDriver &&
+        pool->conn->storageDriver->poolListAllVolumes) {
+        int ret;
+        ret = pool->conn->storageDriver->poolListAllVolumes(pool, vols, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(pool->conn);
+    return -1;
+}
+
 /**
  * virStorageVolGetConnect:
  * @vol: pointer to a pool
@@ -13364,6 +13829,73 @@ error:
 }
 
 
+/**
+ * virConnectListAllNodeDevices:
+ * @conn: Pointer to the hypervisor connection.
+ * @devices: Pointer to a variable to store the array containing the node
+ *           device objects or NULL if the list is not required (just returns
+ *           number of node devices).
+ * @flags: bitwise-OR of virConnectListAllNodeDeviceFlags.
+ *
+ * Collect the list of node devices, and allocate an array to store those
+ * objects.  This saves the virNodeDeviceLookupByName round trip needed for
+ * each name returned by virNodeListDevices.
+ *
+ * Normally, all node devices are returned; however, @flags can be used to
+ * filter the results for a smaller list of targeted node devices.  A device
+ * is returned if it has any of the capabilities selected by:
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_SYSTEM
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_PCI_DEV
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_USB_DEV
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_USB_INTERFACE
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_NET
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI_HOST
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI_TARGET
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI
+ * VIR_CONNECT_LIST_NODE_DEVICES_CAP_STORAGE
+ *
+ * Returns the number of node devices found or -1 and sets @devices to
+ * NULL in case of error.  On success, the array stored into @devices is
+ * guaranteed to have an extra allocated element set to NULL but not included
+ * in the return count, to make iteration easier.  The caller is responsible
+ * for calling virNodeDeviceFree() on each array element, then calling
+ * free() on @devices.
+ */
+int
+virConnectListAllNodeDevices(virConnectPtr conn,
+                             virNodeDevicePtr **devices,
+                             unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, devices=%p, flags=%x", conn, devices, flags);
+
+    virResetLastError();
+
+    if (devices)
+        *devices = NULL;
+
+    if (!VIR_IS_CONNECT(conn)) {
+        virLibConnError(VIR_ERR_INVALID_CONN, __FUNCTION__);
+        virDispatchError(NULL);
+        return -1;
+    }
+
+    if (conn->deviceMonitor &&
+        conn->deviceMonitor->listAllNodeDevices) {
+        int ret;
+        ret = conn->deviceMonitor->listAllNodeDevices(conn, devices, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virLibConnError(VIR_ERR_NO_SUPPORT, __FUNCTION__);
+
+error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virNodeDeviceLookupByName:
  * @conn: pointer to the hypervisor connection
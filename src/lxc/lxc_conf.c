@@ -216,6 +216,18 @@ int lxcLoadDriverConfig(virLXCDriverPtr driver)
     CHECK_TYPE ("security_require_confined", VIR_CONF_LONG);
     if (p) driver->securityRequireConfined = p->l;
 
+    p = virConfGetValue(conf, "console_buffer_size");
+    CHECK_TYPE ("console_buffer_size", VIR_CONF_LONG);
+    if (p) {
+        if (p->l < LXC_CONSOLE_BUFFER_MIN || p->l > UINT_MAX) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("%s: console_buffer_size must be between %d and %u"),
+                           filename, LXC_CONSOLE_BUFFER_MIN, UINT_MAX);
+            virConfFree(conf);
+            return -1;
+        }
+        driver->consoleBufferSize = p->l;
+    }
 
 #undef CHECK_TYPE
 
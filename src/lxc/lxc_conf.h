@@ -43,6 +43,9 @@
 # define LXC_LOG_DIR LOCALSTATEDIR "/log/libvirt/lxc"
 # define LXC_AUTOSTART_DIR LXC_CONFIG_DIR "/autostart"
 
+/* Smallest console relay buffer the controller accepts */
+# define LXC_CONSOLE_BUFFER_MIN 1024
+
 typedef struct _virLXCDriver virLXCDriver;
 typedef virLXCDriver *virLXCDriverPtr;
 
@@ -59,6 +62,7 @@ struct _virLXCDriver {
     char *logDir;
     int log_libvirtd;
     int have_netns;
+    unsigned int consoleBufferSize;
 
     virDomainEventStatePtr domainEventState;
 
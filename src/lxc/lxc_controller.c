@@ -27,6 +27,7 @@
 #include <sys/epoll.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/utsname.h>
@@ -74,6 +75,23 @@
 
 #define VIR_FROM_THIS VIR_FROM_LXC
 
+/* Default size of each console relay buffer. The container->host
+ * buffer also holds the output retained while no client is attached */
+#define VIR_LXC_CONTROLLER_CONSOLE_BUFFER (64 * 1024)
+
+/* Amount of old output dropped at once when the retained
+ * container output overflows its buffer */
+#define VIR_LXC_CONTROLLER_CONSOLE_DISCARD 4096
+
+typedef struct _virLXCControllerConsoleRing virLXCControllerConsoleRing;
+typedef virLXCControllerConsoleRing *virLXCControllerConsoleRingPtr;
+struct _virLXCControllerConsoleRing {
+    char *buf;
+    size_t size;
+    size_t head; /* Offset of the oldest queued byte */
+    size_t len;  /* Number of queued bytes */
+};
+
 typedef struct _virLXCControllerConsole virLXCControllerConsole;
 typedef virLXCControllerConsole *virLXCControllerConsolePtr;
 struct _virLXCControllerConsole {
@@ -92,10 +110,8 @@ struct _virLXCControllerConsole {
     int epollWatch;
     int epollFd; /* epoll FD for dealing with EOF */
 
-    size_t fromHostLen;
-    char fromHostBuf[1024];
-    size_t fromContLen;
-    char fromContBuf[1024];
+    virLXCControllerConsoleRing fromHost;
+    virLXCControllerConsoleRing fromCont;
 };
 
 typedef struct _virLXCController virLXCController;
@@ -113,6 +129,7 @@ struct _virLXCController {
 
     size_t nconsoles;
     virLXCControllerConsolePtr consoles;
+    size_t consoleBufferSize;
     char *devptmx;
 
     size_t nloopDevs;
@@ -232,6 +249,9 @@ static void virLXCControllerConsoleClose(virLXCControllerConsolePtr console)
     if (console->epollWatch != -1)
         virEventRemoveHandle(console->epollWatch);
     VIR_FORCE_CLOSE(console->epollFd);
+
+    VIR_FREE(console->fromHost.buf);
+    VIR_FREE(console->fromCont.buf);
 }
 
 
@@ -273,18 +293,30 @@ static void virLXCControllerFree(virLXCControllerPtr ctrl)
 static int virLXCControllerAddConsole(virLXCControllerPtr ctrl,
                                       int hostFd)
 {
+    virLXCControllerConsolePtr console;
+
     if (VIR_EXPAND_N(ctrl->consoles, ctrl->nconsoles, 1) < 0) {
         virReportOOMError();
         return -1;
     }
-    ctrl->consoles[ctrl->nconsoles-1].hostFd = hostFd;
-    ctrl->consoles[ctrl->nconsoles-1].hostWatch = -1;
+    console = &ctrl->consoles[ctrl->nconsoles-1];
 
-    ctrl->consoles[ctrl->nconsoles-1].contFd = -1;
-    ctrl->consoles[ctrl->nconsoles-1].contWatch = -1;
+    console->hostFd = hostFd;
+    console->hostWatch = -1;
 
-    ctrl->consoles[ctrl->nconsoles-1].epollFd = -1;
-    ctrl->consoles[ctrl->nconsoles-1].epollWatch = -1;
+    console->contFd = -1;
+    console->contWatch = -1;
+
+    console->epollFd = -1;
+    console->epollWatch = -1;
+
+    if (VIR_ALLOC_N(console->fromHost.buf, ctrl->consoleBufferSize) < 0 ||
+        VIR_ALLOC_N(console->fromCont.buf, ctrl->consoleBufferSize) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+    console->fromHost.size = ctrl->consoleBufferSize;
+    console->fromCont.size = ctrl->consoleBufferSize;
     return 0;
 }
 
@@ -685,21 +717,121 @@ static void virLXCControllerSignalChildIO(virNetServerPtr server ATTRIBUTE_UNUSE
 }
 
 
+/*
+ * Fill the free space of @ring from @fd with a single readv call.
+ * If @overwrite is set and the ring is full, the oldest queued bytes
+ * are discarded first so the reader never stalls.
+ *
+ * Returns the number of bytes read, or -1 with errno set
+ */
+static ssize_t
+virLXCControllerConsoleRingRead(virLXCControllerConsoleRingPtr ring,
+                                int fd,
+                                bool overwrite)
+{
+    struct iovec iov[2];
+    int niov = 1;
+    size_t tail;
+    ssize_t done;
+
+    if (ring->len == ring->size && overwrite) {
+        size_t drop = MIN(ring->len, VIR_LXC_CONTROLLER_CONSOLE_DISCARD);
+        VIR_DEBUG("Dropping %zu bytes of retained console output", drop);
+        ring->head = (ring->head + drop) % ring->size;
+        ring->len -= drop;
+    }
+
+    if (ring->len == ring->size) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    tail = (ring->head + ring->len) % ring->size;
+    if (tail >= ring->head) {
+        iov[0].iov_base = ring->buf + tail;
+        iov[0].iov_len = ring->size - tail;
+        if (ring->head) {
+            iov[1].iov_base = ring->buf;
+            iov[1].iov_len = ring->head;
+            niov = 2;
+        }
+    } else {
+        iov[0].iov_base = ring->buf + tail;
+        iov[0].iov_len = ring->head - tail;
+    }
+
+reread:
+    done = readv(fd, iov, niov);
+    if (done == -1 && errno == EINTR)
+        goto reread;
+
+    if (done > 0)
+        ring->len += done;
+    return done;
+}
+
+
+/*
+ * Flush as much of @ring to @fd as possible with a single writev call.
+ *
+ * Returns the number of bytes written, or -1 with errno set
+ */
+static ssize_t
+virLXCControllerConsoleRingWrite(virLXCControllerConsoleRingPtr ring,
+                                 int fd)
+{
+    struct iovec iov[2];
+    int niov = 1;
+    ssize_t done;
+
+    if (ring->len == 0)
+        return 0;
+
+    iov[0].iov_base = ring->buf + ring->head;
+    if (ring->head + ring->len > ring->size) {
+        iov[0].iov_len = ring->size - ring->head;
+        iov[1].iov_base = ring->buf;
+        iov[1].iov_len = ring->len - iov[0].iov_len;
+        niov = 2;
+    } else {
+        iov[0].iov_len = ring->len;
+    }
+
+rewrite:
+    done = writev(fd, iov, niov);
+    if (done == -1 && errno == EINTR)
+        goto rewrite;
+
+    if (done > 0) {
+        ring->len -= done;
+        if (ring->len)
+            ring->head = (ring->head + done) % ring->size;
+        else
+            ring->head = 0;
+    }
+    return done;
+}
+
+
 static void virLXCControllerConsoleUpdateWatch(virLXCControllerConsolePtr console)
 {
     int hostEvents = 0;
     int contEvents = 0;
 
-    if (!console->hostClosed || (!console->hostBlocking && console->fromContLen)) {
-        if (console->fromHostLen < sizeof(console->fromHostBuf))
+    if (!console->hostClosed || (!console->hostBlocking && console->fromCont.len)) {
+        if (console->fromHost.len < console->fromHost.size)
             hostEvents |= VIR_EVENT_HANDLE_READABLE;
-        if (console->fromContLen)
+        if (console->fromCont.len)
             hostEvents |= VIR_EVENT_HANDLE_WRITABLE;
     }
-    if (!console->contClosed || (!console->contBlocking && console->fromHostLen)) {
-        if (console->fromContLen < sizeof(console->fromContBuf))
+    if (!console->contClosed || (!console->contBlocking && console->fromHost.len)) {
+        /* While nobody is attached on the host side, keep draining
+         * the container so it never stalls on console output; the
+         * oldest retained output is dropped to make room */
+        if (console->fromCont.len < console->fromCont.size ||
+            console->hostClosed)
             contEvents |= VIR_EVENT_HANDLE_READABLE;
-        if (console->fromHostLen)
+        if (console->fromHost.len)
             contEvents |= VIR_EVENT_HANDLE_WRITABLE;
     }
 
@@ -794,8 +926,8 @@ static void virLXCControllerConsoleEPoll(int watch, int fd, int events, void *op
     virMutexLock(&lock);
     VIR_DEBUG("IO event watch=%d fd=%d events=%d fromHost=%zu fromcont=%zu",
               watch, fd, events,
-              console->fromHostLen,
-              console->fromContLen);
+              console->fromHost.len,
+              console->fromCont.len);
 
     while (1) {
         struct epoll_event event;
@@ -841,63 +973,43 @@ static void virLXCControllerConsoleIO(int watch, int fd, int events, void *opaqu
     virMutexLock(&lock);
     VIR_DEBUG("IO event watch=%d fd=%d events=%d fromHost=%zu fromcont=%zu",
               watch, fd, events,
-              console->fromHostLen,
-              console->fromContLen);
+              console->fromHost.len,
+              console->fromCont.len);
     if (events & VIR_EVENT_HANDLE_READABLE) {
-        char *buf;
-        size_t *len;
-        size_t avail;
+        virLXCControllerConsoleRingPtr ring;
+        bool overwrite = false;
         ssize_t done;
         if (watch == console->hostWatch) {
-            buf = console->fromHostBuf;
-            len = &console->fromHostLen;
-            avail = sizeof(console->fromHostBuf) - *len;
+            ring = &console->fromHost;
         } else {
-            buf = console->fromContBuf;
-            len = &console->fromContLen;
-            avail = sizeof(console->fromContBuf) - *len;
+            ring = &console->fromCont;
+            overwrite = console->hostClosed;
         }
-    reread:
-        done = read(fd, buf + *len, avail);
-        if (done == -1 && errno == EINTR)
-            goto reread;
+        done = virLXCControllerConsoleRingRead(ring, fd, overwrite);
         if (done == -1 && errno != EAGAIN) {
             virReportSystemError(errno, "%s",
                                  _("Unable to read container pty"));
             goto error;
         }
-        if (done > 0) {
-            *len += done;
-        } else {
+        if (done <= 0)
             VIR_DEBUG("Read fd %d done %d errno %d", fd, (int)done, errno);
-        }
     }
 
     if (events & VIR_EVENT_HANDLE_WRITABLE) {
-        char *buf;
-        size_t *len;
+        virLXCControllerConsoleRingPtr ring;
         ssize_t done;
-        if (watch == console->hostWatch) {
-            buf = console->fromContBuf;
-            len = &console->fromContLen;
-        } else {
-            buf = console->fromHostBuf;
-            len = &console->fromHostLen;
-        }
+        if (watch == console->hostWatch)
+            ring = &console->fromCont;
+        else
+            ring = &console->fromHost;
 
-    rewrite:
-        done = write(fd, buf, *len);
-        if (done == -1 && errno == EINTR)
-            goto rewrite;
+        done = virLXCControllerConsoleRingWrite(ring, fd);
         if (done == -1 && errno != EAGAIN) {
             virReportSystemError(errno, "%s",
                                  _("Unable to write to container pty"));
             goto error;
         }
-        if (done > 0) {
-            memmove(buf, buf + done, (*len - done));
-            *len -= done;
-        } else {
+        if (done <= 0) {
             VIR_DEBUG("Write fd %d done %d errno %d", fd, (int)done, errno);
             if (watch == console->hostWatch)
                 console->hostBlocking = true;
@@ -1469,6 +1581,7 @@ int main(int argc, char *argv[])
         { "console", 1, NULL, 'c' },
         { "handshakefd", 1, NULL, 's' },
         { "security", 1, NULL, 'S' },
+        { "console-buffer", 1, NULL, 'B' },
         { "help", 0, NULL, 'h' },
         { 0, 0, 0, 0 },
     };
@@ -1477,6 +1590,7 @@ int main(int argc, char *argv[])
     virLXCControllerPtr ctrl = NULL;
     size_t i;
     const char *securityDriver = "none";
+    unsigned int consoleBufferSize = VIR_LXC_CONTROLLER_CONSOLE_BUFFER;
 
     if (setlocale(LC_ALL, "") == NULL ||
         bindtextdomain(PACKAGE, LOCALEDIR) == NULL ||
@@ -1492,7 +1606,7 @@ int main(int argc, char *argv[])
     while (1) {
         int c;
 
-        c = getopt_long(argc, argv, "dn:v:m:c:s:h:S:",
+        c = getopt_long(argc, argv, "dn:v:m:c:s:h:S:B:",
                        options, NULL);
 
         if (c == -1)
@@ -1544,6 +1658,15 @@ int main(int argc, char *argv[])
             securityDriver = optarg;
             break;
 
+        case 'B':
+            if (virStrToLong_ui(optarg, NULL, 10, &consoleBufferSize) < 0 ||
+                consoleBufferSize < LXC_CONSOLE_BUFFER_MIN) {
+                fprintf(stderr, "malformed --console-buffer argument '%s'\n",
+                        optarg);
+                goto cleanup;
+            }
+            break;
+
         case 'h':
         case '?':
             fprintf(stderr, "\n");
@@ -1557,6 +1680,7 @@ int main(int argc, char *argv[])
             fprintf(stderr, "  -v VETH, --veth VETH\n");
             fprintf(stderr, "  -s FD, --handshakefd FD\n");
             fprintf(stderr, "  -S NAME, --security NAME\n");
+            fprintf(stderr, "  -B SIZE, --console-buffer SIZE\n");
             fprintf(stderr, "  -h, --help\n");
             fprintf(stderr, "\n");
             goto cleanup;
@@ -1585,6 +1709,7 @@ int main(int argc, char *argv[])
         goto cleanup;
 
     ctrl->handshakeFd = handshakeFd;
+    ctrl->consoleBufferSize = consoleBufferSize;
 
     if (!(ctrl->securityManager = virSecurityManagerNew(securityDriver,
                                                         LXC_DRIVER_NAME,
@@ -663,6 +663,7 @@ static int lxcDomainSetMaxMemory(virDomainPtr dom, unsigned long newmax) {
     }
 
     vm->def->mem.max_balloon = newmax;
+    virDomainObjUnpublishDef(vm);
     ret = 0;
 
 cleanup:
@@ -910,11 +911,20 @@ static char *lxcDomainGetXMLDesc(virDomainPtr dom,
 {
     virLXCDriverPtr driver = dom->conn->privateData;
     virDomainObjPtr vm;
+    virDomainPublishedDefPtr pub = NULL;
     char *ret = NULL;
 
     /* Flags checked by virDomainDefFormat */
 
     lxcDriverLock(driver);
+    if (!(flags & VIR_DOMAIN_XML_INACTIVE))
+        pub = virDomainFindPublishedDefByUUID(&driver->domains, dom->uuid);
+    if (pub) {
+        lxcDriverUnlock(driver);
+        ret = virDomainPublishedDefFormat(pub, flags);
+        virDomainPublishedDefRelease(pub);
+        return ret;
+    }
     vm = virDomainFindByUUID(&driver->domains, dom->uuid);
     lxcDriverUnlock(driver);
 
@@ -926,6 +936,22 @@ static char *lxcDomainGetXMLDesc(virDomainPtr dom,
         goto cleanup;
     }
 
+    /* Publish the live definition again if it changed since, so the
+     * next callers don't need the domain lock */
+    if (virDomainObjIsActive(vm) && !(flags & VIR_DOMAIN_XML_INACTIVE)) {
+        if (virDomainObjPublishDef(driver->caps, vm) < 0) {
+            VIR_WARN("Unable to publish definition of domain %s",
+                     vm->def->name);
+            virResetLastError();
+        }
+        if ((pub = virDomainObjGetPublishedDef(vm))) {
+            virDomainObjUnlock(vm);
+            ret = virDomainPublishedDefFormat(pub, flags);
+            virDomainPublishedDefRelease(pub);
+            return ret;
+        }
+    }
+
     ret = virDomainDefFormat((flags & VIR_DOMAIN_XML_INACTIVE) &&
                              vm->newDef ? vm->newDef : vm->def,
                              flags);
@@ -2358,6 +2384,48 @@ cleanup:
     return ret;
 }
 
+/*
+ * Wait up to @timeout milliseconds for the kernel to signal a change
+ * of the freezer.state file open on @fd. Kernels which do not notify
+ * changes of that file make this a plain timed wait.
+ */
+static void lxcFreezerWait(int fd, int timeout)
+{
+    struct pollfd pfd;
+
+    if (fd < 0) {
+        usleep(timeout * 1000);
+        return;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout) < 0)
+        VIR_DEBUG("Polling freezer.state failed with errno: %d", errno);
+}
+
+/*
+ * Read the freezer state through @fd, which also re-arms change
+ * notification on it. Returns 0 on success or -errno on failure.
+ */
+static int lxcFreezerReadState(int fd, char **state)
+{
+    char buf[32];
+    ssize_t got;
+    char *tmp;
+
+    if ((got = pread(fd, buf, sizeof(buf) - 1, 0)) < 0)
+        return -errno;
+    buf[got] = '\0';
+    if ((tmp = strchr(buf, '\n')))
+        *tmp = '\0';
+
+    if (!(*state = strdup(buf)))
+        return -ENOMEM;
+    return 0;
+}
+
 static int lxcFreezeContainer(virLXCDriverPtr driver, virDomainObjPtr vm)
 {
     int timeout = 1000; /* In milliseconds */
@@ -2365,6 +2433,8 @@ static int lxcFreezeContainer(virLXCDriverPtr driver, virDomainObjPtr vm)
     int exp = 10;
     int waited_time = 0;
     int ret = -1;
+    int fd = -1;
+    char *path = NULL;
     char *state = NULL;
     virCgroupPtr cgroup = NULL;
 
@@ -2374,6 +2444,13 @@ static int lxcFreezeContainer(virLXCDriverPtr driver, virDomainObjPtr vm)
 
     /* From here on, we know that cgroup != NULL.  */
 
+    /* Keep freezer.state open for the duration of the wait so that
+     * completion can be noticed without waiting out each interval */
+    if (virCgroupPathOfController(cgroup, VIR_CGROUP_CONTROLLER_FREEZER,
+                                  "freezer.state", &path) == 0 &&
+        (fd = open(path, O_RDONLY)) < 0)
+        VIR_DEBUG("Unable to open %s, falling back to polling", path);
+
     while (waited_time < timeout) {
         int r;
         /*
@@ -2408,9 +2485,12 @@ static int lxcFreezeContainer(virLXCDriverPtr driver, virDomainObjPtr vm)
          * decide that the freezing has been complete only with
          * the state actually transit to "FROZEN".
          */
-        usleep(check_interval * 1000);
+        lxcFreezerWait(fd, check_interval);
 
-        r = virCgroupGetFreezerState(cgroup, &state);
+        if (fd >= 0)
+            r = lxcFreezerReadState(fd, &state);
+        else
+            r = virCgroupGetFreezerState(cgroup, &state);
 
         if (r < 0) {
             VIR_DEBUG("Reading freezer.state failed with errno: %d", r);
@@ -2446,7 +2526,9 @@ error:
     ret = -1;
 
 cleanup:
+    VIR_FORCE_CLOSE(fd);
     virCgroupFree(&cgroup);
+    VIR_FREE(path);
     VIR_FREE(state);
     return ret;
 }
@@ -2460,6 +2542,9 @@ static int lxcDomainSuspend(virDomainPtr dom)
 
     lxcDriverLock(driver);
     vm = virDomainFindByUUID(&driver->domains, dom->uuid);
+    /* Only the domain lock is needed from here on, so don't hold up
+     * every other container while waiting on the freezer */
+    lxcDriverUnlock(driver);
 
     if (!vm) {
         char uuidstr[VIR_UUID_STRING_BUFLEN];
@@ -2497,7 +2582,6 @@ cleanup:
         virDomainEventStateQueue(driver->domainEventState, event);
     if (vm)
         virDomainObjUnlock(vm);
-    lxcDriverUnlock(driver);
     return ret;
 }
 
@@ -2525,6 +2609,7 @@ static int lxcDomainResume(virDomainPtr dom)
 
     lxcDriverLock(driver);
     vm = virDomainFindByUUID(&driver->domains, dom->uuid);
+    lxcDriverUnlock(driver);
 
     if (!vm) {
         char uuidstr[VIR_UUID_STRING_BUFLEN];
@@ -2563,7 +2648,6 @@ cleanup:
         virDomainEventStateQueue(driver->domainEventState, event);
     if (vm)
         virDomainObjUnlock(vm);
-    lxcDriverUnlock(driver);
     return ret;
 }
 
@@ -282,6 +282,8 @@ static void virLXCProcessCleanup(virLXCDriverPtr driver,
         VIR_FREE(xml);
     }
 
+    virDomainObjUnpublishDef(vm);
+
     if (vm->newDef) {
         virDomainDefFree(vm->def);
         vm->def = vm->newDef;
@@ -799,6 +801,11 @@ virLXCProcessBuildControllerCmd(virLXCDriverPtr driver,
         virCommandPreserveFD(cmd, ttyFDs[i]);
     }
 
+    if (driver->consoleBufferSize) {
+        virCommandAddArg(cmd, "--console-buffer");
+        virCommandAddArgFormat(cmd, "%u", driver->consoleBufferSize);
+    }
+
     virCommandAddArgPair(cmd, "--security",
                          virSecurityManagerGetModel(driver->securityManager));
 
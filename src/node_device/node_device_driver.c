@@ -128,19 +128,12 @@ nodeNumOfDevices(virConnectPtr conn,
                  unsigned int flags)
 {
     virDeviceMonitorStatePtr driver = conn->devMonPrivateData;
-    int ndevs = 0;
-    unsigned int i;
+    int ndevs;
 
     virCheckFlags(0, -1);
 
     nodeDeviceLock(driver);
-    for (i = 0; i < driver->devs.count; i++) {
-        virNodeDeviceObjLock(driver->devs.objs[i]);
-        if ((cap == NULL) ||
-            virNodeDeviceHasCap(driver->devs.objs[i], cap))
-            ++ndevs;
-        virNodeDeviceObjUnlock(driver->devs.objs[i]);
-    }
+    ndevs = virNodeDeviceObjListNumOfDevices(&driver->devs, cap);
     nodeDeviceUnlock(driver);
 
     return ndevs;
@@ -153,34 +146,32 @@ nodeListDevices(virConnectPtr conn,
                 unsigned int flags)
 {
     virDeviceMonitorStatePtr driver = conn->devMonPrivateData;
-    int ndevs = 0;
-    unsigned int i;
+    int ndevs;
 
     virCheckFlags(0, -1);
 
     nodeDeviceLock(driver);
-    for (i = 0; i < driver->devs.count && ndevs < maxnames; i++) {
-        virNodeDeviceObjLock(driver->devs.objs[i]);
-        if (cap == NULL ||
-            virNodeDeviceHasCap(driver->devs.objs[i], cap)) {
-            if ((names[ndevs++] = strdup(driver->devs.objs[i]->def->name)) == NULL) {
-                virNodeDeviceObjUnlock(driver->devs.objs[i]);
-                virReportOOMError();
-                goto failure;
-            }
-        }
-        virNodeDeviceObjUnlock(driver->devs.objs[i]);
-    }
+    ndevs = virNodeDeviceObjListGetNames(&driver->devs, cap, names, maxnames);
     nodeDeviceUnlock(driver);
 
     return ndevs;
+}
 
- failure:
+int
+nodeListAllNodeDevices(virConnectPtr conn,
+                       virNodeDevicePtr **devices,
+                       unsigned int flags)
+{
+    virDeviceMonitorStatePtr driver = conn->devMonPrivateData;
+    int ret;
+
+    virCheckFlags(VIR_CONNECT_LIST_NODE_DEVICES_FILTERS_CAP, -1);
+
+    nodeDeviceLock(driver);
+    ret = virNodeDeviceList(conn, &driver->devs, devices, flags);
     nodeDeviceUnlock(driver);
-    --ndevs;
-    while (--ndevs >= 0)
-        VIR_FREE(names[ndevs]);
-    return -1;
+
+    return ret;
 }
 
 
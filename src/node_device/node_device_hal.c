@@ -551,14 +551,16 @@ static void device_cap_added(LibHalContext *ctx,
 
     nodeDeviceLock(driverState);
     dev = virNodeDeviceFindByName(&driverState->devs,name);
-    nodeDeviceUnlock(driverState);
     VIR_DEBUG("%s %s", cap, name);
     if (dev) {
         (void)gather_capability(ctx, udi, cap, &dev->def->caps);
+        /* Keep the capability index in sync with the new capability */
+        ignore_value(virNodeDeviceObjUpdateCaps(&driverState->devs, dev));
         virNodeDeviceObjUnlock(dev);
     } else {
         VIR_DEBUG("no device named %s", name);
     }
+    nodeDeviceUnlock(driverState);
 }
 
 
@@ -770,6 +772,7 @@ static virDeviceMonitor halDeviceMonitor = {
     .close = halNodeDrvClose, /* 0.5.0 */
     .numOfDevices = nodeNumOfDevices, /* 0.5.0 */
     .listDevices = nodeListDevices, /* 0.5.0 */
+    .listAllNodeDevices = nodeListAllNodeDevices, /* 0.9.14 */
     .deviceLookupByName = nodeDeviceLookupByName, /* 0.5.0 */
     .deviceGetXMLDesc = nodeDeviceGetXMLDesc, /* 0.5.0 */
     .deviceGetParent = nodeDeviceGetParent, /* 0.5.0 */
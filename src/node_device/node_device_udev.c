@@ -52,6 +52,26 @@ struct _udevPrivate {
 
 static virDeviceMonitorStatePtr driverState = NULL;
 
+/* The initial enumeration builds device definitions on several threads,
+ * one per UDEV_ENUMERATE_THREAD_MIN_DEVICES devices */
+#define UDEV_ENUMERATE_MAX_THREADS 8
+#define UDEV_ENUMERATE_THREAD_MIN_DEVICES 64
+
+/* libpciaccess loads the PCI ID database lazily and without locking */
+static virMutex udevPCIIdsLock;
+
+static int udevPCIIdsOnceInit(void)
+{
+    if (virMutexInit(&udevPCIIdsLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        return -1;
+    }
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(udevPCIIds)
+
 static int udevStrToLong_ull(char const *s,
                              char **end_ptr,
                              int base,
@@ -379,6 +399,8 @@ static int udevTranslatePCIIds(unsigned int vendor,
     m.device_class_mask = 0;
     m.match_data = 0;
 
+    virMutexLock(&udevPCIIdsLock);
+
     /* pci_get_strings returns void */
     pci_get_strings(&m,
                     &device_name,
@@ -405,6 +427,7 @@ static int udevTranslatePCIIds(unsigned int vendor,
     ret = 0;
 
 out:
+    virMutexUnlock(&udevPCIIdsLock);
     return ret;
 }
 
@@ -1223,29 +1246,25 @@ static int udevRemoveOneDevice(struct udev_device *device)
 }
 
 
-static int udevSetParent(struct udev_device *device,
-                         virNodeDeviceDefPtr def)
+static int udevSetParent(virNodeDeviceDefPtr def)
 {
-    struct udev_device *parent_device = NULL;
-    const char *parent_sysfs_path = NULL;
     virNodeDeviceObjPtr dev = NULL;
+    char *parent_sysfs_path = NULL;
+    char *p;
     int ret = -1;
 
-    parent_device = device;
-    do {
-
-        parent_device = udev_device_get_parent(parent_device);
-        if (parent_device == NULL) {
-            break;
-        }
+    if ((parent_sysfs_path = strdup(def->sysfs_path)) == NULL) {
+        virReportOOMError();
+        goto out;
+    }
 
-        parent_sysfs_path = udev_device_get_syspath(parent_device);
-        if (parent_sysfs_path == NULL) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Could not get syspath for parent of '%s'"),
-                           udev_device_get_syspath(parent_device));
-            goto out;
-        }
+    /* Like udev_device_get_parent(), walk up the sysfs directories of
+     * the device; the closest one we know about is its parent.  This
+     * doesn't need the udev device, so it also works for definitions
+     * built during the parallel enumeration. */
+    while ((p = strrchr(parent_sysfs_path, '/')) != NULL &&
+           p != parent_sysfs_path) {
+        *p = '\0';
 
         dev = virNodeDeviceFindBySysfsPath(&driverState->devs,
                                            parent_sysfs_path);
@@ -1258,15 +1277,11 @@ static int udevSetParent(struct udev_device *device,
                 goto out;
             }
 
-            def->parent_sysfs_path = strdup(parent_sysfs_path);
-            if (def->parent_sysfs_path == NULL) {
-                virReportOOMError();
-                goto out;
-            }
-
+            def->parent_sysfs_path = parent_sysfs_path;
+            parent_sysfs_path = NULL;
+            break;
         }
-
-    } while (def->parent == NULL && parent_device != NULL);
+    }
 
     if (def->parent == NULL) {
         def->parent = strdup("computer");
@@ -1280,14 +1295,17 @@ static int udevSetParent(struct udev_device *device,
     ret = 0;
 
 out:
+    VIR_FREE(parent_sysfs_path);
     return ret;
 }
 
 
-static int udevAddOneDevice(struct udev_device *device)
+/* Build the definition of @device, except for its parent.  This only
+ * looks at the device itself and may run on any thread. */
+static int udevGetDeviceDef(struct udev_device *device,
+                            virNodeDeviceDefPtr *newdef)
 {
     virNodeDeviceDefPtr def = NULL;
-    virNodeDeviceObjPtr dev = NULL;
     int ret = -1;
 
     if (VIR_ALLOC(def) != 0) {
@@ -1296,6 +1314,11 @@ static int udevAddOneDevice(struct udev_device *device)
     }
 
     def->sysfs_path = strdup(udev_device_get_syspath(device));
+    if (def->sysfs_path == NULL) {
+        virReportOOMError();
+        goto out;
+    }
+
     if (udevGetStringProperty(device,
                               "DRIVER",
                               &def->driver) == PROPERTY_ERROR) {
@@ -1315,7 +1338,24 @@ static int udevAddOneDevice(struct udev_device *device)
         goto out;
     }
 
-    if (udevSetParent(device, def) != 0) {
+    *newdef = def;
+    def = NULL;
+    ret = 0;
+
+out:
+    virNodeDeviceDefFree(def);
+    return ret;
+}
+
+
+/* Resolve the parent of @def and add it to the device list.  @def is
+ * consumed in all cases.  The driver lock must be held. */
+static int udevAssignDeviceDef(virNodeDeviceDefPtr def)
+{
+    virNodeDeviceObjPtr dev = NULL;
+    int ret = -1;
+
+    if (udevSetParent(def) != 0) {
         goto out;
     }
 
@@ -1341,37 +1381,97 @@ out:
 }
 
 
-static int udevProcessDeviceListEntry(struct udev *udev,
-                                      struct udev_list_entry *list_entry)
+static int udevAddOneDevice(struct udev_device *device)
+{
+    virNodeDeviceDefPtr def = NULL;
+
+    if (udevGetDeviceDef(device, &def) != 0) {
+        return -1;
+    }
+
+    return udevAssignDeviceDef(def);
+}
+
+
+typedef struct _udevEnumerateJob udevEnumerateJob;
+typedef udevEnumerateJob *udevEnumerateJobPtr;
+struct _udevEnumerateJob {
+    virMutex lock;
+    const char **syspaths;
+    virNodeDeviceDefPtr *defs;          /* indexed like syspaths */
+    size_t ndevices;
+    size_t next;                        /* next device to build */
+};
+
+/* Build definitions for the devices of @job which no other thread has
+ * picked up yet, using the udev context @udev of the calling thread. */
+static void udevEnumerateBuildDefs(udevEnumerateJobPtr job,
+                                   struct udev *udev)
 {
     struct udev_device *device;
-    const char *name = NULL;
-    int ret = -1;
+    size_t i;
 
-    name = udev_list_entry_get_name(list_entry);
+    for (;;) {
+        virMutexLock(&job->lock);
+        i = job->next;
+        if (i < job->ndevices)
+            job->next++;
+        virMutexUnlock(&job->lock);
 
-    device = udev_device_new_from_syspath(udev, name);
+        if (i >= job->ndevices)
+            break;
 
-    if (device != NULL) {
-        if (udevAddOneDevice(device) != 0) {
+        device = udev_device_new_from_syspath(udev, job->syspaths[i]);
+        if (device == NULL)
+            continue;
+
+        if (udevGetDeviceDef(device, &job->defs[i]) != 0) {
             VIR_DEBUG("Failed to create node device for udev device '%s'",
-                      name);
+                      job->syspaths[i]);
         }
-        ret = 0;
+
+        udev_device_unref(device);
     }
+}
 
-    udev_device_unref(device);
+static void udevEnumerateThread(void *opaque)
+{
+    udevEnumerateJobPtr job = opaque;
+    struct udev *udev;
 
-    return ret;
+    /* udev contexts must not be shared between threads */
+    if ((udev = udev_new()) == NULL)
+        return;
+    udev_set_log_fn(udev, udevLogFunction);
+
+    udevEnumerateBuildDefs(job, udev);
+
+    udev_unref(udev);
 }
 
 
+/*
+ * Enumerate the existing devices.  Reading the sysfs attributes of
+ * thousands of devices dominates startup, so the definitions are built
+ * in parallel; they are then added in enumeration order, which lists
+ * parents before their children, so parents resolve as before.
+ */
 static int udevEnumerateDevices(struct udev *udev)
 {
     struct udev_enumerate *udev_enumerate = NULL;
     struct udev_list_entry *list_entry = NULL;
+    udevEnumerateJob job;
+    virThread threads[UDEV_ENUMERATE_MAX_THREADS];
+    size_t nthreads, nstarted = 0, i;
     int ret = 0;
 
+    memset(&job, 0, sizeof(job));
+    if (virMutexInit(&job.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        return -1;
+    }
+
     udev_enumerate = udev_enumerate_new(udev);
 
     ret = udev_enumerate_scan_devices(udev_enumerate);
@@ -1382,12 +1482,65 @@ static int udevEnumerateDevices(struct udev *udev)
 
     udev_list_entry_foreach(list_entry,
                             udev_enumerate_get_list_entry(udev_enumerate)) {
+        job.ndevices++;
+    }
+
+    if (VIR_ALLOC_N(job.syspaths, job.ndevices) < 0 ||
+        VIR_ALLOC_N(job.defs, job.ndevices) < 0) {
+        virReportOOMError();
+        ret = -1;
+        goto out;
+    }
+
+    i = 0;
+    udev_list_entry_foreach(list_entry,
+                            udev_enumerate_get_list_entry(udev_enumerate)) {
+        job.syspaths[i++] = udev_list_entry_get_name(list_entry);
+    }
+
+    nthreads = job.ndevices / UDEV_ENUMERATE_THREAD_MIN_DEVICES;
+    if (nthreads > UDEV_ENUMERATE_MAX_THREADS)
+        nthreads = UDEV_ENUMERATE_MAX_THREADS;
 
-        udevProcessDeviceListEntry(udev, list_entry);
+    /* The calling thread works along with the others and finishes the
+     * job on its own if no thread could be started */
+    for (i = 1; i < nthreads; i++) {
+        if (virThreadCreate(&threads[nstarted], true,
+                            udevEnumerateThread, &job) < 0) {
+            VIR_WARN("Unable to create udev enumeration thread");
+            break;
+        }
+        nstarted++;
+    }
+
+    udevEnumerateBuildDefs(&job, udev);
+
+    for (i = 0; i < nstarted; i++)
+        virThreadJoin(&threads[i]);
+
+    VIR_DEBUG("Built %zu device definitions using %zu threads",
+              job.ndevices, nstarted + 1);
+
+    for (i = 0; i < job.ndevices; i++) {
+        if (job.defs[i] == NULL)
+            continue;
+
+        if (udevAssignDeviceDef(job.defs[i]) != 0) {
+            VIR_DEBUG("Failed to create node device for udev device '%s'",
+                      job.syspaths[i]);
+        }
+        job.defs[i] = NULL;
     }
 
 out:
+    if (job.defs) {
+        for (i = 0; i < job.ndevices; i++)
+            virNodeDeviceDefFree(job.defs[i]);
+    }
+    VIR_FREE(job.defs);
+    VIR_FREE(job.syspaths);
     udev_enumerate_unref(udev_enumerate);
+    virMutexDestroy(&job.lock);
     return ret;
 }
 
@@ -1630,6 +1783,11 @@ static int udevDeviceMonitorStartup(int privileged ATTRIBUTE_UNUSED)
     }
 #endif
 
+    if (udevPCIIdsInitialize() < 0) {
+        ret = -1;
+        goto out;
+    }
+
     if (VIR_ALLOC(priv) < 0) {
         virReportOOMError();
         ret = -1;
@@ -1757,6 +1915,7 @@ static virDeviceMonitor udevDeviceMonitor = {
     .close = udevNodeDrvClose, /* 0.7.3 */
     .numOfDevices = nodeNumOfDevices, /* 0.7.3 */
     .listDevices = nodeListDevices, /* 0.7.3 */
+    .listAllNodeDevices = nodeListAllNodeDevices, /* 0.9.14 */
     .deviceLookupByName = nodeDeviceLookupByName, /* 0.7.3 */
     .deviceGetXMLDesc = nodeDeviceGetXMLDesc, /* 0.7.3 */
     .deviceGetParent = nodeDeviceGetParent, /* 0.7.3 */
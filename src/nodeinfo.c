@@ -48,6 +48,7 @@
 #include "count-one-bits.h"
 #include "intprops.h"
 #include "virfile.h"
+#include "threads.h"
 
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -62,10 +63,17 @@
 # define LINUX_NB_MEMORY_STATS_ALL 4
 # define LINUX_NB_MEMORY_STATS_CELL 2
 
-/* NB, this is not static as we need to call it from the testsuite */
+/* NB, these are not static as we need to call them from the testsuite */
 int linuxNodeInfoCPUPopulate(FILE *cpuinfo,
                              const char *sysfs_dir,
                              virNodeInfoPtr nodeinfo);
+int linuxNodeInfoCPUPopulateCached(const char *cpuinfo_path,
+                                   const char *sysfs_dir,
+                                   virNodeInfoPtr nodeinfo);
+int linuxNodeGetCellsFreeMemory(const char *sysfs_dir,
+                                unsigned long long *freeMems,
+                                int startCell,
+                                int maxCells);
 
 static int linuxNodeGetCPUStats(FILE *procstat,
                                 int cpuNum,
@@ -719,6 +727,237 @@ cleanup:
     return ret;
 }
 
+/*
+ * The CPU topology of the host only changes when CPUs are brought
+ * online or offline, which is reflected in the list of online CPUs,
+ * so /proc/cpuinfo and the per CPU sysfs files are only parsed again
+ * when that list changed.
+ */
+static virMutex linuxNodeInfoLock;
+static char *linuxNodeInfoSysfsDir;
+static char *linuxNodeInfoOnline;
+static bool linuxNodeInfoValid;
+static virNodeInfo linuxNodeInfo;
+
+static int linuxNodeInfoOnceInit(void)
+{
+    if (virMutexInit(&linuxNodeInfoLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Failed to initialized mutex"));
+        return -1;
+    }
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(linuxNodeInfo)
+
+
+/* Read the list of online CPUs below @sysfs_dir into @online, which
+ * is left empty if the kernel doesn't support CPU hotplug */
+static int
+linuxNodeInfoGetOnline(const char *sysfs_dir, char **online)
+{
+    char *path;
+    int ret = -1;
+
+    if (virAsprintf(&path, "%s/cpu/online", sysfs_dir) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (!virFileExists(path)) {
+        if (!(*online = strdup(""))) {
+            virReportOOMError();
+            goto cleanup;
+        }
+    } else if (virFileReadAll(path, 5 * VIR_DOMAIN_CPUMASK_LEN, online) < 0) {
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(path);
+    return ret;
+}
+
+int linuxNodeInfoCPUPopulateCached(const char *cpuinfo_path,
+                                   const char *sysfs_dir,
+                                   virNodeInfoPtr nodeinfo)
+{
+    char *online = NULL;
+    FILE *cpuinfo = NULL;
+    virNodeInfo info;
+    int ret = -1;
+
+    if (linuxNodeInfoInitialize() < 0)
+        return -1;
+
+    if (linuxNodeInfoGetOnline(sysfs_dir, &online) < 0)
+        return -1;
+
+    virMutexLock(&linuxNodeInfoLock);
+
+    if (!linuxNodeInfoValid ||
+        STRNEQ(linuxNodeInfoSysfsDir, sysfs_dir) ||
+        STRNEQ(linuxNodeInfoOnline, online)) {
+        linuxNodeInfoValid = false;
+
+        if (!(cpuinfo = fopen(cpuinfo_path, "r"))) {
+            virReportSystemError(errno,
+                                 _("cannot open %s"), cpuinfo_path);
+            goto cleanup;
+        }
+
+        memset(&info, 0, sizeof(info));
+        if (linuxNodeInfoCPUPopulate(cpuinfo, sysfs_dir, &info) < 0)
+            goto cleanup;
+
+        VIR_FREE(linuxNodeInfoSysfsDir);
+        if (!(linuxNodeInfoSysfsDir = strdup(sysfs_dir))) {
+            virReportOOMError();
+            goto cleanup;
+        }
+        VIR_FREE(linuxNodeInfoOnline);
+        linuxNodeInfoOnline = online;
+        online = NULL;
+
+        linuxNodeInfo = info;
+        linuxNodeInfoValid = true;
+    }
+
+    nodeinfo->cpus = linuxNodeInfo.cpus;
+    nodeinfo->mhz = linuxNodeInfo.mhz;
+    nodeinfo->nodes = linuxNodeInfo.nodes;
+    nodeinfo->sockets = linuxNodeInfo.sockets;
+    nodeinfo->cores = linuxNodeInfo.cores;
+    nodeinfo->threads = linuxNodeInfo.threads;
+
+    ret = 0;
+
+cleanup:
+    virMutexUnlock(&linuxNodeInfoLock);
+    VIR_FORCE_FCLOSE(cpuinfo);
+    VIR_FREE(online);
+    return ret;
+}
+
+/* Return the highest NUMA cell number below @sysfs_dir, -2 if there
+ * is no NUMA information, or -1 on error */
+static int
+linuxNodeGetMaxCell(const char *sysfs_dir)
+{
+    char *path;
+    DIR *dir;
+    struct dirent *ent;
+    unsigned int cell;
+    int max = -2;
+
+    if (virAsprintf(&path, "%s/node", sysfs_dir) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (!(dir = opendir(path))) {
+        VIR_FREE(path);
+        return -2;
+    }
+
+    errno = 0;
+    while ((ent = readdir(dir))) {
+        if (sscanf(ent->d_name, "node%u", &cell) == 1 &&
+            (int)cell > max)
+            max = cell;
+        errno = 0;
+    }
+
+    if (errno) {
+        virReportSystemError(errno, _("problem reading %s"), path);
+        max = -1;
+    }
+
+    closedir(dir);
+    VIR_FREE(path);
+    return max;
+}
+
+/*
+ * Fill @freeMems with the free memory in bytes of up to @maxCells
+ * NUMA cells starting at @startCell, read from the meminfo file of
+ * each cell below @sysfs_dir.
+ *
+ * Returns the number of cells filled in, -2 if there is no NUMA
+ * information below @sysfs_dir, or -1 on error.
+ */
+int linuxNodeGetCellsFreeMemory(const char *sysfs_dir,
+                                unsigned long long *freeMems,
+                                int startCell,
+                                int maxCells)
+{
+    char *path = NULL;
+    FILE *meminfo = NULL;
+    char line[1024];
+    int maxCell, lastCell, numCells, n;
+    int ret = -1;
+
+    if ((maxCell = linuxNodeGetMaxCell(sysfs_dir)) < 0)
+        return maxCell;
+
+    if (startCell > maxCell) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("start cell %d out of range (0-%d)"),
+                       startCell, maxCell);
+        goto cleanup;
+    }
+    lastCell = startCell + maxCells - 1;
+    if (lastCell > maxCell)
+        lastCell = maxCell;
+
+    for (numCells = 0, n = startCell ; n <= lastCell ; n++) {
+        unsigned long long mem;
+        bool found = false;
+
+        if (virAsprintf(&path, "%s/node/node%d/meminfo", sysfs_dir, n) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        if (!(meminfo = fopen(path, "r"))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to query NUMA free memory for node: %d"),
+                           n);
+            goto cleanup;
+        }
+
+        /* Node 0 MemFree:         5300920 kB */
+        while (fgets(line, sizeof(line), meminfo) != NULL) {
+            if (sscanf(line, "Node %*u MemFree: %llu kB", &mem) == 1) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to query NUMA free memory for node: %d"),
+                           n);
+            goto cleanup;
+        }
+
+        freeMems[numCells++] = mem * 1024;
+
+        VIR_FORCE_FCLOSE(meminfo);
+        VIR_FREE(path);
+    }
+    ret = numCells;
+
+cleanup:
+    VIR_FORCE_FCLOSE(meminfo);
+    VIR_FREE(path);
+    return ret;
+}
+
 /*
  * Linux maintains cpu bit map. For example, if cpuid=5's flag is not set
  * and max cpu is 7. The map file shows 0-4,6-7. This function parses
@@ -772,26 +1011,14 @@ int nodeGetInfo(virConnectPtr conn ATTRIBUTE_UNUSED, virNodeInfoPtr nodeinfo) {
         return -1;
 
 #ifdef __linux__
-    {
-    int ret = -1;
-    FILE *cpuinfo = fopen(CPUINFO_PATH, "r");
-    if (!cpuinfo) {
-        virReportSystemError(errno,
-                             _("cannot open %s"), CPUINFO_PATH);
+    if (linuxNodeInfoCPUPopulateCached(CPUINFO_PATH, SYSFS_SYSTEM_PATH,
+                                       nodeinfo) < 0)
         return -1;
-    }
-
-    ret = linuxNodeInfoCPUPopulate(cpuinfo, SYSFS_SYSTEM_PATH, nodeinfo);
-    if (ret < 0)
-        goto cleanup;
 
     /* Convert to KB. */
     nodeinfo->memory = physmem_total () / 1024;
 
-cleanup:
-    VIR_FORCE_FCLOSE(cpuinfo);
-    return ret;
-    }
+    return 0;
 #else
     /* XXX Solaris will need an impl later if they port QEMU driver */
     virReportError(VIR_ERR_NO_SUPPORT, "%s",
@@ -931,24 +1158,47 @@ nodeGetCPUmap(virConnectPtr conn ATTRIBUTE_UNUSED,
 # define MASK_CPU_ISSET(mask, cpu) \
   (((mask)[((cpu) / n_bits(*(mask)))] >> ((cpu) % n_bits(*(mask)))) & 1)
 
-int
-nodeCapsInitNUMA(virCapsPtr caps)
+typedef struct _nodeNUMACell nodeNUMACell;
+typedef nodeNUMACell *nodeNUMACellPtr;
+struct _nodeNUMACell {
+    int num;
+    int ncpus;
+    int *cpus;
+};
+
+/* CPUs of each NUMA cell, guarded by linuxNodeInfoLock and collected
+ * again whenever the list of online CPUs changed */
+static nodeNUMACellPtr nodeNUMACells;
+static size_t nnodeNUMACells;
+static char *nodeNUMAOnline;
+
+static void
+nodeNUMACellsFree(nodeNUMACellPtr cells, size_t ncells)
+{
+    size_t i;
+
+    for (i = 0 ; i < ncells ; i++)
+        VIR_FREE(cells[i].cpus);
+    VIR_FREE(cells);
+}
+
+static int
+nodeNUMACellsPopulate(nodeNUMACellPtr *retcells, size_t *nretcells)
 {
     int n;
     unsigned long *mask = NULL;
     unsigned long *allonesmask = NULL;
+    nodeNUMACellPtr cells = NULL;
+    size_t ncells = 0;
     int *cpus = NULL;
     int ret = -1;
     int max_n_cpus = NUMA_MAX_N_CPUS;
-
-    if (numa_available() < 0)
-        return 0;
-
     int mask_n_bytes = max_n_cpus / 8;
+
     if (VIR_ALLOC_N(mask, mask_n_bytes / sizeof(*mask)) < 0)
-        goto cleanup;
+        goto no_memory;
     if (VIR_ALLOC_N(allonesmask, mask_n_bytes / sizeof(*mask)) < 0)
-        goto cleanup;
+        goto no_memory;
     memset(allonesmask, 0xff, mask_n_bytes);
 
     for (n = 0 ; n <= numa_max_node() ; n++) {
@@ -972,28 +1222,85 @@ nodeCapsInitNUMA(virCapsPtr caps)
                 ncpus++;
 
         if (VIR_ALLOC_N(cpus, ncpus) < 0)
-            goto cleanup;
+            goto no_memory;
 
         for (ncpus = 0, i = 0 ; i < max_n_cpus ; i++)
             if (MASK_CPU_ISSET(mask, i))
                 cpus[ncpus++] = i;
 
-        if (virCapabilitiesAddHostNUMACell(caps,
-                                           n,
-                                           ncpus,
-                                           cpus) < 0)
-            goto cleanup;
+        if (VIR_REALLOC_N(cells, ncells + 1) < 0)
+            goto no_memory;
 
-        VIR_FREE(cpus);
+        cells[ncells].num = n;
+        cells[ncells].ncpus = ncpus;
+        cells[ncells].cpus = cpus;
+        ncells++;
+        cpus = NULL;
     }
 
+    *retcells = cells;
+    *nretcells = ncells;
+    cells = NULL;
+    ncells = 0;
     ret = 0;
 
 cleanup:
+    nodeNUMACellsFree(cells, ncells);
     VIR_FREE(cpus);
     VIR_FREE(mask);
     VIR_FREE(allonesmask);
     return ret;
+
+no_memory:
+    virReportOOMError();
+    goto cleanup;
+}
+
+int
+nodeCapsInitNUMA(virCapsPtr caps)
+{
+    char *online = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (numa_available() < 0)
+        return 0;
+
+    if (linuxNodeInfoInitialize() < 0)
+        return -1;
+
+    if (linuxNodeInfoGetOnline(SYSFS_SYSTEM_PATH, &online) < 0)
+        return -1;
+
+    virMutexLock(&linuxNodeInfoLock);
+
+    if (!nodeNUMAOnline || STRNEQ(nodeNUMAOnline, online)) {
+        nodeNUMACellsFree(nodeNUMACells, nnodeNUMACells);
+        nodeNUMACells = NULL;
+        nnodeNUMACells = 0;
+        VIR_FREE(nodeNUMAOnline);
+
+        if (nodeNUMACellsPopulate(&nodeNUMACells, &nnodeNUMACells) < 0)
+            goto cleanup;
+
+        nodeNUMAOnline = online;
+        online = NULL;
+    }
+
+    for (i = 0 ; i < nnodeNUMACells ; i++) {
+        if (virCapabilitiesAddHostNUMACell(caps,
+                                           nodeNUMACells[i].num,
+                                           nodeNUMACells[i].ncpus,
+                                           nodeNUMACells[i].cpus) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    virMutexUnlock(&linuxNodeInfoLock);
+    VIR_FREE(online);
+    return ret;
 }
 
 
@@ -1007,6 +1314,12 @@ nodeGetCellsFreeMemory(virConnectPtr conn ATTRIBUTE_UNUSED,
     int ret = -1;
     int maxCell;
 
+    /* Read all cells at once from sysfs if possible */
+    if ((ret = linuxNodeGetCellsFreeMemory(SYSFS_SYSTEM_PATH, freeMems,
+                                           startCell, maxCells)) != -2)
+        return ret;
+    ret = -1;
+
     if (numa_available() < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("NUMA not supported on this host"));
@@ -1043,7 +1356,27 @@ unsigned long long
 nodeGetFreeMemory(virConnectPtr conn ATTRIBUTE_UNUSED)
 {
     unsigned long long freeMem = 0;
-    int n;
+    unsigned long long *freeMems = NULL;
+    int n, maxCell, ncells;
+
+    if ((maxCell = linuxNodeGetMaxCell(SYSFS_SYSTEM_PATH)) != -2) {
+        if (maxCell < 0)
+            return 0;
+
+        if (VIR_ALLOC_N(freeMems, maxCell + 1) < 0) {
+            virReportOOMError();
+            return 0;
+        }
+
+        if ((ncells = linuxNodeGetCellsFreeMemory(SYSFS_SYSTEM_PATH, freeMems,
+                                                  0, maxCell + 1)) > 0) {
+            for (n = 0 ; n < ncells ; n++)
+                freeMem += freeMems[n];
+        }
+
+        VIR_FREE(freeMems);
+        return freeMem;
+    }
 
     if (numa_available() < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
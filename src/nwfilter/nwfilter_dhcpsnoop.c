@@ -47,6 +47,7 @@
 #endif
 
 #include <fcntl.h>
+#include <poll.h>
 
 #include <arpa/inet.h>
 #include <netinet/ip.h>
@@ -60,6 +61,7 @@
 #include "conf/domain_conf.h"
 #include "nwfilter_gentech_driver.h"
 #include "nwfilter_dhcpsnoop.h"
+#include "nwfilter_dhcpsnooppriv.h"
 #include "nwfilter_ipaddrmap.h"
 #include "virnetdev.h"
 #include "virfile.h"
@@ -75,18 +77,30 @@
 # define LEASEFILE LOCALSTATEDIR "/run/libvirt/network/nwfilter.leases"
 # define TMPLEASEFILE LOCALSTATEDIR "/run/libvirt/network/nwfilter.ltmp"
 
+typedef struct _virNWFilterSnoopCapture virNWFilterSnoopCapture;
+typedef virNWFilterSnoopCapture *virNWFilterSnoopCapturePtr;
+
 struct virNWFilterSnoopState {
     /* lease file */
     int                  leaseFD;
     virAtomicInt         nLeases; /* number of active leases */
     virAtomicInt         wLeases; /* number of written leases */
-    virAtomicInt         nThreads; /* number of running threads */
+    virAtomicInt         nThreads; /* number of snooped interfaces */
     /* thread management */
     virHashTablePtr      snoopReqs;
     virHashTablePtr      ifnameToKey;
     virMutex             snoopLock;  /* protects SnoopReqs and IfNameToKey */
     virHashTablePtr      active;
     virMutex             activeLock; /* protects Active */
+    /* capture engine */
+    virThread            engineThread;
+    bool                 engineRunning;
+    bool                 engineQuit;
+    int                  engineWakeupFD[2];
+    virNWFilterSnoopCapturePtr *newCaptures; /* not yet seen by the engine */
+    size_t               nNewCaptures;
+    virMutex             engineLock; /* protects engineQuit and newCaptures */
+    virThreadPoolPtr     decoder;
 };
 
 # define virNWFilterSnoopLock() \
@@ -114,11 +128,8 @@ typedef virNWFilterSnoopReq *virNWFilterSnoopReqPtr;
 typedef struct _virNWFilterSnoopIPLease virNWFilterSnoopIPLease;
 typedef virNWFilterSnoopIPLease *virNWFilterSnoopIPLeasePtr;
 
-typedef enum {
-    THREAD_STATUS_NONE,
-    THREAD_STATUS_OK,
-    THREAD_STATUS_FAIL,
-} virNWFilterSnoopThreadStatus;
+typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
+typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
 
 struct _virNWFilterSnoopReq {
     /*
@@ -143,11 +154,20 @@ struct _virNWFilterSnoopReq {
     virNWFilterSnoopIPLeasePtr           end;
     char                                *threadkey;
 
-    virNWFilterSnoopThreadStatus         threadStatus;
-    virCond                              threadStatusCond;
-
     int                                  jobCompletionStatus;
-    /* the number of submitted jobs in the worker's queue */
+
+    /*
+     * packets waiting to be decoded, in the order they were captured;
+     * at most one decoder worker handles the req at any time
+     */
+    virNWFilterDHCPDecodeJobPtr          jobsHead;
+    virNWFilterDHCPDecodeJobPtr          jobsTail;
+    /* the number of queued jobs per capture direction */
+    unsigned int                         queuedJobs[2];
+    bool                                 jobScheduled;
+    /* protects the members above down to jobsHead */
+    virMutex                             jobLock;
+
     /*
      * protect those members that can change while the
      * req is on the public SnoopReq hash and
@@ -157,7 +177,6 @@ struct _virNWFilterSnoopReq {
      * - start
      * - end
      * - a lease while it is on the list
-     * - threadStatus
      * (for refctr, see above)
      */
     virMutex                             lock;
@@ -167,6 +186,7 @@ struct _virNWFilterSnoopReq {
  * Note about lock-order:
  * 1st: virNWFilterSnoopLock()
  * 2nd: virNWFilterSnoopReqLock(req)
+ * 3rd: req->jobLock or the engine lock
  *
  * Rationale: Former protects the SnoopReqs hash, latter its contents
  */
@@ -219,11 +239,6 @@ struct _virNWFilterSnoopDHCPHdr {
 # define DHCPO_MTYPE      53     /* message type */
 # define DHCPO_END       255     /* end of options */
 
-/* DHCP message types */
-# define DHCPDECLINE     4
-# define DHCPACK         5
-# define DHCPRELEASE     7
-
 # define MIN_VALID_DHCP_PKT_SIZE \
     (offsetof(virNWFilterSnoopEthHdr, eh_data) + \
      sizeof(struct udphdr) + \
@@ -233,14 +248,11 @@ struct _virNWFilterSnoopDHCPHdr {
 # define PCAP_READ_MAXERRS          25 /* retries on failing device */
 # define PCAP_FLOOD_TIMEOUT_MS      10 /* ms */
 
-typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
-typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
-
 struct _virNWFilterDHCPDecodeJob {
     unsigned char packet[PCAP_PBUFSIZE];
     int caplen;
     bool fromVM;
-    virAtomicIntPtr qCtr;
+    virNWFilterDHCPDecodeJobPtr next;
 };
 
 # define DHCP_PKT_RATE          10 /* pkts/sec */
@@ -251,6 +263,9 @@ struct _virNWFilterDHCPDecodeJob {
 
 # define MAX_QUEUED_JOBS        (DHCP_PKT_BURST + 2 * DHCP_PKT_RATE)
 
+# define DHCP_DECODE_WORKERS    16 /* max. threads decoding packets */
+# define DHCP_LEASE_CHECK_S     10 /* sec between checks for expired leases */
+
 typedef struct _virNWFilterSnoopRateLimitConf virNWFilterSnoopRateLimitConf;
 typedef virNWFilterSnoopRateLimitConf *virNWFilterSnoopRateLimitConfPtr;
 
@@ -258,9 +273,9 @@ struct _virNWFilterSnoopRateLimitConf {
     time_t prev;
     unsigned int pkt_ctr;
     time_t burst;
-    const unsigned int rate;
-    const unsigned int burstRate;
-    const unsigned int burstInterval;
+    unsigned int rate;
+    unsigned int burstRate;
+    unsigned int burstInterval;
 };
 
 typedef struct _virNWFilterSnoopPcapConf virNWFilterSnoopPcapConf;
@@ -268,14 +283,44 @@ typedef virNWFilterSnoopPcapConf *virNWFilterSnoopPcapConfPtr;
 
 struct _virNWFilterSnoopPcapConf {
     pcap_t *handle;
-    const pcap_direction_t dir;
+    pcap_direction_t dir;
     const char *filter;
     virNWFilterSnoopRateLimitConf rateLimit; /* indep. rate limiters */
-    virAtomicInt qCtr; /* number of jobs in the worker's queue */
-    const unsigned int maxQSize;
+    unsigned int maxQSize;
     unsigned long long penaltyTimeoutAbs;
 };
 
+/*
+ * An interface being snooped by the capture engine. Only the engine
+ * thread touches it once it has been handed over.
+ */
+struct _virNWFilterSnoopCapture {
+    virNWFilterSnoopReqPtr req; /* holds a reference */
+    char *ifname;
+    char *threadkey;
+    int ifindex;
+    int errcount;
+    bool failed;
+    time_t last_displayed;
+    time_t last_displayed_queue;
+    virNWFilterSnoopPcapConf pcapConf[2]; /* from VM, to VM */
+};
+
+/*
+ * Packets collected from one pcap_dispatch() run
+ */
+typedef struct _virNWFilterSnoopBatch virNWFilterSnoopBatch;
+typedef virNWFilterSnoopBatch *virNWFilterSnoopBatchPtr;
+
+struct _virNWFilterSnoopBatch {
+    virNWFilterSnoopCapturePtr cap;
+    virNWFilterSnoopPcapConfPtr pc;
+    unsigned int queued; /* jobs already queued on the req */
+    virNWFilterDHCPDecodeJobPtr head;
+    virNWFilterDHCPDecodeJobPtr tail;
+    bool error;
+};
+
 /* local function prototypes */
 static int virNWFilterSnoopReqLeaseDel(virNWFilterSnoopReqPtr req,
                                        virSocketAddrPtr ipaddr,
@@ -287,10 +332,12 @@ static void virNWFilterSnoopReqUnlock(virNWFilterSnoopReqPtr req);
 
 static void virNWFilterSnoopLeaseFileLoad(void);
 static void virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLeasePtr ipl);
+static void virNWFilterSnoopLeaseFileRefresh(void);
 
 /* local variables */
 static struct virNWFilterSnoopState virNWFilterSnoopState = {
     .leaseFD = -1,
+    .engineWakeupFD = { -1, -1 },
 };
 
 static const unsigned char dhcp_magic[4] = { 99, 130, 83, 99 };
@@ -317,6 +364,20 @@ virNWFilterSnoopActivate(virNWFilterSnoopReqPtr req)
     return key;
 }
 
+/*
+ * Interrupt the capture engine's poll() so it picks up new interfaces
+ * and notices cancelled ones.
+ */
+static void
+virNWFilterSnoopEngineWakeup(void)
+{
+    char c = 0;
+
+    if (virNWFilterSnoopState.engineWakeupFD[1] >= 0)
+        ignore_value(safewrite(virNWFilterSnoopState.engineWakeupFD[1],
+                               &c, sizeof(c)));
+}
+
 static void
 virNWFilterSnoopCancel(char **threadKey)
 {
@@ -329,6 +390,8 @@ virNWFilterSnoopCancel(char **threadKey)
     VIR_FREE(*threadKey);
 
     virNWFilterSnoopActiveUnlock();
+
+    virNWFilterSnoopEngineWakeup();
 }
 
 static bool
@@ -586,14 +649,12 @@ virNWFilterSnoopReqNew(const char *ifkey)
         return NULL;
     }
 
-    req->threadStatus = THREAD_STATUS_NONE;
-
     if (virAtomicIntInit(&req->refctr) < 0 ||
         virStrcpyStatic(req->ifkey, ifkey) == NULL ||
         virMutexInitRecursive(&req->lock) < 0)
         goto err_free_req;
 
-    if (virCondInit(&req->threadStatusCond) < 0)
+    if (virMutexInit(&req->jobLock) < 0)
         goto err_destroy_mutex;
 
     virNWFilterSnoopReqGet(req);
@@ -618,6 +679,7 @@ static void
 virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
 {
     virNWFilterSnoopIPLeasePtr ipl;
+    virNWFilterDHCPDecodeJobPtr job;
 
     if (!req)
         return;
@@ -629,6 +691,12 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
     for (ipl = req->start; ipl; ipl = req->start)
         virNWFilterSnoopReqLeaseDel(req, &ipl->ipAddress, false, false);
 
+    /* drop packets nobody is going to decode anymore */
+    while ((job = req->jobsHead)) {
+        req->jobsHead = job->next;
+        VIR_FREE(job);
+    }
+
     /* free all req data */
     VIR_FREE(req->ifname);
     VIR_FREE(req->linkdev);
@@ -636,7 +704,7 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
     virNWFilterHashTableFree(req->vars);
 
     virMutexDestroy(&req->lock);
-    ignore_value(virCondDestroy(&req->threadStatusCond));
+    virMutexDestroy(&req->jobLock);
 
     VIR_FREE(req);
 }
@@ -969,25 +1037,25 @@ malformed:
 }
 
 /*
- * Decode the DHCP options
+ * Decode a captured DHCP frame into @msg
  *
- * Returns 0 in case of full success.
- * Returns -2 in case of some error with the packet.
- * Returns -1 in case of error with the installation of rules
+ * Returns 0 for an ACK, DECLINE or RELEASE seen in the direction it
+ * is expected in, -1 for anything else.
  */
-static int
-virNWFilterSnoopDHCPDecode(virNWFilterSnoopReqPtr req,
-                           virNWFilterSnoopEthHdrPtr pep,
-                           int len, bool fromVM)
+int
+virNWFilterSnoopDHCPParse(const unsigned char *frame,
+                          int len, bool fromVM,
+                          virNWFilterSnoopDHCPMsgPtr msg)
 {
+    virNWFilterSnoopEthHdrPtr pep = (virNWFilterSnoopEthHdrPtr) frame;
     struct iphdr *pip;
     struct udphdr *pup;
     virNWFilterSnoopDHCPHdrPtr pd;
-    virNWFilterSnoopIPLease ipl;
-    uint8_t mtype;
-    uint32_t leasetime;
     uint32_t nwint;
 
+    if (len < (int) offsetof(virNWFilterSnoopEthHdr, eh_data))
+        return -1;
+
     /* go through the protocol headers */
     switch (ntohs(pep->eh_type)) {
     case ETHERTYPE_IP:
@@ -995,56 +1063,77 @@ virNWFilterSnoopDHCPDecode(virNWFilterSnoopReqPtr req,
         len -= offsetof(virNWFilterSnoopEthHdr, eh_data);
         break;
     default:
-        return -2;
+        return -1;
     }
 
-    if (len < 0)
-        return -2;
+    if (len < (int) sizeof(*pip))
+        return -1;
 
     pup = (struct udphdr *) ((char *) pip + (pip->ihl << 2));
     len -= pip->ihl << 2;
     if (len < 0)
-        return -2;
+        return -1;
 
     pd = (virNWFilterSnoopDHCPHdrPtr) ((char *) pup + sizeof(*pup));
     len -= sizeof(*pup);
     if (len < 0)
-        return -2;                 /* invalid packet length */
+        return -1;                 /* invalid packet length */
 
-    if (virNWFilterSnoopDHCPGetOpt(pd, len, &mtype, &leasetime) < 0)
-        return -2;
+    memset(msg, 0, sizeof(*msg));
 
-    memset(&ipl, 0, sizeof(ipl));
+    if (virNWFilterSnoopDHCPGetOpt(pd, len, &msg->mtype, &msg->leasetime) < 0)
+        return -1;
 
     memcpy(&nwint, &pd->d_yiaddr, sizeof(nwint));
-    virSocketAddrSetIPv4Addr(&ipl.ipAddress, ntohl(nwint));
+    virSocketAddrSetIPv4Addr(&msg->ipAddress, ntohl(nwint));
 
     memcpy(&nwint, &pd->d_siaddr, sizeof(nwint));
-    virSocketAddrSetIPv4Addr(&ipl.ipServer, ntohl(nwint));
-
-    if (leasetime == ~0)
-        ipl.timeout = ~0;
-    else
-        ipl.timeout = time(0) + leasetime;
-
-    ipl.snoopReq = req;
+    virSocketAddrSetIPv4Addr(&msg->ipServer, ntohl(nwint));
 
     /* check that the type of message comes from the right direction */
-    switch (mtype) {
+    switch (msg->mtype) {
     case DHCPACK:
     case DHCPDECLINE:
-        if (fromVM)
-            return -2;
-        break;
+        return fromVM ? -1 : 0;
     case DHCPRELEASE:
-        if (!fromVM)
-            return -2;
-        break;
+        return fromVM ? 0 : -1;
     default:
-        break;
+        return -1;
     }
+}
+
+/*
+ * Decode a DHCP packet and update the leases of the req
+ *
+ * Returns 0 in case of full success.
+ * Returns -2 in case of some error with the packet.
+ * Returns -1 in case of error with the installation of rules
+ */
+static int
+virNWFilterSnoopDHCPDecode(virNWFilterSnoopReqPtr req,
+                           virNWFilterSnoopEthHdrPtr pep,
+                           int len, bool fromVM)
+{
+    virNWFilterSnoopDHCPMsg msg;
+    virNWFilterSnoopIPLease ipl;
 
-    switch (mtype) {
+    if (virNWFilterSnoopDHCPParse((const unsigned char *) pep, len,
+                                  fromVM, &msg) < 0)
+        return -2;
+
+    memset(&ipl, 0, sizeof(ipl));
+
+    ipl.ipAddress = msg.ipAddress;
+    ipl.ipServer = msg.ipServer;
+
+    if (msg.leasetime == ~0)
+        ipl.timeout = ~0;
+    else
+        ipl.timeout = time(0) + msg.leasetime;
+
+    ipl.snoopReq = req;
+
+    switch (msg.mtype) {
     case DHCPACK:
         if (virNWFilterSnoopReqLeaseAdd(req, &ipl, true) < 0)
             return -1;
@@ -1107,6 +1196,13 @@ virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
         goto cleanup;
     }
 
+    /* the capture engine must never block on a single interface */
+    if (pcap_setnonblock(handle, 1, pcap_errbuf) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("pcap_setnonblock: %s"), pcap_errbuf);
+        goto cleanup;
+    }
+
     if (pcap_compile(handle, &fp, ext_filter, 1, PCAP_NETMASK_UNKNOWN) != 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("pcap_compile: %s"), pcap_geterr(handle));
@@ -1142,58 +1238,100 @@ cleanup_nohandle:
 }
 
 /*
- * Worker function to decode the DHCP message and with that
- * also do the time-consuming work of instantiating the filters
+ * Worker function to decode the DHCP messages queued on a req and
+ * with that also do the time-consuming work of instantiating the
+ * filters. Also expires old leases of the req.
  */
-static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque)
+static void virNWFilterDHCPDecodeWorker(void *jobdata,
+                                        void *opaque ATTRIBUTE_UNUSED)
 {
-    virNWFilterSnoopReqPtr req = opaque;
-    virNWFilterDHCPDecodeJobPtr job = jobdata;
-    virNWFilterSnoopEthHdrPtr packet = (virNWFilterSnoopEthHdrPtr)job->packet;
+    virNWFilterSnoopReqPtr req = jobdata;
+    virNWFilterDHCPDecodeJobPtr job;
 
-    if (virNWFilterSnoopDHCPDecode(req, packet,
-                                   job->caplen, job->fromVM) == -1) {
-        req->jobCompletionStatus = -1;
+    virNWFilterSnoopReqLeaseTimerRun(req);
 
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Instantiation of rules failed on "
-                         "interface '%s'"), req->ifname);
+    for (;;) {
+        virMutexLock(&req->jobLock);
+
+        if (!(job = req->jobsHead)) {
+            req->jobScheduled = false;
+            virMutexUnlock(&req->jobLock);
+            break;
+        }
+
+        req->jobsHead = job->next;
+        if (!req->jobsHead)
+            req->jobsTail = NULL;
+        req->queuedJobs[job->fromVM ? 0 : 1]--;
+
+        virMutexUnlock(&req->jobLock);
+
+        if (req->jobCompletionStatus == 0 &&
+            virNWFilterSnoopDHCPDecode(req,
+                                       (virNWFilterSnoopEthHdrPtr)job->packet,
+                                       job->caplen, job->fromVM) == -1) {
+            req->jobCompletionStatus = -1;
+
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Instantiation of rules failed on "
+                             "interface '%s'"), req->ifname);
+        }
+        VIR_FREE(job);
     }
-    virAtomicIntDec(job->qCtr);
-    VIR_FREE(job);
+
+    /* drop the reference taken when the req was scheduled */
+    virNWFilterSnoopReqPut(req);
 }
 
 /*
- * Submit a job to the worker thread doing the time-consuming work...
+ * Have a decoder worker look at the req unless one is already
+ * busy with it. Call this function with req->jobLock held.
  */
 static int
-virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPoolPtr pool,
-                                    virNWFilterSnoopEthHdrPtr pep,
-                                    int len, pcap_direction_t dir,
-                                    virAtomicIntPtr qCtr)
+virNWFilterSnoopReqSchedule(virNWFilterSnoopReqPtr req)
 {
-    virNWFilterDHCPDecodeJobPtr job;
-    int ret;
-
-    if (len <= MIN_VALID_DHCP_PKT_SIZE || len > sizeof(job->packet))
+    if (req->jobScheduled)
         return 0;
 
-    if (VIR_ALLOC(job) < 0) {
-        virReportOOMError();
+    /* the caller holds a reference, so this one can't be the first */
+    virNWFilterSnoopReqGet(req);
+
+    if (virThreadPoolSendJob(virNWFilterSnoopState.decoder, 0, req) < 0) {
+        virAtomicIntDec(&req->refctr);
         return -1;
     }
 
-    memcpy(job->packet, pep, len);
-    job->caplen = len;
-    job->fromVM = (dir == PCAP_D_IN);
-    job->qCtr = qCtr;
+    req->jobScheduled = true;
+
+    return 0;
+}
+
+/*
+ * Hand the packets of a batch over to the decoder workers...
+ */
+static int
+virNWFilterSnoopReqQueueJobs(virNWFilterSnoopReqPtr req,
+                             virNWFilterSnoopBatchPtr batch)
+{
+    virNWFilterDHCPDecodeJobPtr job;
+    int ret;
+
+    virMutexLock(&req->jobLock);
 
-    ret = virThreadPoolSendJob(pool, 0, job);
+    for (job = batch->head; job; job = job->next)
+        req->queuedJobs[job->fromVM ? 0 : 1]++;
 
-    if (ret == 0)
-        virAtomicIntInc(qCtr);
+    if (req->jobsTail)
+        req->jobsTail->next = batch->head;
     else
-        VIR_FREE(job);
+        req->jobsHead = batch->head;
+    req->jobsTail = batch->tail;
+
+    batch->head = batch->tail = NULL;
+
+    ret = virNWFilterSnoopReqSchedule(req);
+
+    virMutexUnlock(&req->jobLock);
 
     return ret;
 }
@@ -1316,247 +1454,430 @@ virNWFilterSnoopAdjustPoll(virNWFilterSnoopPcapConfPtr pc,
 }
 
 /*
- * The DHCP snooping thread. It spends most of its time in the pcap
- * library and if it gets suitable packets, it submits them to the worker
- * thread for processing.
+ * pcap_dispatch() callback: rate limit the packets coming in on one
+ * of the pcap handles of an interface and collect them in a batch
+ * for the decoder workers.
  */
 static void
-virNWFilterDHCPSnoopThread(void *req0)
+virNWFilterSnoopPcapPacket(u_char *opaque,
+                           const struct pcap_pkthdr *hdr,
+                           const u_char *packet)
 {
-    virNWFilterSnoopReqPtr req = req0;
-    struct pcap_pkthdr *hdr;
-    virNWFilterSnoopEthHdrPtr packet;
-    int ifindex = 0;
-    int errcount = 0;
-    int tmp = -1, i, rv, n, pollTo;
-    char *threadkey = NULL;
-    virThreadPoolPtr worker = NULL;
-    time_t last_displayed = 0, last_displayed_queue = 0;
-    virNWFilterSnoopPcapConf pcapConf[] = {
-        {
-            .dir = PCAP_D_IN, /* from VM */
-            .filter = "dst port 67 and src port 68",
-            .rateLimit = {
-                .prev = time(0),
-                .rate = DHCP_PKT_RATE,
-                .burstRate = DHCP_PKT_BURST,
-                .burstInterval = DHCP_BURST_INTERVAL_S,
-            },
-            .maxQSize = MAX_QUEUED_JOBS,
-        }, {
-            .dir = PCAP_D_OUT, /* to VM */
-            .filter = "src port 67 and dst port 68",
-            .rateLimit = {
-                .prev = time(0),
-                .rate = DHCP_PKT_RATE,
-                .burstRate = DHCP_PKT_BURST,
-                .burstInterval = DHCP_BURST_INTERVAL_S,
-            },
-            .maxQSize = MAX_QUEUED_JOBS,
-        },
-    };
-    struct pollfd fds[] = {
-        {
-            /* get a POLLERR if interface goes down or disappears */
-            .events = POLLIN | POLLERR,
-        }, {
-            .events = POLLIN | POLLERR,
-        },
-    };
-    bool error = false;
+    virNWFilterSnoopBatchPtr batch = (virNWFilterSnoopBatchPtr)opaque;
+    virNWFilterSnoopCapturePtr cap = batch->cap;
+    virNWFilterSnoopPcapConfPtr pc = batch->pc;
+    virNWFilterDHCPDecodeJobPtr job;
+    unsigned int diff;
+
+    if (batch->queued > pc->maxQSize) {
+        if (time(0) - cap->last_displayed_queue > 10) {
+            cap->last_displayed_queue = time(0);
+            VIR_WARN("Worker thread for interface '%s' has a "
+                     "job queue that is too long",
+                     cap->ifname);
+        }
+        return;
+    }
 
-    /* whoever started us increased the reference counter for the req for us */
+    diff = virNWFilterSnoopRateLimit(&pc->rateLimit);
+    if (diff > 0) {
+        virNWFilterSnoopRatePenalty(pc, diff, DHCP_PKT_RATE);
+        /* rate-limited warnings */
+        if (time(0) - cap->last_displayed > 10) {
+             cap->last_displayed = time(0);
+             VIR_WARN("Too many DHCP packets on interface '%s'",
+                      cap->ifname);
+        }
+        /* leave the rest in the buffer until the penalty expires */
+        if (pc->penaltyTimeoutAbs != 0)
+            pcap_breakloop(pc->handle);
+        return;
+    }
 
-    /* protect req->ifname & req->threadkey */
-    virNWFilterSnoopReqLock(req);
+    if (hdr->caplen <= MIN_VALID_DHCP_PKT_SIZE ||
+        hdr->caplen > sizeof(job->packet))
+        return;
 
-    if (req->ifname && req->threadkey) {
-        for (i = 0; i < ARRAY_CARDINALITY(pcapConf); i++) {
-            pcapConf[i].handle =
-                virNWFilterSnoopDHCPOpen(req->ifname, &req->macaddr,
-                                         pcapConf[i].filter,
-                                         pcapConf[i].dir);
-            if (!pcapConf[i].handle ||
-                virAtomicIntInit(&pcapConf[i].qCtr) < 0) {
-                error = true;
-                break;
-            }
-            fds[i].fd = pcap_fileno(pcapConf[i].handle);
-        }
-        tmp = virNetDevGetIndex(req->ifname, &ifindex);
-        threadkey = strdup(req->threadkey);
-        worker = virThreadPoolNew(1, 1, 0,
-                                  virNWFilterDHCPDecodeWorker,
-                                  req);
+    if (VIR_ALLOC(job) < 0) {
+        virReportOOMError();
+        batch->error = true;
+        pcap_breakloop(pc->handle);
+        return;
     }
 
-    /* let creator know how well we initialized */
-    if (error == true || !threadkey || tmp < 0 || !worker ||
-        ifindex != req->ifindex)
-        req->threadStatus = THREAD_STATUS_FAIL;
+    memcpy(job->packet, packet, hdr->caplen);
+    job->caplen = hdr->caplen;
+    job->fromVM = (pc->dir == PCAP_D_IN);
+
+    if (batch->tail)
+        batch->tail->next = job;
     else
-        req->threadStatus = THREAD_STATUS_OK;
+        batch->head = job;
+    batch->tail = job;
+    batch->queued++;
+}
+
+/*
+ * Read everything that is pending on one of the pcap handles of an
+ * interface -- with a TPACKET_V3 ring that is a whole ring block -- and
+ * queue the DHCP packets on the req in one go.
+ */
+static void
+virNWFilterSnoopCaptureRead(virNWFilterSnoopCapturePtr cap,
+                            size_t idx)
+{
+    virNWFilterSnoopPcapConfPtr pc = &cap->pcapConf[idx];
+    virNWFilterSnoopReqPtr req = cap->req;
+    virNWFilterSnoopBatch batch;
+    virNWFilterDHCPDecodeJobPtr job;
+    int rv, tmp;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.cap = cap;
+    batch.pc = pc;
 
-    virCondSignal(&req->threadStatusCond);
+    virMutexLock(&req->jobLock);
+    batch.queued = req->queuedJobs[idx];
+    virMutexUnlock(&req->jobLock);
+
+    rv = pcap_dispatch(pc->handle, -1, virNWFilterSnoopPcapPacket,
+                       (u_char *)&batch);
+
+    if (batch.head &&
+        virNWFilterSnoopReqQueueJobs(req, &batch) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Job submission failed on "
+                         "interface '%s'"), cap->ifname);
+        cap->failed = true;
+    }
+
+    while ((job = batch.head)) {
+        batch.head = job->next;
+        VIR_FREE(job);
+    }
+
+    if (batch.error)
+        cap->failed = true;
+
+    if (rv != -1) {
+        cap->errcount = 0;
+        return;
+    }
+
+    /* error reading from socket */
+    tmp = -1;
+
+    /* protect req->ifname */
+    virNWFilterSnoopReqLock(req);
+
+    if (req->ifname)
+        tmp = virNetDevValidateConfig(req->ifname, NULL, cap->ifindex);
 
     virNWFilterSnoopReqUnlock(req);
 
-    if (req->threadStatus != THREAD_STATUS_OK)
-        goto exit;
+    if (tmp <= 0) {
+        cap->failed = true;
+        return;
+    }
 
-    while (!error) {
-        if (virNWFilterSnoopAdjustPoll(pcapConf,
-                                       ARRAY_CARDINALITY(pcapConf),
-                                       fds, &pollTo) < 0) {
-            break;
-        }
+    if (++cap->errcount > PCAP_READ_MAXERRS) {
+        pcap_close(pc->handle);
+        pc->handle = NULL;
 
-        n = poll(fds, ARRAY_CARDINALITY(fds), pollTo);
+        /* protect req->ifname */
+        virNWFilterSnoopReqLock(req);
 
-        if (n < 0) {
-            if (errno != EAGAIN && errno != EINTR)
-                error = true;
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("interface '%s' failing; "
+                         "reopening"),
+                       req->ifname);
+        if (req->ifname)
+            pc->handle = virNWFilterSnoopDHCPOpen(req->ifname, &req->macaddr,
+                                                  pc->filter, pc->dir);
+
+        virNWFilterSnoopReqUnlock(req);
+
+        if (!pc->handle)
+            cap->failed = true;
+    }
+}
+
+/*
+ * Stop snooping on an interface and drop the capture's reference
+ * to the req. If snooping stopped because of an error, the req's
+ * association with the interface is dropped as well.
+ */
+static void
+virNWFilterSnoopCaptureFree(virNWFilterSnoopCapturePtr cap)
+{
+    virNWFilterSnoopReqPtr req = cap->req;
+    size_t i;
+
+    if (cap->failed) {
+        /* protect IfNameToKey */
+        virNWFilterSnoopLock();
+
+        /* protect req->ifname & req->threadkey */
+        virNWFilterSnoopReqLock(req);
+
+        virNWFilterSnoopCancel(&req->threadkey);
+
+        if (req->ifname)
+            ignore_value(virHashRemoveEntry(virNWFilterSnoopState.ifnameToKey,
+                                            req->ifname));
+
+        VIR_FREE(req->ifname);
+
+        virNWFilterSnoopReqUnlock(req);
+        virNWFilterSnoopUnlock();
+    }
+
+    for (i = 0; i < ARRAY_CARDINALITY(cap->pcapConf); i++) {
+        if (cap->pcapConf[i].handle)
+            pcap_close(cap->pcapConf[i].handle);
+    }
+
+    virNWFilterSnoopReqPut(req);
+
+    VIR_FREE(cap->ifname);
+    VIR_FREE(cap->threadkey);
+    VIR_FREE(cap);
+
+    virAtomicIntDec(&virNWFilterSnoopState.nThreads);
+}
+
+/*
+ * The DHCP capture engine. A single thread polls the pcap handles of
+ * all snooped interfaces and hands suitable packets to the decoder
+ * workers, which do the processing. It also periodically has the
+ * workers expire old leases.
+ */
+static void
+virNWFilterSnoopEngine(void *opaque ATTRIBUTE_UNUSED)
+{
+    virNWFilterSnoopCapturePtr *caps = NULL;
+    size_t ncaps = 0;
+    struct pollfd *fds = NULL;
+    size_t fds_max = 0;
+    time_t last_lease_check = 0;
+    size_t i, j;
+
+    for (;;) {
+        int n, pollTo = DHCP_LEASE_CHECK_S * 1000;
+        size_t nfds;
+        bool quit;
+        time_t now;
+        char buf[16];
+
+        virMutexLock(&virNWFilterSnoopState.engineLock);
+
+        quit = virNWFilterSnoopState.engineQuit;
+
+        if (virNWFilterSnoopState.nNewCaptures &&
+            VIR_RESIZE_N(caps, ncaps, ncaps,
+                         virNWFilterSnoopState.nNewCaptures) == 0) {
+            for (i = 0; i < virNWFilterSnoopState.nNewCaptures; i++)
+                caps[ncaps++] = virNWFilterSnoopState.newCaptures[i];
+            VIR_FREE(virNWFilterSnoopState.newCaptures);
+            virNWFilterSnoopState.nNewCaptures = 0;
         }
 
-        virNWFilterSnoopReqLeaseTimerRun(req);
+        virMutexUnlock(&virNWFilterSnoopState.engineLock);
+
+        if (quit)
+            break;
 
         /*
-         * Check whether we were cancelled or whether
-         * a previously submitted job failed.
+         * Drop interfaces for which we were cancelled, where a previously
+         * submitted job failed or reading failed.
          */
-        if (!virNWFilterSnoopIsActive(threadkey) ||
-            req->jobCompletionStatus != 0)
-            goto exit;
-
-        for (i = 0; n > 0 && i < ARRAY_CARDINALITY(fds); i++) {
-            if (!fds[i].revents)
+        i = 0;
+        while (i < ncaps) {
+            virNWFilterSnoopCapturePtr cap = caps[i];
+
+            if (!cap->failed &&
+                virNWFilterSnoopIsActive(cap->threadkey) &&
+                cap->req->jobCompletionStatus == 0) {
+                i++;
                 continue;
+            }
 
-            fds[i].revents = 0;
-            n--;
-
-            rv = pcap_next_ex(pcapConf[i].handle, &hdr,
-                              (const u_char **)&packet);
+            virNWFilterSnoopCaptureFree(cap);
+            caps[i] = caps[--ncaps];
+        }
 
-            if (rv < 0) {
-                /* error reading from socket */
-                tmp = -1;
+        now = time(0);
+        if (now - last_lease_check >= DHCP_LEASE_CHECK_S) {
+            last_lease_check = now;
+            for (i = 0; i < ncaps; i++) {
+                virMutexLock(&caps[i]->req->jobLock);
+                ignore_value(virNWFilterSnoopReqSchedule(caps[i]->req));
+                virMutexUnlock(&caps[i]->req->jobLock);
+            }
+        }
 
-                /* protect req->ifname */
-                virNWFilterSnoopReqLock(req);
+        nfds = 1 + 2 * ncaps;
+        if (VIR_RESIZE_N(fds, fds_max, 0, nfds) < 0) {
+            virReportOOMError();
+            usleep(1000 * 1000);
+            continue;
+        }
 
-                if (req->ifname)
-                    tmp = virNetDevValidateConfig(req->ifname, NULL, ifindex);
+        fds[0].fd = virNWFilterSnoopState.engineWakeupFD[0];
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
 
-                virNWFilterSnoopReqUnlock(req);
+        for (i = 0; i < ncaps; i++) {
+            struct pollfd *pfd = &fds[1 + 2 * i];
+            int tmp;
 
-                if (tmp <= 0) {
-                    error = true;
-                    break;
-                }
+            for (j = 0; j < 2; j++) {
+                pfd[j].fd = pcap_fileno(caps[i]->pcapConf[j].handle);
+                /* get a POLLERR if interface goes down or disappears */
+                pfd[j].events = POLLIN | POLLERR;
+                pfd[j].revents = 0;
+            }
 
-                if (++errcount > PCAP_READ_MAXERRS) {
-                    pcap_close(pcapConf[i].handle);
-                    pcapConf[i].handle = NULL;
-
-                    /* protect req->ifname */
-                    virNWFilterSnoopReqLock(req);
-
-                    virReportError(VIR_ERR_INTERNAL_ERROR,
-                                   _("interface '%s' failing; "
-                                     "reopening"),
-                                   req->ifname);
-                    if (req->ifname)
-                        pcapConf[i].handle =
-                            virNWFilterSnoopDHCPOpen(req->ifname, &req->macaddr,
-                                                     pcapConf[i].filter,
-                                                     pcapConf[i].dir);
-
-                    virNWFilterSnoopReqUnlock(req);
-
-                    if (!pcapConf[i].handle) {
-                        error = true;
-                        break;
-                    }
-                }
+            if (virNWFilterSnoopAdjustPoll(caps[i]->pcapConf, 2,
+                                           pfd, &tmp) < 0) {
+                caps[i]->failed = true;
                 continue;
             }
+            if (tmp >= 0 && tmp < pollTo)
+                pollTo = tmp;
+        }
 
-            errcount = 0;
+        n = poll(fds, nfds, pollTo);
 
-            if (rv) {
-                unsigned int diff;
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                virReportSystemError(errno, "%s",
+                                     _("DHCP snooping poll failed"));
+                usleep(1000 * 1000);
+            }
+            continue;
+        }
 
-                /* submit packet to worker thread */
-                if (virAtomicIntRead(&pcapConf[i].qCtr) >
-                    pcapConf[i].maxQSize) {
-                    if (last_displayed_queue - time(0) > 10) {
-                        last_displayed_queue = time(0);
-                        VIR_WARN("Worker thread for interface '%s' has a "
-                                 "job queue that is too long\n",
-                                 req->ifname);
-                    }
-                    continue;
-                }
+        if (fds[0].revents) {
+            while (saferead(fds[0].fd, buf, sizeof(buf)) > 0)
+                ;
+            n--;
+        }
 
-                diff = virNWFilterSnoopRateLimit(&pcapConf[i].rateLimit);
-                if (diff > 0) {
-                    virNWFilterSnoopRatePenalty(&pcapConf[i], diff,
-                                                DHCP_PKT_RATE);
-                    /* rate-limited warnings */
-                    if (time(0) - last_displayed > 10) {
-                         last_displayed = time(0);
-                         VIR_WARN("Too many DHCP packets on interface '%s'",
-                                  req->ifname);
-                    }
+        for (i = 0; n > 0 && i < ncaps; i++) {
+            for (j = 0; j < 2; j++) {
+                if (!fds[1 + 2 * i + j].revents ||
+                    caps[i]->failed)
                     continue;
-                }
 
-                if (virNWFilterSnoopDHCPDecodeJobSubmit(worker, packet,
-                                                      hdr->caplen,
-                                                      pcapConf[i].dir,
-                                                      &pcapConf[i].qCtr) < 0) {
-                    virReportError(VIR_ERR_INTERNAL_ERROR,
-                                   _("Job submission failed on "
-                                     "interface '%s'"), req->ifname);
-                    error = true;
-                    break;
-                }
+                n--;
+                virNWFilterSnoopCaptureRead(caps[i], j);
             }
-        } /* for all fds */
-    } /* while (!error) */
-
-    /* protect IfNameToKey */
-    virNWFilterSnoopLock();
+        }
+    }
 
-    /* protect req->ifname & req->threadkey */
-    virNWFilterSnoopReqLock(req);
+    for (i = 0; i < ncaps; i++)
+        virNWFilterSnoopCaptureFree(caps[i]);
+    VIR_FREE(caps);
+    VIR_FREE(fds);
+}
 
-    virNWFilterSnoopCancel(&req->threadkey);
+/*
+ * Start snooping DHCP traffic on the req's interface by handing it
+ * to the capture engine. Call this function with the req locked.
+ * On success the engine takes over the caller's reference to the req.
+ */
+static int
+virNWFilterSnoopReqStartCapture(virNWFilterSnoopReqPtr req)
+{
+    virNWFilterSnoopCapturePtr cap;
+    size_t i;
+    static const virNWFilterSnoopPcapConf pcapConf[] = {
+        {
+            .dir = PCAP_D_IN, /* from VM */
+            .filter = "dst port 67 and src port 68",
+            .rateLimit = {
+                .rate = DHCP_PKT_RATE,
+                .burstRate = DHCP_PKT_BURST,
+                .burstInterval = DHCP_BURST_INTERVAL_S,
+            },
+            .maxQSize = MAX_QUEUED_JOBS,
+        }, {
+            .dir = PCAP_D_OUT, /* to VM */
+            .filter = "src port 67 and dst port 68",
+            .rateLimit = {
+                .rate = DHCP_PKT_RATE,
+                .burstRate = DHCP_PKT_BURST,
+                .burstInterval = DHCP_BURST_INTERVAL_S,
+            },
+            .maxQSize = MAX_QUEUED_JOBS,
+        },
+    };
 
-    ignore_value(virHashRemoveEntry(virNWFilterSnoopState.ifnameToKey,
-                                    req->ifname));
+    verify(ARRAY_CARDINALITY(pcapConf) == ARRAY_CARDINALITY(cap->pcapConf));
 
-    VIR_FREE(req->ifname);
+    if (VIR_ALLOC(cap) < 0) {
+        virReportOOMError();
+        return -1;
+    }
 
-    virNWFilterSnoopReqUnlock(req);
-    virNWFilterSnoopUnlock();
+    cap->req = req;
 
-exit:
-    virThreadPoolFree(worker);
+    if (!(cap->ifname = strdup(req->ifname)) ||
+        !(cap->threadkey = strdup(req->threadkey))) {
+        virReportOOMError();
+        goto error;
+    }
 
-    virNWFilterSnoopReqPut(req);
+    if (virNetDevGetIndex(req->ifname, &cap->ifindex) < 0)
+        goto error;
 
-    VIR_FREE(threadkey);
+    if (cap->ifindex != req->ifindex) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("interface '%s' has been replaced"),
+                       req->ifname);
+        goto error;
+    }
 
     for (i = 0; i < ARRAY_CARDINALITY(pcapConf); i++) {
-        if (pcapConf[i].handle)
-            pcap_close(pcapConf[i].handle);
+        cap->pcapConf[i] = pcapConf[i];
+        cap->pcapConf[i].rateLimit.prev = time(0);
+        cap->pcapConf[i].handle =
+            virNWFilterSnoopDHCPOpen(req->ifname, &req->macaddr,
+                                     pcapConf[i].filter,
+                                     pcapConf[i].dir);
+        if (!cap->pcapConf[i].handle)
+            goto error;
     }
 
-    virAtomicIntDec(&virNWFilterSnoopState.nThreads);
+    virMutexLock(&virNWFilterSnoopState.engineLock);
 
-    return;
+    if (VIR_EXPAND_N(virNWFilterSnoopState.newCaptures,
+                     virNWFilterSnoopState.nNewCaptures, 1) < 0) {
+        virMutexUnlock(&virNWFilterSnoopState.engineLock);
+        virReportOOMError();
+        goto error;
+    }
+    virNWFilterSnoopState.newCaptures[
+        virNWFilterSnoopState.nNewCaptures - 1] = cap;
+
+    virMutexUnlock(&virNWFilterSnoopState.engineLock);
+
+    virAtomicIntInc(&virNWFilterSnoopState.nThreads);
+
+    virNWFilterSnoopEngineWakeup();
+
+    return 0;
+
+error:
+    for (i = 0; i < ARRAY_CARDINALITY(cap->pcapConf); i++) {
+        if (cap->pcapConf[i].handle)
+            pcap_close(cap->pcapConf[i].handle);
+    }
+    VIR_FREE(cap->ifname);
+    VIR_FREE(cap->threadkey);
+    VIR_FREE(cap);
+    return -1;
 }
 
 static void
@@ -1583,7 +1904,6 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriverPtr techdriver,
     bool isnewreq;
     char ifkey[VIR_IFKEY_LEN];
     int tmp;
-    virThread thread;
     virNWFilterVarValuePtr dhcpsrvrs;
 
     virNWFilterSnoopIFKeyFMT(ifkey, vmuuid, macaddr);
@@ -1667,19 +1987,9 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriverPtr techdriver,
         goto exit_rem_ifnametokey;
     }
 
-    /* prevent thread from holding req */
+    /* protect req->threadkey */
     virNWFilterSnoopReqLock(req);
 
-    if (virThreadCreate(&thread, false, virNWFilterDHCPSnoopThread,
-                        req) != 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("virNWFilterDHCPSnoopReq virThreadCreate "
-                         "failed on interface '%s'"), ifname);
-        goto exit_snoopreq_unlock;
-    }
-
-    virAtomicIntInc(&virNWFilterSnoopState.nThreads);
-
     req->threadkey = virNWFilterSnoopActivate(req);
     if (!req->threadkey) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1695,16 +2005,18 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriverPtr techdriver,
         goto exit_snoop_cancel;
     }
 
-    /* sync with thread */
-    if (virCondWait(&req->threadStatusCond, &req->lock) < 0 ||
-        req->threadStatus != THREAD_STATUS_OK)
+    if (virNWFilterSnoopReqStartCapture(req) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Starting to snoop on interface '%s' failed"),
+                       req->ifname);
         goto exit_snoop_cancel;
+    }
 
     virNWFilterSnoopReqUnlock(req);
 
     virNWFilterSnoopUnlock();
 
-    /* do not 'put' the req -- the thread will do this */
+    /* do not 'put' the req -- the capture engine will do this */
 
     return 0;
 
@@ -1739,7 +2051,7 @@ virNWFilterSnoopLeaseFileOpen(void)
 
 /*
  * Write a single lease to the given file.
- *
+ * The caller is responsible for syncing the file.
  */
 static int
 virNWFilterSnoopLeaseFileWrite(int lfd, const char *ifkey,
@@ -1774,8 +2086,6 @@ virNWFilterSnoopLeaseFileWrite(int lfd, const char *ifkey,
         goto cleanup;
     }
 
-    ignore_value(fsync(lfd));
-
 cleanup:
     VIR_FREE(lbuf);
     VIR_FREE(dhcpstr);
@@ -1785,10 +2095,10 @@ cleanup:
 }
 
 /*
- * Append a single lease to the end of the lease file.
- * To keep a limited number of dead leases, re-read the lease
- * file if the threshold of active leases versus written ones
- * exceeds a threshold.
+ * Append a single lease to the end of the lease file, which is used
+ * as a journal. To keep a limited number of dead leases, compact it
+ * by writing out the leases held in memory once the number of
+ * written leases versus active ones exceeds a threshold.
  */
 static void
 virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLeasePtr ipl)
@@ -1803,10 +2113,15 @@ virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLeasePtr ipl)
                                        req->ifkey, ipl) < 0)
         goto err_exit;
 
-    /* keep dead leases at < ~95% of file size */
+    ignore_value(fsync(virNWFilterSnoopState.leaseFD));
+
+    /*
+     * keep dead leases at < ~95% of file size; the leases in memory
+     * are up to date, so there is no need to re-read the file
+     */
     if (virAtomicIntInc(&virNWFilterSnoopState.wLeases) >=
         virAtomicIntRead(&virNWFilterSnoopState.nLeases) * 20)
-        virNWFilterSnoopLeaseFileLoad();   /* load & refresh lease file */
+        virNWFilterSnoopLeaseFileRefresh();
 
 err_exit:
     virNWFilterSnoopUnlock();
@@ -1894,6 +2209,8 @@ virNWFilterSnoopLeaseFileRefresh(void)
                        virNWFilterSnoopSaveIter, (void *)&tfd);
     }
 
+    ignore_value(fsync(tfd));
+
     if (VIR_CLOSE(tfd) < 0) {
         virReportSystemError(errno, _("unable to close %s"), TMPLEASEFILE);
         /* assuming the old lease file is still better, skip the renaming */
@@ -1989,7 +2306,8 @@ virNWFilterSnoopLeaseFileLoad(void)
 }
 
 /*
- * Wait until all threads have ended.
+ * Wait until the capture engine has let go of all interfaces, then
+ * stop it and the decoder workers.
  */
 static void
 virNWFilterSnoopJoinThreads(void)
@@ -1999,6 +2317,23 @@ virNWFilterSnoopJoinThreads(void)
                  virAtomicIntRead(&virNWFilterSnoopState.nThreads));
         usleep(1000 * 1000);
     }
+
+    if (virNWFilterSnoopState.engineRunning) {
+        virMutexLock(&virNWFilterSnoopState.engineLock);
+        virNWFilterSnoopState.engineQuit = true;
+        virMutexUnlock(&virNWFilterSnoopState.engineLock);
+
+        virNWFilterSnoopEngineWakeup();
+        virThreadJoin(&virNWFilterSnoopState.engineThread);
+        virNWFilterSnoopState.engineRunning = false;
+    }
+
+    /* waits for the workers to finish */
+    virThreadPoolFree(virNWFilterSnoopState.decoder);
+    virNWFilterSnoopState.decoder = NULL;
+
+    VIR_FORCE_CLOSE(virNWFilterSnoopState.engineWakeupFD[0]);
+    VIR_FORCE_CLOSE(virNWFilterSnoopState.engineWakeupFD[1]);
 }
 
 /*
@@ -2062,6 +2397,7 @@ virNWFilterDHCPSnoopInit(void)
 
     if (virMutexInitRecursive(&virNWFilterSnoopState.snoopLock) < 0 ||
         virMutexInit(&virNWFilterSnoopState.activeLock) < 0 ||
+        virMutexInit(&virNWFilterSnoopState.engineLock) < 0 ||
         virAtomicIntInit(&virNWFilterSnoopState.nLeases) < 0 ||
         virAtomicIntInit(&virNWFilterSnoopState.wLeases) < 0 ||
         virAtomicIntInit(&virNWFilterSnoopState.nThreads) < 0)
@@ -2079,12 +2415,39 @@ virNWFilterDHCPSnoopInit(void)
         goto err_exit;
     }
 
+    if (pipe2(virNWFilterSnoopState.engineWakeupFD,
+              O_CLOEXEC | O_NONBLOCK) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create DHCP snooping wakeup pipe"));
+        goto err_exit;
+    }
+
+    virNWFilterSnoopState.decoder =
+        virThreadPoolNew(1, DHCP_DECODE_WORKERS, 0,
+                         virNWFilterDHCPDecodeWorker, NULL);
+    if (!virNWFilterSnoopState.decoder)
+        goto err_exit;
+
+    if (virThreadCreate(&virNWFilterSnoopState.engineThread, true,
+                        virNWFilterSnoopEngine, NULL) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to start DHCP snooping thread"));
+        goto err_exit;
+    }
+    virNWFilterSnoopState.engineRunning = true;
+
     virNWFilterSnoopLeaseFileLoad();
     virNWFilterSnoopLeaseFileOpen();
 
     return 0;
 
 err_exit:
+    virThreadPoolFree(virNWFilterSnoopState.decoder);
+    virNWFilterSnoopState.decoder = NULL;
+
+    VIR_FORCE_CLOSE(virNWFilterSnoopState.engineWakeupFD[0]);
+    VIR_FORCE_CLOSE(virNWFilterSnoopState.engineWakeupFD[1]);
+
     virHashFree(virNWFilterSnoopState.ifnameToKey);
     virNWFilterSnoopState.ifnameToKey = NULL;
 
@@ -0,0 +1,50 @@
+/*
+ * nwfilter_dhcpsnooppriv.h: DHCP frame decoding, exposed for testing
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library;  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NWFILTER_DHCPSNOOPPRIV_H
+# define __NWFILTER_DHCPSNOOPPRIV_H
+
+# include <stdint.h>
+
+# include "internal.h"
+# include "virsocketaddr.h"
+
+/* DHCP message types */
+# define DHCPDECLINE     4
+# define DHCPACK         5
+# define DHCPRELEASE     7
+
+typedef struct _virNWFilterSnoopDHCPMsg virNWFilterSnoopDHCPMsg;
+typedef virNWFilterSnoopDHCPMsg *virNWFilterSnoopDHCPMsgPtr;
+
+struct _virNWFilterSnoopDHCPMsg {
+    uint8_t mtype;              /* one of the message types above */
+    virSocketAddr ipAddress;    /* yiaddr */
+    virSocketAddr ipServer;     /* siaddr */
+    uint32_t leasetime;         /* in seconds, ~0 for infinite */
+};
+
+int virNWFilterSnoopDHCPParse(const unsigned char *frame,
+                              int len,
+                              bool fromVM,
+                              virNWFilterSnoopDHCPMsgPtr msg)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4);
+
+#endif /* __NWFILTER_DHCPSNOOPPRIV_H */
@@ -42,6 +42,7 @@
 #include "command.h"
 #include "configmake.h"
 #include "intprops.h"
+#include "virhashcode.h"
 
 
 #define VIR_FROM_THIS VIR_FROM_NWFILTER
@@ -82,6 +83,7 @@
 static char *ebtables_cmd_path;
 static char *iptables_cmd_path;
 static char *ip6tables_cmd_path;
+static char *ipset_cmd_path;
 static char *grep_cmd_path;
 static char *gawk_cmd_path;
 
@@ -150,6 +152,12 @@ static const char ebiptables_script_set_ifs[] =
     virBufferAsprintf(BUFPTR, "IPT=%s\n", iptables_cmd_path);
 #define NWFILTER_SET_IP6TABLES_SHELLVAR(BUFPTR) \
     virBufferAsprintf(BUFPTR, "IPT=%s\n", ip6tables_cmd_path);
+#define NWFILTER_SET_IPSET_SHELLVAR(BUFPTR) \
+    virBufferAsprintf(BUFPTR, "IPSET=%s\n", ipset_cmd_path);
+
+/* Prefix of the ipsets holding the values of list variables; it is
+ * followed by the interface name and a hash of the values */
+#define IPSET_VAR_PREFIX "lv-"
 
 #define VIRT_IN_CHAIN      "libvirt-in"
 #define VIRT_OUT_CHAIN     "libvirt-out"
@@ -453,6 +461,7 @@ ebiptablesRuleInstFree(ebiptablesRuleInstPtr inst)
         return;
 
     VIR_FREE(inst->commandTemplate);
+    VIR_FREE(inst->ipsetName);
     VIR_FREE(inst);
 }
 
@@ -2689,6 +2698,334 @@ ebiptablesCreateRuleInstance(enum virDomainNetType nettype ATTRIBUTE_UNUSED,
     return rc;
 }
 
+/*
+ * iptablesRuleGetIpHdr:
+ * @rule: the rule
+ * @isIPv6: set to whether the rule is instantiated with ip6tables
+ *
+ * Returns the IP header attributes of a rule instantiated with
+ * ip(6)tables, NULL for rules instantiated with ebtables.
+ */
+static ipHdrDataDefPtr
+iptablesRuleGetIpHdr(virNWFilterRuleDefPtr rule, bool *isIPv6)
+{
+    *isIPv6 = false;
+
+    switch (rule->prtclType) {
+    case VIR_NWFILTER_RULE_PROTOCOL_TCPoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_TCP:
+        return &rule->p.tcpHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_UDPoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_UDP:
+        return &rule->p.udpHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_UDPLITEoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_UDPLITE:
+        return &rule->p.udpliteHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_ESPoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_ESP:
+        return &rule->p.espHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_AHoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_AH:
+        return &rule->p.ahHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_SCTPoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_SCTP:
+        return &rule->p.sctpHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_ICMPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_ICMP:
+        return &rule->p.icmpHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_ALLoIPV6:
+        *isIPv6 = true;
+        /* fallthrough */
+    case VIR_NWFILTER_RULE_PROTOCOL_ALL:
+        return &rule->p.allHdrFilter.ipHdr;
+    case VIR_NWFILTER_RULE_PROTOCOL_IGMP:
+        return &rule->p.igmpHdrFilter.ipHdr;
+    default:
+        return NULL;
+    }
+}
+
+
+/*
+ * iptablesCreateIPSetInstance:
+ * @rule: the rule
+ * @item: the source or destination address attribute of the rule
+ * @ifname: the name of the interface the rule is instantiated for
+ * @vars: the variables available to the rule
+ * @isIPv6: whether the rule is instantiated with ip6tables
+ * @res: the data structure to store the ipset commands into
+ * @setname: buffer to store the name of the set into
+ *
+ * If @item iterates over a list of addresses and nothing else in the
+ * rule is tied to that iteration, create the commands filling an
+ * ipset with the addresses, so that the rule can match the set once
+ * instead of being instantiated for every address. The set name is
+ * derived from the interface and the addresses. Rules matching
+ * different lists thus never share a set, and a set in use by the
+ * rules in place never changes contents: a changed list, e.g. after
+ * DHCP snooping learned an address, gets a new set, and the old one
+ * is destroyed once no rule references it anymore.
+ *
+ * Returns 1 if the set was created, 0 if the list has to be expanded
+ * as usual, -1 on error.
+ */
+static int
+iptablesCreateIPSetInstance(virNWFilterRuleDefPtr rule,
+                            nwItemDescPtr item,
+                            const char *ifname,
+                            virNWFilterHashTablePtr vars,
+                            bool isIPv6,
+                            virNWFilterRuleInstPtr res,
+                            char setname[MAX_IPSET_NAME_LENGTH])
+{
+    virNWFilterVarAccessPtr varAccess = item->varAccess;
+    virNWFilterVarValuePtr value;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    virBuffer vals = VIR_BUFFER_INITIALIZER;
+    ebiptablesRuleInstPtr inst;
+    const char *varName;
+    char *content;
+    unsigned int i, n;
+    int len;
+
+    if (!ipset_cmd_path ||
+        !HAS_ENTRY_ITEM(item) ||
+        !(item->flags & NWFILTER_ENTRY_ITEM_FLAG_HAS_VAR) ||
+        (item->flags & NWFILTER_ENTRY_ITEM_FLAG_IS_NEG) ||
+        virNWFilterVarAccessGetType(varAccess) !=
+            VIR_NWFILTER_VAR_ACCESS_ITERATOR)
+        return 0;
+
+    /* variables sharing an iterator are stepped through together */
+    for (i = 0; i < rule->nVarAccess; i++) {
+        if (rule->varAccess[i] != varAccess &&
+            virNWFilterVarAccessGetType(rule->varAccess[i]) ==
+                VIR_NWFILTER_VAR_ACCESS_ITERATOR &&
+            virNWFilterVarAccessGetIterId(rule->varAccess[i]) ==
+                virNWFilterVarAccessGetIterId(varAccess))
+            return 0;
+    }
+
+    if (!virNWFilterRuleDefVarAccessUsedOnlyBy(rule, varAccess, item))
+        return 0;
+
+    varName = virNWFilterVarAccessGetVarName(varAccess);
+    if (!(value = virHashLookup(vars->hashTable, varName)) ||
+        (n = virNWFilterVarValueGetCardinality(value)) < 2)
+        return 0;
+
+    for (i = 0; i < n; i++) {
+        const char *val = virNWFilterVarValueGetNthValue(value, i);
+        virSocketAddr addr;
+
+        /* leave anything but plain addresses to the usual expansion */
+        if (!val ||
+            virSocketAddrParse(&addr, val, isIPv6 ? AF_INET6 : AF_INET) < 0) {
+            virResetLastError();
+            virBufferFreeAndReset(&vals);
+            return 0;
+        }
+
+        virBufferAsprintf(&vals, "%s\n", val);
+    }
+
+    if (virBufferError(&vals)) {
+        virBufferFreeAndReset(&vals);
+        virReportOOMError();
+        return -1;
+    }
+
+    /* the name, with a suffix for the temporary set, must fit */
+    content = virBufferContentAndReset(&vals);
+    len = snprintf(setname, MAX_IPSET_NAME_LENGTH - 2,
+                   IPSET_VAR_PREFIX "%s-%08x", ifname,
+                   virHashCodeGen(content, strlen(content), isIPv6));
+    VIR_FREE(content);
+    if (len >= MAX_IPSET_NAME_LENGTH - 2)
+        return 0;
+
+    /* fill a temporary set and swap it in; a set the rules in place
+     * already match has the same contents, unless an earlier attempt
+     * to fill it was interrupted */
+    NWFILTER_SET_IPSET_SHELLVAR(&buf);
+
+    virBufferAsprintf(&buf,
+                      CMD_DEF("$IPSET -exist create %s hash:ip family %s")
+                      CMD_SEPARATOR
+                      CMD_EXEC
+                      "%s"
+                      CMD_DEF("$IPSET -exist create %s-t hash:ip family %s")
+                      CMD_SEPARATOR
+                      CMD_EXEC
+                      "%s"
+                      CMD_DEF("$IPSET flush %s-t")
+                      CMD_SEPARATOR
+                      CMD_EXEC
+                      "%s",
+                      setname, isIPv6 ? "inet6" : "inet",
+                      CMD_STOPONERR(1),
+                      setname, isIPv6 ? "inet6" : "inet",
+                      CMD_STOPONERR(1),
+                      setname,
+                      CMD_STOPONERR(1));
+
+    for (i = 0; i < n; i++) {
+        virBufferAsprintf(&buf,
+                          CMD_DEF("$IPSET add %s-t %s")
+                          CMD_SEPARATOR
+                          CMD_EXEC
+                          "%s",
+                          setname, virNWFilterVarValueGetNthValue(value, i),
+                          CMD_STOPONERR(1));
+    }
+
+    virBufferAsprintf(&buf,
+                      CMD_DEF("$IPSET swap %s-t %s")
+                      CMD_SEPARATOR
+                      CMD_EXEC
+                      "%s"
+                      CMD_DEF("$IPSET destroy %s-t")
+                      CMD_SEPARATOR
+                      CMD_EXEC
+                      "%s",
+                      setname, setname,
+                      CMD_STOPONERR(1),
+                      setname,
+                      CMD_STOPONERR(1));
+
+    if (virBufferError(&buf)) {
+        virBufferFreeAndReset(&buf);
+        virReportOOMError();
+        return -1;
+    }
+
+    if (VIR_ALLOC(inst) < 0 ||
+        !(inst->ipsetName = strdup(setname))) {
+        VIR_FREE(inst);
+        virBufferFreeAndReset(&buf);
+        virReportOOMError();
+        return -1;
+    }
+
+    inst->commandTemplate = virBufferContentAndReset(&buf);
+    inst->priority = rule->priority;
+    inst->ruleType = RT_IPSET;
+
+    if (virNWFilterRuleInstAddData(res, inst) < 0) {
+        ebiptablesRuleInstFree(inst);
+        return -1;
+    }
+
+    return 1;
+}
+
+
+/*
+ * iptablesRuleUseIPSet:
+ * @rule: the rule
+ * @setRule: filled with a copy of @rule matching the ipset
+ * @ifname: the name of the interface the rule is instantiated for
+ * @vars: the variables available to the rule
+ * @res: the data structure to store the ipset commands into
+ *
+ * Try to match the values of a list variable used as source or
+ * destination address of an ip(6)tables rule with an ipset.
+ *
+ * Returns the variable access now covered by the set, which must no
+ * longer be iterated over, or NULL if the rule is to be instantiated
+ * as is. @err is set to true on error.
+ */
+static virNWFilterVarAccessPtr
+iptablesRuleUseIPSet(virNWFilterRuleDefPtr rule,
+                     virNWFilterRuleDefPtr setRule,
+                     const char *ifname,
+                     virNWFilterHashTablePtr vars,
+                     virNWFilterRuleInstPtr res,
+                     bool *err)
+{
+    char setname[MAX_IPSET_NAME_LENGTH];
+    ipHdrDataDefPtr ipHdr, setIpHdr;
+    nwItemDescPtr item = NULL;
+    bool isIPv6;
+    int rc = 0;
+
+    *err = false;
+
+    if (!(ipHdr = iptablesRuleGetIpHdr(rule, &isIPv6)))
+        return NULL;
+
+    /* a rule can only match a single set */
+    if (HAS_ENTRY_ITEM(&ipHdr->dataIPSet))
+        return NULL;
+
+    /* the set holds plain addresses */
+    if (!HAS_ENTRY_ITEM(&ipHdr->dataSrcIPMask) &&
+        ipHdr->dataSrcIPAddr.varAccess != ipHdr->dataDstIPAddr.varAccess)
+        rc = iptablesCreateIPSetInstance(rule, &ipHdr->dataSrcIPAddr,
+                                         ifname, vars, isIPv6, res,
+                                         setname);
+    if (rc > 0) {
+        item = &ipHdr->dataSrcIPAddr;
+    } else if (rc == 0 &&
+               !HAS_ENTRY_ITEM(&ipHdr->dataDstIPMask) &&
+               ipHdr->dataSrcIPAddr.varAccess !=
+                   ipHdr->dataDstIPAddr.varAccess) {
+        rc = iptablesCreateIPSetInstance(rule, &ipHdr->dataDstIPAddr,
+                                         ifname, vars, isIPv6, res,
+                                         setname);
+        if (rc > 0)
+            item = &ipHdr->dataDstIPAddr;
+    }
+
+    if (rc < 0) {
+        *err = true;
+        return NULL;
+    }
+
+    if (!item)
+        return NULL;
+
+    /* the copy shares everything but the IP header with the rule */
+    *setRule = *rule;
+    setIpHdr = iptablesRuleGetIpHdr(setRule, &isIPv6);
+
+    setIpHdr->dataIPSet.flags = NWFILTER_ENTRY_ITEM_FLAG_EXISTS;
+    setIpHdr->dataIPSet.varAccess = NULL;
+    setIpHdr->dataIPSet.datatype = DATATYPE_IPSETNAME;
+    ignore_value(virStrcpyStatic(setIpHdr->dataIPSet.u.ipset.setname,
+                                 setname));
+
+    /* the single flag is 'src' for a source address */
+    setIpHdr->dataIPSetFlags.flags = NWFILTER_ENTRY_ITEM_FLAG_EXISTS;
+    setIpHdr->dataIPSetFlags.varAccess = NULL;
+    setIpHdr->dataIPSetFlags.datatype = DATATYPE_IPSETFLAGS;
+    setIpHdr->dataIPSetFlags.u.ipset.numFlags = 1;
+    setIpHdr->dataIPSetFlags.u.ipset.flags =
+        item == &ipHdr->dataSrcIPAddr ? 1 : 0;
+
+    if (item == &ipHdr->dataSrcIPAddr)
+        setIpHdr->dataSrcIPAddr.flags = 0;
+    else
+        setIpHdr->dataDstIPAddr.flags = 0;
+
+    return item->varAccess;
+}
+
+
 static int
 ebiptablesCreateRuleInstanceIterate(
                              enum virDomainNetType nettype ATTRIBUTE_UNUSED,
@@ -2700,15 +3037,40 @@ ebiptablesCreateRuleInstanceIterate(
 {
     int rc = 0;
     virNWFilterVarCombIterPtr vciter;
+    virNWFilterRuleDef setRule;
+    virNWFilterVarAccessPtr setAccess;
+    virNWFilterVarAccessPtr *varAccess = rule->varAccess;
+    size_t nVarAccess = rule->nVarAccess;
+    size_t i;
+    bool err;
+
+    /* a list of addresses matched by an ipset needs no iteration */
+    setAccess = iptablesRuleUseIPSet(rule, &setRule, ifname, vars, res, &err);
+    if (err)
+        return -1;
+
+    if (setAccess) {
+        if (VIR_ALLOC_N(varAccess, rule->nVarAccess) < 0) {
+            virReportOOMError();
+            return -1;
+        }
+        nVarAccess = 0;
+        for (i = 0; i < rule->nVarAccess; i++) {
+            if (rule->varAccess[i] != setAccess)
+                varAccess[nVarAccess++] = rule->varAccess[i];
+        }
+        rule = &setRule;
+    }
 
     /* rule->vars holds all the variables names that this rule will access.
      * iterate over all combinations of the variables' values and instantiate
      * the filtering rule with each combination.
      */
-    vciter = virNWFilterVarCombIterCreate(vars,
-                                          rule->varAccess, rule->nVarAccess);
-    if (!vciter)
-        return -1;
+    vciter = virNWFilterVarCombIterCreate(vars, varAccess, nVarAccess);
+    if (!vciter) {
+        rc = -1;
+        goto cleanup;
+    }
 
     do {
         rc = ebiptablesCreateRuleInstance(nettype,
@@ -2724,6 +3086,10 @@ ebiptablesCreateRuleInstanceIterate(
 
     virNWFilterVarCombIterFree(vciter);
 
+cleanup:
+    if (setAccess)
+        VIR_FREE(varAccess);
+
     return rc;
 }
 
@@ -2741,7 +3107,7 @@ ebiptablesDisplayRuleInstance(void *_inst)
     ebiptablesRuleInstPtr inst = (ebiptablesRuleInstPtr)_inst;
     VIR_INFO("Command Template: '%s', Needed protocol: '%s'",
              inst->commandTemplate,
-             inst->neededProtocolChain);
+             NULLSTR(inst->neededProtocolChain));
     return 0;
 }
 
@@ -3645,6 +4011,30 @@ ebtablesCreateTmpRootAndSubChains(virBufferPtr buf,
     return rc;
 }
 
+/*
+ * Destroy the ipsets holding list variables of the given interface
+ * that no rule references anymore, including any temporary set left
+ * over by a failed update. ipset refuses to destroy a set which is
+ * still in use, so the sets of the rules in place are kept.
+ */
+static void
+ebiptablesRemoveIPSets(virBufferPtr buf, const char *ifname)
+{
+    NWFILTER_SET_IPSET_SHELLVAR(buf);
+
+    virBufferAsprintf(buf,
+                      "for set in $($IPSET list -n 2>/dev/null); do\n"
+                      "  case $set in\n"
+                      "  " IPSET_VAR_PREFIX "%s-????????|"
+                      IPSET_VAR_PREFIX "%s-????????" "-t)\n"
+                      "    $IPSET destroy $set 2>/dev/null\n"
+                      "  ;;\n"
+                      "  esac\n"
+                      "done\n",
+                      ifname, ifname);
+}
+
+
 static int
 ebiptablesApplyNewRules(const char *ifname,
                         int nruleInstances,
@@ -3658,6 +4048,7 @@ ebiptablesApplyNewRules(const char *ifname,
     virHashTablePtr chains_out_set = virHashCreate(10, NULL);
     bool haveIptables = false;
     bool haveIp6tables = false;
+    bool haveIpsets = false;
     ebiptablesRuleInstPtr ebtChains = NULL;
     int nEbtChains = 0;
     char *errmsg = NULL;
@@ -3752,6 +4143,9 @@ ebiptablesApplyNewRules(const char *ifname,
         case RT_IP6TABLES:
             haveIp6tables = true;
         break;
+        case RT_IPSET:
+            haveIpsets = true;
+        break;
         }
     }
 
@@ -3763,6 +4157,35 @@ ebiptablesApplyNewRules(const char *ifname,
     if (ebiptablesExecCLI(&buf, NULL, &errmsg) < 0)
         goto tear_down_tmpebchains;
 
+    /* fill the ipsets before any rule can reference them; several
+       rules may share one set */
+    if (haveIpsets) {
+        virHashTablePtr ipsets = virHashCreate(10, NULL);
+
+        if (!ipsets) {
+            virReportOOMError();
+            goto tear_down_tmpebchains;
+        }
+
+        for (i = 0; i < nruleInstances; i++) {
+            sa_assert (inst);
+            if (inst[i]->ruleType != RT_IPSET ||
+                virHashLookup(ipsets, inst[i]->ipsetName))
+                continue;
+
+            if (virHashAddEntry(ipsets, inst[i]->ipsetName, inst[i]) < 0) {
+                virHashFree(ipsets);
+                goto tear_down_tmpebchains;
+            }
+            virBufferAdd(&buf, inst[i]->commandTemplate, -1);
+        }
+
+        virHashFree(ipsets);
+
+        if (ebiptablesExecCLI(&buf, NULL, &errmsg) < 0)
+            goto tear_down_tmpebchains;
+    }
+
     if (haveIptables) {
         NWFILTER_SET_IPTABLES_SHELLVAR(&buf);
 
@@ -3898,6 +4321,10 @@ tear_down_tmpebchains:
         ebtablesRemoveTmpRootChain(&buf, 0, ifname);
     }
 
+    /* the sets created for the new rules */
+    if (haveIpsets)
+        ebiptablesRemoveIPSets(&buf, ifname);
+
     ebiptablesExecCLI(&buf, &cli_status, NULL);
 
     virReportError(VIR_ERR_BUILD_FIREWALL,
@@ -3952,6 +4379,10 @@ ebiptablesTearNewRules(const char *ifname)
         ebtablesRemoveTmpRootChain(&buf, 0, ifname);
     }
 
+    /* the sets only the new rules used */
+    if (ipset_cmd_path)
+        ebiptablesRemoveIPSets(&buf, ifname);
+
     ebiptablesExecCLI(&buf, &cli_status, NULL);
 
     return 0;
@@ -4001,6 +4432,12 @@ ebiptablesTearOldRules(const char *ifname)
         ebiptablesExecCLI(&buf, &cli_status, NULL);
     }
 
+    /* the sets only the old rules used */
+    if (ipset_cmd_path) {
+        ebiptablesRemoveIPSets(&buf, ifname);
+        ebiptablesExecCLI(&buf, &cli_status, NULL);
+    }
+
     return 0;
 }
 
@@ -4029,11 +4466,15 @@ ebiptablesRemoveRules(const char *ifname ATTRIBUTE_UNUSED,
 
     NWFILTER_SET_EBTABLES_SHELLVAR(&buf);
 
-    for (i = 0; i < nruleInstances; i++)
+    for (i = 0; i < nruleInstances; i++) {
+        /* the sets go away with the interface */
+        if (inst[i]->ruleType == RT_IPSET)
+            continue;
         ebiptablesInstCommand(&buf,
                               inst[i]->commandTemplate,
                               'D', -1,
                               0);
+    }
 
     if (ebiptablesExecCLI(&buf, &cli_status, NULL) < 0)
         goto err_exit;
@@ -4092,6 +4533,10 @@ ebiptablesAllTeardown(const char *ifname)
         ebtablesRemoveRootChain(&buf, 1, ifname);
         ebtablesRemoveRootChain(&buf, 0, ifname);
     }
+
+    /* only once no rule references them anymore */
+    if (ipset_cmd_path)
+        ebiptablesRemoveIPSets(&buf, ifname);
     ebiptablesExecCLI(&buf, &cli_status, NULL);
 
     return 0;
@@ -4194,6 +4639,25 @@ ebiptablesDriverInit(bool privileged)
         VIR_WARN("Could not find 'ip6tables' executable");
     }
 
+    /* optional; lets list variables be matched with a single rule */
+    ipset_cmd_path = virFindFileInPath("ipset");
+    if (ipset_cmd_path) {
+        NWFILTER_SET_IPSET_SHELLVAR(&buf);
+
+        virBufferAsprintf(&buf,
+                          CMD_DEF("$IPSET list -n") CMD_SEPARATOR
+                          CMD_EXEC
+                          "%s",
+                          CMD_STOPONERR(1));
+
+        if (ebiptablesExecCLI(&buf, NULL, &errmsg) < 0) {
+            VIR_FREE(ipset_cmd_path);
+            VIR_INFO("Testing of ipset command failed, list variables "
+                     "will be expanded into separate rules: %s",
+                     errmsg);
+        }
+    }
+
     /* ip(6)tables support needs gawk & grep, ebtables doesn't */
     if ((iptables_cmd_path != NULL || ip6tables_cmd_path != NULL) &&
         (!grep_cmd_path || !gawk_cmd_path)) {
@@ -4225,5 +4689,6 @@ ebiptablesDriverShutdown(void)
     VIR_FREE(ebtables_cmd_path);
     VIR_FREE(iptables_cmd_path);
     VIR_FREE(ip6tables_cmd_path);
+    VIR_FREE(ipset_cmd_path);
     ebiptables_driver.flags = 0;
 }
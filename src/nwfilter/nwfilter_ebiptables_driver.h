@@ -29,6 +29,7 @@ enum RuleType {
     RT_EBTABLES,
     RT_IPTABLES,
     RT_IP6TABLES,
+    RT_IPSET,
 };
 
 typedef struct _ebiptablesRuleInst ebiptablesRuleInst;
@@ -40,6 +41,7 @@ struct _ebiptablesRuleInst {
     char chainprefix;    /* I for incoming, O for outgoing */
     virNWFilterRulePriority priority;
     enum RuleType ruleType;
+    char *ipsetName;     /* the set filled by an RT_IPSET command */
 };
 
 extern virNWFilterTechDriver ebiptables_driver;
@@ -1169,6 +1169,14 @@ virNWFilterDomainFWUpdateCB(void *payload,
             if ((net->filter) && (net->ifname)) {
                 switch (cb->step) {
                 case STEP_APPLY_NEW:
+                    if (cb->affectedFilters &&
+                        !virHashLookup(cb->affectedFilters, net->filter)) {
+                        /* filter tree doesn't include the changed filter */
+                        cb->err = virHashAddEntry(cb->skipInterfaces,
+                                                  net->ifname,
+                                                  (void *)~0);
+                        break;
+                    }
                     cb->err = virNWFilterUpdateInstantiateFilter(cb->conn,
                                                                  vm->uuid,
                                                                  net,
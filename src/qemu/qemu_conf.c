@@ -492,6 +492,19 @@ int qemudLoadDriverConfig(struct qemud_driver *driver,
     CHECK_TYPE("keepalive_count", VIR_CONF_LONG);
     if (p) driver->keepAliveCount = p->l;
 
+    p = virConfGetValue(conf, "stats_interval");
+    CHECK_TYPE("stats_interval", VIR_CONF_LONG);
+    if (p) {
+        if (p->l < 0 || p->l > UINT_MAX) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("%s: stats_interval must be between 0 and %u"),
+                           filename, UINT_MAX);
+            virConfFree(conf);
+            return -1;
+        }
+        driver->statsInterval = p->l;
+    }
+
     virConfFree (conf);
     return 0;
 }
@@ -150,6 +150,9 @@ struct qemud_driver {
 
     int keepAliveInterval;
     unsigned int keepAliveCount;
+
+    /* How long monitor statistics are reused, in milliseconds */
+    unsigned int statsInterval;
 };
 
 typedef struct _qemuDomainCmdlineDef qemuDomainCmdlineDef;
@@ -251,10 +251,206 @@ static void qemuDomainObjPrivateFree(void *data)
         qemuAgentClose(priv->agent);
     }
     VIR_FREE(priv->cleanupCallbacks);
+    virHashFree(priv->diskSamples);
     VIR_FREE(priv);
 }
 
 
+/* Monitor statistics of one disk, with the time they were taken */
+typedef struct _qemuDomainDiskSample qemuDomainDiskSample;
+typedef qemuDomainDiskSample *qemuDomainDiskSamplePtr;
+struct _qemuDomainDiskSample {
+    unsigned long long statsStamp;      /* 0 if @stats were never taken */
+    qemuDomainDiskStats stats;
+    unsigned long long extentStamp;     /* 0 if @extent was never taken */
+    unsigned long long extent;
+};
+
+static void
+qemuDomainDiskSampleFree(void *payload, const void *name ATTRIBUTE_UNUSED)
+{
+    VIR_FREE(payload);
+}
+
+/* Whether a sample taken at @stamp may still be handed out */
+static bool
+qemuDomainStatsFresh(struct qemud_driver *driver,
+                     unsigned long long stamp)
+{
+    unsigned long long now;
+
+    if (!driver->statsInterval || !stamp)
+        return false;
+    if (virTimeMillisNow(&now) < 0)
+        return false;
+    return now - stamp < driver->statsInterval;
+}
+
+/* Returns the sample of disk @alias, creating it if @create is true */
+static qemuDomainDiskSamplePtr
+qemuDomainDiskSampleGet(virDomainObjPtr vm,
+                        const char *alias,
+                        bool create)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainDiskSamplePtr sample;
+
+    if (priv->diskSamples &&
+        (sample = virHashLookup(priv->diskSamples, alias)))
+        return sample;
+    if (!create)
+        return NULL;
+
+    if (!priv->diskSamples &&
+        !(priv->diskSamples = virHashCreate(vm->def->ndisks ? vm->def->ndisks : 1,
+                                            qemuDomainDiskSampleFree)))
+        return NULL;
+
+    if (VIR_ALLOC(sample) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+    if (virHashAddEntry(priv->diskSamples, alias, sample) < 0) {
+        VIR_FREE(sample);
+        return NULL;
+    }
+    return sample;
+}
+
+/*
+ * Copy the block statistics of disk @alias last taken from the
+ * monitor to @stats if they are recent enough to be reused.
+ *
+ * Returns true if @stats was filled in.
+ */
+bool
+qemuDomainDiskStatsCached(struct qemud_driver *driver,
+                          virDomainObjPtr vm,
+                          const char *alias,
+                          qemuDomainDiskStatsPtr stats)
+{
+    qemuDomainDiskSamplePtr sample = qemuDomainDiskSampleGet(vm, alias, false);
+
+    if (!sample || !qemuDomainStatsFresh(driver, sample->statsStamp))
+        return false;
+
+    *stats = sample->stats;
+    return true;
+}
+
+void
+qemuDomainDiskStatsStore(struct qemud_driver *driver,
+                         virDomainObjPtr vm,
+                         const char *alias,
+                         const qemuDomainDiskStats *stats)
+{
+    qemuDomainDiskSamplePtr sample;
+    unsigned long long now;
+
+    if (!driver->statsInterval ||
+        virTimeMillisNow(&now) < 0 ||
+        !(sample = qemuDomainDiskSampleGet(vm, alias, true))) {
+        virResetLastError();
+        return;
+    }
+
+    sample->stats = *stats;
+    sample->statsStamp = now;
+}
+
+bool
+qemuDomainBlockExtentCached(struct qemud_driver *driver,
+                            virDomainObjPtr vm,
+                            const char *alias,
+                            unsigned long long *extent)
+{
+    qemuDomainDiskSamplePtr sample = qemuDomainDiskSampleGet(vm, alias, false);
+
+    if (!sample || !qemuDomainStatsFresh(driver, sample->extentStamp))
+        return false;
+
+    *extent = sample->extent;
+    return true;
+}
+
+void
+qemuDomainBlockExtentStore(struct qemud_driver *driver,
+                           virDomainObjPtr vm,
+                           const char *alias,
+                           unsigned long long extent)
+{
+    qemuDomainDiskSamplePtr sample;
+    unsigned long long now;
+
+    if (!driver->statsInterval ||
+        virTimeMillisNow(&now) < 0 ||
+        !(sample = qemuDomainDiskSampleGet(vm, alias, true))) {
+        virResetLastError();
+        return;
+    }
+
+    sample->extent = extent;
+    sample->extentStamp = now;
+}
+
+/*
+ * Copy up to @nr_stats of the memory statistics last taken from the
+ * monitor to @stats if they are recent enough to be reused.
+ *
+ * Returns the number of statistics copied, or -1 if there are none.
+ */
+int
+qemuDomainMemoryStatsCached(struct qemud_driver *driver,
+                            virDomainObjPtr vm,
+                            virDomainMemoryStatPtr stats,
+                            unsigned int nr_stats)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    int n;
+
+    if (!qemuDomainStatsFresh(driver, priv->memStatsStamp))
+        return -1;
+
+    n = MIN(priv->nmemStats, nr_stats);
+    memcpy(stats, priv->memStats, n * sizeof(*stats));
+    return n;
+}
+
+void
+qemuDomainMemoryStatsStore(struct qemud_driver *driver,
+                           virDomainObjPtr vm,
+                           const virDomainMemoryStatStruct *stats,
+                           int nstats)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned long long now;
+
+    if (!driver->statsInterval ||
+        virTimeMillisNow(&now) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    priv->nmemStats = MIN(nstats, VIR_DOMAIN_MEMORY_STAT_NR);
+    memcpy(priv->memStats, stats, priv->nmemStats * sizeof(*stats));
+    priv->memStatsStamp = now;
+}
+
+/* Forget all statistics taken from the monitor, e.g. because the
+ * devices they refer to changed */
+void
+qemuDomainStatsClear(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    virHashFree(priv->diskSamples);
+    priv->diskSamples = NULL;
+    priv->blockStatsParams = 0;
+    priv->memStatsStamp = 0;
+    priv->nmemStats = 0;
+}
+
+
 static int qemuDomainObjPrivateXMLFormat(virBufferPtr buf, void *data)
 {
     qemuDomainObjPrivatePtr priv = data;
@@ -939,6 +1135,9 @@ int qemuDomainObjEndJob(struct qemud_driver *driver, virDomainObjPtr obj)
     qemuDomainObjResetJob(priv);
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveJob(driver, obj);
+    /* Any job but a query may have changed the live definition */
+    if (job != QEMU_JOB_QUERY)
+        virDomainObjUnpublishDef(obj);
     virCondSignal(&priv->job.cond);
 
     return virDomainObjUnref(obj);
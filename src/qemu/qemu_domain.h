@@ -114,6 +114,21 @@ typedef qemuDomainPCIAddressSet *qemuDomainPCIAddressSetPtr;
 typedef void (*qemuDomainCleanupCallback)(struct qemud_driver *driver,
                                           virDomainObjPtr vm);
 
+/* Block statistics of one disk as reported by the monitor */
+typedef struct _qemuDomainDiskStats qemuDomainDiskStats;
+typedef qemuDomainDiskStats *qemuDomainDiskStatsPtr;
+struct _qemuDomainDiskStats {
+    long long rd_req;
+    long long rd_bytes;
+    long long rd_total_times;
+    long long wr_req;
+    long long wr_bytes;
+    long long wr_total_times;
+    long long flush_req;
+    long long flush_total_times;
+    long long errs;
+};
+
 typedef struct _qemuDomainObjPrivate qemuDomainObjPrivate;
 typedef qemuDomainObjPrivate *qemuDomainObjPrivatePtr;
 struct _qemuDomainObjPrivate {
@@ -154,6 +169,14 @@ struct _qemuDomainObjPrivate {
     qemuDomainCleanupCallback *cleanupCallbacks;
     size_t ncleanupCallbacks;
     size_t ncleanupCallbacks_max;
+
+    /* Monitor statistics shared by all stats APIs for up to
+     * driver->statsInterval milliseconds */
+    virHashTablePtr diskSamples;  /* disk alias -> qemuDomainDiskSamplePtr */
+    int blockStatsParams;         /* Number of block stats, 0 if unknown */
+    unsigned long long memStatsStamp;
+    virDomainMemoryStatStruct memStats[VIR_DOMAIN_MEMORY_STAT_NR];
+    int nmemStats;
 };
 
 struct qemuDomainWatchdogEvent
@@ -169,6 +192,32 @@ int qemuDomainAsyncJobPhaseFromString(enum qemuDomainAsyncJob job,
 
 void qemuDomainEventFlush(int timer, void *opaque);
 
+bool qemuDomainDiskStatsCached(struct qemud_driver *driver,
+                               virDomainObjPtr vm,
+                               const char *alias,
+                               qemuDomainDiskStatsPtr stats);
+void qemuDomainDiskStatsStore(struct qemud_driver *driver,
+                              virDomainObjPtr vm,
+                              const char *alias,
+                              const qemuDomainDiskStats *stats);
+bool qemuDomainBlockExtentCached(struct qemud_driver *driver,
+                                 virDomainObjPtr vm,
+                                 const char *alias,
+                                 unsigned long long *extent);
+void qemuDomainBlockExtentStore(struct qemud_driver *driver,
+                                virDomainObjPtr vm,
+                                const char *alias,
+                                unsigned long long extent);
+int qemuDomainMemoryStatsCached(struct qemud_driver *driver,
+                                virDomainObjPtr vm,
+                                virDomainMemoryStatPtr stats,
+                                unsigned int nr_stats);
+void qemuDomainMemoryStatsStore(struct qemud_driver *driver,
+                                virDomainObjPtr vm,
+                                const virDomainMemoryStatStruct *stats,
+                                int nstats);
+void qemuDomainStatsClear(virDomainObjPtr vm);
+
 /* driver must be locked before calling */
 void qemuDomainEventQueue(struct qemud_driver *driver,
                           virDomainEventPtr event);
@@ -4557,6 +4557,7 @@ static char *qemuDomainGetXMLDesc(virDomainPtr dom,
 {
     struct qemud_driver *driver = dom->conn->privateData;
     virDomainObjPtr vm;
+    virDomainPublishedDefPtr pub = NULL;
     char *ret = NULL;
     unsigned long long balloon;
     int err = 0;
@@ -4605,12 +4606,33 @@ endjob:
             }
             if (err < 0)
                 goto cleanup;
-            if (err > 0)
+            if (err > 0 && vm->def->mem.cur_balloon != balloon) {
                 vm->def->mem.cur_balloon = balloon;
+                virDomainObjUnpublishDef(vm);
+            }
             /* err == 0 indicates no balloon support, so ignore it */
         }
     }
 
+    /* Format a published copy of the live definition once all locks
+     * are dropped, publishing one first if it changed since */
+    if (virDomainObjIsActive(vm) &&
+        !(flags & (VIR_DOMAIN_XML_INACTIVE | VIR_DOMAIN_XML_UPDATE_CPU))) {
+        if (virDomainObjPublishDef(driver->caps, vm) < 0) {
+            VIR_WARN("Unable to publish definition of domain %s",
+                     vm->def->name);
+            virResetLastError();
+        }
+        pub = virDomainObjGetPublishedDef(vm);
+    }
+    if (pub) {
+        virDomainObjUnlock(vm);
+        qemuDriverUnlock(driver);
+        ret = virDomainPublishedDefFormat(pub, flags);
+        virDomainPublishedDefRelease(pub);
+        return ret;
+    }
+
     ret = qemuDomainFormatXML(driver, vm, flags, false);
 
 cleanup:
@@ -5770,7 +5792,10 @@ qemuDomainModifyDeviceFlags(virDomainPtr dom, const char *xml,
     struct qemud_driver *driver = dom->conn->privateData;
     virDomainObjPtr vm = NULL;
     virDomainDefPtr vmdef = NULL;
-    virDomainDeviceDefPtr dev = NULL, dev_copy = NULL;
+    virDomainDeviceDefPtr *devs = NULL, *devs_copy = NULL;
+    size_t ndevs = 0;
+    size_t i;
+    int n;
     bool force = (flags & VIR_DOMAIN_DEVICE_MODIFY_FORCE) != 0;
     int ret = -1;
     unsigned int affect;
@@ -5816,20 +5841,30 @@ qemuDomainModifyDeviceFlags(virDomainPtr dom, const char *xml,
          goto endjob;
     }
 
-    dev = dev_copy = virDomainDeviceDefParse(driver->caps, vm->def, xml,
-                                             VIR_DOMAIN_XML_INACTIVE);
-    if (dev == NULL)
+    /* The XML may hold a <devices> list, which is then handled as
+     * a whole within this job */
+    if ((n = virDomainDeviceDefParseList(driver->caps, vm->def, xml,
+                                         VIR_DOMAIN_XML_INACTIVE, &devs)) < 0)
         goto endjob;
+    ndevs = n;
+    devs_copy = devs;
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG &&
         flags & VIR_DOMAIN_AFFECT_LIVE) {
         /* If we are affecting both CONFIG and LIVE
-         * create a deep copy of device as adding
+         * create a deep copy of devices as adding
          * to CONFIG takes one instance.
          */
-        dev_copy = virDomainDeviceDefCopy(driver->caps, vm->def, dev);
-        if (!dev_copy)
+        if (VIR_ALLOC_N(devs_copy, ndevs) < 0) {
+            virReportOOMError();
             goto endjob;
+        }
+        for (i = 0 ; i < ndevs ; i++) {
+            devs_copy[i] = virDomainDeviceDefCopy(driver->caps, vm->def,
+                                                  devs[i]);
+            if (!devs_copy[i])
+                goto endjob;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
@@ -5837,55 +5872,70 @@ qemuDomainModifyDeviceFlags(virDomainPtr dom, const char *xml,
         vmdef = virDomainObjCopyPersistentDef(driver->caps, vm);
         if (!vmdef)
             goto endjob;
-        switch (action) {
-        case QEMU_DEVICE_ATTACH:
-            ret = qemuDomainAttachDeviceConfig(vmdef, dev);
-            break;
-        case QEMU_DEVICE_DETACH:
-            ret = qemuDomainDetachDeviceConfig(vmdef, dev);
-            break;
-        case QEMU_DEVICE_UPDATE:
-            ret = qemuDomainUpdateDeviceConfig(vmdef, dev);
-            break;
-        default:
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("unknown domain modify action %d"), action);
-            break;
-        }
+        for (i = 0 ; i < ndevs ; i++) {
+            switch (action) {
+            case QEMU_DEVICE_ATTACH:
+                ret = qemuDomainAttachDeviceConfig(vmdef, devs[i]);
+                break;
+            case QEMU_DEVICE_DETACH:
+                ret = qemuDomainDetachDeviceConfig(vmdef, devs[i]);
+                break;
+            case QEMU_DEVICE_UPDATE:
+                ret = qemuDomainUpdateDeviceConfig(vmdef, devs[i]);
+                break;
+            default:
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("unknown domain modify action %d"), action);
+                ret = -1;
+                break;
+            }
 
-        if (ret == -1)
-            goto endjob;
+            if (ret == -1)
+                goto endjob;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_LIVE) {
-        switch (action) {
-        case QEMU_DEVICE_ATTACH:
-            ret = qemuDomainAttachDeviceLive(vm, dev_copy, dom);
-            break;
-        case QEMU_DEVICE_DETACH:
-            ret = qemuDomainDetachDeviceLive(vm, dev_copy, dom);
-            break;
-        case QEMU_DEVICE_UPDATE:
-            ret = qemuDomainUpdateDeviceLive(vm, dev_copy, dom, force);
-            break;
-        default:
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("unknown domain modify action %d"), action);
-            ret = -1;
-            break;
+        for (i = 0 ; i < ndevs ; i++) {
+            switch (action) {
+            case QEMU_DEVICE_ATTACH:
+                ret = qemuDomainAttachDeviceLive(vm, devs_copy[i], dom);
+                break;
+            case QEMU_DEVICE_DETACH:
+                ret = qemuDomainDetachDeviceLive(vm, devs_copy[i], dom);
+                break;
+            case QEMU_DEVICE_UPDATE:
+                ret = qemuDomainUpdateDeviceLive(vm, devs_copy[i], dom,
+                                                 force);
+                break;
+            default:
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("unknown domain modify action %d"), action);
+                ret = -1;
+                break;
+            }
+
+            if (ret == -1)
+                break;
         }
 
-        if (ret == -1)
+        /* Disk aliases may now refer to other devices */
+        qemuDomainStatsClear(vm);
+
+        /* Devices modified before a failing one stay modified, so
+         * the status is saved once for the whole list in that case
+         * too. */
+        if (ret == -1 && i == 0)
             goto endjob;
         /*
          * update domain status forcibly because the domain status may be
          * changed even if we failed to attach the device. For example,
          * a new controller may be created.
          */
-        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0) {
+        if (virDomainSaveStatus(driver->caps, driver->stateDir, vm) < 0)
             ret = -1;
+        if (ret == -1)
             goto endjob;
-        }
     }
 
     /* Finally, if no error until here, we can save config. */
@@ -5903,9 +5953,14 @@ endjob:
 
 cleanup:
     virDomainDefFree(vmdef);
-    if (dev != dev_copy)
-        virDomainDeviceDefFree(dev_copy);
-    virDomainDeviceDefFree(dev);
+    for (i = 0 ; i < ndevs ; i++) {
+        if (devs_copy && devs_copy != devs)
+            virDomainDeviceDefFree(devs_copy[i]);
+        virDomainDeviceDefFree(devs[i]);
+    }
+    if (devs_copy != devs)
+        VIR_FREE(devs_copy);
+    VIR_FREE(devs);
     if (vm)
         virDomainObjUnlock(vm);
     qemuDriverUnlock(driver);
@@ -6937,6 +6992,7 @@ qemuDomainSetNumaParameters(virDomainPtr dom,
 
                 /* update vm->def here so that dumpxml can read the new
                  * values from vm->def. */
+                virDomainObjUnpublishDef(vm);
                 savedmask = false;
                 if (!vm->def->numatune.memory.nodemask) {
                     if (VIR_ALLOC_N(vm->def->numatune.memory.nodemask,
@@ -7669,6 +7725,7 @@ qemuDomainBlockStats(virDomainPtr dom,
     virDomainObjPtr vm;
     virDomainDiskDefPtr disk = NULL;
     qemuDomainObjPrivatePtr priv;
+    qemuDomainDiskStats sample;
 
     qemuDriverLock(driver);
     vm = virDomainFindByUUID(&driver->domains, dom->uuid);
@@ -7700,6 +7757,11 @@ qemuDomainBlockStats(virDomainPtr dom,
         goto cleanup;
     }
 
+    if (qemuDomainDiskStatsCached(driver, vm, disk->info.alias, &sample)) {
+        ret = 0;
+        goto cleanup;
+    }
+
     priv = vm->privateData;
     if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
         goto cleanup;
@@ -7713,22 +7775,32 @@ qemuDomainBlockStats(virDomainPtr dom,
     qemuDomainObjEnterMonitor(driver, vm);
     ret = qemuMonitorGetBlockStatsInfo(priv->mon,
                                        disk->info.alias,
-                                       &stats->rd_req,
-                                       &stats->rd_bytes,
-                                       NULL,
-                                       &stats->wr_req,
-                                       &stats->wr_bytes,
-                                       NULL,
-                                       NULL,
-                                       NULL,
-                                       &stats->errs);
+                                       &sample.rd_req,
+                                       &sample.rd_bytes,
+                                       &sample.rd_total_times,
+                                       &sample.wr_req,
+                                       &sample.wr_bytes,
+                                       &sample.wr_total_times,
+                                       &sample.flush_req,
+                                       &sample.flush_total_times,
+                                       &sample.errs);
     qemuDomainObjExitMonitor(driver, vm);
 
+    if (ret == 0)
+        qemuDomainDiskStatsStore(driver, vm, disk->info.alias, &sample);
+
 endjob:
     if (qemuDomainObjEndJob(driver, vm) == 0)
         vm = NULL;
 
 cleanup:
+    if (ret == 0) {
+        stats->rd_req = sample.rd_req;
+        stats->rd_bytes = sample.rd_bytes;
+        stats->wr_req = sample.wr_req;
+        stats->wr_bytes = sample.wr_bytes;
+        stats->errs = sample.errs;
+    }
     if (vm)
         virDomainObjUnlock(vm);
     return ret;
@@ -7746,8 +7818,8 @@ qemuDomainBlockStatsFlags(virDomainPtr dom,
     virDomainObjPtr vm;
     virDomainDiskDefPtr disk = NULL;
     qemuDomainObjPrivatePtr priv;
-    long long rd_req, rd_bytes, wr_req, wr_bytes, rd_total_times;
-    long long wr_total_times, flush_req, flush_total_times, errs;
+    qemuDomainDiskStats sample;
+    bool job = false;
     virTypedParameterPtr param;
 
     virCheckFlags(VIR_TYPED_PARAM_STRING_OKAY, -1);
@@ -7791,108 +7863,132 @@ qemuDomainBlockStatsFlags(virDomainPtr dom,
     priv = vm->privateData;
     VIR_DEBUG("priv=%p, params=%p, flags=%x", priv, params, flags);
 
-    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
-        goto cleanup;
+    tmp = *nparams;
 
-    if (!virDomainObjIsActive(vm)) {
-        virReportError(VIR_ERR_OPERATION_INVALID,
-                       "%s", _("domain is not running"));
-        goto endjob;
-    }
+    /* Serve the call from a recent sample if there is one; the
+     * number of parameters does not change while the domain runs */
+    if (priv->blockStatsParams &&
+        (tmp == 0 ||
+         qemuDomainDiskStatsCached(driver, vm, disk->info.alias, &sample))) {
+        *nparams = priv->blockStatsParams;
+        ret = 0;
+        if (tmp == 0)
+            goto cleanup;
+    } else {
+        if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
+            goto cleanup;
+        job = true;
 
-    qemuDomainObjEnterMonitor(driver, vm);
-    tmp = *nparams;
-    ret = qemuMonitorGetBlockStatsParamsNumber(priv->mon, nparams);
+        if (!virDomainObjIsActive(vm)) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           "%s", _("domain is not running"));
+            goto endjob;
+        }
 
-    if (tmp == 0 || ret < 0) {
-        qemuDomainObjExitMonitor(driver, vm);
-        goto endjob;
-    }
+        qemuDomainObjEnterMonitor(driver, vm);
+        ret = qemuMonitorGetBlockStatsParamsNumber(priv->mon, nparams);
 
-    ret = qemuMonitorGetBlockStatsInfo(priv->mon,
-                                       disk->info.alias,
-                                       &rd_req,
-                                       &rd_bytes,
-                                       &rd_total_times,
-                                       &wr_req,
-                                       &wr_bytes,
-                                       &wr_total_times,
-                                       &flush_req,
-                                       &flush_total_times,
-                                       &errs);
+        if (tmp == 0 || ret < 0) {
+            qemuDomainObjExitMonitor(driver, vm);
+            if (ret == 0 && driver->statsInterval)
+                priv->blockStatsParams = *nparams;
+            goto endjob;
+        }
 
-    qemuDomainObjExitMonitor(driver, vm);
+        ret = qemuMonitorGetBlockStatsInfo(priv->mon,
+                                           disk->info.alias,
+                                           &sample.rd_req,
+                                           &sample.rd_bytes,
+                                           &sample.rd_total_times,
+                                           &sample.wr_req,
+                                           &sample.wr_bytes,
+                                           &sample.wr_total_times,
+                                           &sample.flush_req,
+                                           &sample.flush_total_times,
+                                           &sample.errs);
 
-    if (ret < 0)
-        goto endjob;
+        qemuDomainObjExitMonitor(driver, vm);
+
+        if (ret < 0)
+            goto endjob;
+
+        if (driver->statsInterval)
+            priv->blockStatsParams = *nparams;
+        qemuDomainDiskStatsStore(driver, vm, disk->info.alias, &sample);
+    }
 
     tmp = 0;
     ret = -1;
 
-    if (tmp < *nparams && wr_bytes != -1) {
+    if (tmp < *nparams && sample.wr_bytes != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param, VIR_DOMAIN_BLOCK_STATS_WRITE_BYTES,
-                                    VIR_TYPED_PARAM_LLONG, wr_bytes) < 0)
+                                    VIR_TYPED_PARAM_LLONG,
+                                    sample.wr_bytes) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && wr_req != -1) {
+    if (tmp < *nparams && sample.wr_req != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param, VIR_DOMAIN_BLOCK_STATS_WRITE_REQ,
-                                    VIR_TYPED_PARAM_LLONG, wr_req) < 0)
+                                    VIR_TYPED_PARAM_LLONG, sample.wr_req) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && rd_bytes != -1) {
+    if (tmp < *nparams && sample.rd_bytes != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param, VIR_DOMAIN_BLOCK_STATS_READ_BYTES,
-                                    VIR_TYPED_PARAM_LLONG, rd_bytes) < 0)
+                                    VIR_TYPED_PARAM_LLONG,
+                                    sample.rd_bytes) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && rd_req != -1) {
+    if (tmp < *nparams && sample.rd_req != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param, VIR_DOMAIN_BLOCK_STATS_READ_REQ,
-                                    VIR_TYPED_PARAM_LLONG, rd_req) < 0)
+                                    VIR_TYPED_PARAM_LLONG, sample.rd_req) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && flush_req != -1) {
+    if (tmp < *nparams && sample.flush_req != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param, VIR_DOMAIN_BLOCK_STATS_FLUSH_REQ,
-                                    VIR_TYPED_PARAM_LLONG, flush_req) < 0)
+                                    VIR_TYPED_PARAM_LLONG,
+                                    sample.flush_req) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && wr_total_times != -1) {
+    if (tmp < *nparams && sample.wr_total_times != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param,
                                     VIR_DOMAIN_BLOCK_STATS_WRITE_TOTAL_TIMES,
-                                    VIR_TYPED_PARAM_LLONG, wr_total_times) < 0)
+                                    VIR_TYPED_PARAM_LLONG,
+                                    sample.wr_total_times) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && rd_total_times != -1) {
+    if (tmp < *nparams && sample.rd_total_times != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param,
                                     VIR_DOMAIN_BLOCK_STATS_READ_TOTAL_TIMES,
-                                    VIR_TYPED_PARAM_LLONG, rd_total_times) < 0)
+                                    VIR_TYPED_PARAM_LLONG,
+                                    sample.rd_total_times) < 0)
             goto endjob;
         tmp++;
     }
 
-    if (tmp < *nparams && flush_total_times != -1) {
+    if (tmp < *nparams && sample.flush_total_times != -1) {
         param = &params[tmp];
         if (virTypedParameterAssign(param,
                                     VIR_DOMAIN_BLOCK_STATS_FLUSH_TOTAL_TIMES,
                                     VIR_TYPED_PARAM_LLONG,
-                                    flush_total_times) < 0)
+                                    sample.flush_total_times) < 0)
             goto endjob;
         tmp++;
     }
@@ -7903,7 +7999,7 @@ qemuDomainBlockStatsFlags(virDomainPtr dom,
     *nparams = tmp;
 
 endjob:
-    if (qemuDomainObjEndJob(driver, vm) == 0)
+    if (job && qemuDomainObjEndJob(driver, vm) == 0)
         vm = NULL;
 
 cleanup:
@@ -8114,6 +8210,7 @@ qemuDomainSetInterfaceParameters(virDomainPtr dom,
         virNetDevBandwidthFree(net->bandwidth);
         net->bandwidth = newBandwidth;
         newBandwidth = NULL;
+        virDomainObjUnpublishDef(vm);
     }
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
         if (!persistentNet->bandwidth) {
@@ -8277,6 +8374,7 @@ qemudDomainMemoryStats (virDomainPtr dom,
 {
     struct qemud_driver *driver = dom->conn->privateData;
     virDomainObjPtr vm;
+    bool job = false;
     int ret = -1;
 
     virCheckFlags(0, -1);
@@ -8293,33 +8391,50 @@ qemudDomainMemoryStats (virDomainPtr dom,
         goto cleanup;
     }
 
-    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
-        goto cleanup;
+    if (virDomainObjIsActive(vm))
+        ret = qemuDomainMemoryStatsCached(driver, vm, stats, nr_stats);
 
-    if (!virDomainObjIsActive(vm)) {
-        virReportError(VIR_ERR_OPERATION_INVALID,
-                       "%s", _("domain is not running"));
-    } else {
+    if (ret < 0) {
         qemuDomainObjPrivatePtr priv = vm->privateData;
+        virDomainMemoryStatStruct sample[VIR_DOMAIN_MEMORY_STAT_NR];
+
+        if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
+            goto cleanup;
+        job = true;
+
+        if (!virDomainObjIsActive(vm)) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           "%s", _("domain is not running"));
+            goto endjob;
+        }
+
+        /* Always take the full set so that it can serve any caller */
         qemuDomainObjEnterMonitor(driver, vm);
-        ret = qemuMonitorGetMemoryStats(priv->mon, stats, nr_stats);
+        ret = qemuMonitorGetMemoryStats(priv->mon, sample,
+                                        VIR_DOMAIN_MEMORY_STAT_NR);
         qemuDomainObjExitMonitor(driver, vm);
 
-        if (ret >= 0 && ret < nr_stats) {
-            long rss;
-            if (qemudGetProcessInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
-                virReportError(VIR_ERR_OPERATION_FAILED, "%s",
-                               _("cannot get RSS for domain"));
-            } else {
-                stats[ret].tag = VIR_DOMAIN_MEMORY_STAT_RSS;
-                stats[ret].val = rss;
-                ret++;
-            }
+        if (ret >= 0) {
+            qemuDomainMemoryStatsStore(driver, vm, sample, ret);
+            ret = MIN(ret, nr_stats);
+            memcpy(stats, sample, ret * sizeof(*stats));
+        }
+    }
 
+    if (ret >= 0 && ret < nr_stats) {
+        long rss;
+        if (qemudGetProcessInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
+            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                           _("cannot get RSS for domain"));
+        } else {
+            stats[ret].tag = VIR_DOMAIN_MEMORY_STAT_RSS;
+            stats[ret].val = rss;
+            ret++;
         }
     }
 
-    if (qemuDomainObjEndJob(driver, vm) == 0)
+endjob:
+    if (job && qemuDomainObjEndJob(driver, vm) == 0)
         vm = NULL;
 
 cleanup:
@@ -8627,6 +8742,12 @@ static int qemuDomainGetBlockInfo(virDomainPtr dom,
         virDomainObjIsActive(vm)) {
         qemuDomainObjPrivatePtr priv = vm->privateData;
 
+        if (qemuDomainBlockExtentCached(driver, vm, disk->info.alias,
+                                        &info->allocation)) {
+            ret = 0;
+            goto cleanup;
+        }
+
         if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
             goto cleanup;
 
@@ -8636,6 +8757,9 @@ static int qemuDomainGetBlockInfo(virDomainPtr dom,
                                             disk->info.alias,
                                             &info->allocation);
             qemuDomainObjExitMonitor(driver, vm);
+            if (ret == 0)
+                qemuDomainBlockExtentStore(driver, vm, disk->info.alias,
+                                           info->allocation);
         } else {
             ret = 0;
         }
@@ -12602,6 +12726,7 @@ qemuDomainSetMetadata(virDomainPtr dom,
             goto cleanup;
             break;
         }
+        virDomainObjUnpublishDef(vm);
     }
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
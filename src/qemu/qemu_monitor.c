@@ -27,6 +27,9 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <fcntl.h>
+#if HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
 
 #include "qemu_monitor.h"
 #include "qemu_monitor_text.h"
@@ -36,6 +39,8 @@
 #include "memory.h"
 #include "logging.h"
 #include "virfile.h"
+#include "virtime.h"
+#include "dirname.h"
 
 #ifdef WITH_DTRACE_PROBES
 # include "libvirt_qemu_probes.h"
@@ -269,13 +274,73 @@ qemuMonitorUnwatch(void *monitor)
         qemuMonitorUnlock(mon);
 }
 
+/* How long to wait for qemu to create its monitor socket, in ms */
+#define QEMU_MONITOR_OPEN_TIMEOUT 3000
+/* Upper bound on the time between two connection attempts, in ms */
+#define QEMU_MONITOR_OPEN_MAX_DELAY 100
+
+/*
+ * Watch the directory holding the monitor socket, so that we learn
+ * as soon as qemu creates it. Returns the inotify descriptor, or -1
+ * if it is not available, in which case the caller has to poll.
+ */
+static int
+qemuMonitorWatchSocketDir(const char *monitor)
+{
+#if HAVE_SYS_INOTIFY_H
+    char *dir;
+    int fd;
+
+    if (!(dir = mdir_name(monitor)))
+        return -1;
+
+    if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0 &&
+        inotify_add_watch(fd, dir, IN_CREATE | IN_MOVED_TO) < 0) {
+        VIR_DEBUG("Unable to watch %s for the monitor socket", dir);
+        VIR_FORCE_CLOSE(fd);
+    }
+
+    VIR_FREE(dir);
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Sleep for up to @timeout ms, returning early if something was
+ * created in the directory watched by @watchfd. Returns true if
+ * we were woken up by such an event.
+ */
+static bool
+qemuMonitorWaitSocketDir(int watchfd, int timeout)
+{
+    struct pollfd fd = { .fd = watchfd, .events = POLLIN };
+    char buf[1024];
+
+    if (watchfd < 0) {
+        usleep(timeout * 1000);
+        return false;
+    }
+
+    if (poll(&fd, 1, timeout) <= 0)
+        return false;
+
+    /* Drain the queued events, we only care that there were some */
+    while (read(watchfd, buf, sizeof(buf)) > 0)
+        ;
+    return true;
+}
+
 static int
 qemuMonitorOpenUnix(const char *monitor, pid_t cpid)
 {
     struct sockaddr_un addr;
     int monfd;
-    int timeout = 3; /* In seconds */
-    int ret, i = 0;
+    int watchfd = -1;
+    unsigned long long now, deadline;
+    int delay = 1;
+    int ret;
 
     if ((monfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
         virReportSystemError(errno,
@@ -291,34 +356,57 @@ qemuMonitorOpenUnix(const char *monitor, pid_t cpid)
         goto error;
     }
 
-    do {
+    if (virTimeMillisNow(&now) < 0)
+        goto error;
+    deadline = now + QEMU_MONITOR_OPEN_TIMEOUT;
+
+    /* Set up the watch before the first attempt, so that the socket
+     * can't show up unnoticed between a failed connect and the wait */
+    watchfd = qemuMonitorWatchSocketDir(monitor);
+
+    while (1) {
+        int err;
+
         ret = connect(monfd, (struct sockaddr *) &addr, sizeof(addr));
 
         if (ret == 0)
             break;
 
-        if ((errno == ENOENT || errno == ECONNREFUSED) &&
+        err = errno;
+        if ((err == ENOENT || err == ECONNREFUSED) &&
             virKillProcess(cpid, 0) == 0) {
             /* ENOENT       : Socket may not have shown up yet
-             * ECONNREFUSED : Leftover socket hasn't been removed yet */
+             * ECONNREFUSED : Leftover socket hasn't been removed yet,
+             *                or qemu has bound but not yet listened */
+            if (virTimeMillisNow(&now) < 0)
+                goto error;
+
+            if (now >= deadline) {
+                virReportSystemError(err, "%s",
+                                     _("monitor socket did not show up."));
+                goto error;
+            }
+
+            /* A new file in the directory is most likely our socket, so
+             * retry quickly after an event, and back off otherwise */
+            if (qemuMonitorWaitSocketDir(watchfd,
+                                         MIN(delay, deadline - now)))
+                delay = 1;
+            else if (delay < QEMU_MONITOR_OPEN_MAX_DELAY)
+                delay = MIN(delay * 2, QEMU_MONITOR_OPEN_MAX_DELAY);
             continue;
         }
 
-        virReportSystemError(errno, "%s",
+        virReportSystemError(err, "%s",
                              _("failed to connect to monitor socket"));
         goto error;
-
-    } while ((++i <= timeout*5) && (usleep(.2 * 1000000) <= 0));
-
-    if (ret != 0) {
-        virReportSystemError(errno, "%s",
-                             _("monitor socket did not show up."));
-        goto error;
     }
 
+    VIR_FORCE_CLOSE(watchfd);
     return monfd;
 
 error:
+    VIR_FORCE_CLOSE(watchfd);
     VIR_FORCE_CLOSE(monfd);
     return -1;
 }
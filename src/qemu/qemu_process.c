@@ -24,10 +24,17 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sys/poll.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <linux/capability.h>
+#if HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+#if HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 
 #include "qemu_process.h"
 #include "qemu_domain.h"
@@ -1259,6 +1266,57 @@ error:
     return ret;
 }
 
+/* Longest we wait for log output before checking qemu is alive, in ms */
+#define QEMU_PROCESS_LOG_MAX_DELAY 1000
+/* Longest delay between two reads of the log without inotify, in ms */
+#define QEMU_PROCESS_LOG_POLL_DELAY 100
+
+/*
+ * Watch the log file open on @fd for writes, and for qemu closing it
+ * when it exits. Returns the inotify descriptor, or -1 if it is not
+ * available, in which case the caller has to poll.
+ */
+static int
+qemuProcessWatchLog(int fd ATTRIBUTE_UNUSED)
+{
+#if HAVE_SYS_INOTIFY_H
+    char *path;
+    int watchfd;
+
+    if (virAsprintf(&path, "/proc/self/fd/%d", fd) < 0)
+        return -1;
+
+    if ((watchfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0 &&
+        inotify_add_watch(watchfd, path, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        VIR_DEBUG("Unable to watch log file %s", path);
+        VIR_FORCE_CLOSE(watchfd);
+    }
+
+    VIR_FREE(path);
+    return watchfd;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Sleep for up to @timeout ms, returning early if the log watched by
+ * @watchfd changed.
+ */
+static void
+qemuProcessWaitLog(int watchfd, int timeout)
+{
+    struct pollfd fd = { .fd = watchfd, .events = POLLIN };
+    char buf[1024];
+
+    if (poll(&fd, 1, timeout) <= 0)
+        return;
+
+    /* Drain the queued events, we only care that there were some */
+    while (read(watchfd, buf, sizeof(buf)) > 0)
+        ;
+}
+
 typedef int qemuProcessLogHandleOutput(virDomainObjPtr vm,
                                        const char *output,
                                        int fd);
@@ -1275,7 +1333,9 @@ qemuProcessReadLogOutput(virDomainObjPtr vm,
                          const char *what,
                          int timeout)
 {
-    int retries = (timeout*10);
+    unsigned long long now, deadline;
+    int delay = 1;
+    int watchfd = -1;
     int got = 0;
     char *debug = NULL;
     int ret = -1;
@@ -1290,7 +1350,14 @@ qemuProcessReadLogOutput(virDomainObjPtr vm,
         return -1;
     }
 
-    while (retries) {
+    if (virTimeMillisNow(&now) < 0)
+        goto cleanup;
+    deadline = now + timeout * 1000ull;
+
+    /* Wake up as soon as qemu writes something, instead of sleeping */
+    watchfd = qemuProcessWatchLog(fd);
+
+    while (now < deadline) {
         ssize_t func_ret, bytes;
         int isdead = 0;
         char *eol;
@@ -1344,8 +1411,19 @@ qemuProcessReadLogOutput(virDomainObjPtr vm,
             goto cleanup;
         }
 
-        usleep(100*1000);
-        retries--;
+        if (watchfd >= 0) {
+            /* Nothing to do until qemu writes more, or exits and
+             * closes the log; the bound only catches a missed exit */
+            qemuProcessWaitLog(watchfd,
+                               MIN(QEMU_PROCESS_LOG_MAX_DELAY, deadline - now));
+        } else {
+            /* Poll quickly at first, then back off */
+            usleep(MIN(delay, deadline - now) * 1000);
+            delay = MIN(delay * 2, QEMU_PROCESS_LOG_POLL_DELAY);
+        }
+
+        if (virTimeMillisNow(&now) < 0)
+            goto cleanup;
     }
 
     virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1353,6 +1431,7 @@ qemuProcessReadLogOutput(virDomainObjPtr vm,
                    what, buf);
 
 cleanup:
+    VIR_FORCE_CLOSE(watchfd);
     VIR_FREE(debug);
     return ret;
 }
@@ -3866,11 +3945,78 @@ cleanup:
 }
 
 
+/* How long qemuProcessKill waits after SIGTERM, in ms */
+#define QEMU_PROCESS_KILL_GRACE 10000
+/* How much longer it waits, after SIGKILL if requested, in ms */
+#define QEMU_PROCESS_KILL_TIMEOUT 5000
+/* Longest delay between two checks when polling for exit, in ms */
+#define QEMU_PROCESS_KILL_POLL_DELAY 200
+
+/*
+ * Wait up to @timeout ms for process @pid to exit. qemu is not our
+ * child, so where the kernel supports it we wait on a pidfd, which
+ * becomes readable as soon as the process is gone; otherwise we poll
+ * with an increasing delay, so a quick exit is noticed quickly.
+ *
+ * Returns 0 if the process exited, 1 on timeout, -1 on error
+ */
+static int
+qemuProcessWaitForExit(pid_t pid, unsigned long long timeout)
+{
+    unsigned long long now, deadline;
+    struct pollfd fd = { .fd = -1, .events = POLLIN };
+    int delay = 1;
+    int ret = -1;
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+    deadline = now + timeout;
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    fd.fd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+
+    while (1) {
+        if (virKillProcess(pid, 0) < 0) {
+            if (errno == ESRCH)
+                ret = 0;
+            break;
+        }
+
+        if (virTimeMillisNow(&now) < 0)
+            break;
+        if (now >= deadline) {
+            ret = 1;
+            break;
+        }
+
+        if (fd.fd >= 0) {
+            int rc = poll(&fd, 1, MIN(deadline - now, INT_MAX));
+            if (rc > 0) {
+                /* Exited, even if it is yet to be reaped */
+                ret = 0;
+                break;
+            }
+            if (rc < 0 && errno != EINTR)
+                VIR_FORCE_CLOSE(fd.fd);
+        } else {
+            usleep(MIN(delay, deadline - now) * 1000);
+            delay = MIN(delay * 2, QEMU_PROCESS_KILL_POLL_DELAY);
+        }
+    }
+
+    VIR_FORCE_CLOSE(fd.fd);
+    return ret;
+}
+
+
 int
 qemuProcessKill(struct qemud_driver *driver,
                 virDomainObjPtr vm, unsigned int flags)
 {
-    int i, ret = -1;
+    int ret = -1;
+    int rc;
+    int signum = SIGTERM; /* kindly suggest it should exit */
     const char *signame = "TERM";
     bool driver_unlocked = false;
 
@@ -3884,62 +4030,73 @@ qemuProcessKill(struct qemud_driver *driver,
         }
     }
 
-    /* This loop sends SIGTERM (or SIGKILL if flags has
+    /* Send SIGTERM (or SIGKILL if flags has
      * VIR_QEMU_PROCESS_KILL_FORCE and VIR_QEMU_PROCESS_KILL_NOWAIT),
-     * then waits a few iterations (10 seconds) to see if it dies. If
-     * the qemu process still hasn't exited, and
-     * VIR_QEMU_PROCESS_KILL_FORCE is requested, a SIGKILL will then
-     * be sent, and qemuProcessKill will wait up to 5 seconds more for
-     * the process to exit before returning.  Note that the FORCE mode
-     * could result in lost data in the guest, so it should only be
-     * used if the guest is hung and can't be destroyed in any other
-     * manner.
+     * then wait up to 10 seconds to see if it dies. If the qemu
+     * process still hasn't exited, and VIR_QEMU_PROCESS_KILL_FORCE is
+     * requested, a SIGKILL will then be sent, and qemuProcessKill
+     * will wait up to 5 seconds more for the process to exit before
+     * returning; otherwise the wait simply goes on for those 5
+     * seconds. Note that the FORCE mode could result in lost data in
+     * the guest, so it should only be used if the guest is hung and
+     * can't be destroyed in any other manner.
      */
-    for (i = 0 ; i < 75; i++) {
-        int signum;
-        if (i == 0) {
-            if ((flags & VIR_QEMU_PROCESS_KILL_FORCE) &&
-                (flags & VIR_QEMU_PROCESS_KILL_NOWAIT)) {
-                signum = SIGKILL; /* kill it immediately */
-                signame="KILL";
-            } else {
-                signum = SIGTERM; /* kindly suggest it should exit */
-            }
-        } else if ((i == 50) & (flags & VIR_QEMU_PROCESS_KILL_FORCE)) {
+    if ((flags & VIR_QEMU_PROCESS_KILL_FORCE) &&
+        (flags & VIR_QEMU_PROCESS_KILL_NOWAIT)) {
+        signum = SIGKILL; /* kill it immediately */
+        signame = "KILL";
+    }
+
+    if (virKillProcess(vm->pid, signum) < 0)
+        goto signalled;
+
+    if (flags & VIR_QEMU_PROCESS_KILL_NOWAIT) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (driver) {
+        /* THREADS.txt says we can't hold the driver lock while sleeping */
+        qemuDriverUnlock(driver);
+        driver_unlocked = true;
+    }
+
+    rc = qemuProcessWaitForExit(vm->pid, QEMU_PROCESS_KILL_GRACE);
+
+    if (rc == 1) {
+        if (flags & VIR_QEMU_PROCESS_KILL_FORCE) {
             VIR_WARN("Timed out waiting after SIG%s to process %d, "
                      "sending SIGKILL", signame, vm->pid);
             signum = SIGKILL; /* kill it after a grace period */
-            signame="KILL";
-        } else {
-            signum = 0; /* Just check for existence */
-        }
-
-        if (virKillProcess(vm->pid, signum) < 0) {
-            if (errno != ESRCH) {
-                char ebuf[1024];
-                VIR_WARN("Failed to terminate process %d with SIG%s: %s",
-                         vm->pid, signame,
-                         virStrerror(errno, ebuf, sizeof(ebuf)));
-                goto cleanup;
-            }
-            ret = 0;
-            goto cleanup; /* process is dead */
-        }
-
-        if (i == 0 && (flags & VIR_QEMU_PROCESS_KILL_NOWAIT)) {
-            ret = 0;
-            goto cleanup;
+            signame = "KILL";
+            if (virKillProcess(vm->pid, signum) < 0)
+                goto signalled;
         }
+        rc = qemuProcessWaitForExit(vm->pid, QEMU_PROCESS_KILL_TIMEOUT);
+    }
 
-        if (driver && !driver_unlocked) {
-            /* THREADS.txt says we can't hold the driver lock while sleeping */
-            qemuDriverUnlock(driver);
-            driver_unlocked = true;
-        }
+    if (rc == 0) {
+        ret = 0; /* process is dead */
+    } else if (rc == 1) {
+        VIR_WARN("Timed out waiting after SIG%s to process %d",
+                 signame, vm->pid);
+    } else {
+        char ebuf[1024];
+        VIR_WARN("Failed to check process %d: %s",
+                 vm->pid, virStrerror(errno, ebuf, sizeof(ebuf)));
+    }
+    goto cleanup;
 
-        usleep(200 * 1000);
+signalled:
+    if (errno != ESRCH) {
+        char ebuf[1024];
+        VIR_WARN("Failed to terminate process %d with SIG%s: %s",
+                 vm->pid, signame,
+                 virStrerror(errno, ebuf, sizeof(ebuf)));
+        goto cleanup;
     }
-    VIR_WARN("Timed out waiting after SIG%s to process %d", signame, vm->pid);
+    ret = 0; /* process is dead */
+
 cleanup:
     if (driver_unlocked) {
         /* We had unlocked the driver, so re-lock it. THREADS.txt says
@@ -4046,6 +4203,8 @@ void qemuProcessStop(struct qemud_driver *driver,
     if (priv->mon)
         qemuMonitorClose(priv->mon);
 
+    qemuDomainStatsClear(vm);
+
     if (priv->monConfig) {
         if (priv->monConfig->type == VIR_DOMAIN_CHR_TYPE_UNIX)
             unlink(priv->monConfig->data.nix.path);
@@ -4168,6 +4327,8 @@ retry:
         VIR_FREE(xml);
     }
 
+    virDomainObjUnpublishDef(vm);
+
     if (vm->newDef) {
         virDomainDefFree(vm->def);
         vm->def = vm->newDef;
@@ -2683,6 +2683,133 @@ done:
     return rv;
 }
 
+static int
+remoteConnectListAllStoragePools(virConnectPtr conn,
+                                 virStoragePoolPtr **pools,
+                                 unsigned int flags)
+{
+    int rv = -1;
+    int i;
+    virStoragePoolPtr *tmp_pools = NULL;
+    remote_connect_list_all_storage_pools_args args;
+    remote_connect_list_all_storage_pools_ret ret;
+
+    struct private_data *priv = conn->storagePrivateData;
+
+    remoteDriverLock(priv);
+
+    args.need_results = !!pools;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn,
+             priv,
+             0,
+             REMOTE_PROC_CONNECT_LIST_ALL_STORAGE_POOLS,
+             (xdrproc_t) xdr_remote_connect_list_all_storage_pools_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_connect_list_all_storage_pools_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    if (pools) {
+        if (VIR_ALLOC_N(tmp_pools, ret.pools.pools_len + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        for (i = 0; i < ret.pools.pools_len; i++) {
+            tmp_pools[i] = get_nonnull_storage_pool(conn, ret.pools.pools_val[i]);
+            if (!tmp_pools[i]) {
+                virReportOOMError();
+                goto cleanup;
+            }
+        }
+        *pools = tmp_pools;
+        tmp_pools = NULL;
+    }
+
+    rv = ret.ret;
+
+cleanup:
+    if (tmp_pools) {
+        for (i = 0; i < ret.pools.pools_len; i++)
+            if (tmp_pools[i])
+                virStoragePoolFree(tmp_pools[i]);
+        VIR_FREE(tmp_pools);
+    }
+
+    xdr_free((xdrproc_t) xdr_remote_connect_list_all_storage_pools_ret, (char *) &ret);
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+static int
+remoteStoragePoolListAllVolumes(virStoragePoolPtr pool,
+                                virStorageVolPtr **vols,
+                                unsigned int flags)
+{
+    int rv = -1;
+    int i;
+    virStorageVolPtr *tmp_vols = NULL;
+    remote_storage_pool_list_all_volumes_args args;
+    remote_storage_pool_list_all_volumes_ret ret;
+
+    struct private_data *priv = pool->conn->storagePrivateData;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_storage_pool(&args.pool, pool);
+    args.need_results = !!vols;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(pool->conn,
+             priv,
+             0,
+             REMOTE_PROC_STORAGE_POOL_LIST_ALL_VOLUMES,
+             (xdrproc_t) xdr_remote_storage_pool_list_all_volumes_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_storage_pool_list_all_volumes_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    if (vols) {
+        if (VIR_ALLOC_N(tmp_vols, ret.vols.vols_len + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        for (i = 0; i < ret.vols.vols_len; i++) {
+            tmp_vols[i] = get_nonnull_storage_vol(pool->conn, ret.vols.vols_val[i]);
+            if (!tmp_vols[i]) {
+                virReportOOMError();
+                goto cleanup;
+            }
+        }
+        *vols = tmp_vols;
+        tmp_vols = NULL;
+    }
+
+    rv = ret.ret;
+
+cleanup:
+    if (tmp_vols) {
+        for (i = 0; i < ret.vols.vols_len; i++)
+            if (tmp_vols[i])
+                virStorageVolFree(tmp_vols[i]);
+        VIR_FREE(tmp_vols);
+    }
+
+    xdr_free((xdrproc_t) xdr_remote_storage_pool_list_all_volumes_ret, (char *) &ret);
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
 /*----------------------------------------------------------------------*/
 
 static virDrvOpenStatus ATTRIBUTE_NONNULL (1)
@@ -2698,6 +2825,69 @@ remoteDevMonClose(virConnectPtr conn)
     return remoteGenericClose(conn, &conn->devMonPrivateData);
 }
 
+static int
+remoteConnectListAllNodeDevices(virConnectPtr conn,
+                                virNodeDevicePtr **devices,
+                                unsigned int flags)
+{
+    int rv = -1;
+    int i;
+    virNodeDevicePtr *tmp_devices = NULL;
+    remote_connect_list_all_node_devices_args args;
+    remote_connect_list_all_node_devices_ret ret;
+
+    struct private_data *priv = conn->devMonPrivateData;
+
+    remoteDriverLock(priv);
+
+    args.need_results = !!devices;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn,
+             priv,
+             0,
+             REMOTE_PROC_CONNECT_LIST_ALL_NODE_DEVICES,
+             (xdrproc_t) xdr_remote_connect_list_all_node_devices_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_connect_list_all_node_devices_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    if (devices) {
+        if (VIR_ALLOC_N(tmp_devices, ret.devices.devices_len + 1) < 0) {
+            virReportOOMError();
+            goto cleanup;
+        }
+
+        for (i = 0; i < ret.devices.devices_len; i++) {
+            tmp_devices[i] = get_nonnull_node_device(conn, ret.devices.devices_val[i]);
+            if (!tmp_devices[i]) {
+                virReportOOMError();
+                goto cleanup;
+            }
+        }
+        *devices = tmp_devices;
+        tmp_devices = NULL;
+    }
+
+    rv = ret.ret;
+
+cleanup:
+    if (tmp_devices) {
+        for (i = 0; i < ret.devices.devices_len; i++)
+            if (tmp_devices[i])
+                virNodeDeviceFree(tmp_devices[i]);
+        VIR_FREE(tmp_devices);
+    }
+
+    xdr_free((xdrproc_t) xdr_remote_connect_list_all_node_devices_ret, (char *) &ret);
+
+done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
 static int
 remoteNodeDeviceDettach (virNodeDevicePtr dev)
 {
@@ -4897,6 +5087,318 @@ call (virConnectPtr conn,
 }
 
 
+/* An asynchronous call, from its submission until the user
+ * callback ran on the event loop */
+typedef struct _remoteAsyncCall remoteAsyncCall;
+typedef remoteAsyncCall *remoteAsyncCallPtr;
+
+/* Copies the decoded reply of @call to the caller's buffer */
+typedef int (*remoteAsyncFinishFunc)(remoteAsyncCallPtr call);
+
+struct _remoteAsyncCall {
+    virConnectPtr conn;
+    virDomainPtr dom;           /* referenced domain, if any */
+
+    xdrproc_t ret_filter;
+    union {
+        remote_domain_lookup_by_name_ret lookup_by_name;
+        remote_domain_lookup_by_uuid_ret lookup_by_uuid;
+        remote_domain_get_info_ret get_info;
+        remote_domain_block_stats_ret block_stats;
+        remote_domain_interface_stats_ret interface_stats;
+    } ret;
+    remoteAsyncFinishFunc finish;
+    void *result;               /* caller's buffer */
+    size_t size;
+
+    virConnectAsyncCallback cb;
+    void *opaque;
+    virFreeCallback freecb;
+};
+
+static void
+remoteAsyncCallFree(remoteAsyncCallPtr call)
+{
+    if (call->dom)
+        virUnrefDomain(call->dom);
+    virUnrefConnect(call->conn);
+    VIR_FREE(call);
+}
+
+static void
+remoteAsyncDone(int result, void *opaque)
+{
+    remoteAsyncCallPtr call = opaque;
+
+    if (result == 0) {
+        result = call->finish(call);
+        xdr_free(call->ret_filter, (char *)&call->ret);
+    }
+
+    call->cb(call->conn, result, call->opaque);
+    virResetLastError();
+
+    if (call->freecb)
+        call->freecb(call->opaque);
+    remoteAsyncCallFree(call);
+}
+
+/*
+ * Submit @proc_nr and return without waiting for the reply. Once it
+ * arrived, @call->finish and then the user callback are run from the
+ * event loop. On failure @call is freed.
+ */
+static int
+callAsync(virConnectPtr conn,
+          virDomainPtr dom,
+          remoteAsyncCallPtr call,
+          int proc_nr,
+          xdrproc_t args_filter, char *args)
+{
+    struct private_data *priv = conn->privateData;
+    int rv;
+
+    virConnectRef(conn);
+    call->conn = conn;
+    if (dom) {
+        virDomainRef(dom);
+        call->dom = dom;
+    }
+
+    remoteDriverLock(priv);
+    rv = virNetClientProgramCallAsync(priv->remoteProgram,
+                                      priv->client,
+                                      priv->counter++,
+                                      proc_nr,
+                                      args_filter, args,
+                                      call->ret_filter, &call->ret,
+                                      remoteAsyncDone, call);
+    remoteDriverUnlock(priv);
+
+    if (rv < 0)
+        remoteAsyncCallFree(call);
+    return rv;
+}
+
+static remoteAsyncCallPtr
+remoteAsyncCallNew(xdrproc_t ret_filter,
+                   remoteAsyncFinishFunc finish,
+                   void *result,
+                   size_t size,
+                   virConnectAsyncCallback cb,
+                   void *opaque,
+                   virFreeCallback freecb)
+{
+    remoteAsyncCallPtr call;
+
+    if (VIR_ALLOC(call) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+
+    call->ret_filter = ret_filter;
+    call->finish = finish;
+    call->result = result;
+    call->size = size;
+    call->cb = cb;
+    call->opaque = opaque;
+    call->freecb = freecb;
+
+    return call;
+}
+
+static int
+remoteDomainLookupAsyncFinish(remoteAsyncCallPtr call)
+{
+    virDomainPtr *dom = call->result;
+
+    /* lookup_by_name and lookup_by_uuid replies share their layout */
+    if (!(*dom = get_nonnull_domain(call->conn, call->ret.lookup_by_name.dom)))
+        return -1;
+    return 0;
+}
+
+static int
+remoteDomainLookupByNameAsync(virConnectPtr conn,
+                              const char *name,
+                              virDomainPtr *dom,
+                              virConnectAsyncCallback cb,
+                              void *opaque,
+                              virFreeCallback freecb,
+                              unsigned int flags)
+{
+    remote_domain_lookup_by_name_args args;
+    remoteAsyncCallPtr call;
+
+    virCheckFlags(0, -1);
+
+    if (!(call = remoteAsyncCallNew((xdrproc_t) xdr_remote_domain_lookup_by_name_ret,
+                                    remoteDomainLookupAsyncFinish,
+                                    dom, 0, cb, opaque, freecb)))
+        return -1;
+
+    args.name = (char *) name;
+
+    return callAsync(conn, NULL, call, REMOTE_PROC_DOMAIN_LOOKUP_BY_NAME,
+                     (xdrproc_t) xdr_remote_domain_lookup_by_name_args,
+                     (char *) &args);
+}
+
+static int
+remoteDomainLookupByUUIDAsync(virConnectPtr conn,
+                              const unsigned char *uuid,
+                              virDomainPtr *dom,
+                              virConnectAsyncCallback cb,
+                              void *opaque,
+                              virFreeCallback freecb,
+                              unsigned int flags)
+{
+    remote_domain_lookup_by_uuid_args args;
+    remoteAsyncCallPtr call;
+
+    virCheckFlags(0, -1);
+
+    if (!(call = remoteAsyncCallNew((xdrproc_t) xdr_remote_domain_lookup_by_uuid_ret,
+                                    remoteDomainLookupAsyncFinish,
+                                    dom, 0, cb, opaque, freecb)))
+        return -1;
+
+    memcpy(args.uuid, uuid, VIR_UUID_BUFLEN);
+
+    return callAsync(conn, NULL, call, REMOTE_PROC_DOMAIN_LOOKUP_BY_UUID,
+                     (xdrproc_t) xdr_remote_domain_lookup_by_uuid_args,
+                     (char *) &args);
+}
+
+static int
+remoteDomainGetInfoAsyncFinish(remoteAsyncCallPtr call)
+{
+    virDomainInfoPtr info = call->result;
+
+    info->state = call->ret.get_info.state;
+    info->maxMem = call->ret.get_info.maxMem;
+    info->memory = call->ret.get_info.memory;
+    info->nrVirtCpu = call->ret.get_info.nrVirtCpu;
+    info->cpuTime = call->ret.get_info.cpuTime;
+    return 0;
+}
+
+static int
+remoteDomainGetInfoAsync(virDomainPtr domain,
+                         virDomainInfoPtr info,
+                         virConnectAsyncCallback cb,
+                         void *opaque,
+                         virFreeCallback freecb,
+                         unsigned int flags)
+{
+    remote_domain_get_info_args args;
+    remoteAsyncCallPtr call;
+
+    virCheckFlags(0, -1);
+
+    if (!(call = remoteAsyncCallNew((xdrproc_t) xdr_remote_domain_get_info_ret,
+                                    remoteDomainGetInfoAsyncFinish,
+                                    info, 0, cb, opaque, freecb)))
+        return -1;
+
+    make_nonnull_domain(&args.dom, domain);
+
+    return callAsync(domain->conn, domain, call, REMOTE_PROC_DOMAIN_GET_INFO,
+                     (xdrproc_t) xdr_remote_domain_get_info_args,
+                     (char *) &args);
+}
+
+static int
+remoteDomainBlockStatsAsyncFinish(remoteAsyncCallPtr call)
+{
+    struct _virDomainBlockStats stats;
+
+    stats.rd_req = call->ret.block_stats.rd_req;
+    stats.rd_bytes = call->ret.block_stats.rd_bytes;
+    stats.wr_req = call->ret.block_stats.wr_req;
+    stats.wr_bytes = call->ret.block_stats.wr_bytes;
+    stats.errs = call->ret.block_stats.errs;
+
+    memcpy(call->result, &stats, call->size);
+    return 0;
+}
+
+static int
+remoteDomainBlockStatsAsync(virDomainPtr domain,
+                            const char *path,
+                            virDomainBlockStatsPtr stats,
+                            size_t size,
+                            virConnectAsyncCallback cb,
+                            void *opaque,
+                            virFreeCallback freecb,
+                            unsigned int flags)
+{
+    remote_domain_block_stats_args args;
+    remoteAsyncCallPtr call;
+
+    virCheckFlags(0, -1);
+
+    if (!(call = remoteAsyncCallNew((xdrproc_t) xdr_remote_domain_block_stats_ret,
+                                    remoteDomainBlockStatsAsyncFinish,
+                                    stats, size, cb, opaque, freecb)))
+        return -1;
+
+    make_nonnull_domain(&args.dom, domain);
+    args.path = (char *) path;
+
+    return callAsync(domain->conn, domain, call, REMOTE_PROC_DOMAIN_BLOCK_STATS,
+                     (xdrproc_t) xdr_remote_domain_block_stats_args,
+                     (char *) &args);
+}
+
+static int
+remoteDomainInterfaceStatsAsyncFinish(remoteAsyncCallPtr call)
+{
+    struct _virDomainInterfaceStats stats;
+
+    stats.rx_bytes = call->ret.interface_stats.rx_bytes;
+    stats.rx_packets = call->ret.interface_stats.rx_packets;
+    stats.rx_errs = call->ret.interface_stats.rx_errs;
+    stats.rx_drop = call->ret.interface_stats.rx_drop;
+    stats.tx_bytes = call->ret.interface_stats.tx_bytes;
+    stats.tx_packets = call->ret.interface_stats.tx_packets;
+    stats.tx_errs = call->ret.interface_stats.tx_errs;
+    stats.tx_drop = call->ret.interface_stats.tx_drop;
+
+    memcpy(call->result, &stats, call->size);
+    return 0;
+}
+
+static int
+remoteDomainInterfaceStatsAsync(virDomainPtr domain,
+                                const char *path,
+                                virDomainInterfaceStatsPtr stats,
+                                size_t size,
+                                virConnectAsyncCallback cb,
+                                void *opaque,
+                                virFreeCallback freecb,
+                                unsigned int flags)
+{
+    remote_domain_interface_stats_args args;
+    remoteAsyncCallPtr call;
+
+    virCheckFlags(0, -1);
+
+    if (!(call = remoteAsyncCallNew((xdrproc_t) xdr_remote_domain_interface_stats_ret,
+                                    remoteDomainInterfaceStatsAsyncFinish,
+                                    stats, size, cb, opaque, freecb)))
+        return -1;
+
+    make_nonnull_domain(&args.dom, domain);
+    args.path = (char *) path;
+
+    return callAsync(domain->conn, domain, call,
+                     REMOTE_PROC_DOMAIN_INTERFACE_STATS,
+                     (xdrproc_t) xdr_remote_domain_interface_stats_args,
+                     (char *) &args);
+}
+
+
 static int
 remoteDomainGetInterfaceParameters (virDomainPtr domain,
                                     const char *device,
@@ -5229,7 +5731,9 @@ static virDriver remote_driver = {
     .domainCreateXML = remoteDomainCreateXML, /* 0.3.0 */
     .domainLookupByID = remoteDomainLookupByID, /* 0.3.0 */
     .domainLookupByUUID = remoteDomainLookupByUUID, /* 0.3.0 */
+    .domainLookupByUUIDAsync = remoteDomainLookupByUUIDAsync, /* 0.9.14 */
     .domainLookupByName = remoteDomainLookupByName, /* 0.3.0 */
+    .domainLookupByNameAsync = remoteDomainLookupByNameAsync, /* 0.9.14 */
     .domainSuspend = remoteDomainSuspend, /* 0.3.0 */
     .domainResume = remoteDomainResume, /* 0.3.0 */
     .domainPMSuspendForDuration = remoteDomainPMSuspendForDuration, /* 0.9.10 */
@@ -5250,6 +5754,7 @@ static virDriver remote_driver = {
     .domainSetBlkioParameters = remoteDomainSetBlkioParameters, /* 0.9.0 */
     .domainGetBlkioParameters = remoteDomainGetBlkioParameters, /* 0.9.0 */
     .domainGetInfo = remoteDomainGetInfo, /* 0.3.0 */
+    .domainGetInfoAsync = remoteDomainGetInfoAsync, /* 0.9.14 */
     .domainGetState = remoteDomainGetState, /* 0.9.2 */
     .domainGetControlInfo = remoteDomainGetControlInfo, /* 0.9.3 */
     .domainSave = remoteDomainSave, /* 0.3.0 */
@@ -5297,8 +5802,10 @@ static virDriver remote_driver = {
     .domainMigrateFinish = remoteDomainMigrateFinish, /* 0.3.2 */
     .domainBlockResize = remoteDomainBlockResize, /* 0.9.8 */
     .domainBlockStats = remoteDomainBlockStats, /* 0.3.2 */
+    .domainBlockStatsAsync = remoteDomainBlockStatsAsync, /* 0.9.14 */
     .domainBlockStatsFlags = remoteDomainBlockStatsFlags, /* 0.9.5 */
     .domainInterfaceStats = remoteDomainInterfaceStats, /* 0.3.2 */
+    .domainInterfaceStatsAsync = remoteDomainInterfaceStatsAsync, /* 0.9.14 */
     .domainSetInterfaceParameters = remoteDomainSetInterfaceParameters, /* 0.9.9 */
     .domainGetInterfaceParameters = remoteDomainGetInterfaceParameters, /* 0.9.9 */
     .domainMemoryStats = remoteDomainMemoryStats, /* 0.7.5 */
@@ -5433,6 +5940,7 @@ static virStorageDriver storage_driver = {
     .listPools = remoteListStoragePools, /* 0.4.1 */
     .numOfDefinedPools = remoteNumOfDefinedStoragePools, /* 0.4.1 */
     .listDefinedPools = remoteListDefinedStoragePools, /* 0.4.1 */
+    .listAllPools = remoteConnectListAllStoragePools, /* 0.9.14 */
     .findPoolSources = remoteFindStoragePoolSources, /* 0.4.5 */
     .poolLookupByName = remoteStoragePoolLookupByName, /* 0.4.1 */
     .poolLookupByUUID = remoteStoragePoolLookupByUUID, /* 0.4.1 */
@@ -5451,6 +5959,7 @@ static virStorageDriver storage_driver = {
     .poolSetAutostart = remoteStoragePoolSetAutostart, /* 0.4.1 */
     .poolNumOfVolumes = remoteStoragePoolNumOfVolumes, /* 0.4.1 */
     .poolListVolumes = remoteStoragePoolListVolumes, /* 0.4.1 */
+    .poolListAllVolumes = remoteStoragePoolListAllVolumes, /* 0.9.14 */
 
     .volLookupByName = remoteStorageVolLookupByName, /* 0.4.1 */
     .volLookupByKey = remoteStorageVolLookupByKey, /* 0.4.1 */
@@ -5491,6 +6000,7 @@ static virDeviceMonitor dev_monitor = {
     .close = remoteDevMonClose, /* 0.5.0 */
     .numOfDevices = remoteNodeNumOfDevices, /* 0.5.0 */
     .listDevices = remoteNodeListDevices, /* 0.5.0 */
+    .listAllNodeDevices = remoteConnectListAllNodeDevices, /* 0.9.14 */
     .deviceLookupByName = remoteNodeDeviceLookupByName, /* 0.5.0 */
     .deviceGetXMLDesc = remoteNodeDeviceGetXMLDesc, /* 0.5.0 */
     .deviceGetParent = remoteNodeDeviceGetParent, /* 0.5.0 */
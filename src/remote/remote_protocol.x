@@ -2527,6 +2527,37 @@ struct remote_connect_list_all_domains_ret {
     unsigned int ret;
 };
 
+struct remote_connect_list_all_storage_pools_args {
+    int need_results;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_storage_pools_ret {
+    remote_nonnull_storage_pool pools<>;
+    unsigned int ret;
+};
+
+struct remote_storage_pool_list_all_volumes_args {
+    remote_nonnull_storage_pool pool;
+    int need_results;
+    unsigned int flags;
+};
+
+struct remote_storage_pool_list_all_volumes_ret {
+    remote_nonnull_storage_vol vols<>;
+    unsigned int ret;
+};
+
+struct remote_connect_list_all_node_devices_args {
+    int need_results;
+    unsigned int flags;
+};
+
+struct remote_connect_list_all_node_devices_ret {
+    remote_nonnull_node_device devices<>;
+    unsigned int ret;
+};
+
 
 /*----- Protocol. -----*/
 
@@ -2854,7 +2885,10 @@ enum remote_procedure {
     REMOTE_PROC_DOMAIN_LIST_ALL_SNAPSHOTS = 274, /* skipgen skipgen priority:high */
     REMOTE_PROC_DOMAIN_SNAPSHOT_LIST_ALL_CHILDREN = 275, /* skipgen skipgen priority:high */
     REMOTE_PROC_DOMAIN_EVENT_BALLOON_CHANGE = 276, /* autogen autogen */
-    REMOTE_PROC_DOMAIN_GET_HOSTNAME = 277 /* autogen autogen */
+    REMOTE_PROC_DOMAIN_GET_HOSTNAME = 277, /* autogen autogen */
+    REMOTE_PROC_CONNECT_LIST_ALL_STORAGE_POOLS = 278, /* skipgen skipgen priority:high */
+    REMOTE_PROC_STORAGE_POOL_LIST_ALL_VOLUMES = 279, /* skipgen skipgen priority:high */
+    REMOTE_PROC_CONNECT_LIST_ALL_NODE_DEVICES = 280 /* skipgen skipgen priority:high */
 
     /*
      * Notice how the entries are grouped in sets of 10 ?
@@ -36,6 +36,7 @@
 #include "logging.h"
 #include "util.h"
 #include "virterror_internal.h"
+#include "event.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -58,6 +59,10 @@ struct _virNetClientCall {
 
     virCond cond;
 
+    /* Set for asynchronous calls, which never have a thread */
+    virNetClientCallCompleteFunc completeCb;
+    void *completeOpaque;
+
     virNetClientCallPtr next;
 };
 
@@ -106,6 +111,13 @@ struct _virNetClient {
     virNetClientCloseFunc closeCb;
     void *closeOpaque;
     virFreeCallback closeFf;
+
+    /* Asynchronous calls which got their reply or failed, waiting
+     * for asyncTimer to run their completion callback from the
+     * event loop */
+    virNetClientCallPtr asyncDone;
+    int asyncTimer;
+    size_t nasync; /* Asynchronous calls not completed yet */
 };
 
 
@@ -237,6 +249,42 @@ static bool virNetClientCallMatchPredicate(virNetClientCallPtr head,
 }
 
 
+/*
+ * Hand asynchronous calls over to the event loop to run their
+ * completion callback: completed ones, or every one of them if
+ * @all is set, since the connection is going away.
+ */
+static bool virNetClientCallCollectAsync(virNetClientCallPtr call,
+                                         void *opaque)
+{
+    virNetClientPtr client = opaque;
+
+    if (!call->completeCb)
+        return false;
+
+    if (call->mode != VIR_NET_CLIENT_MODE_COMPLETE &&
+        client->sock && !client->wantClose)
+        return false;
+
+    VIR_DEBUG("Async call %p done, mode=%d", call, call->mode);
+    virNetClientCallQueue(&client->asyncDone, call);
+    return true;
+}
+
+static void virNetClientIOCompleteAsync(virNetClientPtr client)
+{
+    if (!client->nasync)
+        return;
+
+    virNetClientCallRemovePredicate(&client->waitDispatch,
+                                    virNetClientCallCollectAsync,
+                                    client);
+
+    if (client->asyncDone)
+        virEventUpdateTimeout(client->asyncTimer, 0);
+}
+
+
 static void virNetClientEventFree(void *opaque)
 {
     virNetClientPtr client = opaque;
@@ -318,6 +366,7 @@ static virNetClientPtr virNetClientNew(virNetSocketPtr sock,
         goto error;
 
     client->sock = sock;
+    client->asyncTimer = -1;
     client->wakeupReadFD = wakeupFD[0];
     client->wakeupSendFD = wakeupFD[1];
     wakeupFD[0] = wakeupFD[1] = -1;
@@ -535,6 +584,16 @@ virNetClientCloseLocked(virNetClientPtr client)
     virNetSASLSessionFree(client->sasl);
     client->sasl = NULL;
 #endif
+    /* No reply is going to arrive for pending asynchronous calls */
+    virNetClientIOCompleteAsync(client);
+
+    /* The timer drops itself after completing the last of them. With
+     * none left, it would never run again and keep the client alive */
+    if (!client->nasync && client->asyncTimer != -1) {
+        virEventRemoveTimeout(client->asyncTimer);
+        client->asyncTimer = -1;
+    }
+
     ka = client->keepalive;
     client->keepalive = NULL;
     client->wantClose = false;
@@ -620,6 +679,7 @@ int virNetClientSetTLSSession(virNetClientPtr client,
     int len;
     struct pollfd fds[1];
     sigset_t oldmask, blockedsigs;
+    const char *service;
 
     sigemptyset (&blockedsigs);
 #ifdef SIGWINCH
@@ -632,8 +692,15 @@ int virNetClientSetTLSSession(virNetClientPtr client,
 
     virNetClientLock(client);
 
+    /* The remote address ends with the port, which lets sessions
+     * to several daemons on one host be resumed separately */
+    if ((service = virNetSocketRemoteAddrString(client->sock)) &&
+        (service = strrchr(service, ';')))
+        service++;
+
     if (!(client->tls = virNetTLSSessionNew(tls,
-                                            client->hostname)))
+                                            client->hostname,
+                                            service)))
         goto error;
 
     virNetSocketSetTLSSession(client->sock, client->tls);
@@ -669,6 +736,10 @@ int virNetClientSetTLSSession(virNetClientPtr client,
         ignore_value(pthread_sigmask(SIG_BLOCK, &oldmask, NULL));
     }
 
+    VIR_DEBUG("TLS session with %s %s", NULLSTR(client->hostname),
+              virNetTLSSessionIsResumed(client->tls) ?
+              "resumed" : "negotiated in full");
+
     ret = virNetTLSContextCheckCertificate(tls, client->tls);
 
     if (ret < 0)
@@ -1025,6 +1096,12 @@ virNetClientCallDispatch(virNetClientPtr client)
 }
 
 
+/*
+ * Write out @thecall, along with as many of the calls queued
+ * behind it as fit in one batch. The batch ends after a call
+ * that passes file descriptors, since those have to follow its
+ * payload on the wire.
+ */
 static ssize_t
 virNetClientIOWriteMessage(virNetClientPtr client,
                            virNetClientCallPtr thecall)
@@ -1032,13 +1109,46 @@ virNetClientIOWriteMessage(virNetClientPtr client,
     ssize_t ret = 0;
 
     if (thecall->msg->bufferOffset < thecall->msg->bufferLength) {
-        ret = virNetSocketWrite(client->sock,
-                                thecall->msg->buffer + thecall->msg->bufferOffset,
-                                thecall->msg->bufferLength - thecall->msg->bufferOffset);
+        struct iovec iov[VIR_NET_SOCKET_WRITEV_MAX_IOV];
+        size_t niov = 0;
+        size_t nbytes = 0;
+        size_t done;
+        virNetClientCallPtr call;
+
+        for (call = thecall ;
+             call && niov < VIR_NET_SOCKET_WRITEV_MAX_IOV &&
+                 nbytes < VIR_NET_SOCKET_WRITEV_MAX_BYTES ;
+             call = call->next) {
+            if (call->mode != VIR_NET_CLIENT_MODE_WAIT_TX)
+                continue;
+            if (call->msg->bufferOffset >= call->msg->bufferLength)
+                break;
+
+            iov[niov].iov_base = call->msg->buffer + call->msg->bufferOffset;
+            iov[niov].iov_len = call->msg->bufferLength - call->msg->bufferOffset;
+            nbytes += iov[niov].iov_len;
+            niov++;
+
+            if (call->msg->nfds)
+                break;
+        }
+
+        ret = virNetSocketWritev(client->sock, iov, niov);
         if (ret <= 0)
             return ret;
 
-        thecall->msg->bufferOffset += ret;
+        /* Spread what was sent over the calls of the batch */
+        done = ret;
+        for (call = thecall ; call && done ; call = call->next) {
+            size_t avail;
+            if (call->mode != VIR_NET_CLIENT_MODE_WAIT_TX)
+                continue;
+            avail = call->msg->bufferLength - call->msg->bufferOffset;
+            if (avail > done)
+                avail = done;
+            call->msg->bufferOffset += avail;
+            done -= avail;
+        }
     }
 
     if (thecall->msg->bufferOffset == thecall->msg->bufferLength) {
@@ -1447,6 +1557,7 @@ static int virNetClientIOEventLoop(virNetClientPtr client,
         /* Iterate through waiting calls and if any are
          * complete, remove them from the dispatch list.
          */
+        virNetClientIOCompleteAsync(client);
         virNetClientCallRemovePredicate(&client->waitDispatch,
                                         virNetClientIOEventLoopRemoveDone,
                                         thiscall);
@@ -1715,6 +1826,7 @@ void virNetClientIncomingEvent(virNetSocketPtr sock,
     }
 
     /* Remove completed calls or signal their threads. */
+    virNetClientIOCompleteAsync(client);
     virNetClientCallRemovePredicate(&client->waitDispatch,
                                     virNetClientIOEventLoopRemoveDone,
                                     NULL);
@@ -1942,3 +2054,137 @@ int virNetClientSendWithReplyStream(virNetClientPtr client,
         return -1;
     return 0;
 }
+
+
+static void
+virNetClientAsyncTimer(int timer,
+                       void *opaque)
+{
+    virNetClientPtr client = opaque;
+    virNetClientCallPtr calls;
+
+    virNetClientLock(client);
+    calls = client->asyncDone;
+    client->asyncDone = NULL;
+    virEventUpdateTimeout(timer, -1);
+    virNetClientUnlock(client);
+
+    while (calls) {
+        virNetClientCallPtr call = calls;
+        calls = call->next;
+
+        call->completeCb(client, call->msg,
+                         call->mode == VIR_NET_CLIENT_MODE_COMPLETE,
+                         call->completeOpaque);
+
+        ignore_value(virCondDestroy(&call->cond));
+        VIR_FREE(call);
+
+        virNetClientLock(client);
+        client->nasync--;
+        virNetClientUnlock(client);
+    }
+
+    /* Drop the timer along with its reference on the client once the
+     * connection is gone and nothing else can complete */
+    virNetClientLock(client);
+    if (!client->sock && !client->nasync && client->asyncTimer != -1) {
+        virEventRemoveTimeout(client->asyncTimer);
+        client->asyncTimer = -1;
+    }
+    virNetClientUnlock(client);
+}
+
+
+/*
+ * @msg: a message allocated on the heap
+ * @cb: function to call once the reply arrived
+ * @opaque: data for @cb
+ *
+ * Send a message asynchronously and return without waiting for
+ * the reply. Once the reply arrived, or the connection was closed
+ * before that, @cb is called from the event loop with @msg, which
+ * holds the reply if @complete is true. This requires an event loop
+ * implementation to be registered.
+ *
+ * On success @msg is owned by the client until it is passed to @cb,
+ * which must free it.
+ *
+ * Returns 0 if the message was queued, -1 on error.
+ */
+int virNetClientSendAsync(virNetClientPtr client,
+                          virNetMessagePtr msg,
+                          virNetClientCallCompleteFunc cb,
+                          void *opaque)
+{
+    virNetClientCallPtr call = NULL;
+    int ret = -1;
+
+    virNetClientLock(client);
+
+    PROBE(RPC_CLIENT_MSG_TX_QUEUE,
+          "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
+          client, msg->bufferLength,
+          msg->header.prog, msg->header.vers, msg->header.proc,
+          msg->header.type, msg->header.status, msg->header.serial);
+
+    if (!client->sock || client->wantClose) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("client socket is closed"));
+        goto cleanup;
+    }
+
+    if (msg->nfds) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Attempt to pass file descriptors with an "
+                         "asynchronous call"));
+        goto cleanup;
+    }
+
+    if (client->asyncTimer == -1) {
+        client->refs++;
+        if ((client->asyncTimer = virEventAddTimeout(-1,
+                                                     virNetClientAsyncTimer,
+                                                     client,
+                                                     virNetClientEventFree)) < 0) {
+            client->refs--;
+            client->asyncTimer = -1;
+            virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                           _("asynchronous calls require an event loop"));
+            goto cleanup;
+        }
+    }
+
+    if (!(call = virNetClientCallNew(msg, true, false)))
+        goto cleanup;
+
+    call->completeCb = cb;
+    call->completeOpaque = opaque;
+    client->nasync++;
+
+    virNetClientCallQueue(&client->waitDispatch, call);
+
+    /* Whoever drives the socket, a thread waiting for its own reply
+     * or the event loop, takes care of sending the call */
+    if (client->haveTheBuck) {
+        char ignore = 1;
+
+        if (safewrite(client->wakeupSendFD, &ignore, sizeof(ignore)) != sizeof(ignore)) {
+            virNetClientCallRemove(&client->waitDispatch, call);
+            client->nasync--;
+            ignore_value(virCondDestroy(&call->cond));
+            VIR_FREE(call);
+            virReportSystemError(errno, "%s",
+                                 _("failed to wake up polling thread"));
+            goto cleanup;
+        }
+    } else {
+        virNetClientIOUpdateCallback(client, true);
+    }
+
+    ret = 0;
+
+cleanup:
+    virNetClientUnlock(client);
+    return ret;
+}
@@ -85,6 +85,16 @@ int virNetClientSendNoReply(virNetClientPtr client,
 int virNetClientSendNonBlock(virNetClientPtr client,
                              virNetMessagePtr msg);
 
+typedef void (*virNetClientCallCompleteFunc)(virNetClientPtr client,
+                                             virNetMessagePtr msg,
+                                             bool complete,
+                                             void *opaque);
+
+int virNetClientSendAsync(virNetClientPtr client,
+                          virNetMessagePtr msg,
+                          virNetClientCallCompleteFunc cb,
+                          void *opaque);
+
 int virNetClientSendWithReplyStream(virNetClientPtr client,
                                     virNetMessagePtr msg,
                                     virNetClientStreamPtr st);
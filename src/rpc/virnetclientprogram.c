@@ -264,27 +264,23 @@ cleanup:
 }
 
 
-int virNetClientProgramCall(virNetClientProgramPtr prog,
-                            virNetClientPtr client,
-                            unsigned serial,
-                            int proc,
-                            size_t noutfds,
-                            int *outfds,
-                            size_t *ninfds,
-                            int **infds,
-                            xdrproc_t args_filter, void *args,
-                            xdrproc_t ret_filter, void *ret)
+/*
+ * Build the message calling procedure @proc of @prog with @args,
+ * passing along copies of @outfds
+ */
+static virNetMessagePtr
+virNetClientProgramNewCall(virNetClientProgramPtr prog,
+                           unsigned serial,
+                           int proc,
+                           size_t noutfds,
+                           int *outfds,
+                           xdrproc_t args_filter, void *args)
 {
     virNetMessagePtr msg;
     size_t i;
 
-    if (infds)
-        *infds = NULL;
-    if (ninfds)
-        *ninfds = 0;
-
     if (!(msg = virNetMessageNew(false)))
-        return -1;
+        return NULL;
 
     msg->header.prog = prog->program;
     msg->header.vers = prog->version;
@@ -324,9 +320,22 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     if (virNetMessageEncodePayload(msg, args_filter, args) < 0)
         goto error;
 
-    if (virNetClientSendWithReply(client, msg) < 0)
-        goto error;
+    return msg;
+
+error:
+    virNetMessageFree(msg);
+    return NULL;
+}
 
+
+/*
+ * Check that @msg is the reply to call @serial of procedure @proc
+ */
+static int
+virNetClientProgramCheckReply(virNetMessagePtr msg,
+                              unsigned serial,
+                              int proc)
+{
     /* None of these 3 should ever happen here, because
      * virNetClientSend should have validated the reply,
      * but it doesn't hurt to check again.
@@ -335,21 +344,55 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
         msg->header.type != VIR_NET_REPLY_WITH_FDS) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message type %d"), msg->header.type);
-        goto error;
+        return -1;
     }
     if (msg->header.proc != proc) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message proc %d != %d"),
                        msg->header.proc, proc);
-        goto error;
+        return -1;
     }
     if (msg->header.serial != serial) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message serial %d != %d"),
                        msg->header.serial, serial);
-        goto error;
+        return -1;
     }
 
+    return 0;
+}
+
+
+int virNetClientProgramCall(virNetClientProgramPtr prog,
+                            virNetClientPtr client,
+                            unsigned serial,
+                            int proc,
+                            size_t noutfds,
+                            int *outfds,
+                            size_t *ninfds,
+                            int **infds,
+                            xdrproc_t args_filter, void *args,
+                            xdrproc_t ret_filter, void *ret)
+{
+    virNetMessagePtr msg;
+    size_t i;
+
+    if (infds)
+        *infds = NULL;
+    if (ninfds)
+        *ninfds = 0;
+
+    if (!(msg = virNetClientProgramNewCall(prog, serial, proc,
+                                           noutfds, outfds,
+                                           args_filter, args)))
+        return -1;
+
+    if (virNetClientSendWithReply(client, msg) < 0)
+        goto error;
+
+    if (virNetClientProgramCheckReply(msg, serial, proc) < 0)
+        goto error;
+
     switch (msg->header.status) {
     case VIR_NET_OK:
         if (infds && ninfds) {
@@ -402,3 +445,112 @@ error:
     }
     return -1;
 }
+
+
+typedef struct _virNetClientProgramAsyncCall virNetClientProgramAsyncCall;
+typedef virNetClientProgramAsyncCall *virNetClientProgramAsyncCallPtr;
+struct _virNetClientProgramAsyncCall {
+    virNetClientProgramPtr prog;
+    unsigned serial;
+    int proc;
+    xdrproc_t ret_filter;
+    void *ret;
+    virNetClientProgramCompleteFunc cb;
+    void *opaque;
+};
+
+static void
+virNetClientProgramAsyncDone(virNetClientPtr client ATTRIBUTE_UNUSED,
+                             virNetMessagePtr msg,
+                             bool complete,
+                             void *opaque)
+{
+    virNetClientProgramAsyncCallPtr call = opaque;
+    int result = -1;
+
+    if (!complete) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("connection closed before the reply arrived"));
+        goto cleanup;
+    }
+
+    if (virNetClientProgramCheckReply(msg, call->serial, call->proc) < 0)
+        goto cleanup;
+
+    switch (msg->header.status) {
+    case VIR_NET_OK:
+        if (virNetMessageDecodePayload(msg, call->ret_filter, call->ret) < 0)
+            goto cleanup;
+        result = 0;
+        break;
+
+    case VIR_NET_ERROR:
+        virNetClientProgramDispatchError(call->prog, msg);
+        break;
+
+    default:
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected message status %d"), msg->header.status);
+        break;
+    }
+
+cleanup:
+    virNetMessageFree(msg);
+    call->cb(result, call->opaque);
+    virNetClientProgramFree(call->prog);
+    VIR_FREE(call);
+}
+
+
+/*
+ * Like virNetClientProgramCall, but returns as soon as the call was
+ * queued. Once the reply arrived, @ret is filled in and @cb is run
+ * from the event loop with a result of 0, or -1 with the error set
+ * if the call failed. @ret must stay valid until then. Passing file
+ * descriptors is not supported.
+ *
+ * Returns 0 if the call was queued, -1 on error, in which case @cb
+ * is never run.
+ */
+int virNetClientProgramCallAsync(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 unsigned serial,
+                                 int proc,
+                                 xdrproc_t args_filter, void *args,
+                                 xdrproc_t ret_filter, void *ret,
+                                 virNetClientProgramCompleteFunc cb,
+                                 void *opaque)
+{
+    virNetMessagePtr msg;
+    virNetClientProgramAsyncCallPtr call;
+
+    if (VIR_ALLOC(call) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    if (!(msg = virNetClientProgramNewCall(prog, serial, proc, 0, NULL,
+                                           args_filter, args))) {
+        VIR_FREE(call);
+        return -1;
+    }
+
+    call->prog = prog;
+    call->serial = serial;
+    call->proc = proc;
+    call->ret_filter = ret_filter;
+    call->ret = ret;
+    call->cb = cb;
+    call->opaque = opaque;
+    virNetClientProgramRef(prog);
+
+    if (virNetClientSendAsync(client, msg,
+                              virNetClientProgramAsyncDone, call) < 0) {
+        virNetClientProgramFree(prog);
+        virNetMessageFree(msg);
+        VIR_FREE(call);
+        return -1;
+    }
+
+    return 0;
+}
@@ -32,6 +32,34 @@
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+/*
+ * The length word and the header are fixed-layout sequences of
+ * XDR unsigned ints, so they are (de)serialised directly rather than
+ * going through an XDR stream for every message.
+ */
+static void
+virNetMessagePutUInt(char *buf, unsigned int val)
+{
+    unsigned char *p = (unsigned char *)buf;
+
+    p[0] = (val >> 24) & 0xff;
+    p[1] = (val >> 16) & 0xff;
+    p[2] = (val >> 8) & 0xff;
+    p[3] = val & 0xff;
+}
+
+static unsigned int
+virNetMessageGetUInt(const char *buf)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+
+    return ((unsigned int)p[0] << 24) |
+        ((unsigned int)p[1] << 16) |
+        ((unsigned int)p[2] << 8) |
+        (unsigned int)p[3];
+}
+
+
 virNetMessagePtr virNetMessageNew(bool tracked)
 {
     virNetMessagePtr msg;
@@ -51,6 +79,7 @@ virNetMessagePtr virNetMessageNew(bool tracked)
 void virNetMessageClear(virNetMessagePtr msg)
 {
     bool tracked = msg->tracked;
+    bool priority = msg->priority;
     size_t i;
 
     VIR_DEBUG("msg=%p nfds=%zu", msg, msg->nfds);
@@ -61,6 +90,7 @@ void virNetMessageClear(virNetMessagePtr msg)
     VIR_FREE(msg->buffer);
     memset(msg, 0, sizeof(*msg));
     msg->tracked = tracked;
+    msg->priority = priority;
 }
 
 
@@ -111,17 +141,15 @@ virNetMessagePtr virNetMessageQueueServe(virNetMessagePtr *queue)
 
 int virNetMessageDecodeLength(virNetMessagePtr msg)
 {
-    XDR xdr;
     unsigned int len;
     int ret = -1;
 
-    xdrmem_create(&xdr, msg->buffer,
-                  msg->bufferLength, XDR_DECODE);
-    if (!xdr_u_int(&xdr, &len)) {
+    if (msg->bufferLength < VIR_NET_MESSAGE_LEN_MAX) {
         virReportError(VIR_ERR_RPC, "%s", _("Unable to decode message length"));
         goto cleanup;
     }
-    msg->bufferOffset = xdr_getpos(&xdr);
+    len = virNetMessageGetUInt(msg->buffer);
+    msg->bufferOffset = VIR_NET_MESSAGE_LEN_MAX;
 
     if (len < VIR_NET_MESSAGE_LEN_MAX) {
         virReportError(VIR_ERR_RPC,
@@ -154,7 +182,6 @@ int virNetMessageDecodeLength(virNetMessagePtr msg)
     ret = 0;
 
 cleanup:
-    xdr_destroy(&xdr);
     return ret;
 }
 
@@ -172,29 +199,27 @@ cleanup:
  */
 int virNetMessageDecodeHeader(virNetMessagePtr msg)
 {
-    XDR xdr;
-    int ret = -1;
+    const char *p;
 
     msg->bufferOffset = VIR_NET_MESSAGE_LEN_MAX;
 
     /* Parse the header. */
-    xdrmem_create(&xdr,
-                  msg->buffer + msg->bufferOffset,
-                  msg->bufferLength - msg->bufferOffset,
-                  XDR_DECODE);
-
-    if (!xdr_virNetMessageHeader(&xdr, &msg->header)) {
+    if (msg->bufferLength < msg->bufferOffset + VIR_NET_MESSAGE_HEADER_MAX) {
         virReportError(VIR_ERR_RPC, "%s", _("Unable to decode message header"));
-        goto cleanup;
+        return -1;
     }
 
-    msg->bufferOffset += xdr_getpos(&xdr);
+    p = msg->buffer + msg->bufferOffset;
+    msg->header.prog = virNetMessageGetUInt(p);
+    msg->header.vers = virNetMessageGetUInt(p + 4);
+    msg->header.proc = virNetMessageGetUInt(p + 8);
+    msg->header.type = virNetMessageGetUInt(p + 12);
+    msg->header.serial = virNetMessageGetUInt(p + 16);
+    msg->header.status = virNetMessageGetUInt(p + 20);
 
-    ret = 0;
+    msg->bufferOffset += VIR_NET_MESSAGE_HEADER_MAX;
 
-cleanup:
-    xdr_destroy(&xdr);
-    return ret;
+    return 0;
 }
 
 
@@ -204,59 +229,73 @@ cleanup:
  * Encodes the length word and header of the message, setting the
  * message offset ready to encode the payload. Leaves space
  * for the length field later. Upon return bufferLength will
- * refer to the total available space for message, while
+ * refer to the space currently available for the message, which
+ * is grown as needed while encoding the payload, while
  * bufferOffset will refer to current space used by header
  *
  * returns 0 if successfully encoded, -1 upon fatal error
  */
 int virNetMessageEncodeHeader(virNetMessagePtr msg)
 {
-    XDR xdr;
-    int ret = -1;
-    unsigned int len = 0;
+    char *p;
+    unsigned int len = VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX;
 
-    msg->bufferLength = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
+    msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
     if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0) {
         virReportOOMError();
-        goto cleanup;
+        return -1;
     }
-    msg->bufferOffset = 0;
+
+    /* Fill in current length - may be re-written later
+     * if a payload is added
+     */
+    p = msg->buffer;
+    virNetMessagePutUInt(p, len);
 
     /* Format the header. */
-    xdrmem_create(&xdr,
-                  msg->buffer,
-                  msg->bufferLength,
-                  XDR_ENCODE);
-
-    /* The real value is filled in shortly */
-    if (!xdr_u_int(&xdr, &len)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
-        goto cleanup;
-    }
+    p += VIR_NET_MESSAGE_LEN_MAX;
+    virNetMessagePutUInt(p, msg->header.prog);
+    virNetMessagePutUInt(p + 4, msg->header.vers);
+    virNetMessagePutUInt(p + 8, msg->header.proc);
+    virNetMessagePutUInt(p + 12, msg->header.type);
+    virNetMessagePutUInt(p + 16, msg->header.serial);
+    virNetMessagePutUInt(p + 20, msg->header.status);
 
-    if (!xdr_virNetMessageHeader(&xdr, &msg->header)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message header"));
-        goto cleanup;
-    }
+    msg->bufferOffset = len;
 
-    len = xdr_getpos(&xdr);
-    xdr_setpos(&xdr, 0);
+    return 0;
+}
 
-    /* Fill in current length - may be re-written later
-     * if a payload is added
-     */
-    if (!xdr_u_int(&xdr, &len)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to re-encode message length"));
-        goto cleanup;
+
+/*
+ * Grow the buffer of an outgoing message so that at least @len
+ * more bytes fit after bufferOffset
+ */
+static int
+virNetMessageGrowBuffer(virNetMessagePtr msg, size_t len)
+{
+    size_t newlen = msg->bufferLength;
+
+    if (msg->bufferOffset + len > VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Message too long to send (%zu bytes needed, %d bytes allowed)"),
+                       msg->bufferOffset + len,
+                       VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX);
+        return -1;
     }
 
-    msg->bufferOffset += len;
+    while (newlen < msg->bufferOffset + len)
+        newlen *= 2;
+    if (newlen > VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)
+        newlen = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
 
-    ret = 0;
+    if (VIR_REALLOC_N(msg->buffer, newlen) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+    msg->bufferLength = newlen;
 
-cleanup:
-    xdr_destroy(&xdr);
-    return ret;
+    return 0;
 }
 
 
@@ -337,17 +376,34 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
                                void *data)
 {
     XDR xdr;
-    unsigned int msglen;
+    size_t newlen;
 
     /* Serialise payload of the message. This assumes that
      * virNetMessageEncodeHeader has already been run, so
      * just appends to that data */
-    xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
-                  msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
+    for (;;) {
+        xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
+                      msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
 
-    if (!(*filter)(&xdr, data)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
-        goto error;
+        if ((*filter)(&xdr, data))
+            break;
+
+        xdr_destroy(&xdr);
+
+        /* Encoding only fails for lack of space or for data
+         * exceeding the protocol limits, so retry with a larger
+         * buffer until we hit the maximum message size */
+        if (msg->bufferLength >= VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX) {
+            virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
+            return -1;
+        }
+
+        newlen = msg->bufferLength * 2;
+        if (newlen > VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)
+            newlen = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
+
+        if (virNetMessageGrowBuffer(msg, newlen - msg->bufferOffset) < 0)
+            return -1;
     }
 
     /* Get the length stored in buffer. */
@@ -356,21 +412,11 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 
     /* Re-encode the length word. */
     VIR_DEBUG("Encode length as %zu", msg->bufferOffset);
-    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
-    msglen = msg->bufferOffset;
-    if (!xdr_u_int(&xdr, &msglen)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
-        goto error;
-    }
-    xdr_destroy(&xdr);
+    virNetMessagePutUInt(msg->buffer, msg->bufferOffset);
 
     msg->bufferLength = msg->bufferOffset;
     msg->bufferOffset = 0;
     return 0;
-
-error:
-    xdr_destroy(&xdr);
-    return -1;
 }
 
 
@@ -406,61 +452,32 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *data,
                                   size_t len)
 {
-    XDR xdr;
-    unsigned int msglen;
-
-    if ((msg->bufferLength - msg->bufferOffset) < len) {
-        virReportError(VIR_ERR_RPC,
-                    _("Stream data too long to send (%zu bytes needed, %zu bytes available)"),
-                    len, (msg->bufferLength - msg->bufferOffset));
+    if ((msg->bufferLength - msg->bufferOffset) < len &&
+        virNetMessageGrowBuffer(msg, len) < 0)
         return -1;
-    }
 
     memcpy(msg->buffer + msg->bufferOffset, data, len);
     msg->bufferOffset += len;
 
     /* Re-encode the length word. */
     VIR_DEBUG("Encode length as %zu", msg->bufferOffset);
-    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
-    msglen = msg->bufferOffset;
-    if (!xdr_u_int(&xdr, &msglen)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
-        goto error;
-    }
-    xdr_destroy(&xdr);
+    virNetMessagePutUInt(msg->buffer, msg->bufferOffset);
 
     msg->bufferLength = msg->bufferOffset;
     msg->bufferOffset = 0;
     return 0;
-
-error:
-    xdr_destroy(&xdr);
-    return -1;
 }
 
 
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
 {
-    XDR xdr;
-    unsigned int msglen;
-
     /* Re-encode the length word. */
     VIR_DEBUG("Encode length as %zu", msg->bufferOffset);
-    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
-    msglen = msg->bufferOffset;
-    if (!xdr_u_int(&xdr, &msglen)) {
-        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
-        goto error;
-    }
-    xdr_destroy(&xdr);
+    virNetMessagePutUInt(msg->buffer, msg->bufferOffset);
 
     msg->bufferLength = msg->bufferOffset;
     msg->bufferOffset = 0;
     return 0;
-
-error:
-    xdr_destroy(&xdr);
-    return -1;
 }
 
 
@@ -33,6 +33,7 @@ typedef void (*virNetMessageFreeCallback)(virNetMessagePtr msg, void *opaque);
 
 struct _virNetMessage {
     bool tracked;
+    bool priority; /* Dispatched on the server's priority lane */
 
     char *buffer; /* Typically VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
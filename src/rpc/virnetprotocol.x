@@ -53,6 +53,9 @@ const VIR_NET_MESSAGE_HEADER_MAX = 24;
 /* Size of message payload */
 const VIR_NET_MESSAGE_PAYLOAD_MAX = 4194280;
 
+/* Initial message buffer size, grown as needed up to VIR_NET_MESSAGE_MAX */
+const VIR_NET_MESSAGE_INITIAL = 65536;
+
 /* Size of message length field. Not counted in VIR_NET_MESSAGE_MAX */
 const VIR_NET_MESSAGE_LEN_MAX = 4;
 
@@ -36,6 +36,7 @@
 #include "util.h"
 #include "virfile.h"
 #include "event.h"
+#include "virtime.h"
 #if HAVE_AVAHI
 # include "virnetservermdns.h"
 #endif
@@ -63,6 +64,7 @@ struct _virNetServerJob {
     virNetServerClientPtr client;
     virNetMessagePtr msg;
     virNetServerProgramPtr prog;
+    unsigned long long queued; /* When the job was queued, in ms */
 };
 
 struct _virNetServer {
@@ -172,9 +174,14 @@ static void virNetServerHandleJob(void *jobOpaque, void *opaque)
     virNetServerPtr srv = opaque;
     virNetServerJobPtr job = jobOpaque;
 
+    unsigned long long now;
+
     VIR_DEBUG("server=%p client=%p message=%p prog=%p",
               srv, job->client, job->msg, job->prog);
 
+    if (job->queued && virTimeMillisNow(&now) == 0 && now >= job->queued)
+        virNetServerClientAddQueueDelay(job->client, now - job->queued);
+
     if (virNetServerProcessMsg(srv, job->client, job->prog, job->msg) < 0)
         goto error;
 
@@ -231,12 +238,20 @@ static int virNetServerDispatchNewMessage(virNetServerClientPtr client,
             job->prog = prog;
             priority = virNetServerProgramGetPriority(prog, msg->header.proc);
         }
+        msg->priority = priority != 0;
+
+        if (virTimeMillisNow(&job->queued) < 0)
+            job->queued = 0;
 
         ret = virThreadPoolSendJob(srv->workers, priority, job);
 
         if (ret < 0) {
+            msg->priority = false;
             VIR_FREE(job);
             virNetServerProgramFree(prog);
+        } else if (priority) {
+            /* Tell the client this one runs on the priority lane */
+            ret = 1;
         }
     } else {
         ret = virNetServerProcessMsg(srv, client, prog, msg);
@@ -249,6 +264,24 @@ cleanup:
 }
 
 
+/*
+ * Let a client which used up its guaranteed share of requests have
+ * another one only if there is a worker with nothing to do.
+ */
+static bool virNetServerAdmitRequest(virNetServerClientPtr client ATTRIBUTE_UNUSED,
+                                     void *opaque)
+{
+    virNetServerPtr srv = opaque;
+    virThreadPoolStats stats;
+
+    if (!srv->workers)
+        return false;
+
+    virThreadPoolGetStats(srv->workers, &stats);
+    return stats.freeWorkers > stats.jobQueueDepth;
+}
+
+
 static int virNetServerDispatchNewClient(virNetServerServicePtr svc ATTRIBUTE_UNUSED,
                                          virNetServerClientPtr client,
                                          void *opaque)
@@ -281,6 +314,9 @@ static int virNetServerDispatchNewClient(virNetServerServicePtr svc ATTRIBUTE_UN
     virNetServerClientSetDispatcher(client,
                                     virNetServerDispatchNewMessage,
                                     srv);
+    virNetServerClientSetAdmitter(client,
+                                  virNetServerAdmitRequest,
+                                  srv);
 
     virNetServerClientInitKeepAlive(client, srv->keepaliveInterval,
                                     srv->keepaliveCount);
@@ -80,6 +80,9 @@ struct _virNetServerClient
      * throttling calculations */
     size_t nrequests;
     size_t nrequests_max;
+    /* Requests dispatched on the server's priority lane,
+     * included in nrequests but not held to nrequests_max */
+    size_t nrequests_prio;
     /* Zero or one messages being received. Zero if
      * nrequests >= max_clients and throttling */
     virNetMessagePtr rx;
@@ -87,6 +90,17 @@ struct _virNetServerClient
      * back to client, including async events */
     virNetMessagePtr tx;
 
+    /* Counters for the transmit side, to judge how
+     * well queued messages are batched per flush */
+    unsigned long long txMessages;
+    unsigned long long txWrites;
+    unsigned long long txFlushes;
+
+    /* Time requests waited for a worker, in milliseconds */
+    unsigned long long queuedRequests;
+    unsigned long long queueDelayTotal;
+    unsigned long long queueDelayMax;
+
     /* Filters to capture messages that would otherwise
      * end up on the 'dx' queue */
     virNetServerClientFilterPtr filters;
@@ -95,6 +109,9 @@ struct _virNetServerClient
     virNetServerClientDispatchFunc dispatchFunc;
     void *dispatchOpaque;
 
+    virNetServerClientAdmitFunc admitFunc;
+    void *admitOpaque;
+
     void *privateData;
     virNetServerClientFreeFunc privateDataFreeFunc;
     virNetServerClientCloseFunc privateDataCloseFunc;
@@ -103,6 +120,10 @@ struct _virNetServerClient
 };
 
 
+/* Maximum number of requests a client may have in flight, as a
+ * multiple of its guaranteed share, while the server is idle */
+#define VIR_NET_SERVER_CLIENT_BURST_FACTOR 8
+
 static void virNetServerClientDispatchEvent(virNetSocketPtr sock, int events, void *opaque);
 static void virNetServerClientUpdateEvent(virNetServerClientPtr client);
 static void virNetServerClientDispatchRead(virNetServerClientPtr client);
@@ -120,6 +141,30 @@ static void virNetServerClientUnlock(virNetServerClientPtr client)
 }
 
 
+/*
+ * @client: a locked client object
+ *
+ * Decide whether another request may be read from @client. Every
+ * client is guaranteed nrequests_max requests in flight, not counting
+ * those on the priority lane, which are cheap. Beyond that it may only
+ * use workers which would otherwise sit idle. No client ever has more
+ * than a hard limit of requests in flight, priority ones included, so
+ * a pipelining client can't starve the others.
+ */
+static bool virNetServerClientCanReceive(virNetServerClientPtr client)
+{
+    if (client->nrequests >=
+        client->nrequests_max * VIR_NET_SERVER_CLIENT_BURST_FACTOR)
+        return false;
+
+    if (client->nrequests - client->nrequests_prio < client->nrequests_max)
+        return true;
+
+    return client->admitFunc &&
+        client->admitFunc(client, client->admitOpaque);
+}
+
+
 /*
  * @client: a locked client object
  */
@@ -509,6 +554,67 @@ const char *virNetServerClientGetIdentity(virNetServerClientPtr client)
     return identity;
 }
 
+/*
+ * virNetServerClientGetTransmitStats:
+ * @client: the client
+ * @messages: filled with the number of messages sent
+ * @writes: filled with the number of write calls issued
+ * @flushes: filled with the number of times the tx queue was flushed
+ *
+ * Report how the messages sent to @client were batched onto the wire.
+ */
+void virNetServerClientGetTransmitStats(virNetServerClientPtr client,
+                                        unsigned long long *messages,
+                                        unsigned long long *writes,
+                                        unsigned long long *flushes)
+{
+    virNetServerClientLock(client);
+    *messages = client->txMessages;
+    *writes = client->txWrites;
+    *flushes = client->txFlushes;
+    virNetServerClientUnlock(client);
+}
+
+
+/*
+ * virNetServerClientAddQueueDelay:
+ * @client: the client
+ * @delay: time in milliseconds a request waited for a worker
+ *
+ * Account for the queueing delay of one request from @client.
+ */
+void virNetServerClientAddQueueDelay(virNetServerClientPtr client,
+                                     unsigned long long delay)
+{
+    virNetServerClientLock(client);
+    client->queuedRequests++;
+    client->queueDelayTotal += delay;
+    if (delay > client->queueDelayMax)
+        client->queueDelayMax = delay;
+    virNetServerClientUnlock(client);
+}
+
+/*
+ * virNetServerClientGetQueueStats:
+ * @client: the client
+ * @requests: filled with the number of requests dispatched
+ * @totalDelay: filled with the total time they waited for a worker
+ * @maxDelay: filled with the longest time one waited for a worker
+ *
+ * Report how long requests from @client were queued, in milliseconds.
+ */
+void virNetServerClientGetQueueStats(virNetServerClientPtr client,
+                                     unsigned long long *requests,
+                                     unsigned long long *totalDelay,
+                                     unsigned long long *maxDelay)
+{
+    virNetServerClientLock(client);
+    *requests = client->queuedRequests;
+    *totalDelay = client->queueDelayTotal;
+    *maxDelay = client->queueDelayMax;
+    virNetServerClientUnlock(client);
+}
+
 void virNetServerClientSetPrivateData(virNetServerClientPtr client,
                                       void *opaque,
                                       virNetServerClientFreeFunc ff)
@@ -556,6 +662,17 @@ void virNetServerClientSetDispatcher(virNetServerClientPtr client,
 }
 
 
+void virNetServerClientSetAdmitter(virNetServerClientPtr client,
+                                   virNetServerClientAdmitFunc func,
+                                   void *opaque)
+{
+    virNetServerClientLock(client);
+    client->admitFunc = func;
+    client->admitOpaque = opaque;
+    virNetServerClientUnlock(client);
+}
+
+
 const char *virNetServerClientLocalAddrString(virNetServerClientPtr client)
 {
     if (!client->sock)
@@ -724,7 +841,7 @@ int virNetServerClientInit(virNetServerClientPtr client)
         int ret;
 
         if (!(client->tls = virNetTLSSessionNew(client->tlsCtxt,
-                                                NULL)))
+                                                NULL, NULL)))
             goto error;
 
         virNetSocketSetTLSSession(client->sock,
@@ -908,18 +1025,24 @@ readmore:
 
         /* Send off to for normal dispatch to workers */
         if (msg) {
+            int rv = -1;
             client->refs++;
             if (!client->dispatchFunc ||
-                client->dispatchFunc(client, msg, client->dispatchOpaque) < 0) {
+                (rv = client->dispatchFunc(client, msg,
+                                           client->dispatchOpaque)) < 0) {
                 virNetMessageFree(msg);
                 client->wantClose = true;
                 client->refs--;
                 return;
             }
+            /* The reply can't complete before we drop the client
+             * lock, so this is accounted before it is released */
+            if (rv > 0)
+                client->nrequests_prio++;
         }
 
         /* Possibly need to create another receive buffer */
-        if (client->nrequests < client->nrequests_max) {
+        if (virNetServerClientCanReceive(client)) {
             if (!(client->rx = virNetMessageNew(true))) {
                 client->wantClose = true;
             } else {
@@ -939,7 +1062,11 @@ readmore:
 
 
 /*
- * Send client->tx using no encoding
+ * Send as many queued client->tx messages as fit in one
+ * batch using no encoding. The batch ends after a message
+ * carrying file descriptors, since those must follow its
+ * payload on the wire, and after the message completing a
+ * SASL negotiation, since everything after it is encoded.
  *
  * Returns:
  *   -1 on error or EOF
@@ -948,7 +1075,12 @@ readmore:
  */
 static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 {
+    struct iovec iov[VIR_NET_SOCKET_WRITEV_MAX_IOV];
+    size_t niov = 0;
+    size_t nbytes = 0;
+    virNetMessagePtr msg;
     ssize_t ret;
+    size_t done;
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
         virReportError(VIR_ERR_RPC,
@@ -961,13 +1093,42 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
     if (client->tx->bufferLength == client->tx->bufferOffset)
         return 1;
 
-    ret = virNetSocketWrite(client->sock,
-                            client->tx->buffer + client->tx->bufferOffset,
-                            client->tx->bufferLength - client->tx->bufferOffset);
+    for (msg = client->tx ;
+         msg && niov < VIR_NET_SOCKET_WRITEV_MAX_IOV &&
+             nbytes < VIR_NET_SOCKET_WRITEV_MAX_BYTES ;
+         msg = msg->next) {
+        if (msg->bufferLength <= msg->bufferOffset)
+            break;
+
+        iov[niov].iov_base = msg->buffer + msg->bufferOffset;
+        iov[niov].iov_len = msg->bufferLength - msg->bufferOffset;
+        nbytes += iov[niov].iov_len;
+        niov++;
+
+        if (msg->nfds)
+            break;
+#if HAVE_SASL
+        if (client->sasl)
+            break;
+#endif
+    }
+
+    ret = virNetSocketWritev(client->sock, iov, niov);
     if (ret <= 0)
         return ret; /* -1 error, 0 = egain */
 
-    client->tx->bufferOffset += ret;
+    client->txWrites++;
+
+    /* Spread what was sent over the messages of the batch */
+    done = ret;
+    for (msg = client->tx ; msg && done ; msg = msg->next) {
+        size_t avail = msg->bufferLength - msg->bufferOffset;
+        if (avail > done)
+            avail = done;
+        msg->bufferOffset += avail;
+        done -= avail;
+    }
+
     return ret;
 }
 
@@ -979,16 +1140,19 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 static void
 virNetServerClientDispatchWrite(virNetServerClientPtr client)
 {
+    unsigned long long writes = client->txWrites;
+    unsigned long long messages = client->txMessages;
+
     while (client->tx) {
         if (client->tx->bufferOffset < client->tx->bufferLength) {
             ssize_t ret;
             ret = virNetServerClientWrite(client);
             if (ret < 0) {
                 client->wantClose = true;
-                return;
+                goto done;
             }
             if (ret == 0)
-                return; /* Would block on write EAGAIN */
+                goto done; /* Would block on write EAGAIN */
         }
 
         if (client->tx->bufferOffset == client->tx->bufferLength) {
@@ -999,10 +1163,10 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                 int rv;
                 if ((rv = virNetSocketSendFD(client->sock, client->tx->fds[i])) < 0) {
                     client->wantClose = true;
-                    return;
+                    goto done;
                 }
                 if (rv == 0) /* Blocking */
-                    return;
+                    goto done;
                 client->tx->donefds++;
             }
 
@@ -1019,19 +1183,24 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
 
             /* Get finished msg from head of tx queue */
             msg = virNetMessageQueueServe(&client->tx);
+            client->txMessages++;
 
             if (msg->tracked) {
                 client->nrequests--;
+                if (msg->priority) {
+                    client->nrequests_prio--;
+                    msg->priority = false;
+                }
                 /* See if the recv queue is currently throttled */
                 if (!client->rx &&
-                    client->nrequests < client->nrequests_max) {
+                    virNetServerClientCanReceive(client)) {
                     /* Ready to recv more messages */
                     virNetMessageClear(msg);
                     msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
                     if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0) {
                         virReportOOMError();
                         virNetMessageFree(msg);
-                        return;
+                        goto done;
                     }
                     client->rx = msg;
                     msg = NULL;
@@ -1047,6 +1216,14 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                 client->wantClose = true;
          }
     }
+
+done:
+    if (client->txWrites != writes) {
+        client->txFlushes++;
+        VIR_DEBUG("client=%p flushed %llu messages in %llu writes",
+                  client, client->txMessages - messages,
+                  client->txWrites - writes);
+    }
 }
 
 static void
@@ -30,10 +30,17 @@
 typedef struct _virNetServerClient virNetServerClient;
 typedef virNetServerClient *virNetServerClientPtr;
 
+/* Returns -1 on error, 0 once @msg is queued, or 1 once @msg is
+ * queued on the priority lane after setting msg->priority */
 typedef int (*virNetServerClientDispatchFunc)(virNetServerClientPtr client,
                                               virNetMessagePtr msg,
                                               void *opaque);
 
+/* Whether the server has spare capacity for requests beyond a
+ * client's guaranteed share */
+typedef bool (*virNetServerClientAdmitFunc)(virNetServerClientPtr client,
+                                            void *opaque);
+
 typedef int (*virNetServerClientFilterFunc)(virNetServerClientPtr client,
                                             virNetMessagePtr msg,
                                             void *opaque);
@@ -73,6 +80,18 @@ const char *virNetServerClientGetIdentity(virNetServerClientPtr client);
 int virNetServerClientGetUNIXIdentity(virNetServerClientPtr client,
                                       uid_t *uid, gid_t *gid, pid_t *pid);
 
+void virNetServerClientGetTransmitStats(virNetServerClientPtr client,
+                                        unsigned long long *messages,
+                                        unsigned long long *writes,
+                                        unsigned long long *flushes);
+
+void virNetServerClientAddQueueDelay(virNetServerClientPtr client,
+                                     unsigned long long delay);
+void virNetServerClientGetQueueStats(virNetServerClientPtr client,
+                                     unsigned long long *requests,
+                                     unsigned long long *totalDelay,
+                                     unsigned long long *maxDelay);
+
 void virNetServerClientRef(virNetServerClientPtr client);
 
 typedef void (*virNetServerClientFreeFunc)(void *data);
@@ -90,6 +109,9 @@ void virNetServerClientSetCloseHook(virNetServerClientPtr client,
 void virNetServerClientSetDispatcher(virNetServerClientPtr client,
                                      virNetServerClientDispatchFunc func,
                                      void *opaque);
+void virNetServerClientSetAdmitter(virNetServerClientPtr client,
+                                   virNetServerClientAdmitFunc func,
+                                   void *opaque);
 void virNetServerClientClose(virNetServerClientPtr client);
 bool virNetServerClientIsClosed(virNetServerClientPtr client);
 
@@ -35,6 +35,10 @@
 # include <netinet/tcp.h>
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+
 #include "c-ctype.h"
 #include "virnetsocket.h"
 #include "util.h"
@@ -49,6 +53,9 @@
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
+/* Largest TLS record payload, which bounds a single gnutls_record_send */
+#define VIR_NET_SOCKET_TLS_RECORD_SIZE 16384
+
 
 struct _virNetSocket {
     virMutex lock;
@@ -1171,6 +1178,98 @@ ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len)
 }
 
 
+static ssize_t virNetSocketWritevWire(virNetSocketPtr sock,
+                                      const struct iovec *iov,
+                                      size_t niov)
+{
+#ifdef HAVE_SYS_UIO_H
+    ssize_t ret;
+#endif
+    size_t total = 0;
+    size_t i;
+
+    if (niov == 1)
+        return virNetSocketWriteWire(sock, iov[0].iov_base, iov[0].iov_len);
+
+    if (sock->tlsSession) {
+        /* GNUTLS has no vectored send and puts out at most one record
+         * per call, so there is no point handing it more than that.
+         * A first buffer which fills a record on its own is sent in
+         * place; otherwise the small buffers at the head of the batch
+         * are packed into one record.  If the write returns EAGAIN, the
+         * caller retries from the same offsets with the same or more
+         * data queued, so the pending record is always a prefix of
+         * what we hand over next time. */
+        char buf[VIR_NET_SOCKET_TLS_RECORD_SIZE];
+
+        if (iov[0].iov_len >= sizeof(buf))
+            return virNetSocketWriteWire(sock, iov[0].iov_base,
+                                         iov[0].iov_len);
+
+        for (i = 0 ; i < niov && total < sizeof(buf) ; i++) {
+            size_t len = MIN(iov[i].iov_len, sizeof(buf) - total);
+            memcpy(buf + total, iov[i].iov_base, len);
+            total += len;
+        }
+        return virNetSocketWriteWire(sock, buf, total);
+    }
+
+#ifdef HAVE_SYS_UIO_H
+rewrite:
+    ret = writev(sock->fd, iov, niov);
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto rewrite;
+        if (errno == EAGAIN)
+            return 0;
+
+        virReportSystemError(errno, "%s",
+                             _("Cannot write data"));
+        return -1;
+    }
+    if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while writing data"));
+        return -1;
+    }
+
+    return ret;
+#else
+    return virNetSocketWriteWire(sock, iov[0].iov_base, iov[0].iov_len);
+#endif
+}
+
+
+/*
+ * virNetSocketWritev:
+ * @sock: the socket
+ * @iov: buffers to send, in order
+ * @niov: number of entries in @iov, at least 1
+ *
+ * Send as much of @iov as the socket will accept in a single
+ * system call (or TLS write). With a SASL layer only the first
+ * buffer is sent, since each one has to be encoded separately.
+ *
+ * Returns the number of bytes sent, 0 on EAGAIN, -1 on error
+ */
+ssize_t virNetSocketWritev(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov)
+{
+    ssize_t ret;
+
+    virMutexLock(&sock->lock);
+#if HAVE_SASL
+    if (sock->saslSession)
+        ret = virNetSocketWriteSASL(sock, iov[0].iov_base, iov[0].iov_len);
+    else
+#endif
+        ret = virNetSocketWritevWire(sock, iov, niov);
+    virMutexUnlock(&sock->lock);
+    return ret;
+}
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
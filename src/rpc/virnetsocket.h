@@ -31,6 +31,13 @@
 #  include "virnetsaslcontext.h"
 # endif
 
+# include <sys/socket.h>
+
+/* Upper bounds on how much virNetSocketWritev callers should
+ * gather into a single flush */
+# define VIR_NET_SOCKET_WRITEV_MAX_IOV 64
+# define VIR_NET_SOCKET_WRITEV_MAX_BYTES (256 * 1024)
+
 typedef struct _virNetSocket virNetSocket;
 typedef virNetSocket *virNetSocketPtr;
 
@@ -96,6 +103,9 @@ int virNetSocketSetBlocking(virNetSocketPtr sock,
 
 ssize_t virNetSocketRead(virNetSocketPtr sock, char *buf, size_t len);
 ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len);
+ssize_t virNetSocketWritev(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov);
 
 int virNetSocketSendFD(virNetSocketPtr sock, int fd);
 int virNetSocketRecvFD(virNetSocketPtr sock, int *fd);
@@ -35,10 +35,15 @@
 #include "util.h"
 #include "logging.h"
 #include "threads.h"
+#include "virhash.h"
 #include "configmake.h"
 
 #define DH_BITS 1024
 
+/* Number of hosts whose TLS session parameters are
+ * remembered for resumption by clients */
+#define VIR_NET_TLS_SESSION_CACHE_MAX 1024
+
 #define LIBVIRT_PKI_DIR SYSCONFDIR "/pki"
 #define LIBVIRT_CACERT LIBVIRT_PKI_DIR "/CA/cacert.pem"
 #define LIBVIRT_CACRL LIBVIRT_PKI_DIR "/CA/cacrl.pem"
@@ -46,6 +51,7 @@
 #define LIBVIRT_CLIENTCERT LIBVIRT_PKI_DIR "/libvirt/clientcert.pem"
 #define LIBVIRT_SERVERKEY LIBVIRT_PKI_DIR "/libvirt/private/serverkey.pem"
 #define LIBVIRT_SERVERCERT LIBVIRT_PKI_DIR "/libvirt/servercert.pem"
+#define LIBVIRT_DHPARAMS LIBVIRT_PKI_DIR "/libvirt/dhparams.pem"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -55,10 +61,17 @@ struct _virNetTLSContext {
 
     gnutls_certificate_credentials_t x509cred;
     gnutls_dh_params_t dhParams;
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    gnutls_datum_t ticketKey;
+#endif
 
     bool isServer;
     bool requireValidCert;
     const char *const*x509dnWhitelist;
+
+    /* Credential files of a client context, so that sessions are
+     * only resumed with the credentials they were established with */
+    char *credentials;
 };
 
 struct _virNetTLSSession {
@@ -70,12 +83,51 @@ struct _virNetTLSSession {
 
     bool isServer;
     char *hostname;
+    char *cacheKey;
     gnutls_session_t session;
     virNetTLSSessionWriteFunc writeFunc;
     virNetTLSSessionReadFunc readFunc;
     void *opaque;
 };
 
+/* Diffie Hellman parameters generated on demand, shared by
+ * every server context that has no parameters file */
+static gnutls_dh_params_t virNetTLSDHParams;
+static bool virNetTLSDHParamsReady;
+
+/* Client session data to resume from, keyed by hostname, port
+ * and client credentials */
+static virHashTablePtr virNetTLSSessionCache;
+static virMutex virNetTLSCacheLock;
+
+
+static void
+virNetTLSSessionCacheDataFree(void *payload,
+                              const void *name ATTRIBUTE_UNUSED)
+{
+    gnutls_datum_t *data = payload;
+
+    gnutls_free(data->data);
+    VIR_FREE(data);
+}
+
+static int virNetTLSCacheOnceInit(void)
+{
+    if (virMutexInit(&virNetTLSCacheLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Failed to initialized mutex"));
+        return -1;
+    }
+
+    if (!(virNetTLSSessionCache =
+          virHashCreate(64, virNetTLSSessionCacheDataFree)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virNetTLSCache)
+
 
 static int
 virNetTLSContextCheckCertFile(const char *type, const char *file, bool allowMissing)
@@ -634,10 +686,90 @@ cleanup:
 }
 
 
+/*
+ * Load the Diffie Hellman parameters for a server context from
+ * @dhparams if that file exists. Otherwise use parameters generated
+ * once per process, since generating them takes several seconds.
+ */
+static int virNetTLSContextLoadDHParams(virNetTLSContextPtr ctxt,
+                                        const char *dhparams)
+{
+    char *buf = NULL;
+    int len;
+    gnutls_datum_t data;
+    int err;
+    int ret = -1;
+
+    if (dhparams && virFileExists(dhparams)) {
+        VIR_DEBUG("Loading diffie-hellman parameters from %s", dhparams);
+        if ((len = virFileReadAll(dhparams, 1024*64, &buf)) < 0)
+            goto cleanup;
+
+        data.data = (unsigned char *)buf;
+        data.size = len;
+        err = gnutls_dh_params_import_pkcs3(ctxt->dhParams, &data,
+                                            GNUTLS_X509_FMT_PEM);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to import diffie-hellman parameters %s: %s"),
+                           dhparams, gnutls_strerror(err));
+            goto cleanup;
+        }
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (virNetTLSCacheInitialize() < 0)
+        goto cleanup;
+
+    virMutexLock(&virNetTLSCacheLock);
+    if (!virNetTLSDHParamsReady) {
+        /* These should be discarded and regenerated once a day, once
+         * a week or once a month, depending on the security
+         * requirements; providing a parameters file allows that
+         * without paying for generation at every daemon start. */
+        VIR_DEBUG("Generating diffie-hellman parameters");
+        err = gnutls_dh_params_init(&virNetTLSDHParams);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to initialize diffie-hellman parameters: %s"),
+                           gnutls_strerror(err));
+            goto unlock;
+        }
+        err = gnutls_dh_params_generate2(virNetTLSDHParams, DH_BITS);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to generate diffie-hellman parameters: %s"),
+                           gnutls_strerror(err));
+            gnutls_dh_params_deinit(virNetTLSDHParams);
+            goto unlock;
+        }
+        virNetTLSDHParamsReady = true;
+    }
+
+    err = gnutls_dh_params_cpy(ctxt->dhParams, virNetTLSDHParams);
+    if (err < 0) {
+        virReportError(VIR_ERR_SYSTEM_ERROR,
+                       _("Unable to copy diffie-hellman parameters: %s"),
+                       gnutls_strerror(err));
+        goto unlock;
+    }
+
+    ret = 0;
+
+unlock:
+    virMutexUnlock(&virNetTLSCacheLock);
+cleanup:
+    VIR_FREE(buf);
+    return ret;
+}
+
+
 static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
                                                const char *cacrl,
                                                const char *cert,
                                                const char *key,
+                                               const char *dhparams,
                                                const char *const*x509dnWhitelist,
                                                bool sanityCheckCert,
                                                bool requireValidCert,
@@ -686,11 +818,7 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
     if (virNetTLSContextLoadCredentials(ctxt, isServer, cacert, cacrl, cert, key) < 0)
         goto error;
 
-    /* Generate Diffie Hellman parameters - for use with DHE
-     * kx algorithms. These should be discarded and regenerated
-     * once a day, once a week or once a month. Depending on the
-     * security requirements.
-     */
+    /* Diffie Hellman parameters - for use with DHE kx algorithms */
     if (isServer) {
         err = gnutls_dh_params_init(&ctxt->dhParams);
         if (err < 0) {
@@ -699,16 +827,29 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
                            gnutls_strerror(err));
             goto error;
         }
-        err = gnutls_dh_params_generate2(ctxt->dhParams, DH_BITS);
+        if (virNetTLSContextLoadDHParams(ctxt, dhparams) < 0)
+            goto error;
+
+        gnutls_certificate_set_dh_params(ctxt->x509cred,
+                                         ctxt->dhParams);
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        /* Let clients resume sessions without a full handshake */
+        err = gnutls_session_ticket_key_generate(&ctxt->ticketKey);
         if (err < 0) {
             virReportError(VIR_ERR_SYSTEM_ERROR,
-                           _("Unable to generate diffie-hellman parameters: %s"),
+                           _("Unable to generate TLS session ticket key: %s"),
                            gnutls_strerror(err));
             goto error;
         }
+#endif
+    }
 
-        gnutls_certificate_set_dh_params(ctxt->x509cred,
-                                         ctxt->dhParams);
+    if (!isServer &&
+        virAsprintf(&ctxt->credentials, "%s;%s;%s",
+                    cacert, NULLSTR(cert), NULLSTR(key)) < 0) {
+        virReportOOMError();
+        goto error;
     }
 
     ctxt->requireValidCert = requireValidCert;
@@ -725,6 +866,10 @@ error:
     if (isServer)
         gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    gnutls_free(ctxt->ticketKey.data);
+#endif
+    VIR_FREE(ctxt->credentials);
     VIR_FREE(ctxt);
     return NULL;
 }
@@ -736,7 +881,8 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
                                              char **cacert,
                                              char **cacrl,
                                              char **cert,
-                                             char **key)
+                                             char **key,
+                                             char **dhparams)
 {
     char *userdir = NULL;
     char *user_pki_path = NULL;
@@ -745,6 +891,7 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
     *cacrl = NULL;
     *key = NULL;
     *cert = NULL;
+    *dhparams = NULL;
 
     VIR_DEBUG("pkipath=%s isServer=%d tryUserPkiPath=%d",
               pkipath, isServer, tryUserPkiPath);
@@ -767,6 +914,10 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
         if ((virAsprintf(cert, "%s/%s", pkipath,
                          isServer ? "servercert.pem" : "clientcert.pem")) < 0)
              goto out_of_memory;
+
+        if ((virAsprintf(dhparams, "%s/%s", pkipath,
+                         "dhparams.pem")) < 0)
+            goto out_of_memory;
     } else if (tryUserPkiPath) {
         /* Check to see if $HOME/.pki contains at least one of the
          * files and if so, use that
@@ -797,6 +948,10 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
                          isServer ? "servercert.pem" : "clientcert.pem")) < 0)
             goto out_of_memory;
 
+        if ((virAsprintf(dhparams, "%s/%s", user_pki_path,
+                         "dhparams.pem")) < 0)
+            goto out_of_memory;
+
         /*
          * If some of the files can't be found, fallback
          * to the global location for them
@@ -813,6 +968,8 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
             VIR_FREE(*key);
             VIR_FREE(*cert);
         }
+        if (!virFileExists(*dhparams))
+            VIR_FREE(*dhparams);
     }
 
     /* No explicit path, or user path didn't exist, so
@@ -839,6 +996,12 @@ static int virNetTLSContextLocateCredentials(const char *pkipath,
             goto out_of_memory;
     }
 
+    if (!*dhparams) {
+        VIR_DEBUG("Using default TLS diffie-hellman parameters path");
+        if (!(*dhparams = strdup(LIBVIRT_DHPARAMS)))
+            goto out_of_memory;
+    }
+
     VIR_FREE(user_pki_path);
     VIR_FREE(userdir);
 
@@ -850,6 +1013,7 @@ out_of_memory:
     VIR_FREE(*cacrl);
     VIR_FREE(*key);
     VIR_FREE(*cert);
+    VIR_FREE(*dhparams);
     VIR_FREE(user_pki_path);
     VIR_FREE(userdir);
     return -1;
@@ -864,13 +1028,15 @@ static virNetTLSContextPtr virNetTLSContextNewPath(const char *pkipath,
                                                    bool isServer)
 {
     char *cacert = NULL, *cacrl = NULL, *key = NULL, *cert = NULL;
+    char *dhparams = NULL;
     virNetTLSContextPtr ctxt = NULL;
 
     if (virNetTLSContextLocateCredentials(pkipath, tryUserPkiPath, isServer,
-                                          &cacert, &cacrl, &cert, &key) < 0)
+                                          &cacert, &cacrl, &cert, &key,
+                                          &dhparams) < 0)
         return NULL;
 
-    ctxt = virNetTLSContextNew(cacert, cacrl, cert, key,
+    ctxt = virNetTLSContextNew(cacert, cacrl, cert, key, dhparams,
                                x509dnWhitelist, sanityCheckCert,
                                requireValidCert, isServer);
 
@@ -878,6 +1044,7 @@ static virNetTLSContextPtr virNetTLSContextNewPath(const char *pkipath,
     VIR_FREE(cacrl);
     VIR_FREE(key);
     VIR_FREE(cert);
+    VIR_FREE(dhparams);
 
     return ctxt;
 }
@@ -910,7 +1077,7 @@ virNetTLSContextPtr virNetTLSContextNewServer(const char *cacert,
                                               bool sanityCheckCert,
                                               bool requireValidCert)
 {
-    return virNetTLSContextNew(cacert, cacrl, cert, key, x509dnWhitelist,
+    return virNetTLSContextNew(cacert, cacrl, cert, key, NULL, x509dnWhitelist,
                                sanityCheckCert, requireValidCert, true);
 }
 
@@ -922,7 +1089,7 @@ virNetTLSContextPtr virNetTLSContextNewClient(const char *cacert,
                                               bool sanityCheckCert,
                                               bool requireValidCert)
 {
-    return virNetTLSContextNew(cacert, cacrl, cert, key, NULL,
+    return virNetTLSContextNew(cacert, cacrl, cert, key, NULL, NULL,
                                sanityCheckCert, requireValidCert, false);
 }
 
@@ -1123,6 +1290,10 @@ void virNetTLSContextFree(virNetTLSContextPtr ctxt)
 
     gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    gnutls_free(ctxt->ticketKey.data);
+#endif
+    VIR_FREE(ctxt->credentials);
     virMutexUnlock(&ctxt->lock);
     virMutexDestroy(&ctxt->lock);
     VIR_FREE(ctxt);
@@ -1159,13 +1330,14 @@ virNetTLSSessionPull(void *opaque, void *buf, size_t len)
 
 
 virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
-                                        const char *hostname)
+                                        const char *hostname,
+                                        const char *service)
 {
     virNetTLSSessionPtr sess;
     int err;
 
-    VIR_DEBUG("ctxt=%p hostname=%s isServer=%d",
-              ctxt, NULLSTR(hostname), ctxt->isServer);
+    VIR_DEBUG("ctxt=%p hostname=%s service=%s isServer=%d",
+              ctxt, NULLSTR(hostname), NULLSTR(service), ctxt->isServer);
 
     if (VIR_ALLOC(sess) < 0) {
         virReportOOMError();
@@ -1219,6 +1391,36 @@ virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
         gnutls_certificate_server_set_request(sess->session, GNUTLS_CERT_REQUEST);
 
         gnutls_dh_set_prime_bits(sess->session, DH_BITS);
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        if ((err = gnutls_session_ticket_enable_server(sess->session,
+                                                       &ctxt->ticketKey)) != 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Failed to enable TLS session tickets: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+#endif
+    } else if (hostname) {
+        gnutls_datum_t *data;
+
+#if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+        gnutls_session_ticket_enable_client(sess->session);
+#endif
+
+        /* Try to resume the last session we had with this host */
+        if (virAsprintf(&sess->cacheKey, "%s;%s;%s", hostname,
+                        NULLSTR(service), ctxt->credentials) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+        if (virNetTLSCacheInitialize() < 0)
+            goto error;
+        virMutexLock(&virNetTLSCacheLock);
+        if ((data = virHashLookup(virNetTLSSessionCache, sess->cacheKey)) &&
+            gnutls_session_set_data(sess->session, data->data, data->size) != 0)
+            VIR_DEBUG("Ignoring unusable TLS session data for %s", hostname);
+        virMutexUnlock(&virNetTLSCacheLock);
     }
 
     gnutls_transport_set_ptr(sess->session, sess);
@@ -1374,6 +1576,15 @@ virNetTLSSessionGetHandshakeStatus(virNetTLSSessionPtr sess)
     return ret;
 }
 
+bool virNetTLSSessionIsResumed(virNetTLSSessionPtr sess)
+{
+    bool ret;
+    virMutexLock(&sess->lock);
+    ret = sess->handshakeComplete && gnutls_session_is_resumed(sess->session);
+    virMutexUnlock(&sess->lock);
+    return ret;
+}
+
 int virNetTLSSessionGetKeySize(virNetTLSSessionPtr sess)
 {
     gnutls_cipher_algorithm_t cipher;
@@ -1393,6 +1604,38 @@ cleanup:
 }
 
 
+/*
+ * Remember the parameters of a completed client session so the
+ * next connection to the same host and port, made with the same
+ * credentials, can resume it. This is done
+ * when the session is released rather than straight after the
+ * handshake, since TLS 1.3 servers only send their tickets later.
+ */
+static void virNetTLSSessionSaveData(virNetTLSSessionPtr sess)
+{
+    gnutls_datum_t *data;
+
+    if (VIR_ALLOC(data) < 0)
+        return;
+
+    if (gnutls_session_get_data2(sess->session, data) != 0) {
+        VIR_FREE(data);
+        return;
+    }
+    if (data->size == 0) {
+        virNetTLSSessionCacheDataFree(data, NULL);
+        return;
+    }
+
+    virMutexLock(&virNetTLSCacheLock);
+    if (virHashSize(virNetTLSSessionCache) >= VIR_NET_TLS_SESSION_CACHE_MAX &&
+        !virHashLookup(virNetTLSSessionCache, sess->cacheKey))
+        virHashRemoveAll(virNetTLSSessionCache);
+    if (virHashUpdateEntry(virNetTLSSessionCache, sess->cacheKey, data) < 0)
+        virNetTLSSessionCacheDataFree(data, NULL);
+    virMutexUnlock(&virNetTLSCacheLock);
+}
+
 void virNetTLSSessionFree(virNetTLSSessionPtr sess)
 {
     if (!sess)
@@ -1408,7 +1651,11 @@ void virNetTLSSessionFree(virNetTLSSessionPtr sess)
         return;
     }
 
+    if (sess->cacheKey && sess->handshakeComplete)
+        virNetTLSSessionSaveData(sess);
+
     VIR_FREE(sess->hostname);
+    VIR_FREE(sess->cacheKey);
     gnutls_deinit(sess->session);
     virMutexUnlock(&sess->lock);
     virMutexDestroy(&sess->lock);
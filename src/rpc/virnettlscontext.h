@@ -72,7 +72,8 @@ typedef ssize_t (*virNetTLSSessionReadFunc)(char *buf, size_t len,
                                             void *opaque);
 
 virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
-                                        const char *hostname);
+                                        const char *hostname,
+                                        const char *service);
 
 void virNetTLSSessionSetIOCallbacks(virNetTLSSessionPtr sess,
                                     virNetTLSSessionWriteFunc writeFunc,
@@ -97,6 +98,8 @@ typedef enum {
 virNetTLSSessionHandshakeStatus
 virNetTLSSessionGetHandshakeStatus(virNetTLSSessionPtr sess);
 
+bool virNetTLSSessionIsResumed(virNetTLSSessionPtr sess);
+
 int virNetTLSSessionGetKeySize(virNetTLSSessionPtr sess);
 
 void virNetTLSSessionFree(virNetTLSSessionPtr sess);
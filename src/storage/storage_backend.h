@@ -78,6 +78,9 @@ struct _virStorageBackend {
     virStorageBackendRefreshPool refreshPool;
     virStorageBackendStopPool stopPool;
     virStorageBackendDeletePool deletePool;
+    /* refreshPool updates the existing volume list in place rather
+     * than expecting it to be cleared beforehand */
+    bool incrementalRefresh;
 
     virStorageBackendBuildVol buildVol;
     virStorageBackendBuildVolFrom buildVolFrom;
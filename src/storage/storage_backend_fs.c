@@ -805,9 +805,181 @@ error:
 }
 
 
+/* Upper bound on threads used to probe volumes during a pool refresh */
+#define VIR_STORAGE_FS_REFRESH_WORKERS 8
+
+typedef struct _virStorageBackendFileSystemProbeJob virStorageBackendFileSystemProbeJob;
+typedef virStorageBackendFileSystemProbeJob *virStorageBackendFileSystemProbeJobPtr;
+struct _virStorageBackendFileSystemProbeJob {
+    virStorageVolDefPtr vol;
+    int ret;
+    virErrorPtr err;
+};
+
+typedef struct _virStorageBackendFileSystemProbeQueue virStorageBackendFileSystemProbeQueue;
+typedef virStorageBackendFileSystemProbeQueue *virStorageBackendFileSystemProbeQueuePtr;
+struct _virStorageBackendFileSystemProbeQueue {
+    virMutex lock;
+    size_t next;
+    size_t njobs;
+    virStorageBackendFileSystemProbeJobPtr jobs;
+};
+
+
+/*
+ * Fill in format, size and backing store information for @vol, whose
+ * name, key and target path must already be set.
+ *
+ * Returns 0 on success, -2 if @vol is not a file which can be used
+ * as a volume and should be skipped, -1 on error.
+ */
+static int
+virStorageBackendFileSystemProbeVol(virStorageVolDefPtr vol)
+{
+    int ret;
+    char *backingStore;
+    int backingStoreFormat;
+
+    if ((ret = virStorageBackendProbeTarget(&vol->target,
+                                            &backingStore,
+                                            &backingStoreFormat,
+                                            &vol->allocation,
+                                            &vol->capacity,
+                                            &vol->target.encryption)) < 0) {
+        if (ret == -2) {
+            /* Silently ignore non-regular files,
+             * eg '.' '..', 'lost+found', dangling symbolic link */
+            return -2;
+        } else if (ret == -3) {
+            /* The backing file is currently unavailable, its format is not
+             * explicitly specified, the probe to auto detect the format
+             * failed: continue with faked RAW format, since AUTO will
+             * break virStorageVolTargetDefFormat() generating the line
+             * <format type='...'/>. */
+            backingStoreFormat = VIR_STORAGE_FILE_RAW;
+        } else
+            return -1;
+    }
+
+    /* directory based volume */
+    if (vol->target.format == VIR_STORAGE_FILE_DIR)
+        vol->type = VIR_STORAGE_VOL_DIR;
+
+    if (backingStore != NULL) {
+        vol->backingStore.path = backingStore;
+        vol->backingStore.format = backingStoreFormat;
+
+        if (virStorageBackendUpdateVolTargetInfo(&vol->backingStore,
+                                    NULL, NULL,
+                                    VIR_STORAGE_VOL_OPEN_DEFAULT) < 0) {
+            /* The backing file is currently unavailable, the capacity,
+             * allocation, owner, group and mode are unknown. Just log the
+             * error and continue.
+             * Unfortunately virStorageBackendProbeTarget() might already
+             * have logged a similar message for the same problem, but only
+             * if AUTO format detection was used. */
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("cannot probe backing volume info: %s"),
+                           vol->backingStore.path);
+        }
+    }
+
+    return 0;
+}
+
+
+static void
+virStorageBackendFileSystemProbeWorker(void *opaque)
+{
+    virStorageBackendFileSystemProbeQueuePtr queue = opaque;
+
+    for (;;) {
+        virStorageBackendFileSystemProbeJobPtr job;
+
+        virMutexLock(&queue->lock);
+        if (queue->next == queue->njobs) {
+            virMutexUnlock(&queue->lock);
+            break;
+        }
+        job = &queue->jobs[queue->next++];
+        virMutexUnlock(&queue->lock);
+
+        /* Errors are thread local, so carry them back to the caller */
+        if ((job->ret = virStorageBackendFileSystemProbeVol(job->vol)) == -1)
+            job->err = virSaveLastError();
+    }
+}
+
+
+/*
+ * Probe all volumes in @jobs, spreading the work over several threads
+ * since each probe mostly waits on I/O, which matters for pools on
+ * network filesystems.  Falls back to probing in the calling thread
+ * if no worker can be started.
+ */
+static void
+virStorageBackendFileSystemProbeVols(virStorageBackendFileSystemProbeJobPtr jobs,
+                                     size_t njobs)
+{
+    virStorageBackendFileSystemProbeQueue queue;
+    virThread workers[VIR_STORAGE_FS_REFRESH_WORKERS];
+    size_t nworkers = 0;
+    size_t i;
+
+    memset(&queue, 0, sizeof(queue));
+    queue.jobs = jobs;
+    queue.njobs = njobs;
+
+    if (njobs > 1 && virMutexInit(&queue.lock) == 0) {
+        while (nworkers < VIR_STORAGE_FS_REFRESH_WORKERS &&
+               nworkers < njobs) {
+            if (virThreadCreate(&workers[nworkers], true,
+                                virStorageBackendFileSystemProbeWorker,
+                                &queue) < 0) {
+                VIR_WARN("Failed to start storage probe worker");
+                break;
+            }
+            nworkers++;
+        }
+
+        for (i = 0 ; i < nworkers ; i++)
+            virThreadJoin(&workers[i]);
+        virMutexDestroy(&queue.lock);
+    }
+
+    /* Anything left was not picked up by a worker */
+    for (i = queue.next ; i < njobs ; i++) {
+        if ((jobs[i].ret = virStorageBackendFileSystemProbeVol(jobs[i].vol)) == -1)
+            jobs[i].err = virSaveLastError();
+    }
+}
+
+
+static bool
+virStorageBackendFileSystemVolUnchanged(virStorageVolDefPtr vol,
+                                        const struct stat *sb)
+{
+    /* Timestamps only have a resolution of one second, so a file
+     * modified in the same second as it was last probed may have
+     * changed after the probe */
+    return vol->stamp.probed != 0 &&
+        vol->stamp.dev == sb->st_dev &&
+        vol->stamp.ino == sb->st_ino &&
+        vol->stamp.size == sb->st_size &&
+        vol->stamp.mtime == sb->st_mtime &&
+        vol->stamp.ctime == sb->st_ctime &&
+        vol->stamp.mtime < vol->stamp.probed &&
+        vol->stamp.ctime < vol->stamp.probed;
+}
+
+
 /**
  * Iterate over the pool's directory and enumerate all disk images
  * within it. This is non-recursive.
+ *
+ * Volumes already known to the pool whose file has the same inode,
+ * size and timestamps as when it was last probed are kept as is, so
+ * only new and modified files are probed.
  */
 static int
 virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
@@ -817,6 +989,15 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     struct dirent *ent;
     struct statvfs sb;
     virStorageVolDefPtr vol = NULL;
+    virHashTablePtr unchanged = NULL;
+    virStorageBackendFileSystemProbeJobPtr jobs = NULL;
+    size_t njobs = 0;
+    size_t njobs_max = 0;
+    size_t i;
+    time_t now = time(NULL);
+
+    if (!(unchanged = virHashCreate(50, NULL)))
+        goto cleanup;
 
     if (!(dir = opendir(pool->def->target.path))) {
         virReportSystemError(errno,
@@ -826,87 +1007,97 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
     }
 
     while ((ent = readdir(dir)) != NULL) {
-        int ret;
-        char *backingStore;
-        int backingStoreFormat;
+        struct stat st;
+        char *path;
+        bool have_stat;
 
-        if (VIR_ALLOC(vol) < 0)
+        if (virAsprintf(&path, "%s/%s",
+                        pool->def->target.path,
+                        ent->d_name) == -1)
+            goto no_memory;
+
+        have_stat = stat(path, &st) == 0;
+
+        if (have_stat &&
+            (vol = virStorageVolDefFindByName(pool, ent->d_name)) &&
+            virStorageBackendFileSystemVolUnchanged(vol, &st)) {
+            VIR_FREE(path);
+            if (virHashAddEntry(unchanged, vol->name, vol) < 0)
+                goto cleanup;
+            vol = NULL;
+            continue;
+        }
+        vol = NULL;
+
+        if (VIR_ALLOC(vol) < 0) {
+            VIR_FREE(path);
             goto no_memory;
+        }
+        vol->target.path = path;
 
         if ((vol->name = strdup(ent->d_name)) == NULL)
             goto no_memory;
 
         vol->type = VIR_STORAGE_VOL_FILE;
         vol->target.format = VIR_STORAGE_FILE_RAW; /* Real value is filled in during probe */
-        if (virAsprintf(&vol->target.path, "%s/%s",
-                        pool->def->target.path,
-                        vol->name) == -1)
-            goto no_memory;
 
         if ((vol->key = strdup(vol->target.path)) == NULL)
             goto no_memory;
 
-        if ((ret = virStorageBackendProbeTarget(&vol->target,
-                                                &backingStore,
-                                                &backingStoreFormat,
-                                                &vol->allocation,
-                                                &vol->capacity,
-                                                &vol->target.encryption)) < 0) {
-            if (ret == -2) {
-                /* Silently ignore non-regular files,
-                 * eg '.' '..', 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
-                continue;
-            } else if (ret == -3) {
-                /* The backing file is currently unavailable, its format is not
-                 * explicitly specified, the probe to auto detect the format
-                 * failed: continue with faked RAW format, since AUTO will
-                 * break virStorageVolTargetDefFormat() generating the line
-                 * <format type='...'/>. */
-                backingStoreFormat = VIR_STORAGE_FILE_RAW;
-            } else
-                goto cleanup;
-        }
-
-        /* directory based volume */
-        if (vol->target.format == VIR_STORAGE_FILE_DIR)
-            vol->type = VIR_STORAGE_VOL_DIR;
-
-        if (backingStore != NULL) {
-            vol->backingStore.path = backingStore;
-            vol->backingStore.format = backingStoreFormat;
-
-            if (virStorageBackendUpdateVolTargetInfo(&vol->backingStore,
-                                        NULL, NULL,
-                                        VIR_STORAGE_VOL_OPEN_DEFAULT) < 0) {
-                /* The backing file is currently unavailable, the capacity,
-                 * allocation, owner, group and mode are unknown. Just log the
-                 * error and continue.
-                 * Unfortunately virStorageBackendProbeTarget() might already
-                 * have logged a similar message for the same problem, but only
-                 * if AUTO format detection was used. */
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("cannot probe backing volume info: %s"),
-                               vol->backingStore.path);
-            }
+        if (have_stat) {
+            vol->stamp.dev = st.st_dev;
+            vol->stamp.ino = st.st_ino;
+            vol->stamp.size = st.st_size;
+            vol->stamp.mtime = st.st_mtime;
+            vol->stamp.ctime = st.st_ctime;
+            vol->stamp.probed = now;
         }
 
-
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count+1) < 0)
+        if (VIR_RESIZE_N(jobs, njobs_max, njobs, 1) < 0)
             goto no_memory;
-        pool->volumes.objs[pool->volumes.count++] = vol;
+        jobs[njobs++].vol = vol;
         vol = NULL;
     }
     closedir(dir);
+    dir = NULL;
 
+    virStorageBackendFileSystemProbeVols(jobs, njobs);
+
+    for (i = 0 ; i < njobs ; i++) {
+        if (jobs[i].ret == -1) {
+            if (jobs[i].err)
+                virSetError(jobs[i].err);
+            else
+                virReportOOMError();
+            goto cleanup;
+        }
+    }
+
+    /* Drop volumes which disappeared or are about to be replaced by
+     * a freshly probed definition */
+    i = pool->volumes.count;
+    while (i-- > 0) {
+        vol = pool->volumes.objs[i];
+        if (virHashLookup(unchanged, vol->name) == vol)
+            continue;
+        virStoragePoolObjRemoveVol(pool, vol);
+        virStorageVolDefFree(vol);
+    }
+    vol = NULL;
+
+    for (i = 0 ; i < njobs ; i++) {
+        if (jobs[i].ret == -2)
+            continue;
+        if (virStoragePoolObjAddVol(pool, jobs[i].vol) < 0)
+            goto cleanup;
+        jobs[i].vol = NULL;
+    }
 
     if (statvfs(pool->def->target.path, &sb) < 0) {
         virReportSystemError(errno,
                              _("cannot statvfs path '%s'"),
                              pool->def->target.path);
-        return -1;
+        goto cleanup;
     }
     pool->def->capacity = ((unsigned long long)sb.f_frsize *
                            (unsigned long long)sb.f_blocks);
@@ -914,6 +1105,12 @@ virStorageBackendFileSystemRefresh(virConnectPtr conn ATTRIBUTE_UNUSED,
                             (unsigned long long)sb.f_bsize);
     pool->def->allocation = pool->def->capacity - pool->def->available;
 
+    for (i = 0 ; i < njobs ; i++) {
+        virStorageVolDefFree(jobs[i].vol);
+        virFreeError(jobs[i].err);
+    }
+    VIR_FREE(jobs);
+    virHashFree(unchanged);
     return 0;
 
 no_memory:
@@ -924,6 +1121,12 @@ no_memory:
     if (dir)
         closedir(dir);
     virStorageVolDefFree(vol);
+    for (i = 0 ; i < njobs ; i++) {
+        virStorageVolDefFree(jobs[i].vol);
+        virFreeError(jobs[i].err);
+    }
+    VIR_FREE(jobs);
+    virHashFree(unchanged);
     virStoragePoolObjClearVols(pool);
     return -1;
 }
@@ -1260,6 +1463,7 @@ virStorageBackend virStorageBackendDirectory = {
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
     .refreshPool = virStorageBackendFileSystemRefresh,
+    .incrementalRefresh = true,
     .deletePool = virStorageBackendFileSystemDelete,
     .buildVol = virStorageBackendFileSystemVolBuild,
     .buildVolFrom = virStorageBackendFileSystemVolBuildFrom,
@@ -1277,6 +1481,7 @@ virStorageBackend virStorageBackendFileSystem = {
     .checkPool = virStorageBackendFileSystemCheck,
     .startPool = virStorageBackendFileSystemStart,
     .refreshPool = virStorageBackendFileSystemRefresh,
+    .incrementalRefresh = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendFileSystemDelete,
     .buildVol = virStorageBackendFileSystemVolBuild,
@@ -1294,6 +1499,7 @@ virStorageBackend virStorageBackendNetFileSystem = {
     .startPool = virStorageBackendFileSystemStart,
     .findPoolSources = virStorageBackendFileSystemNetFindPoolSources,
     .refreshPool = virStorageBackendFileSystemRefresh,
+    .incrementalRefresh = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendFileSystemDelete,
     .buildVol = virStorageBackendFileSystemVolBuild,
@@ -38,12 +38,236 @@
 #include "memory.h"
 #include "logging.h"
 #include "virfile.h"
+#include "threads.h"
+#include "uuid.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
 #define PV_BLANK_SECTOR_SIZE 512
 
 
+/*
+ * Metadata sequence number of the volume group at the time the volume
+ * list of an active pool was last scanned, keyed by pool UUID.  LVM
+ * bumps it on every metadata commit, so an unchanged number means the
+ * list can be kept as is instead of running lvs again.
+ */
+typedef struct _virStorageBackendLogicalSeqno virStorageBackendLogicalSeqno;
+typedef virStorageBackendLogicalSeqno *virStorageBackendLogicalSeqnoPtr;
+struct _virStorageBackendLogicalSeqno {
+    unsigned long long seqno;
+    /* Volume whose creation accounts for @seqno.  The caller adds it
+     * to the volume list after createVol returned, so the list is only
+     * known to match @seqno once the volume shows up there. */
+    char *created;
+};
+
+static virHashTablePtr virStorageBackendLogicalSeqnos;
+static virMutex virStorageBackendLogicalLock;
+
+static void
+virStorageBackendLogicalSeqnoFree(void *payload,
+                                  const void *name ATTRIBUTE_UNUSED)
+{
+    virStorageBackendLogicalSeqnoPtr cached = payload;
+
+    if (!cached)
+        return;
+
+    VIR_FREE(cached->created);
+    VIR_FREE(cached);
+}
+
+static int virStorageBackendLogicalOnceInit(void)
+{
+    if (virMutexInit(&virStorageBackendLogicalLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Failed to initialized mutex"));
+        return -1;
+    }
+
+    if (!(virStorageBackendLogicalSeqnos =
+          virHashCreate(10, virStorageBackendLogicalSeqnoFree)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virStorageBackendLogical)
+
+
+/*
+ * Get the sequence number the volume list of @pool, which must be
+ * locked, is known to match.  Returns false if there is none, which
+ * includes the case of a created volume that never made it into the
+ * list.
+ */
+static bool
+virStorageBackendLogicalGetCachedSeqno(virStoragePoolObjPtr pool,
+                                       unsigned long long *seqno)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virStorageBackendLogicalSeqnoPtr cached;
+    bool ret = false;
+
+    if (virStorageBackendLogicalInitialize() < 0)
+        return false;
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendLogicalLock);
+    if (!(cached = virHashLookup(virStorageBackendLogicalSeqnos, uuidstr)))
+        goto cleanup;
+
+    if (cached->created) {
+        if (!virStorageVolDefFindByName(pool, cached->created)) {
+            VIR_DEBUG("Volume '%s' was created but not added to pool '%s'",
+                      cached->created, pool->def->name);
+            ignore_value(virHashRemoveEntry(virStorageBackendLogicalSeqnos,
+                                            uuidstr));
+            goto cleanup;
+        }
+        VIR_FREE(cached->created);
+    }
+
+    *seqno = cached->seqno;
+    ret = true;
+
+cleanup:
+    virMutexUnlock(&virStorageBackendLogicalLock);
+    return ret;
+}
+
+static void
+virStorageBackendLogicalSetCachedSeqno(virStoragePoolObjPtr pool,
+                                       unsigned long long seqno,
+                                       const char *created)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virStorageBackendLogicalSeqnoPtr cached;
+    char *tmp = NULL;
+
+    if (virStorageBackendLogicalInitialize() < 0)
+        return;
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendLogicalLock);
+    if (created && !(tmp = strdup(created))) {
+        /* Without the name the list can't be verified later */
+        ignore_value(virHashRemoveEntry(virStorageBackendLogicalSeqnos,
+                                        uuidstr));
+        goto cleanup;
+    }
+
+    if (!(cached = virHashLookup(virStorageBackendLogicalSeqnos, uuidstr))) {
+        if (VIR_ALLOC(cached) < 0)
+            goto cleanup;
+        if (virHashAddEntry(virStorageBackendLogicalSeqnos,
+                            uuidstr, cached) < 0) {
+            VIR_FREE(cached);
+            goto cleanup;
+        }
+    }
+
+    cached->seqno = seqno;
+    VIR_FREE(cached->created);
+    cached->created = tmp;
+    tmp = NULL;
+
+cleanup:
+    VIR_FREE(tmp);
+    virMutexUnlock(&virStorageBackendLogicalLock);
+}
+
+static void
+virStorageBackendLogicalInvalidateCache(virStoragePoolObjPtr pool)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virStorageBackendLogicalInitialize() < 0)
+        return;
+
+    virUUIDFormat(pool->def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendLogicalLock);
+    ignore_value(virHashRemoveEntry(virStorageBackendLogicalSeqnos, uuidstr));
+    virMutexUnlock(&virStorageBackendLogicalLock);
+}
+
+
+static int
+virStorageBackendLogicalGetSeqnoFunc(virStoragePoolObjPtr pool ATTRIBUTE_UNUSED,
+                                     char **const groups,
+                                     void *data)
+{
+    unsigned long long *seqno = data;
+
+    return virStrToLong_ull(groups[0], NULL, 10, seqno);
+}
+
+static int
+virStorageBackendLogicalGetSeqno(virStoragePoolObjPtr pool,
+                                 unsigned long long *seqno)
+{
+    /*
+     *  # vgs --noheadings --options vg_seqno VGNAME
+     *    1742
+     */
+    const char *regexes[] = {
+        "^\\s*([0-9]+)\\s*$"
+    };
+    int vars[] = {
+        1
+    };
+    int ret;
+    virCommandPtr cmd = virCommandNewArgList(VGS,
+                                             "--noheadings",
+                                             "--options", "vg_seqno",
+                                             pool->def->source.name,
+                                             NULL);
+
+    ret = virStorageBackendRunProgRegex(pool, cmd, 1, regexes, vars,
+                                        virStorageBackendLogicalGetSeqnoFunc,
+                                        seqno, "vgs");
+    virCommandFree(cmd);
+    return ret;
+}
+
+/*
+ * Called after libvirt itself changed the volume group metadata by
+ * creating volume @created, or deleting one if it is NULL.  If nobody
+ * else touched the volume group since it was last scanned, the change
+ * accounts for exactly one metadata commit and the list stays in sync
+ * once the caller updated it; otherwise the next refresh has to scan
+ * the volume group again.
+ */
+static void
+virStorageBackendLogicalNoteChange(virStoragePoolObjPtr pool,
+                                   const char *created)
+{
+    unsigned long long cached, seqno;
+
+    if (!virStorageBackendLogicalGetCachedSeqno(pool, &cached))
+        return;
+
+    if (virStorageBackendLogicalGetSeqno(pool, &seqno) < 0) {
+        virResetLastError();
+        virStorageBackendLogicalInvalidateCache(pool);
+        return;
+    }
+
+    if (seqno != cached + 1) {
+        VIR_DEBUG("Volume group '%s' changed from seqno %llu to %llu",
+                  pool->def->source.name, cached, seqno);
+        virStorageBackendLogicalInvalidateCache(pool);
+        return;
+    }
+
+    virStorageBackendLogicalSetCachedSeqno(pool, seqno, created);
+}
+
+
 static int
 virStorageBackendLogicalSetActive(virStoragePoolObjPtr pool,
                                   int on)
@@ -103,12 +327,6 @@ virStorageBackendLogicalMakeVol(virStoragePoolObjPtr pool,
             virReportOOMError();
             goto cleanup;
         }
-
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count + 1)) {
-            virReportOOMError();
-            goto cleanup;
-        }
     }
 
     if (vol->target.path == NULL) {
@@ -257,8 +475,9 @@ virStorageBackendLogicalMakeVol(virStoragePoolObjPtr pool,
         vol->source.nextent++;
     }
 
-    if (is_new_vol)
-        pool->volumes.objs[pool->volumes.count++] = vol;
+    if (is_new_vol &&
+        virStoragePoolObjAddVol(pool, vol) < 0)
+        goto cleanup;
 
     ret = 0;
 
@@ -310,8 +529,12 @@ virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
                                "--unbuffered",
                                "--nosuffix",
                                "--options", "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size",
-                               pool->def->source.name,
                                NULL);
+    /* Only report the volume we're looking for, if any */
+    if (vol)
+        virCommandAddArgFormat(cmd, "%s/%s", pool->def->source.name, vol->name);
+    else
+        virCommandAddArg(cmd, pool->def->source.name);
     if (virStorageBackendRunProgRegex(pool,
                                       cmd,
                                       1,
@@ -330,12 +553,16 @@ cleanup:
 static int
 virStorageBackendLogicalRefreshPoolFunc(virStoragePoolObjPtr pool ATTRIBUTE_UNUSED,
                                         char **const groups,
-                                        void *data ATTRIBUTE_UNUSED)
+                                        void *data)
 {
+    unsigned long long *seqno = data;
+
     if (virStrToLong_ull(groups[0], NULL, 10, &pool->def->capacity) < 0)
         return -1;
     if (virStrToLong_ull(groups[1], NULL, 10, &pool->def->available) < 0)
         return -1;
+    if (virStrToLong_ull(groups[2], NULL, 10, seqno) < 0)
+        return -1;
     pool->def->allocation = pool->def->capacity - pool->def->available;
 
     return 0;
@@ -489,6 +716,8 @@ static int
 virStorageBackendLogicalStartPool(virConnectPtr conn ATTRIBUTE_UNUSED,
                                   virStoragePoolObjPtr pool)
 {
+    virStorageBackendLogicalInvalidateCache(pool);
+
     if (virStorageBackendLogicalSetActive(pool, 1) < 0)
         return -1;
 
@@ -575,59 +804,82 @@ cleanup:
 }
 
 
+/*
+ * The volume list is only rebuilt from lvs output when the volume
+ * group metadata changed since it was last scanned, volumes created
+ * and deleted through libvirt keep it up to date in between.
+ */
 static int
 virStorageBackendLogicalRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
                                     virStoragePoolObjPtr pool)
 {
     /*
-     *  # vgs --separator : --noheadings --units b --unbuffered --nosuffix --options "vg_size,vg_free" VGNAME
-     *    10603200512:4328521728
+     *  # vgs --separator : --noheadings --units b --unbuffered --nosuffix --options "vg_size,vg_free,vg_seqno" VGNAME
+     *    10603200512:4328521728:1742
      *
-     * Pull out size & free
+     * Pull out size, free & metadata sequence number
      *
      * NB vgs from some distros (e.g. SLES10 SP2) outputs trailing ":" on each line
      */
     const char *regexes[] = {
-        "^\\s*(\\S+):([0-9]+):?\\s*$"
+        "^\\s*(\\S+):([0-9]+):([0-9]+):?\\s*$"
     };
     int vars[] = {
-        2
+        3
     };
     virCommandPtr cmd = NULL;
+    unsigned long long seqno = 0;
+    unsigned long long cached;
     int ret = -1;
 
     virFileWaitForDevices();
 
-    /* Get list of all logical volumes */
-    if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
-        goto cleanup;
-
     cmd = virCommandNewArgList(VGS,
                                "--separator", ":",
                                "--noheadings",
                                "--units", "b",
                                "--unbuffered",
                                "--nosuffix",
-                               "--options", "vg_size,vg_free",
+                               "--options", "vg_size,vg_free,vg_seqno",
                                pool->def->source.name,
                                NULL);
 
-    /* Now get basic volgrp metadata */
+    /* Get basic volgrp metadata first, so that a change made while
+     * the volumes are listed shows up on the next refresh */
     if (virStorageBackendRunProgRegex(pool,
                                       cmd,
                                       1,
                                       regexes,
                                       vars,
                                       virStorageBackendLogicalRefreshPoolFunc,
-                                      NULL, "vgs") < 0)
+                                      &seqno, "vgs") < 0)
         goto cleanup;
 
+    if (virStorageBackendLogicalGetCachedSeqno(pool, &cached) &&
+        cached == seqno) {
+        VIR_DEBUG("Volume group '%s' unchanged at seqno %llu",
+                  pool->def->source.name, seqno);
+        ret = 0;
+        goto cleanup;
+    }
+
+    virStorageBackendLogicalInvalidateCache(pool);
+    virStoragePoolObjClearVols(pool);
+
+    /* Get list of all logical volumes */
+    if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
+        goto cleanup;
+
+    virStorageBackendLogicalSetCachedSeqno(pool, seqno, NULL);
+
     ret = 0;
 
 cleanup:
     virCommandFree(cmd);
-    if (ret < 0)
+    if (ret < 0) {
+        virStorageBackendLogicalInvalidateCache(pool);
         virStoragePoolObjClearVols(pool);
+    }
     return ret;
 }
 
@@ -640,6 +892,8 @@ static int
 virStorageBackendLogicalStopPool(virConnectPtr conn ATTRIBUTE_UNUSED,
                                  virStoragePoolObjPtr pool)
 {
+    virStorageBackendLogicalInvalidateCache(pool);
+
     if (virStorageBackendLogicalSetActive(pool, 0) < 0)
         return -1;
 
@@ -657,6 +911,8 @@ virStorageBackendLogicalDeletePool(virConnectPtr conn ATTRIBUTE_UNUSED,
 
     virCheckFlags(0, -1);
 
+    virStorageBackendLogicalInvalidateCache(pool);
+
     /* first remove the volume group */
     cmd = virCommandNewArgList(VGREMOVE,
                                "-f", pool->def->source.name,
@@ -772,6 +1028,9 @@ virStorageBackendLogicalCreateVol(virConnectPtr conn,
         goto cleanup;
     }
 
+    /* The caller adds @vol to the pool's volume list */
+    virStorageBackendLogicalNoteChange(pool, vol->name);
+
     return 0;
 
  cleanup:
@@ -799,7 +1058,7 @@ virStorageBackendLogicalBuildVolFrom(virConnectPtr conn,
 
 static int
 virStorageBackendLogicalDeleteVol(virConnectPtr conn ATTRIBUTE_UNUSED,
-                                  virStoragePoolObjPtr pool ATTRIBUTE_UNUSED,
+                                  virStoragePoolObjPtr pool,
                                   virStorageVolDefPtr vol,
                                   unsigned int flags)
 {
@@ -831,6 +1090,9 @@ virStorageBackendLogicalDeleteVol(virConnectPtr conn ATTRIBUTE_UNUSED,
         }
     }
 
+    /* The caller removes @vol from the pool's volume list */
+    virStorageBackendLogicalNoteChange(pool, NULL);
+
     ret = 0;
 cleanup:
     VIR_FREE(volpath);
@@ -849,6 +1111,7 @@ virStorageBackend virStorageBackendLogical = {
     .refreshPool = virStorageBackendLogicalRefreshPool,
     .stopPool = virStorageBackendLogicalStopPool,
     .deletePool = virStorageBackendLogicalDeletePool,
+    .incrementalRefresh = true,
     .buildVol = NULL,
     .buildVolFrom = virStorageBackendLogicalBuildVolFrom,
     .createVol = virStorageBackendLogicalCreateVol,
@@ -321,11 +321,6 @@ static int virStorageBackendRBDRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
     }
 
     for (i = 0, name = names; name < names + max_size; i++) {
-        if (VIR_REALLOC_N(pool->volumes.objs, pool->volumes.count + 1) < 0) {
-            virStoragePoolObjClearVols(pool);
-            goto out_of_memory;
-        }
-
         virStorageVolDefPtr vol;
         if (VIR_ALLOC(vol) < 0)
             goto out_of_memory;
@@ -342,7 +337,11 @@ static int virStorageBackendRBDRefreshPool(virConnectPtr conn ATTRIBUTE_UNUSED,
         if (volStorageBackendRBDRefreshVolInfo(vol, pool, ptr) < 0)
             goto cleanup;
 
-        pool->volumes.objs[pool->volumes.count++] = vol;
+        if (virStoragePoolObjAddVol(pool, vol) < 0) {
+            virStorageVolDefFree(vol);
+            virStoragePoolObjClearVols(pool);
+            goto cleanup;
+        }
     }
 
     VIR_DEBUG("Found %d images in RBD pool %s",
@@ -29,6 +29,11 @@
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <fcntl.h>
+#ifdef __linux__
+# include <sys/ioctl.h>
+# include <linux/fs.h>
+# include <linux/falloc.h>
+#endif
 
 #if HAVE_PWD_H
 # include <pwd.h>
@@ -47,6 +52,7 @@
 #include "logging.h"
 #include "virfile.h"
 #include "fdstream.h"
+#include "threads.h"
 #include "configmake.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
@@ -428,6 +434,23 @@ storageListDefinedPools(virConnectPtr conn,
     return -1;
 }
 
+static int
+storageListAllPools(virConnectPtr conn,
+                    virStoragePoolPtr **pools,
+                    unsigned int flags)
+{
+    virStorageDriverStatePtr driver = conn->storagePrivateData;
+    int ret = -1;
+
+    virCheckFlags(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ALL, -1);
+
+    storageDriverLock(driver);
+    ret = virStoragePoolList(conn, &driver->pools, pools, flags);
+    storageDriverUnlock(driver);
+
+    return ret;
+}
+
 /* This method is required to be re-entrant / thread safe, so
    uses no driver lock */
 static char *
@@ -895,7 +918,8 @@ storagePoolRefresh(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    virStoragePoolObjClearVols(pool);
+    if (!backend->incrementalRefresh)
+        virStoragePoolObjClearVols(pool);
     if (backend->refreshPool(obj->conn, pool) < 0) {
         if (backend->stopPool)
             backend->stopPool(obj->conn, pool);
@@ -1153,6 +1177,40 @@ storagePoolListVolumes(virStoragePoolPtr obj,
     return -1;
 }
 
+static int
+storagePoolListAllVolumes(virStoragePoolPtr obj,
+                          virStorageVolPtr **vols,
+                          unsigned int flags) {
+    virStorageDriverStatePtr driver = obj->conn->storagePrivateData;
+    virStoragePoolObjPtr pool;
+    int ret = -1;
+
+    virCheckFlags(0, -1);
+
+    storageDriverLock(driver);
+    pool = virStoragePoolObjFindByUUID(&driver->pools, obj->uuid);
+    storageDriverUnlock(driver);
+
+    if (!pool) {
+        virReportError(VIR_ERR_NO_STORAGE_POOL, "%s",
+                       _("no storage pool with matching uuid"));
+        goto cleanup;
+    }
+
+    if (!virStoragePoolObjIsActive(pool)) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("storage pool is not active"));
+        goto cleanup;
+    }
+
+    ret = virStoragePoolObjListVolumes(obj->conn, pool, vols);
+
+cleanup:
+    if (pool)
+        virStoragePoolObjUnlock(pool);
+    return ret;
+}
+
 
 static virStorageVolPtr
 storageVolumeLookupByName(virStoragePoolPtr obj,
@@ -1200,23 +1258,14 @@ static virStorageVolPtr
 storageVolumeLookupByKey(virConnectPtr conn,
                          const char *key) {
     virStorageDriverStatePtr driver = conn->storagePrivateData;
-    unsigned int i;
+    virStoragePoolObjPtr pool;
+    virStorageVolDefPtr vol;
     virStorageVolPtr ret = NULL;
 
     storageDriverLock(driver);
-    for (i = 0 ; i < driver->pools.count && !ret ; i++) {
-        virStoragePoolObjLock(driver->pools.objs[i]);
-        if (virStoragePoolObjIsActive(driver->pools.objs[i])) {
-            virStorageVolDefPtr vol =
-                virStorageVolDefFindByKey(driver->pools.objs[i], key);
-
-            if (vol)
-                ret = virGetStorageVol(conn,
-                                       driver->pools.objs[i]->def->name,
-                                       vol->name,
-                                       vol->key);
-        }
-        virStoragePoolObjUnlock(driver->pools.objs[i]);
+    if ((vol = virStoragePoolObjListFindVolByKey(&driver->pools, key, &pool))) {
+        ret = virGetStorageVol(conn, pool->def->name, vol->name, vol->key);
+        virStoragePoolObjUnlock(pool);
     }
     storageDriverUnlock(driver);
 
@@ -1231,6 +1280,8 @@ static virStorageVolPtr
 storageVolumeLookupByPath(virConnectPtr conn,
                           const char *path) {
     virStorageDriverStatePtr driver = conn->storagePrivateData;
+    virStoragePoolObjPtr pool;
+    virStorageVolDefPtr vol;
     unsigned int i;
     virStorageVolPtr ret = NULL;
     char *cleanpath;
@@ -1240,10 +1291,19 @@ storageVolumeLookupByPath(virConnectPtr conn,
         return NULL;
 
     storageDriverLock(driver);
+    /* Most callers pass the exact path the volume was enumerated
+     * with, so look it up directly before paying for the stable path
+     * resolution below, which may scan /dev/disk/by-* */
+    if ((vol = virStoragePoolObjListFindVolByPath(&driver->pools, cleanpath,
+                                                  &pool))) {
+        ret = virGetStorageVol(conn, pool->def->name, vol->name, vol->key);
+        virStoragePoolObjUnlock(pool);
+    }
+
+    /* The stable path depends on the target directory of each pool */
     for (i = 0 ; i < driver->pools.count && !ret ; i++) {
         virStoragePoolObjLock(driver->pools.objs[i]);
         if (virStoragePoolObjIsActive(driver->pools.objs[i])) {
-            virStorageVolDefPtr vol;
             const char *stable_path;
 
             stable_path = virStorageBackendStablePath(driver->pools.objs[i],
@@ -1324,12 +1384,6 @@ storageVolumeCreateXML(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    if (VIR_REALLOC_N(pool->volumes.objs,
-                      pool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (!backend->createVol) {
         virReportError(VIR_ERR_NO_SUPPORT,
                        "%s", _("storage pool does not support volume "
@@ -1341,11 +1395,13 @@ storageVolumeCreateXML(virStoragePoolPtr obj,
         goto cleanup;
     }
 
-    pool->volumes.objs[pool->volumes.count++] = voldef;
+    if (virStoragePoolObjAddVol(pool, voldef) < 0)
+        goto cleanup;
+
     volobj = virGetStorageVol(obj->conn, pool->def->name, voldef->name,
                               voldef->key);
     if (!volobj) {
-        pool->volumes.count--;
+        virStoragePoolObjRemoveVol(pool, voldef);
         goto cleanup;
     }
 
@@ -1502,18 +1558,14 @@ storageVolumeCreateXMLFrom(virStoragePoolPtr obj,
         backend->refreshVol(obj->conn, pool, origvol) < 0)
         goto cleanup;
 
-    if (VIR_REALLOC_N(pool->volumes.objs,
-                      pool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     /* 'Define' the new volume so we get async progress reporting */
     if (backend->createVol(obj->conn, pool, newvol) < 0) {
         goto cleanup;
     }
 
-    pool->volumes.objs[pool->volumes.count++] = newvol;
+    if (virStoragePoolObjAddVol(pool, newvol) < 0)
+        goto cleanup;
+
     volobj = virGetStorageVol(obj->conn, pool->def->name, newvol->name,
                               newvol->key);
 
@@ -1828,62 +1880,315 @@ out:
 }
 
 
+/*
+ * storageWipeExtentFast:
+ * @vol: the volume
+ * @fd: open file descriptor for the volume
+ * @st: status of @fd
+ * @extent_start: offset of the extent to zero
+ * @extent_length: length of the extent to zero
+ *
+ * Zero the extent without writing the data ourselves: block devices
+ * are discarded if that reads back as zeroes, else zeroed out by the
+ * kernel, and the blocks of regular files are converted to unwritten
+ * extents. Either is a metadata operation on most storage.
+ *
+ * Returns 0 on success, 1 if the caller has to write the zeroes.
+ */
+static int
+storageWipeExtentFast(virStorageVolDefPtr vol ATTRIBUTE_UNUSED,
+                      int fd ATTRIBUTE_UNUSED,
+                      struct stat *st ATTRIBUTE_UNUSED,
+                      off_t extent_start ATTRIBUTE_UNUSED,
+                      off_t extent_length ATTRIBUTE_UNUSED)
+{
+#ifdef __linux__
+    if (S_ISBLK(st->st_mode)) {
+# if defined(BLKDISCARD) && defined(BLKDISCARDZEROES)
+        unsigned int zeroes = 0;
+# endif
+        uint64_t range[2] = { extent_start, extent_length };
+
+# if defined(BLKDISCARD) && defined(BLKDISCARDZEROES)
+        if (ioctl(fd, BLKDISCARDZEROES, &zeroes) == 0 && zeroes &&
+            ioctl(fd, BLKDISCARD, range) == 0) {
+            VIR_DEBUG("Discarded volume with path '%s'", vol->target.path);
+            return 0;
+        }
+# endif
+# ifdef BLKZEROOUT
+        if (ioctl(fd, BLKZEROOUT, range) == 0) {
+            VIR_DEBUG("Zeroed out volume with path '%s'", vol->target.path);
+            return 0;
+        }
+# endif
+        VIR_DEBUG("Cannot offload zeroing of volume with path '%s': %d",
+                  vol->target.path, errno);
+        return 1;
+    }
+
+# if HAVE_FALLOCATE && defined(FALLOC_FL_KEEP_SIZE)
+    if (S_ISREG(st->st_mode)) {
+#  ifdef FALLOC_FL_ZERO_RANGE
+        if (fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+                      extent_start, extent_length) == 0)
+            return 0;
+#  endif
+#  ifdef FALLOC_FL_PUNCH_HOLE
+        /* keep the volume allocated by filling the hole right away */
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      extent_start, extent_length) == 0 &&
+            fallocate(fd, FALLOC_FL_KEEP_SIZE,
+                      extent_start, extent_length) == 0)
+            return 0;
+#  endif
+        VIR_DEBUG("Cannot offload zeroing of volume with path '%s': %d",
+                  vol->target.path, errno);
+    }
+# endif
+#endif /* __linux__ */
+
+    return 1;
+}
+
+
+/* Extents of at least this many bytes per thread are wiped in parallel */
+#define WIPE_THREAD_MIN_EXTENT (1024ull * 1024 * 1024)
+#define WIPE_MAX_THREADS 4
+#define WIPE_BUFFER_SIZE (1024 * 1024)
+/* Alignment of the buffer and offsets required for O_DIRECT */
+#define WIPE_DIRECT_ALIGN 4096
+/* Log progress each time this fraction of the volume got wiped */
+#define WIPE_PROGRESS_STEPS 20
+
+typedef struct _storageWipeProgress storageWipeProgress;
+typedef storageWipeProgress *storageWipeProgressPtr;
+struct _storageWipeProgress {
+    virMutex lock;
+    virStorageVolDefPtr vol;
+    unsigned long long total;
+    unsigned long long wiped;
+    unsigned int step;
+};
+
+typedef struct _storageWipeJob storageWipeJob;
+typedef storageWipeJob *storageWipeJobPtr;
+struct _storageWipeJob {
+    storageWipeProgressPtr progress;
+    off_t start;
+    off_t length;
+    int ret;
+    virThread thread;
+};
+
+static void
+storageWipeAddProgress(storageWipeProgressPtr progress,
+                       size_t written)
+{
+    unsigned int step;
+
+    virMutexLock(&progress->lock);
+    progress->wiped += written;
+    step = progress->wiped * WIPE_PROGRESS_STEPS / progress->total;
+    if (step > progress->step) {
+        progress->step = step;
+        VIR_INFO("Wiped %llu of %llu bytes of volume with path '%s'",
+                 progress->wiped, progress->total,
+                 progress->vol->target.path);
+    }
+    virMutexUnlock(&progress->lock);
+}
+
+/*
+ * Write zeroes over one extent of the volume through a descriptor of
+ * its own, bypassing the page cache when the extent is aligned so a
+ * large wipe doesn't evict everything else.
+ */
 static int
-storageWipeExtent(virStorageVolDefPtr vol,
-                  int fd,
-                  off_t extent_start,
-                  off_t extent_length,
-                  char *writebuf,
-                  size_t writebuf_length,
-                  size_t *bytes_wiped)
+storageWipeExtent(storageWipeJobPtr job)
 {
-    int ret = -1, written = 0;
-    off_t remaining = 0;
-    size_t write_size = 0;
+    virStorageVolDefPtr vol = job->progress->vol;
+    int ret = -1, fd = -1;
+    off_t offset = job->start;
+    off_t remaining = job->length;
+    void *writebuf = NULL;
+    bool direct = false;
 
     VIR_DEBUG("extent logical start: %ju len: %ju",
-              (uintmax_t)extent_start, (uintmax_t)extent_length);
+              (uintmax_t)job->start, (uintmax_t)job->length);
 
-    if ((ret = lseek(fd, extent_start, SEEK_SET)) < 0) {
+#ifdef O_DIRECT
+    if (job->start % WIPE_DIRECT_ALIGN == 0 &&
+        job->length % WIPE_DIRECT_ALIGN == 0 &&
+        (fd = open(vol->target.path, O_WRONLY | O_DIRECT)) >= 0)
+        direct = true;
+#endif
+    if (fd < 0 &&
+        (fd = open(vol->target.path, O_WRONLY)) < 0) {
         virReportSystemError(errno,
-                             _("Failed to seek to position %ju in volume "
-                               "with path '%s'"),
-                             (uintmax_t)extent_start, vol->target.path);
+                             _("Failed to open storage volume with path '%s'"),
+                             vol->target.path);
         goto out;
     }
 
-    remaining = extent_length;
+#if HAVE_POSIX_MEMALIGN
+    if (posix_memalign(&writebuf, WIPE_DIRECT_ALIGN, WIPE_BUFFER_SIZE) != 0) {
+        writebuf = NULL;
+        virReportOOMError();
+        goto out;
+    }
+    memset(writebuf, 0, WIPE_BUFFER_SIZE);
+#else
+    direct = false;
+    if (VIR_ALLOC_N(writebuf, WIPE_BUFFER_SIZE) < 0) {
+        virReportOOMError();
+        goto out;
+    }
+#endif
+
     while (remaining > 0) {
+        size_t write_size = WIPE_BUFFER_SIZE < remaining ?
+            WIPE_BUFFER_SIZE : remaining;
+        ssize_t written = pwrite(fd, writebuf, write_size, offset);
 
-        write_size = (writebuf_length < remaining) ? writebuf_length : remaining;
-        written = safewrite(fd, writebuf, write_size);
-        if (written < 0) {
-            virReportSystemError(errno,
+        if (written < 0 && errno == EINTR)
+            continue;
+
+        if (written < 0 && errno == EINVAL && direct) {
+            /* the device wants a larger alignment, go through the cache */
+            VIR_FORCE_CLOSE(fd);
+            direct = false;
+            if ((fd = open(vol->target.path, O_WRONLY)) < 0) {
+                virReportSystemError(errno,
+                                     _("Failed to open storage volume with "
+                                       "path '%s'"),
+                                     vol->target.path);
+                goto out;
+            }
+            continue;
+        }
+
+        if (written <= 0) {
+            virReportSystemError(written < 0 ? errno : EIO,
                                  _("Failed to write %zu bytes to "
                                    "storage volume with path '%s'"),
                                  write_size, vol->target.path);
-
             goto out;
         }
 
-        *bytes_wiped += written;
+        offset += written;
         remaining -= written;
+        storageWipeAddProgress(job->progress, written);
     }
 
     if (fdatasync(fd) < 0) {
-        ret = -errno;
         virReportSystemError(errno,
                              _("cannot sync data to volume with path '%s'"),
                              vol->target.path);
         goto out;
     }
 
-    VIR_DEBUG("Wrote %zu bytes to volume with path '%s'",
-              *bytes_wiped, vol->target.path);
-
     ret = 0;
 
 out:
+#if HAVE_POSIX_MEMALIGN
+    free(writebuf);
+#else
+    VIR_FREE(writebuf);
+#endif
+    VIR_FORCE_CLOSE(fd);
+    return ret;
+}
+
+static void
+storageWipeExtentThread(void *opaque)
+{
+    storageWipeJobPtr job = opaque;
+
+    job->ret = storageWipeExtent(job);
+}
+
+/*
+ * storageWipeZero:
+ * @vol: the volume
+ * @fd: open file descriptor for the volume
+ * @st: status of @fd
+ * @length: number of bytes to zero from the start of the volume
+ *
+ * Zero the volume, preferably by letting the kernel or the storage do
+ * it, otherwise by writing zeroes from up to WIPE_MAX_THREADS threads,
+ * each taking care of a contiguous extent.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+storageWipeZero(virStorageVolDefPtr vol,
+                int fd,
+                struct stat *st,
+                unsigned long long length)
+{
+    storageWipeProgress progress;
+    storageWipeJob jobs[WIPE_MAX_THREADS];
+    size_t njobs, nstarted = 0, i;
+    off_t start = 0, chunk;
+    int ret = 0;
+
+    if (length == 0 ||
+        storageWipeExtentFast(vol, fd, st, 0, length) == 0)
+        return 0;
+
+    memset(&progress, 0, sizeof(progress));
+    if (virMutexInit(&progress.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        return -1;
+    }
+    progress.vol = vol;
+    progress.total = length;
+
+    njobs = length / WIPE_THREAD_MIN_EXTENT;
+    if (njobs > WIPE_MAX_THREADS)
+        njobs = WIPE_MAX_THREADS;
+    if (njobs == 0)
+        njobs = 1;
+
+    /* keep the extents aligned so each thread may use O_DIRECT */
+    chunk = (length / njobs) & ~((off_t)WIPE_BUFFER_SIZE - 1);
+
+    memset(jobs, 0, sizeof(jobs));
+    for (i = 0; i < njobs; i++) {
+        jobs[i].progress = &progress;
+        jobs[i].start = start;
+        jobs[i].length = i == njobs - 1 ? length - start : chunk;
+        start += jobs[i].length;
+    }
+
+    if (njobs == 1) {
+        ret = storageWipeExtent(&jobs[0]);
+        goto cleanup;
+    }
+
+    for (i = 0; i < njobs; i++) {
+        if (virThreadCreate(&jobs[i].thread, true,
+                            storageWipeExtentThread, &jobs[i]) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create wipe thread"));
+            ret = -1;
+            break;
+        }
+        nstarted++;
+    }
+
+    for (i = 0; i < nstarted; i++) {
+        virThreadJoin(&jobs[i].thread);
+        if (jobs[i].ret < 0)
+            ret = -1;
+    }
+
+cleanup:
+    VIR_DEBUG("Wrote %llu bytes to volume with path '%s'",
+              progress.wiped, vol->target.path);
+    virMutexDestroy(&progress.lock);
     return ret;
 }
 
@@ -1894,8 +2199,6 @@ storageVolumeWipeInternal(virStorageVolDefPtr def,
 {
     int ret = -1, fd = -1;
     struct stat st;
-    char *writebuf = NULL;
-    size_t bytes_wiped = 0;
     virCommandPtr cmd = NULL;
 
     VIR_DEBUG("Wiping volume with path '%s' and algorithm %u",
@@ -1962,24 +2265,12 @@ storageVolumeWipeInternal(virStorageVolDefPtr def,
             ret = storageVolumeZeroSparseFile(def, st.st_size, fd);
         } else {
 
-            if (VIR_ALLOC_N(writebuf, st.st_blksize) != 0) {
-                virReportOOMError();
-                goto out;
-            }
-
-            ret = storageWipeExtent(def,
-                                    fd,
-                                    0,
-                                    def->allocation,
-                                    writebuf,
-                                    st.st_blksize,
-                                    &bytes_wiped);
+            ret = storageWipeZero(def, fd, &st, def->allocation);
         }
     }
 
 out:
     virCommandFree(cmd);
-    VIR_FREE(writebuf);
     VIR_FORCE_CLOSE(fd);
     return ret;
 }
@@ -2065,7 +2356,6 @@ storageVolumeDelete(virStorageVolPtr obj,
     virStoragePoolObjPtr pool;
     virStorageBackendPtr backend;
     virStorageVolDefPtr vol = NULL;
-    unsigned int i;
     int ret = -1;
 
     storageDriverLock(driver);
@@ -2113,25 +2403,12 @@ storageVolumeDelete(virStorageVolPtr obj,
     if (backend->deleteVol(obj->conn, pool, vol, flags) < 0)
         goto cleanup;
 
-    for (i = 0 ; i < pool->volumes.count ; i++) {
-        if (pool->volumes.objs[i] == vol) {
-            VIR_INFO("Deleting volume '%s' from storage pool '%s'",
-                     vol->name, pool->def->name);
-            virStorageVolDefFree(vol);
-            vol = NULL;
-
-            if (i < (pool->volumes.count - 1))
-                memmove(pool->volumes.objs + i, pool->volumes.objs + i + 1,
-                        sizeof(*(pool->volumes.objs)) * (pool->volumes.count - (i + 1)));
+    VIR_INFO("Deleting volume '%s' from storage pool '%s'",
+             vol->name, pool->def->name);
+    virStoragePoolObjRemoveVol(pool, vol);
+    virStorageVolDefFree(vol);
+    vol = NULL;
 
-            if (VIR_REALLOC_N(pool->volumes.objs, pool->volumes.count - 1) < 0) {
-                ; /* Failure to reduce memory allocation isn't fatal */
-            }
-            pool->volumes.count--;
-
-            break;
-        }
-    }
     ret = 0;
 
 cleanup:
@@ -2295,6 +2572,7 @@ static virStorageDriver storageDriver = {
     .listPools = storageListPools, /* 0.4.0 */
     .numOfDefinedPools = storageNumDefinedPools, /* 0.4.0 */
     .listDefinedPools = storageListDefinedPools, /* 0.4.0 */
+    .listAllPools = storageListAllPools, /* 0.9.14 */
     .findPoolSources = storageFindPoolSources, /* 0.4.0 */
     .poolLookupByName = storagePoolLookupByName, /* 0.4.0 */
     .poolLookupByUUID = storagePoolLookupByUUID, /* 0.4.0 */
@@ -2313,6 +2591,7 @@ static virStorageDriver storageDriver = {
     .poolSetAutostart = storagePoolSetAutostart, /* 0.4.0 */
     .poolNumOfVolumes = storagePoolNumVolumes, /* 0.4.0 */
     .poolListVolumes = storagePoolListVolumes, /* 0.4.0 */
+    .poolListAllVolumes = storagePoolListAllVolumes, /* 0.9.14 */
 
     .volLookupByName = storageVolumeLookupByName, /* 0.4.0 */
     .volLookupByKey = storageVolumeLookupByKey, /* 0.4.0 */
@@ -706,12 +706,6 @@ static int testOpenVolumesForPool(xmlDocPtr xml,
             }
         }
 
-        if (VIR_REALLOC_N(pool->volumes.objs,
-                          pool->volumes.count+1) < 0) {
-            virReportOOMError();
-            goto error;
-        }
-
         if (def->target.path == NULL) {
             if (virAsprintf(&def->target.path, "%s/%s",
                             pool->def->target.path,
@@ -729,11 +723,13 @@ static int testOpenVolumesForPool(xmlDocPtr xml,
             }
         }
 
+        if (virStoragePoolObjAddVol(pool, def) < 0)
+            goto error;
+
         pool->def->allocation += def->allocation;
         pool->def->available = (pool->def->capacity -
                                 pool->def->allocation);
 
-        pool->volumes.objs[pool->volumes.count++] = def;
         def = NULL;
     }
 
@@ -3942,6 +3938,22 @@ no_memory:
     return -1;
 }
 
+static int
+testStorageListAllPools(virConnectPtr conn,
+                        virStoragePoolPtr **pools,
+                        unsigned int flags)
+{
+    testConnPtr privconn = conn->privateData;
+    int ret = -1;
+
+    virCheckFlags(VIR_CONNECT_LIST_STORAGE_POOLS_FILTERS_ALL, -1);
+
+    testDriverLock(privconn);
+    ret = virStoragePoolList(conn, &privconn->pools, pools, flags);
+    testDriverUnlock(privconn);
+
+    return ret;
+}
 
 static int testStoragePoolIsActive(virStoragePoolPtr pool)
 {
@@ -4537,6 +4549,40 @@ testStoragePoolListVolumes(virStoragePoolPtr pool,
     return -1;
 }
 
+static int
+testStoragePoolListAllVolumes(virStoragePoolPtr obj,
+                              virStorageVolPtr **vols,
+                              unsigned int flags) {
+    testConnPtr privconn = obj->conn->privateData;
+    virStoragePoolObjPtr pool;
+    int ret = -1;
+
+    virCheckFlags(0, -1);
+
+    testDriverLock(privconn);
+    pool = virStoragePoolObjFindByUUID(&privconn->pools, obj->uuid);
+    testDriverUnlock(privconn);
+
+    if (!pool) {
+        virReportError(VIR_ERR_NO_STORAGE_POOL, "%s",
+                       _("no storage pool with matching uuid"));
+        goto cleanup;
+    }
+
+    if (!virStoragePoolObjIsActive(pool)) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("storage pool '%s' is not active"), obj->name);
+        goto cleanup;
+    }
+
+    ret = virStoragePoolObjListVolumes(obj->conn, pool, vols);
+
+cleanup:
+    if (pool)
+        virStoragePoolObjUnlock(pool);
+    return ret;
+}
+
 
 static virStorageVolPtr
 testStorageVolumeLookupByName(virStoragePoolPtr pool,
@@ -4585,26 +4631,16 @@ static virStorageVolPtr
 testStorageVolumeLookupByKey(virConnectPtr conn,
                              const char *key) {
     testConnPtr privconn = conn->privateData;
-    unsigned int i;
+    virStoragePoolObjPtr privpool;
+    virStorageVolDefPtr privvol;
     virStorageVolPtr ret = NULL;
 
     testDriverLock(privconn);
-    for (i = 0 ; i < privconn->pools.count ; i++) {
-        virStoragePoolObjLock(privconn->pools.objs[i]);
-        if (virStoragePoolObjIsActive(privconn->pools.objs[i])) {
-            virStorageVolDefPtr privvol =
-                virStorageVolDefFindByKey(privconn->pools.objs[i], key);
-
-            if (privvol) {
-                ret = virGetStorageVol(conn,
-                                       privconn->pools.objs[i]->def->name,
-                                       privvol->name,
-                                       privvol->key);
-                virStoragePoolObjUnlock(privconn->pools.objs[i]);
-                break;
-            }
-        }
-        virStoragePoolObjUnlock(privconn->pools.objs[i]);
+    if ((privvol = virStoragePoolObjListFindVolByKey(&privconn->pools, key,
+                                                     &privpool))) {
+        ret = virGetStorageVol(conn, privpool->def->name,
+                               privvol->name, privvol->key);
+        virStoragePoolObjUnlock(privpool);
     }
     testDriverUnlock(privconn);
 
@@ -4619,26 +4655,16 @@ static virStorageVolPtr
 testStorageVolumeLookupByPath(virConnectPtr conn,
                               const char *path) {
     testConnPtr privconn = conn->privateData;
-    unsigned int i;
+    virStoragePoolObjPtr privpool;
+    virStorageVolDefPtr privvol;
     virStorageVolPtr ret = NULL;
 
     testDriverLock(privconn);
-    for (i = 0 ; i < privconn->pools.count ; i++) {
-        virStoragePoolObjLock(privconn->pools.objs[i]);
-        if (virStoragePoolObjIsActive(privconn->pools.objs[i])) {
-            virStorageVolDefPtr privvol =
-                virStorageVolDefFindByPath(privconn->pools.objs[i], path);
-
-            if (privvol) {
-                ret = virGetStorageVol(conn,
-                                       privconn->pools.objs[i]->def->name,
-                                       privvol->name,
-                                       privvol->key);
-                virStoragePoolObjUnlock(privconn->pools.objs[i]);
-                break;
-            }
-        }
-        virStoragePoolObjUnlock(privconn->pools.objs[i]);
+    if ((privvol = virStoragePoolObjListFindVolByPath(&privconn->pools, path,
+                                                      &privpool))) {
+        ret = virGetStorageVol(conn, privpool->def->name,
+                               privvol->name, privvol->key);
+        virStoragePoolObjUnlock(privpool);
     }
     testDriverUnlock(privconn);
 
@@ -4696,12 +4722,6 @@ testStorageVolumeCreateXML(virStoragePoolPtr pool,
         goto cleanup;
     }
 
-    if (VIR_REALLOC_N(privpool->volumes.objs,
-                      privpool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (virAsprintf(&privvol->target.path, "%s/%s",
                     privpool->def->target.path,
                     privvol->name) == -1) {
@@ -4715,12 +4735,13 @@ testStorageVolumeCreateXML(virStoragePoolPtr pool,
         goto cleanup;
     }
 
+    if (virStoragePoolObjAddVol(privpool, privvol) < 0)
+        goto cleanup;
+
     privpool->def->allocation += privvol->allocation;
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    privpool->volumes.objs[privpool->volumes.count++] = privvol;
-
     ret = virGetStorageVol(pool->conn, privpool->def->name,
                            privvol->name, privvol->key);
     privvol = NULL;
@@ -4790,12 +4811,6 @@ testStorageVolumeCreateXMLFrom(virStoragePoolPtr pool,
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    if (VIR_REALLOC_N(privpool->volumes.objs,
-                      privpool->volumes.count+1) < 0) {
-        virReportOOMError();
-        goto cleanup;
-    }
-
     if (virAsprintf(&privvol->target.path, "%s/%s",
                     privpool->def->target.path,
                     privvol->name) == -1) {
@@ -4809,12 +4824,13 @@ testStorageVolumeCreateXMLFrom(virStoragePoolPtr pool,
         goto cleanup;
     }
 
+    if (virStoragePoolObjAddVol(privpool, privvol) < 0)
+        goto cleanup;
+
     privpool->def->allocation += privvol->allocation;
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    privpool->volumes.objs[privpool->volumes.count++] = privvol;
-
     ret = virGetStorageVol(pool->conn, privpool->def->name,
                            privvol->name, privvol->key);
     privvol = NULL;
@@ -4833,7 +4849,6 @@ testStorageVolumeDelete(virStorageVolPtr vol,
     testConnPtr privconn = vol->conn->privateData;
     virStoragePoolObjPtr privpool;
     virStorageVolDefPtr privvol;
-    int i;
     int ret = -1;
 
     virCheckFlags(0, -1);
@@ -4869,25 +4884,9 @@ testStorageVolumeDelete(virStorageVolPtr vol,
     privpool->def->available = (privpool->def->capacity -
                                 privpool->def->allocation);
 
-    for (i = 0 ; i < privpool->volumes.count ; i++) {
-        if (privpool->volumes.objs[i] == privvol) {
-            virStorageVolDefFree(privvol);
-
-            if (i < (privpool->volumes.count - 1))
-                memmove(privpool->volumes.objs + i,
-                        privpool->volumes.objs + i + 1,
-                        sizeof(*(privpool->volumes.objs)) *
-                                (privpool->volumes.count - (i + 1)));
-
-            if (VIR_REALLOC_N(privpool->volumes.objs,
-                              privpool->volumes.count - 1) < 0) {
-                ; /* Failure to reduce memory allocation isn't fatal */
-            }
-            privpool->volumes.count--;
+    virStoragePoolObjRemoveVol(privpool, privvol);
+    virStorageVolDefFree(privvol);
 
-            break;
-        }
-    }
     ret = 0;
 
 cleanup:
@@ -5066,16 +5065,12 @@ testNodeNumOfDevices(virConnectPtr conn,
                      unsigned int flags)
 {
     testConnPtr driver = conn->privateData;
-    int ndevs = 0;
-    unsigned int i;
+    int ndevs;
 
     virCheckFlags(0, -1);
 
     testDriverLock(driver);
-    for (i = 0; i < driver->devs.count; i++)
-        if ((cap == NULL) ||
-            virNodeDeviceHasCap(driver->devs.objs[i], cap))
-            ++ndevs;
+    ndevs = virNodeDeviceObjListNumOfDevices(&driver->devs, cap);
     testDriverUnlock(driver);
 
     return ndevs;
@@ -5089,33 +5084,32 @@ testNodeListDevices(virConnectPtr conn,
                     unsigned int flags)
 {
     testConnPtr driver = conn->privateData;
-    int ndevs = 0;
-    unsigned int i;
+    int ndevs;
 
     virCheckFlags(0, -1);
 
     testDriverLock(driver);
-    for (i = 0; i < driver->devs.count && ndevs < maxnames; i++) {
-        virNodeDeviceObjLock(driver->devs.objs[i]);
-        if (cap == NULL ||
-            virNodeDeviceHasCap(driver->devs.objs[i], cap)) {
-            if ((names[ndevs++] = strdup(driver->devs.objs[i]->def->name)) == NULL) {
-                virNodeDeviceObjUnlock(driver->devs.objs[i]);
-                goto failure;
-            }
-        }
-        virNodeDeviceObjUnlock(driver->devs.objs[i]);
-    }
+    ndevs = virNodeDeviceObjListGetNames(&driver->devs, cap, names, maxnames);
     testDriverUnlock(driver);
 
     return ndevs;
+}
+
+static int
+testNodeListAllNodeDevices(virConnectPtr conn,
+                           virNodeDevicePtr **devices,
+                           unsigned int flags)
+{
+    testConnPtr driver = conn->privateData;
+    int ret;
+
+    virCheckFlags(VIR_CONNECT_LIST_NODE_DEVICES_FILTERS_CAP, -1);
 
- failure:
+    testDriverLock(driver);
+    ret = virNodeDeviceList(conn, &driver->devs, devices, flags);
     testDriverUnlock(driver);
-    --ndevs;
-    while (--ndevs >= 0)
-        VIR_FREE(names[ndevs]);
-    return -1;
+
+    return ret;
 }
 
 static virNodeDevicePtr
@@ -5660,6 +5654,7 @@ static virStorageDriver testStorageDriver = {
     .listPools = testStorageListPools, /* 0.5.0 */
     .numOfDefinedPools = testStorageNumDefinedPools, /* 0.5.0 */
     .listDefinedPools = testStorageListDefinedPools, /* 0.5.0 */
+    .listAllPools = testStorageListAllPools, /* 0.9.14 */
     .findPoolSources = testStorageFindPoolSources, /* 0.5.0 */
     .poolLookupByName = testStoragePoolLookupByName, /* 0.5.0 */
     .poolLookupByUUID = testStoragePoolLookupByUUID, /* 0.5.0 */
@@ -5678,6 +5673,7 @@ static virStorageDriver testStorageDriver = {
     .poolSetAutostart = testStoragePoolSetAutostart, /* 0.5.0 */
     .poolNumOfVolumes = testStoragePoolNumVolumes, /* 0.5.0 */
     .poolListVolumes = testStoragePoolListVolumes, /* 0.5.0 */
+    .poolListAllVolumes = testStoragePoolListAllVolumes, /* 0.9.14 */
 
     .volLookupByName = testStorageVolumeLookupByName, /* 0.5.0 */
     .volLookupByKey = testStorageVolumeLookupByKey, /* 0.5.0 */
@@ -5699,6 +5695,7 @@ static virDeviceMonitor testDevMonitor = {
 
     .numOfDevices = testNodeNumOfDevices, /* 0.7.2 */
     .listDevices = testNodeListDevices, /* 0.7.2 */
+    .listAllNodeDevices = testNodeListAllNodeDevices, /* 0.9.14 */
     .deviceLookupByName = testNodeDeviceLookupByName, /* 0.7.2 */
     .deviceGetXMLDesc = testNodeDeviceGetXMLDesc, /* 0.7.2 */
     .deviceGetParent = testNodeDeviceGetParent, /* 0.7.2 */
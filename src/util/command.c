@@ -21,6 +21,7 @@
 
 #include <config.h>
 
+#include <dirent.h>
 #include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
@@ -28,6 +29,9 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
 
 #if HAVE_CAPNG
 # include <cap-ng.h>
@@ -368,6 +372,199 @@ prepareStdFd(int fd, int std)
     return 0;
 }
 
+/*
+ * virExecGetOpenFDs:
+ * @fds: filled with a list of the descriptors open in this process
+ *
+ * Enumerate the open descriptors of the calling process above stderr
+ * from /proc/self/fd.  The descriptor used to read the directory is
+ * closed again before returning, so it may show up in @fds as a stale
+ * entry; callers must tolerate EBADF when closing.
+ *
+ * Returns the number of entries in @fds, or -1 if the list could not
+ * be obtained and the caller should fall back to probing every
+ * descriptor up to _SC_OPEN_MAX.
+ */
+# ifdef __linux__
+static int
+virExecGetOpenFDs(int **fds)
+{
+    DIR *dir;
+    struct dirent *ent;
+    size_t nfds = 0;
+    size_t maxfds = 0;
+    int fd;
+
+    *fds = NULL;
+
+    if (!(dir = opendir("/proc/self/fd")))
+        return -1;
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (virStrToLong_i(ent->d_name, NULL, 10, &fd) < 0 ||
+            fd <= STDERR_FILENO)
+            continue;
+
+        if (VIR_RESIZE_N(*fds, maxfds, nfds, 1) < 0) {
+            closedir(dir);
+            VIR_FREE(*fds);
+            return -1;
+        }
+        (*fds)[nfds++] = fd;
+    }
+
+    closedir(dir);
+    return nfds;
+}
+# else /* !__linux__ */
+static int
+virExecGetOpenFDs(int **fds)
+{
+    *fds = NULL;
+    return -1;
+}
+# endif /* !__linux__ */
+
+/*
+ * Close all descriptors from @first to @last inclusive in one call.
+ * Returns -1 with errno set to ENOSYS when the platform can't do it.
+ */
+# if HAVE_CLOSE_RANGE
+static int
+virExecCloseRange(unsigned int first, unsigned int last)
+{
+    return close_range(first, last, 0);
+}
+# elif defined(SYS_close_range)
+static int
+virExecCloseRange(unsigned int first, unsigned int last)
+{
+    return syscall(SYS_close_range, first, last, 0);
+}
+# else
+static int
+virExecCloseRange(unsigned int first ATTRIBUTE_UNUSED,
+                  unsigned int last ATTRIBUTE_UNUSED)
+{
+    errno = ENOSYS;
+    return -1;
+}
+# endif
+
+static int
+virExecCompareFD(const void *a, const void *b)
+{
+    int fda = *(const int *)a;
+    int fdb = *(const int *)b;
+
+    return fda < fdb ? -1 : fda > fdb;
+}
+
+/*
+ * virExecCloseFDs:
+ *
+ * In the child, close every descriptor above stderr except the stdio
+ * replacements and those listed in @keepfd, which are made inheritable,
+ * using close_range() for the gaps between them.
+ *
+ * Returns 0 on success, -1 on error, or -2 if close_range() is not
+ * supported and nothing was closed.
+ */
+static int
+virExecCloseFDs(int infd, int childout, int childerr,
+                const int *keepfd, int keepfd_size)
+{
+    int *keep = NULL;
+    size_t nkeep = 0;
+    unsigned int first = STDERR_FILENO + 1;
+    size_t i;
+    int ret = -1;
+
+    if (VIR_ALLOC_N(keep, keepfd_size + 3) < 0) {
+        virReportOOMError();
+        return -1;
+    }
+
+    keep[nkeep++] = infd;
+    keep[nkeep++] = childout;
+    keep[nkeep++] = childerr;
+    for (i = 0; keepfd && i < (size_t)keepfd_size; i++)
+        keep[nkeep++] = keepfd[i];
+
+    qsort(keep, nkeep, sizeof(*keep), virExecCompareFD);
+
+    for (i = 0; i < nkeep; i++) {
+        if (keep[i] < (int)first)
+            continue;
+
+        if (keep[i] > first &&
+            virExecCloseRange(first, keep[i] - 1) < 0)
+            goto close_error;
+        first = keep[i] + 1;
+    }
+
+    if (virExecCloseRange(first, ~0U) < 0)
+        goto close_error;
+
+    for (i = 0; keepfd && i < (size_t)keepfd_size; i++) {
+        if (keepfd[i] <= STDERR_FILENO ||
+            keepfd[i] == infd || keepfd[i] == childout ||
+            keepfd[i] == childerr)
+            continue;
+
+        /* Like the /proc/self/fd walk, skip descriptors that are
+         * listed but not open */
+        if (virSetInherit(keepfd[i], true) < 0 && errno != EBADF) {
+            virReportSystemError(errno, _("failed to preserve fd %d"),
+                                 keepfd[i]);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(keep);
+    return ret;
+
+close_error:
+    /* The first call fails if the kernel lacks close_range; the caller
+     * then falls back to closing descriptors one by one, which also
+     * finishes a partial job. */
+    if (errno == ENOSYS || errno == EINVAL)
+        ret = -2;
+    else
+        virReportSystemError(errno, "%s", _("failed to close descriptors"));
+    goto cleanup;
+}
+
+/*
+ * virExecPrepareFD:
+ *
+ * In the child, close @fd unless it is one of the stdio replacements
+ * or listed in @keepfd, in which case it is made inheritable.
+ */
+static int
+virExecPrepareFD(int fd,
+                 int infd, int childout, int childerr,
+                 const int *keepfd, int keepfd_size)
+{
+    int tmpfd;
+
+    if (fd == infd || fd == childout || fd == childerr)
+        return 0;
+
+    if (!keepfd || !virCommandFDIsSet(fd, keepfd, keepfd_size)) {
+        tmpfd = fd;
+        VIR_MASS_CLOSE(tmpfd);
+    } else if (virSetInherit(fd, true) < 0) {
+        virReportSystemError(errno, _("failed to preserve fd %d"), fd);
+        return -1;
+    }
+
+    return 0;
+}
+
 /*
  * @argv argv to exec
  * @envp optional environment to use for exec
@@ -410,6 +607,9 @@ virExecWithHook(const char *const*argv,
     int tmpfd;
     const char *binary = NULL;
     int forkRet;
+    int *openfds = NULL;
+    int nopenfds;
+    int closeRet;
 
     if (argv[0][0] != '/') {
         if (!(binary = virFindFileInPath(argv[0]))) {
@@ -518,18 +718,29 @@ virExecWithHook(const char *const*argv,
         goto fork_error;
     }
 
-    openmax = sysconf(_SC_OPEN_MAX);
-    for (i = 3; i < openmax; i++) {
-        if (i == infd || i == childout || i == childerr)
-            continue;
-        if (!keepfd || !virCommandFDIsSet(i, keepfd, keepfd_size)) {
-            tmpfd = i;
-            VIR_MASS_CLOSE(tmpfd);
-        } else if (virSetInherit(i, true) < 0) {
-            virReportSystemError(errno, _("failed to preserve fd %d"), i);
-            goto fork_error;
+    /* Only visit the descriptors that are really open when the kernel
+     * can tell us which ones those are; with a large RLIMIT_NOFILE the
+     * blind loop up to _SC_OPEN_MAX dominates the cost of spawning. */
+    if ((closeRet = virExecCloseFDs(infd, childout, childerr,
+                                    keepfd, keepfd_size)) == -1) {
+        goto fork_error;
+    } else if (closeRet == 0) {
+        /* all done by close_range() */
+    } else if ((nopenfds = virExecGetOpenFDs(&openfds)) >= 0) {
+        for (i = 0; i < nopenfds; i++) {
+            if (virExecPrepareFD(openfds[i], infd, childout, childerr,
+                                 keepfd, keepfd_size) < 0)
+                goto fork_error;
+        }
+    } else {
+        openmax = sysconf(_SC_OPEN_MAX);
+        for (i = 3; i < openmax; i++) {
+            if (virExecPrepareFD(i, infd, childout, childerr,
+                                 keepfd, keepfd_size) < 0)
+                goto fork_error;
         }
     }
+    VIR_FREE(openfds);
 
     if (prepareStdFd(infd, STDIN_FILENO) < 0) {
         virReportSystemError(errno,
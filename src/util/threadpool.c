@@ -25,20 +25,27 @@
 
 #include <config.h>
 
+#include <string.h>
+#include <sys/time.h>
+
 #include "threadpool.h"
 #include "memory.h"
 #include "threads.h"
 #include "virterror_internal.h"
+#include "logging.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+/* Lower bound on the number of job nodes kept around for reuse */
+#define VIR_THREAD_POOL_MIN_SPARE_JOBS 16
+
 typedef struct _virThreadPoolJob virThreadPoolJob;
 typedef virThreadPoolJob *virThreadPoolJobPtr;
 
 struct _virThreadPoolJob {
-    virThreadPoolJobPtr prev;
     virThreadPoolJobPtr next;
-    unsigned int priority;
+    unsigned long long seq;      /* Submission order */
+    unsigned long long queued;   /* Submission time in microseconds */
 
     void *data;
 };
@@ -49,7 +56,7 @@ typedef virThreadPoolJobList *virThreadPoolJobListPtr;
 struct _virThreadPoolJobList {
     virThreadPoolJobPtr head;
     virThreadPoolJobPtr tail;
-    virThreadPoolJobPtr firstPrio;
+    size_t count;
 };
 
 
@@ -59,7 +66,14 @@ struct _virThreadPool {
     virThreadPoolJobFunc jobFunc;
     void *jobOpaque;
     virThreadPoolJobList jobList;
+    virThreadPoolJobList prioJobList;
     size_t jobQueueDepth;
+    unsigned long long jobSeq;
+
+    /* Job nodes kept for reuse instead of allocating one per job */
+    virThreadPoolJobPtr spareJobs;
+    size_t nSpareJobs;
+    size_t maxSpareJobs;
 
     virMutex mutex;
     virCond cond;
@@ -71,8 +85,14 @@ struct _virThreadPool {
     virThreadPtr workers;
 
     size_t nPrioWorkers;
+    size_t freePrioWorkers;
     virThreadPtr prioWorkers;
     virCond prioCond;
+
+    unsigned long long jobsQueued;
+    unsigned long long jobsDone;
+    unsigned long long waitTime[VIR_THREAD_POOL_HISTOGRAM_BUCKETS];
+    unsigned long long serviceTime[VIR_THREAD_POOL_HISTOGRAM_BUCKETS];
 };
 
 struct virThreadPoolWorkerData {
@@ -81,6 +101,138 @@ struct virThreadPoolWorkerData {
     bool priority;
 };
 
+
+static unsigned long long virThreadPoolNow(void)
+{
+    struct timeval tv;
+
+    if (gettimeofday(&tv, NULL) < 0)
+        return 0;
+
+    return (tv.tv_sec * 1000000ull) + tv.tv_usec;
+}
+
+
+/* Bucket i counts durations below 2^i microseconds, the last
+ * bucket also counts everything longer */
+static void virThreadPoolHistogramAdd(unsigned long long *histogram,
+                                      unsigned long long start,
+                                      unsigned long long end)
+{
+    unsigned long long duration = end > start ? end - start : 0;
+    size_t i = 0;
+
+    while (i < (VIR_THREAD_POOL_HISTOGRAM_BUCKETS - 1) &&
+           duration >= (1ull << i))
+        i++;
+
+    histogram[i]++;
+}
+
+
+/* Log the non-empty buckets of a histogram, one line per bucket */
+static void virThreadPoolHistogramDebug(virThreadPoolPtr pool,
+                                        const char *what,
+                                        const unsigned long long *histogram)
+{
+    size_t i;
+
+    for (i = 0 ; i < VIR_THREAD_POOL_HISTOGRAM_BUCKETS ; i++) {
+        if (!histogram[i])
+            continue;
+        if (i < VIR_THREAD_POOL_HISTOGRAM_BUCKETS - 1)
+            VIR_DEBUG("pool=%p %s < %llu us: %llu jobs",
+                      pool, what, 1ull << i, histogram[i]);
+        else
+            VIR_DEBUG("pool=%p %s >= %llu us: %llu jobs",
+                      pool, what, 1ull << (i - 1), histogram[i]);
+    }
+}
+
+
+static void virThreadPoolJobListPush(virThreadPoolJobListPtr list,
+                                     virThreadPoolJobPtr job)
+{
+    job->next = NULL;
+    if (list->tail)
+        list->tail->next = job;
+    else
+        list->head = job;
+    list->tail = job;
+    list->count++;
+}
+
+
+static virThreadPoolJobPtr
+virThreadPoolJobListPop(virThreadPoolJobListPtr list)
+{
+    virThreadPoolJobPtr job = list->head;
+
+    if (!job)
+        return NULL;
+
+    list->head = job->next;
+    if (!list->head)
+        list->tail = NULL;
+    list->count--;
+    job->next = NULL;
+    return job;
+}
+
+
+/*
+ * Regular workers serve both queues in submission order, priority
+ * workers only serve the priority queue. Either way this is O(1).
+ */
+static virThreadPoolJobPtr virThreadPoolNextJob(virThreadPoolPtr pool,
+                                                bool priority)
+{
+    virThreadPoolJobListPtr list = &pool->prioJobList;
+
+    if (!priority &&
+        pool->jobList.head &&
+        (!pool->prioJobList.head ||
+         pool->jobList.head->seq < pool->prioJobList.head->seq))
+        list = &pool->jobList;
+
+    return virThreadPoolJobListPop(list);
+}
+
+
+static virThreadPoolJobPtr virThreadPoolJobAlloc(virThreadPoolPtr pool)
+{
+    virThreadPoolJobPtr job;
+
+    if ((job = pool->spareJobs)) {
+        pool->spareJobs = job->next;
+        pool->nSpareJobs--;
+        job->next = NULL;
+        return job;
+    }
+
+    if (VIR_ALLOC(job) < 0) {
+        virReportOOMError();
+        return NULL;
+    }
+    return job;
+}
+
+
+static void virThreadPoolJobRelease(virThreadPoolPtr pool,
+                                    virThreadPoolJobPtr job)
+{
+    if (pool->nSpareJobs >= pool->maxSpareJobs) {
+        VIR_FREE(job);
+        return;
+    }
+
+    job->data = NULL;
+    job->next = pool->spareJobs;
+    pool->spareJobs = job;
+    pool->nSpareJobs++;
+}
+
+
 static void virThreadPoolWorker(void *opaque)
 {
     struct virThreadPoolWorkerData *data = opaque;
@@ -88,6 +240,7 @@ static void virThreadPoolWorker(void *opaque)
     virCondPtr cond = data->cond;
     bool priority = data->priority;
     virThreadPoolJobPtr job = NULL;
+    unsigned long long start;
 
     VIR_FREE(data);
 
@@ -95,57 +248,38 @@ static void virThreadPoolWorker(void *opaque)
 
     while (1) {
         while (!pool->quit &&
-               ((!priority && !pool->jobList.head) ||
-                (priority && !pool->jobList.firstPrio))) {
-            if (!priority)
-                pool->freeWorkers++;
+               !(job = virThreadPoolNextJob(pool, priority))) {
+            size_t *freeWorkers = priority ? &pool->freePrioWorkers :
+                                             &pool->freeWorkers;
+            (*freeWorkers)++;
             if (virCondWait(cond, &pool->mutex) < 0) {
-                if (!priority)
-                    pool->freeWorkers--;
+                (*freeWorkers)--;
                 goto out;
             }
-            if (!priority)
-                pool->freeWorkers--;
+            (*freeWorkers)--;
         }
 
         if (pool->quit)
             break;
 
-        if (priority) {
-            job = pool->jobList.firstPrio;
-        } else {
-            job = pool->jobList.head;
-        }
-
-        if (job == pool->jobList.firstPrio) {
-            virThreadPoolJobPtr tmp = job->next;
-            while (tmp) {
-                if (tmp->priority) {
-                    break;
-                }
-                tmp = tmp->next;
-            }
-            pool->jobList.firstPrio = tmp;
-        }
-
-        if (job->prev)
-            job->prev->next = job->next;
-        else
-            pool->jobList.head = job->next;
-        if (job->next)
-            job->next->prev = job->prev;
-        else
-            pool->jobList.tail = job->prev;
-
         pool->jobQueueDepth--;
+        start = virThreadPoolNow();
+        virThreadPoolHistogramAdd(pool->waitTime, job->queued, start);
 
         virMutexUnlock(&pool->mutex);
         (pool->jobFunc)(job->data, pool->jobOpaque);
-        VIR_FREE(job);
         virMutexLock(&pool->mutex);
+
+        virThreadPoolHistogramAdd(pool->serviceTime, start,
+                                  virThreadPoolNow());
+        pool->jobsDone++;
+        virThreadPoolJobRelease(pool, job);
+        job = NULL;
     }
 
 out:
+    if (job)
+        virThreadPoolJobRelease(pool, job);
     if (priority)
         pool->nPrioWorkers--;
     else
@@ -173,8 +307,6 @@ virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
         return NULL;
     }
 
-    pool->jobList.tail = pool->jobList.head = NULL;
-
     pool->jobFunc = func;
     pool->jobOpaque = opaque;
 
@@ -185,6 +317,20 @@ virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
     if (virCondInit(&pool->quit_cond) < 0)
         goto error;
 
+    /* Enough job nodes for every worker to have one in flight and
+     * one queued, so a busy pool doesn't allocate per job */
+    pool->maxSpareJobs = 2 * (maxWorkers + prioWorkers);
+    if (pool->maxSpareJobs < VIR_THREAD_POOL_MIN_SPARE_JOBS)
+        pool->maxSpareJobs = VIR_THREAD_POOL_MIN_SPARE_JOBS;
+    for (i = 0; i < pool->maxSpareJobs; i++) {
+        virThreadPoolJobPtr job;
+        if (VIR_ALLOC(job) < 0) {
+            virReportOOMError();
+            goto error;
+        }
+        virThreadPoolJobRelease(pool, job);
+    }
+
     if (VIR_ALLOC_N(pool->workers, minWorkers) < 0)
         goto error;
 
@@ -260,8 +406,17 @@ void virThreadPoolFree(virThreadPoolPtr pool)
     while (pool->nWorkers > 0 || pool->nPrioWorkers > 0)
         ignore_value(virCondWait(&pool->quit_cond, &pool->mutex));
 
-    while ((job = pool->jobList.head)) {
-        pool->jobList.head = pool->jobList.head->next;
+    VIR_DEBUG("pool=%p queued %llu jobs, ran %llu",
+              pool, pool->jobsQueued, pool->jobsDone);
+    virThreadPoolHistogramDebug(pool, "wait time", pool->waitTime);
+    virThreadPoolHistogramDebug(pool, "service time", pool->serviceTime);
+
+    while ((job = virThreadPoolJobListPop(&pool->jobList)))
+        VIR_FREE(job);
+    while ((job = virThreadPoolJobListPop(&pool->prioJobList)))
+        VIR_FREE(job);
+    while ((job = pool->spareJobs)) {
+        pool->spareJobs = job->next;
         VIR_FREE(job);
     }
 
@@ -292,7 +447,7 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
     if (pool->quit)
         goto error;
 
-    if (pool->freeWorkers - pool->jobQueueDepth <= 0 &&
+    if (pool->freeWorkers <= pool->jobQueueDepth &&
         pool->nWorkers < pool->maxWorkers) {
         if (VIR_EXPAND_N(pool->workers, pool->nWorkers, 1) < 0) {
             virReportOOMError();
@@ -318,30 +473,27 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
         }
     }
 
-    if (VIR_ALLOC(job) < 0) {
-        virReportOOMError();
+    if (!(job = virThreadPoolJobAlloc(pool)))
         goto error;
-    }
 
     job->data = jobData;
-    job->priority = priority;
-
-    job->prev = pool->jobList.tail;
-    if (pool->jobList.tail)
-        pool->jobList.tail->next = job;
-    pool->jobList.tail = job;
-
-    if (!pool->jobList.head)
-        pool->jobList.head = job;
+    job->seq = pool->jobSeq++;
+    job->queued = virThreadPoolNow();
 
-    if (priority && !pool->jobList.firstPrio)
-        pool->jobList.firstPrio = job;
+    if (priority)
+        virThreadPoolJobListPush(&pool->prioJobList, job);
+    else
+        virThreadPoolJobListPush(&pool->jobList, job);
 
     pool->jobQueueDepth++;
+    pool->jobsQueued++;
 
-    virCondSignal(&pool->cond);
-    if (priority)
+    /* Only wake up a thread which can actually be waiting, preferring
+     * a priority worker for priority jobs */
+    if (priority && pool->freePrioWorkers)
         virCondSignal(&pool->prioCond);
+    else if (pool->freeWorkers)
+        virCondSignal(&pool->cond);
 
     virMutexUnlock(&pool->mutex);
     return 0;
@@ -350,3 +502,27 @@ error:
     virMutexUnlock(&pool->mutex);
     return -1;
 }
+
+/*
+ * Fill @stats with a snapshot of the pool's counters, for
+ * monitoring purposes.
+ */
+void virThreadPoolGetStats(virThreadPoolPtr pool,
+                           virThreadPoolStatsPtr stats)
+{
+    virMutexLock(&pool->mutex);
+
+    stats->nWorkers = pool->nWorkers;
+    stats->freeWorkers = pool->freeWorkers;
+    stats->nPrioWorkers = pool->nPrioWorkers;
+    stats->freePrioWorkers = pool->freePrioWorkers;
+    stats->jobQueueDepth = pool->jobList.count;
+    stats->prioJobQueueDepth = pool->prioJobList.count;
+    stats->jobsQueued = pool->jobsQueued;
+    stats->jobsDone = pool->jobsDone;
+    memcpy(stats->waitTime, pool->waitTime, sizeof(stats->waitTime));
+    memcpy(stats->serviceTime, pool->serviceTime,
+           sizeof(stats->serviceTime));
+
+    virMutexUnlock(&pool->mutex);
+}
@@ -33,6 +33,26 @@ typedef virThreadPool *virThreadPoolPtr;
 
 typedef void (*virThreadPoolJobFunc)(void *jobdata, void *opaque);
 
+# define VIR_THREAD_POOL_HISTOGRAM_BUCKETS 24
+
+typedef struct _virThreadPoolStats virThreadPoolStats;
+typedef virThreadPoolStats *virThreadPoolStatsPtr;
+struct _virThreadPoolStats {
+    size_t nWorkers;
+    size_t freeWorkers;
+    size_t nPrioWorkers;
+    size_t freePrioWorkers;
+    size_t jobQueueDepth;
+    size_t prioJobQueueDepth;
+    unsigned long long jobsQueued;
+    unsigned long long jobsDone;
+
+    /* Time jobs spent queued and running. Bucket i counts durations
+     * below 2^i microseconds, the last one also counts any longer */
+    unsigned long long waitTime[VIR_THREAD_POOL_HISTOGRAM_BUCKETS];
+    unsigned long long serviceTime[VIR_THREAD_POOL_HISTOGRAM_BUCKETS];
+};
+
 virThreadPoolPtr virThreadPoolNew(size_t minWorkers,
                                   size_t maxWorkers,
                                   size_t prioWorkers,
@@ -46,4 +66,8 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
                          void *jobdata) ATTRIBUTE_NONNULL(1)
                                         ATTRIBUTE_RETURN_CHECK;
 
+void virThreadPoolGetStats(virThreadPoolPtr pool,
+                           virThreadPoolStatsPtr stats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 #endif
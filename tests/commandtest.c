@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 
 #include "testutils.h"
@@ -825,6 +826,75 @@ cleanup:
     return ret;
 }
 
+/*
+ * Run program, no args, inherit all ENV, keep CWD.
+ * Descriptors leaked by the parent, including ones far above the
+ * others, must be closed in the child; a preserved descriptor placed
+ * between them must stay open.
+ */
+static int test21(const void *unused ATTRIBUTE_UNUSED)
+{
+    virCommandPtr cmd = virCommandNew(abs_builddir "/commandhelper");
+    int leakfd1 = dup(STDERR_FILENO);
+    int keepfd = dup2(STDERR_FILENO, 100);
+    int leakfd2 = dup2(STDERR_FILENO, 150);
+    int ret = -1;
+
+    if (leakfd1 < 0 || keepfd != 100 || leakfd2 != 150) {
+        puts("cannot set up descriptors");
+        goto cleanup;
+    }
+
+    virCommandPreserveFD(cmd, keepfd);
+
+    if (virCommandRun(cmd, NULL) < 0) {
+        virErrorPtr err = virGetLastError();
+        printf("Cannot run child %s\n", err->message);
+        goto cleanup;
+    }
+
+    ret = checkoutput("test21");
+
+cleanup:
+    virCommandFree(cmd);
+    VIR_FORCE_CLOSE(leakfd1);
+    VIR_FORCE_CLOSE(keepfd);
+    VIR_FORCE_CLOSE(leakfd2);
+    return ret;
+}
+
+/*
+ * Spawn latency benchmark: run a short-lived child with the
+ * descriptor limit raised as far as allowed, where closing every
+ * possible descriptor in the child used to dominate the cost.  Run
+ * in many loops so virtTestRun reports the average spawn time.
+ * Only run when VIR_TEST_EXPENSIVE is set.
+ */
+static int test22(const void *unused ATTRIBUTE_UNUSED)
+{
+    struct rlimit rlim, oldrlim;
+    virCommandPtr cmd = NULL;
+    int status;
+    int ret = -1;
+
+    if (getrlimit(RLIMIT_NOFILE, &oldrlim) < 0)
+        return -1;
+    rlim = oldrlim;
+    rlim.rlim_cur = rlim.rlim_max;
+    ignore_value(setrlimit(RLIMIT_NOFILE, &rlim));
+
+    cmd = virCommandNew("/bin/true");
+    if (virCommandRun(cmd, &status) < 0 || status != 0)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virCommandFree(cmd);
+    ignore_value(setrlimit(RLIMIT_NOFILE, &oldrlim));
+    return ret;
+}
+
 static const char *const newenv[] = {
     "PATH=/usr/bin:/bin",
     "HOSTNAME=test",
@@ -910,6 +980,10 @@ mymain(void)
     DO_TEST(test18);
     DO_TEST(test19);
     DO_TEST(test20);
+    DO_TEST(test21);
+    if (virTestGetExpensive() &&
+        virtTestRun("Command Exec test22 test", 1000, test22, NULL) < 0)
+        ret = -1;
 
     return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,150 @@
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_QEMU
+
+# include "internal.h"
+# include "testutils.h"
+# include "memory.h"
+# include "qemu/qemu_domain.h"
+# include "testutilsqemu.h"
+
+static virCapsPtr caps;
+static virDomainDefPtr def;
+
+struct testInfo {
+    const char *xml;
+    const int *types;           /* expected device types */
+    int ndevs;                  /* -1 if parsing should fail */
+};
+
+static int
+testParseList(const void *opaque)
+{
+    const struct testInfo *info = opaque;
+    virDomainDeviceDefPtr *devs = NULL;
+    int ndevs;
+    int ret = -1;
+    int i;
+
+    ndevs = virDomainDeviceDefParseList(caps, def, info->xml,
+                                        VIR_DOMAIN_XML_INACTIVE, &devs);
+
+    if (ndevs != info->ndevs) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected %d devices, got %d\n",
+                    info->ndevs, ndevs);
+        goto cleanup;
+    }
+
+    if (ndevs < 0) {
+        if (devs) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "device list set on failure\n");
+            goto cleanup;
+        }
+        ret = 0;
+        goto cleanup;
+    }
+
+    for (i = 0 ; i < ndevs ; i++) {
+        if (devs[i]->type != info->types[i]) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "device %d: expected type %d, got %d\n",
+                        i, info->types[i], devs[i]->type);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+cleanup:
+    if (ndevs > 0) {
+        for (i = 0 ; i < ndevs ; i++)
+            virDomainDeviceDefFree(devs[i]);
+    }
+    VIR_FREE(devs);
+    return ret;
+}
+
+
+# define DISK_XML \
+    "<disk type='file' device='disk'>" \
+    "  <source file='/var/lib/libvirt/images/extra.img'/>" \
+    "  <target dev='vdb' bus='virtio'/>" \
+    "</disk>"
+
+# define NET_XML \
+    "<interface type='user'>" \
+    "  <mac address='52:54:00:8b:12:34'/>" \
+    "  <model type='virtio'/>" \
+    "</interface>"
+
+# define WATCHDOG_XML \
+    "<watchdog model='i6300esb' action='reset'/>"
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    char *path = NULL;
+
+    if (!(caps = testQemuCapsInit()))
+        return EXIT_FAILURE;
+
+    if (virAsprintf(&path, "%s/qemuxml2argvdata/qemuxml2argv-minimal.xml",
+                    abs_srcdir) < 0 ||
+        !(def = virDomainDefParseFile(caps, path,
+                                      QEMU_EXPECTED_VIRT_TYPES,
+                                      VIR_DOMAIN_XML_INACTIVE))) {
+        ret = -1;
+        goto cleanup;
+    }
+
+# define DO_TEST(name, xml, ndevs, ...)                                   \
+    do {                                                                  \
+        static const int types[] = { __VA_ARGS__ };                       \
+        const struct testInfo info = { xml, types, ndevs };               \
+        if (virtTestRun("Device list " name, 1, testParseList, &info) < 0)\
+            ret = -1;                                                     \
+    } while (0)
+
+    DO_TEST("single disk", DISK_XML, 1, VIR_DOMAIN_DEVICE_DISK);
+    DO_TEST("single in list", "<devices>" NET_XML "</devices>", 1,
+            VIR_DOMAIN_DEVICE_NET);
+    DO_TEST("several",
+            "<devices>" DISK_XML NET_XML WATCHDOG_XML "</devices>", 3,
+            VIR_DOMAIN_DEVICE_DISK, VIR_DOMAIN_DEVICE_NET,
+            VIR_DOMAIN_DEVICE_WATCHDOG);
+    DO_TEST("empty", "<devices/>", -1, 0);
+    DO_TEST("empty with text", "<devices>\n  \n</devices>", -1, 0);
+    DO_TEST("unknown in the middle",
+            "<devices>" DISK_XML "<bogus/>" WATCHDOG_XML "</devices>", -1, 0);
+    DO_TEST("bad disk in the middle",
+            "<devices>" NET_XML "<disk type='file'/>" WATCHDOG_XML
+            "</devices>", -1, 0);
+    DO_TEST("bad device", "<watchdog model='bogus'/>", -1, 0);
+
+cleanup:
+    VIR_FREE(path);
+    virDomainDefFree(def);
+    virCapabilitiesFree(caps);
+
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
+
+#else
+# include "testutils.h"
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WITH_QEMU */
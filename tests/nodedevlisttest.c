@@ -0,0 +1,172 @@
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+#include "testutils.h"
+#include "memory.h"
+#include "util.h"
+
+static virConnectPtr conn;
+
+struct testListData {
+    const char *cap;            /* for virNodeListDevices */
+    unsigned int flags;         /* for virConnectListAllNodeDevices */
+    const char *const *names;   /* expected result, NULL terminated */
+};
+
+static int
+testCheckNames(const char *const *expect,
+               const char *const *actual,
+               int nactual)
+{
+    int nexpect = 0;
+    int i;
+
+    while (expect[nexpect])
+        nexpect++;
+
+    if (nexpect != nactual) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected %d devices, got %d\n",
+                    nexpect, nactual);
+        return -1;
+    }
+
+    for (i = 0 ; i < nactual ; i++) {
+        if (STRNEQ(expect[i], actual[i])) {
+            if (virTestGetVerbose())
+                fprintf(stderr, "device %d: expected %s, got %s\n",
+                        i, expect[i], actual[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+testListAll(const void *opaque)
+{
+    const struct testListData *data = opaque;
+    virNodeDevicePtr *devices = NULL;
+    const char **names = NULL;
+    int ndevices;
+    int ret = -1;
+    int i;
+
+    if ((ndevices = virConnectListAllNodeDevices(conn, &devices,
+                                                 data->flags)) < 0)
+        goto cleanup;
+
+    if (virConnectListAllNodeDevices(conn, NULL, data->flags) != ndevices) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "device count differs from the listing\n");
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(names, ndevices + 1) < 0)
+        goto cleanup;
+    for (i = 0 ; i < ndevices ; i++)
+        names[i] = virNodeDeviceGetName(devices[i]);
+
+    ret = testCheckNames(data->names, names, ndevices);
+
+cleanup:
+    if (devices) {
+        for (i = 0 ; i < ndevices ; i++)
+            virNodeDeviceFree(devices[i]);
+    }
+    VIR_FREE(devices);
+    VIR_FREE(names);
+    return ret;
+}
+
+static int
+testListByCap(const void *opaque)
+{
+    const struct testListData *data = opaque;
+    char *names[10];
+    int ndevices;
+    int ret = -1;
+    int i;
+
+    if ((ndevices = virNodeListDevices(conn, data->cap, names,
+                                       ARRAY_CARDINALITY(names), 0)) < 0)
+        return -1;
+
+    if (virNodeNumOfDevices(conn, data->cap, 0) != ndevices) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "device count differs from the listing\n");
+        goto cleanup;
+    }
+
+    ret = testCheckNames(data->names, (const char *const *)names, ndevices);
+
+cleanup:
+    for (i = 0 ; i < ndevices ; i++)
+        VIR_FREE(names[i]);
+    return ret;
+}
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    char *uri = NULL;
+
+    if (virAsprintf(&uri, "test://%s/nodedevlistdata/node.xml",
+                    abs_srcdir) < 0)
+        return EXIT_FAILURE;
+
+    if (!(conn = virConnectOpen(uri))) {
+        VIR_FREE(uri);
+        return EXIT_FAILURE;
+    }
+    VIR_FREE(uri);
+
+#define DO_TEST_FULL(name, func, cap, flags, ...)                         \
+    do {                                                                  \
+        static const char *const expect[] = { __VA_ARGS__, NULL };        \
+        struct testListData data = { cap, flags, expect };                \
+        if (virtTestRun("Node device list " name, 1, func, &data) < 0)    \
+            ret = -1;                                                     \
+    } while (0)
+
+#define DO_TEST_ALL(name, flags, ...) \
+    DO_TEST_FULL(name, testListAll, NULL, flags, __VA_ARGS__)
+
+#define DO_TEST_CAP(cap, ...) \
+    DO_TEST_FULL(cap, testListByCap, cap, 0, __VA_ARGS__)
+
+    DO_TEST_ALL("all", 0,
+                "computer", "usb_device_1d6b_1_0000_00_1d_0",
+                "pci_1002_71c4", "net_00_13_02_b9_f9_d3",
+                "pci_8086_27c8");
+    DO_TEST_ALL("pci", VIR_CONNECT_LIST_NODE_DEVICES_CAP_PCI_DEV,
+                "pci_1002_71c4", "pci_8086_27c8");
+    /* pci_8086_27c8 has both capabilities and is listed once */
+    DO_TEST_ALL("pci+usb",
+                VIR_CONNECT_LIST_NODE_DEVICES_CAP_PCI_DEV |
+                VIR_CONNECT_LIST_NODE_DEVICES_CAP_USB_DEV,
+                "usb_device_1d6b_1_0000_00_1d_0", "pci_1002_71c4",
+                "pci_8086_27c8");
+    DO_TEST_ALL("system+net",
+                VIR_CONNECT_LIST_NODE_DEVICES_CAP_SYSTEM |
+                VIR_CONNECT_LIST_NODE_DEVICES_CAP_NET,
+                "computer", "net_00_13_02_b9_f9_d3");
+    DO_TEST_ALL("scsi", VIR_CONNECT_LIST_NODE_DEVICES_CAP_SCSI, NULL);
+
+    DO_TEST_CAP("usb_device",
+                "usb_device_1d6b_1_0000_00_1d_0", "pci_8086_27c8");
+    DO_TEST_CAP("pci", "pci_1002_71c4", "pci_8086_27c8");
+    DO_TEST_CAP("storage", NULL);
+
+    virConnectClose(conn);
+
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
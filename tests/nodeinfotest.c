@@ -28,6 +28,13 @@ main(void)
 extern int linuxNodeInfoCPUPopulate(FILE *cpuinfo,
                                     char *sysfs_dir,
                                     virNodeInfoPtr nodeinfo);
+extern int linuxNodeInfoCPUPopulateCached(const char *cpuinfo_path,
+                                          const char *sysfs_dir,
+                                          virNodeInfoPtr nodeinfo);
+extern int linuxNodeGetCellsFreeMemory(const char *sysfs_dir,
+                                       unsigned long long *freeMems,
+                                       int startCell,
+                                       int maxCells);
 
 static int
 linuxTestCompareFiles(const char *cpuinfofile,
@@ -117,6 +124,93 @@ cleanup:
 }
 
 
+/*
+ * Once the topology of a host was parsed, further lookups must be
+ * answered from the cache without reading /proc/cpuinfo again.
+ */
+static int
+linuxTestNodeInfoCached(const void *data)
+{
+    int ret = -1;
+    char *cpuinfo = NULL;
+    char *sysfs_dir = NULL;
+    const char *test = data;
+    const char *arch = "x86";
+    virNodeInfo expect, actual;
+    size_t nlookups = 10;
+    size_t i;
+
+# if defined(__powerpc__) || \
+     defined(__powerpc64__)
+    arch = "ppc";
+# endif
+
+    if (virAsprintf(&sysfs_dir, "%s/nodeinfodata/linux-%s",
+                    abs_srcdir, test) < 0 ||
+        virAsprintf(&cpuinfo, "%s/nodeinfodata/linux-%s-%s.cpuinfo",
+                    abs_srcdir, arch, test) < 0)
+        goto cleanup;
+
+    memset(&expect, 0, sizeof(expect));
+    if (linuxNodeInfoCPUPopulateCached(cpuinfo, sysfs_dir, &expect) < 0)
+        goto cleanup;
+
+    for (i = 0 ; i < nlookups ; i++) {
+        memset(&actual, 0, sizeof(actual));
+        if (linuxNodeInfoCPUPopulateCached("/nonexistent/cpuinfo",
+                                           sysfs_dir, &actual) < 0)
+            goto cleanup;
+        if (memcmp(&expect, &actual, sizeof(expect)) != 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(cpuinfo);
+    VIR_FREE(sysfs_dir);
+    return ret;
+}
+
+
+static int
+linuxTestCellsFreeMemory(const void *data ATTRIBUTE_UNUSED)
+{
+    int ret = -1;
+    char *sysfs_dir = NULL;
+    unsigned long long freeMems[8];
+    const unsigned long long expect[] = {
+        64350240ull * 1024, 65372380ull * 1024, 64730416ull * 1024,
+    };
+    int ncells;
+    size_t i;
+
+    if (virAsprintf(&sysfs_dir, "%s/nodeinfodata/linux-test3",
+                    abs_srcdir) < 0)
+        goto cleanup;
+
+    if ((ncells = linuxNodeGetCellsFreeMemory(sysfs_dir, freeMems,
+                                              2, 3)) != 3)
+        goto cleanup;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(expect) ; i++) {
+        if (freeMems[i] != expect[i])
+            goto cleanup;
+    }
+
+    /* Only cells 6 and 7 exist from the start cell on */
+    if (linuxNodeGetCellsFreeMemory(sysfs_dir, freeMems, 6, 8) != 2 ||
+        linuxNodeGetCellsFreeMemory(sysfs_dir, freeMems, 8, 1) != -1)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(sysfs_dir);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -141,6 +235,19 @@ mymain(void)
       if (virtTestRun(nodeData[i], 1, linuxTestNodeInfo, nodeData[i]) != 0)
         ret = -1;
 
+    for (i = 0 ; i < ARRAY_CARDINALITY(nodeData); i++) {
+        char *name;
+
+        if (virAsprintf(&name, "%s cached", nodeData[i]) < 0)
+            return EXIT_FAILURE;
+        if (virtTestRun(name, 1, linuxTestNodeInfoCached, nodeData[i]) != 0)
+            ret = -1;
+        VIR_FREE(name);
+    }
+
+    if (virtTestRun("cells free memory", 1, linuxTestCellsFreeMemory, NULL) != 0)
+        ret = -1;
+
     return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
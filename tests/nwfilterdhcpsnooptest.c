@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library;  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_LIBPCAP
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <arpa/inet.h>
+
+# include "testutils.h"
+# include "memory.h"
+# include "util.h"
+# include "nwfilter/nwfilter_dhcpsnooppriv.h"
+
+# define TEST_PKT_SIZE      576
+
+# define TEST_ETH_HLEN      14
+# define TEST_IP_HLEN       20
+# define TEST_UDP_HLEN      8
+# define TEST_DHCP_OFFSET   (TEST_ETH_HLEN + TEST_IP_HLEN + TEST_UDP_HLEN)
+# define TEST_DHCP_YIADDR   (TEST_DHCP_OFFSET + 16)
+# define TEST_DHCP_SIADDR   (TEST_DHCP_OFFSET + 20)
+# define TEST_DHCP_OPTIONS  (TEST_DHCP_OFFSET + 236)
+
+# define DHCPOFFER          2
+
+struct testFrame {
+    const char *name;
+    uint16_t ethertype;
+    uint8_t mtype;
+    uint32_t leasetime;         /* 0 to leave the option out */
+    bool fromVM;
+    bool badMagic;
+    int truncate;               /* cut the frame to this length if > 0 */
+    int expect;                 /* return value of the parser */
+};
+
+static const char *yiaddr = "192.168.122.50";
+static const char *siaddr = "192.168.122.1";
+
+/*
+ * Build an Ethernet/IPv4/UDP frame carrying a DHCP message with
+ * the given type and lease time, and return its length.
+ */
+static int
+testBuildFrame(const struct testFrame *frame,
+               unsigned char *buf)
+{
+    uint16_t ethertype = htons(frame->ethertype);
+    uint32_t leasetime = htonl(frame->leasetime);
+    static const unsigned char magic[4] = { 99, 130, 83, 99 };
+    int len = TEST_DHCP_OPTIONS;
+
+    memset(buf, 0, TEST_PKT_SIZE);
+
+    memcpy(buf + 12, &ethertype, sizeof(ethertype));
+
+    buf[TEST_ETH_HLEN] = 0x45;          /* IPv4, 20 byte header */
+    buf[TEST_ETH_HLEN + 9] = 17;        /* UDP */
+
+    buf[TEST_ETH_HLEN + TEST_IP_HLEN + 1] = 67;
+    buf[TEST_ETH_HLEN + TEST_IP_HLEN + 3] = 68;
+
+    buf[TEST_DHCP_OFFSET] = 2;          /* BOOTREPLY */
+    if (inet_pton(AF_INET, yiaddr, buf + TEST_DHCP_YIADDR) != 1 ||
+        inet_pton(AF_INET, siaddr, buf + TEST_DHCP_SIADDR) != 1)
+        return -1;
+
+    memcpy(buf + len, magic, sizeof(magic));
+    if (frame->badMagic)
+        buf[len] = 0;
+    len += sizeof(magic);
+
+    buf[len++] = 53;                    /* message type */
+    buf[len++] = 1;
+    buf[len++] = frame->mtype;
+
+    if (frame->leasetime) {
+        buf[len++] = 51;                /* lease time */
+        buf[len++] = 4;
+        memcpy(buf + len, &leasetime, sizeof(leasetime));
+        len += sizeof(leasetime);
+    }
+
+    buf[len++] = 0;                     /* pad */
+    buf[len++] = 255;                   /* end */
+
+    if (frame->truncate > 0)
+        len = frame->truncate;
+
+    return len;
+}
+
+static int
+testCheckAddr(virSocketAddrPtr addr, const char *expect)
+{
+    char *str = virSocketAddrFormat(addr);
+    int ret = -1;
+
+    if (!str)
+        return -1;
+
+    if (STRNEQ(str, expect)) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected address %s, got %s\n", expect, str);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(str);
+    return ret;
+}
+
+static int
+testParseFrame(const void *opaque)
+{
+    const struct testFrame *frame = opaque;
+    unsigned char buf[TEST_PKT_SIZE];
+    virNWFilterSnoopDHCPMsg msg;
+    int len;
+    int ret;
+
+    if ((len = testBuildFrame(frame, buf)) < 0)
+        return -1;
+
+    ret = virNWFilterSnoopDHCPParse(buf, len, frame->fromVM, &msg);
+    if (ret != frame->expect) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected %d, got %d\n", frame->expect, ret);
+        return -1;
+    }
+
+    if (ret < 0)
+        return 0;
+
+    if (msg.mtype != frame->mtype) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected message type %u, got %u\n",
+                    frame->mtype, msg.mtype);
+        return -1;
+    }
+
+    if (msg.leasetime != frame->leasetime) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected lease time %u, got %u\n",
+                    frame->leasetime, msg.leasetime);
+        return -1;
+    }
+
+    if (testCheckAddr(&msg.ipAddress, yiaddr) < 0 ||
+        testCheckAddr(&msg.ipServer, siaddr) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+struct testReplayData {
+    unsigned char (*frames)[TEST_PKT_SIZE];
+    int *lens;
+    const struct testFrame *info;
+    size_t nframes;
+    size_t nvalid;
+};
+
+/*
+ * Replay the whole capture through the decoder a number of times.
+ * virtTestRun reports how long each round took in verbose mode.
+ */
+static int
+testReplay(const void *opaque)
+{
+    const struct testReplayData *data = opaque;
+    virNWFilterSnoopDHCPMsg msg;
+    size_t nvalid = 0;
+    size_t i, j;
+
+    for (i = 0 ; i < 10000 ; i++) {
+        for (j = 0 ; j < data->nframes ; j++) {
+            if (virNWFilterSnoopDHCPParse(data->frames[j], data->lens[j],
+                                          data->info[j].fromVM, &msg) == 0)
+                nvalid++;
+        }
+    }
+
+    if (nvalid != 10000 * data->nvalid) {
+        if (virTestGetVerbose())
+            fprintf(stderr, "expected %zu valid messages, got %zu\n",
+                    10000 * data->nvalid, nvalid);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static const struct testFrame frames[] = {
+    { "ACK to VM", 0x0800, DHCPACK, 3600, false, false, 0, 0 },
+    { "ACK infinite lease", 0x0800, DHCPACK, ~0, false, false, 0, 0 },
+    { "ACK from VM", 0x0800, DHCPACK, 3600, true, false, 0, -1 },
+    { "DECLINE to VM", 0x0800, DHCPDECLINE, 0, false, false, 0, 0 },
+    { "DECLINE from VM", 0x0800, DHCPDECLINE, 0, true, false, 0, -1 },
+    { "RELEASE from VM", 0x0800, DHCPRELEASE, 0, true, false, 0, 0 },
+    { "RELEASE to VM", 0x0800, DHCPRELEASE, 0, false, false, 0, -1 },
+    { "OFFER", 0x0800, DHCPOFFER, 3600, false, false, 0, -1 },
+    { "bad magic", 0x0800, DHCPACK, 3600, false, true, 0, -1 },
+    { "truncated options", 0x0800, DHCPACK, 3600, false, false,
+      TEST_DHCP_OPTIONS + 6, -1 },
+    { "truncated IP header", 0x0800, DHCPACK, 3600, false, false,
+      TEST_ETH_HLEN + 10, -1 },
+    { "IPv6", 0x86dd, DHCPACK, 3600, false, false, 0, -1 },
+};
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    unsigned char (*buffers)[TEST_PKT_SIZE] = NULL;
+    int lens[ARRAY_CARDINALITY(frames)];
+    struct testReplayData replay;
+    size_t i;
+
+    if (VIR_ALLOC_N(buffers, ARRAY_CARDINALITY(frames)) < 0)
+        return EXIT_FAILURE;
+
+    replay.frames = buffers;
+    replay.lens = lens;
+    replay.info = frames;
+    replay.nframes = ARRAY_CARDINALITY(frames);
+    replay.nvalid = 0;
+
+    for (i = 0 ; i < ARRAY_CARDINALITY(frames) ; i++) {
+        char *name = NULL;
+
+        if (virAsprintf(&name, "DHCP decode %s", frames[i].name) < 0) {
+            ret = -1;
+            goto cleanup;
+        }
+        if (virtTestRun(name, 1, testParseFrame, &frames[i]) < 0)
+            ret = -1;
+        VIR_FREE(name);
+
+        if ((lens[i] = testBuildFrame(&frames[i], buffers[i])) < 0) {
+            ret = -1;
+            goto cleanup;
+        }
+        if (frames[i].expect == 0)
+            replay.nvalid++;
+    }
+
+    if (virtTestRun("DHCP decode replay", 10, testReplay, &replay) < 0)
+        ret = -1;
+
+cleanup:
+    VIR_FREE(buffers);
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
+
+#else
+# include "testutils.h"
+
+int main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* HAVE_LIBPCAP */
@@ -68,6 +68,7 @@
 
 static unsigned int testDebug = -1;
 static unsigned int testVerbose = -1;
+static unsigned int testExpensive = -1;
 
 static unsigned int testOOM = 0;
 static unsigned int testCounter = 0;
@@ -565,6 +566,13 @@ virTestGetVerbose(void) {
     return testVerbose || virTestGetDebug();
 }
 
+unsigned int
+virTestGetExpensive(void) {
+    if (testExpensive == -1)
+        testExpensive = virTestGetFlag("VIR_TEST_EXPENSIVE");
+    return testExpensive;
+}
+
 int virtTestMain(int argc,
                  char **argv,
                  int (*func)(void))
@@ -596,7 +604,8 @@ int virtTestMain(int argc,
         fprintf(stderr, "Usage: %s\n", argv[0]);
         fputs("effective environment variables:\n"
               "VIR_TEST_VERBOSE set to show names of individual tests\n"
-              "VIR_TEST_DEBUG set to show information for debugging failures\n",
+              "VIR_TEST_DEBUG set to show information for debugging failures\n"
+              "VIR_TEST_EXPENSIVE set to run expensive tests and benchmarks\n",
               stderr);
         return EXIT_FAILURE;
     }
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library;  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "util.h"
+#include "virterror_internal.h"
+#include "memory.h"
+#include "logging.h"
+#include "threads.h"
+#include "event.h"
+#include "virfile.h"
+
+#include "rpc/virnetclient.h"
+#include "rpc/virnetsocket.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+#define TEST_PROG 0x11223344
+#define TEST_VERS 1
+#define TEST_PROC 7
+#define TEST_SERIAL 42
+
+#ifndef WIN32
+struct testServerData {
+    virNetSocketPtr sock;
+    bool reply;
+    bool failed;
+};
+
+struct testAsyncData {
+    bool done;
+    bool complete;
+    unsigned int serial;
+};
+
+
+static int testReadFull(virNetSocketPtr sock, char *buf, size_t len)
+{
+    while (len) {
+        ssize_t got = virNetSocketRead(sock, buf, len);
+        if (got <= 0)
+            return -1;
+        buf += got;
+        len -= got;
+    }
+    return 0;
+}
+
+
+/*
+ * Read a single call and, if asked for, send an empty reply to it.
+ * The connection is closed in either case.
+ */
+static void testServer(void *opaque)
+{
+    struct testServerData *data = opaque;
+    virNetMessagePtr msg = NULL;
+
+    if (!(msg = virNetMessageNew(false)))
+        goto cleanup;
+
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0)
+        goto cleanup;
+
+    if (testReadFull(data->sock, msg->buffer, msg->bufferLength) < 0 ||
+        virNetMessageDecodeLength(msg) < 0 ||
+        testReadFull(data->sock, msg->buffer + msg->bufferOffset,
+                     msg->bufferLength - msg->bufferOffset) < 0 ||
+        virNetMessageDecodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (msg->header.prog != TEST_PROG ||
+        msg->header.type != VIR_NET_CALL ||
+        msg->header.serial != TEST_SERIAL)
+        goto cleanup;
+
+    if (data->reply) {
+        virNetMessageClear(msg);
+        msg->header.prog = TEST_PROG;
+        msg->header.vers = TEST_VERS;
+        msg->header.proc = TEST_PROC;
+        msg->header.type = VIR_NET_REPLY;
+        msg->header.serial = TEST_SERIAL;
+        msg->header.status = VIR_NET_OK;
+
+        if (virNetMessageEncodeHeader(msg) < 0 ||
+            virNetMessageEncodePayloadEmpty(msg) < 0)
+            goto cleanup;
+
+        if (virNetSocketWrite(data->sock, msg->buffer,
+                              msg->bufferLength) != msg->bufferLength)
+            goto cleanup;
+    }
+
+    data->failed = false;
+
+cleanup:
+    virNetMessageFree(msg);
+    virNetSocketFree(data->sock);
+    data->sock = NULL;
+}
+
+
+static void testAsyncComplete(virNetClientPtr client ATTRIBUTE_UNUSED,
+                              virNetMessagePtr msg,
+                              bool complete,
+                              void *opaque)
+{
+    struct testAsyncData *data = opaque;
+
+    data->done = true;
+    data->complete = complete;
+    data->serial = msg->header.serial;
+    virNetMessageFree(msg);
+}
+
+
+static void testTimeoutNop(int timer ATTRIBUTE_UNUSED,
+                           void *opaque ATTRIBUTE_UNUSED)
+{
+}
+
+
+/* Returns the lowest file descriptor not in use */
+static int testLowestFreeFD(void)
+{
+    int fd = dup(STDIN_FILENO);
+
+    VIR_FORCE_CLOSE(fd);
+    return fd;
+}
+
+
+/*
+ * Send an asynchronous call to a server which either replies to it
+ * or hangs up. Then close the client and check it went away along
+ * with everything it had registered with the event loop.
+ */
+static int testClientAsync(const void *opaque)
+{
+    const bool *reply = opaque;
+    virNetSocketPtr lsock = NULL; /* Listen socket */
+    virNetClientPtr client = NULL;
+    virNetMessagePtr msg = NULL;
+    struct testServerData server = { NULL, *reply, true };
+    struct testAsyncData async = { false, false, 0 };
+    virThread thread;
+    bool haveThread = false;
+    int timer = -1;
+    int freeFD;
+    int i;
+    int ret = -1;
+
+    char *path = NULL;
+    char *tmpdir;
+    char template[] = "/tmp/libvirt_XXXXXX";
+
+    tmpdir = mkdtemp(template);
+    if (tmpdir == NULL) {
+        VIR_WARN("Failed to create temporary directory");
+        goto cleanup;
+    }
+    if (virAsprintf(&path, "%s/test.sock", tmpdir) < 0)
+        goto cleanup;
+
+    if (virNetSocketNewListenUNIX(path, 0700, -1, getgid(), &lsock) < 0)
+        goto cleanup;
+
+    if (virNetSocketListen(lsock, 0) < 0)
+        goto cleanup;
+
+    freeFD = testLowestFreeFD();
+
+    if (!(client = virNetClientNewUNIX(path, false, NULL)))
+        goto cleanup;
+
+    if (virNetSocketAccept(lsock, &server.sock) < 0 || !server.sock)
+        goto cleanup;
+
+    if (virNetSocketSetBlocking(server.sock, true) < 0)
+        goto cleanup;
+
+    if (virThreadCreate(&thread, true, testServer, &server) < 0)
+        goto cleanup;
+    haveThread = true;
+
+    if (!(msg = virNetMessageNew(false)))
+        goto cleanup;
+
+    msg->header.prog = TEST_PROG;
+    msg->header.vers = TEST_VERS;
+    msg->header.proc = TEST_PROC;
+    msg->header.type = VIR_NET_CALL;
+    msg->header.serial = TEST_SERIAL;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayloadEmpty(msg) < 0)
+        goto cleanup;
+
+    if (virNetClientSendAsync(client, msg, testAsyncComplete, &async) < 0)
+        goto cleanup;
+    msg = NULL;
+
+    /* Either a reply or the hangup completes the call */
+    while (!async.done) {
+        if (virEventRunDefaultImpl() < 0)
+            goto cleanup;
+    }
+
+    if (async.complete != *reply) {
+        VIR_DEBUG("Expected complete=%d got %d", *reply, async.complete);
+        goto cleanup;
+    }
+    if (async.serial != TEST_SERIAL) {
+        VIR_DEBUG("Expected serial %d got %u", TEST_SERIAL, async.serial);
+        goto cleanup;
+    }
+
+    virThreadJoin(&thread);
+    haveThread = false;
+    if (server.failed) {
+        VIR_DEBUG("Server did not see the expected call");
+        goto cleanup;
+    }
+
+    virNetClientClose(client);
+    virNetClientFree(client);
+    client = NULL;
+
+    /* The event loop releases what was removed from it on its next
+     * iterations; keep it from blocking meanwhile */
+    if ((timer = virEventAddTimeout(0, testTimeoutNop, NULL, NULL)) < 0)
+        goto cleanup;
+    for (i = 0 ; i < 3 ; i++) {
+        if (virEventRunDefaultImpl() < 0)
+            goto cleanup;
+    }
+
+    if (testLowestFreeFD() != freeFD) {
+        VIR_DEBUG("Client left file descriptors open");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    if (timer != -1)
+        virEventRemoveTimeout(timer);
+    virNetMessageFree(msg);
+    if (client) {
+        virNetClientClose(client);
+        virNetClientFree(client);
+    }
+    /* Closing the client above made the server see the hangup */
+    if (haveThread)
+        virThreadJoin(&thread);
+    else
+        virNetSocketFree(server.sock);
+    virNetSocketFree(lsock);
+    if (path)
+        unlink(path);
+    VIR_FREE(path);
+    if (tmpdir)
+        rmdir(tmpdir);
+    return ret;
+}
+#endif
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+#ifndef WIN32
+    bool reply = true;
+    bool hangup = false;
+#endif
+
+    signal(SIGPIPE, SIG_IGN);
+
+#ifndef WIN32
+    if (virEventRegisterDefaultImpl() < 0)
+        return EXIT_FAILURE;
+
+    if (virtTestRun("Client async reply", 1, testClientAsync, &reply) < 0)
+        ret = -1;
+    if (virtTestRun("Client async hangup", 1, testClientAsync, &hangup) < 0)
+        ret = -1;
+#endif
+
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)
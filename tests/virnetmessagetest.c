@@ -47,7 +47,7 @@ static int testMessageHeaderEncode(const void *args ATTRIBUTE_UNUSED)
     };
     /* According to doc to virNetMessageEncodeHeader(&msg):
      * msg->buffer will be this long */
-    unsigned long msg_buf_size = VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX;
+    unsigned long msg_buf_size = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
     int ret = -1;
 
     if (!msg) {
@@ -301,6 +301,76 @@ cleanup:
     return ret;
 }
 
+static int testMessagePayloadEncodeGrow(const void *args ATTRIBUTE_UNUSED)
+{
+    virNetMessageError err;
+    virNetMessagePtr msg = virNetMessageNew(true);
+    size_t msglen = VIR_NET_MESSAGE_INITIAL * 3;
+    size_t i;
+    int ret = -1;
+
+    if (!msg) {
+        virReportOOMError();
+        return -1;
+    }
+
+    memset(&err, 0, sizeof(err));
+
+    err.code = VIR_ERR_INTERNAL_ERROR;
+    err.domain = VIR_FROM_RPC;
+    err.level = VIR_ERR_ERROR;
+
+    /* An error message which does not fit in the initial buffer */
+    if (VIR_ALLOC(err.message) < 0 ||
+        VIR_ALLOC_N(*err.message, msglen + 1) < 0)
+        goto cleanup;
+    memset(*err.message, 'x', msglen);
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_MESSAGE;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_ERROR;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &err) < 0)
+        goto cleanup;
+
+    /* Length word, header, code, domain, message pointer and length,
+     * the message itself and 8 more fields */
+    if (msg->bufferLength != 4 + 24 + 16 + msglen + 8 * 4) {
+        VIR_DEBUG("Expect message length %zu got %zu",
+                  4 + 24 + 16 + msglen + 8 * 4, msg->bufferLength);
+        goto cleanup;
+    }
+
+    if (msg->buffer[0] != 0x00 ||
+        msg->buffer[1] != 0x03 ||
+        msg->buffer[2] != 0x00 ||
+        msg->buffer[3] != 0x4c) {
+        VIR_DEBUG("Length word does not match message length");
+        goto cleanup;
+    }
+
+    for (i = 0 ; i < msglen ; i++) {
+        if (msg->buffer[4 + 24 + 16 + i] != 'x') {
+            VIR_DEBUG("Message string mangled at offset %zu", i);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+cleanup:
+    if (err.message)
+        VIR_FREE(*err.message);
+    VIR_FREE(err.message);
+    virNetMessageFree(msg);
+    return ret;
+}
+
 static int testMessagePayloadDecode(const void *args ATTRIBUTE_UNUSED)
 {
     virNetMessageError err;
@@ -543,6 +613,9 @@ mymain(void)
     if (virtTestRun("Message Payload Encode", 1, testMessagePayloadEncode, NULL) < 0)
         ret = -1;
 
+    if (virtTestRun("Message Payload Encode Grow", 1, testMessagePayloadEncodeGrow, NULL) < 0)
+        ret = -1;
+
     if (virtTestRun("Message Payload Decode", 1, testMessagePayloadDecode, NULL) < 0)
         ret = -1;
 
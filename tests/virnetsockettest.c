@@ -328,6 +328,74 @@ cleanup:
     return ret;
 }
 
+static int testSocketUNIXWritev(const void *data ATTRIBUTE_UNUSED)
+{
+    virNetSocketPtr lsock = NULL; /* Listen socket */
+    virNetSocketPtr ssock = NULL; /* Server socket */
+    virNetSocketPtr csock = NULL; /* Client socket */
+    int ret = -1;
+    struct iovec iov[3];
+    char buf[64];
+    const char *expect = "hello wide world";
+    ssize_t len = strlen(expect);
+    ssize_t got;
+
+    char *path = NULL;
+    char *tmpdir;
+    char template[] = "/tmp/libvirt_XXXXXX";
+
+    tmpdir = mkdtemp(template);
+    if (tmpdir == NULL) {
+        VIR_WARN("Failed to create temporary directory");
+        goto cleanup;
+    }
+    if (virAsprintf(&path, "%s/test.sock", tmpdir) < 0)
+        goto cleanup;
+
+    if (virNetSocketNewListenUNIX(path, 0700, -1, getgid(), &lsock) < 0)
+        goto cleanup;
+
+    if (virNetSocketListen(lsock, 0) < 0)
+        goto cleanup;
+
+    if (virNetSocketNewConnectUNIX(path, false, NULL, &csock) < 0)
+        goto cleanup;
+
+    if (virNetSocketAccept(lsock, &ssock) < 0) {
+        VIR_DEBUG("Unexpected client socket missing");
+        goto cleanup;
+    }
+
+    iov[0].iov_base = (char *)"hello ";
+    iov[0].iov_len = 6;
+    iov[1].iov_base = (char *)"wide ";
+    iov[1].iov_len = 5;
+    iov[2].iov_base = (char *)"world";
+    iov[2].iov_len = 5;
+
+    if (virNetSocketWritev(csock, iov, 3) != len) {
+        VIR_DEBUG("Short vectored write");
+        goto cleanup;
+    }
+
+    if ((got = virNetSocketRead(ssock, buf, sizeof(buf))) != len ||
+        memcmp(buf, expect, got) != 0) {
+        VIR_DEBUG("Unexpected data from vectored write");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+cleanup:
+    VIR_FREE(path);
+    virNetSocketFree(lsock);
+    virNetSocketFree(ssock);
+    virNetSocketFree(csock);
+    if (tmpdir)
+        rmdir(tmpdir);
+    return ret;
+}
+
 static int testSocketCommandNormal(const void *data ATTRIBUTE_UNUSED)
 {
     virNetSocketPtr csock = NULL; /* Client socket */
@@ -496,6 +564,9 @@ mymain(void)
     if (virtTestRun("Socket UNIX Addrs", 1, testSocketUNIXAddrs, NULL) < 0)
         ret = -1;
 
+    if (virtTestRun("Socket UNIX Writev", 1, testSocketUNIXWritev, NULL) < 0)
+        ret = -1;
+
     if (virtTestRun("Socket External Command /dev/zero", 1, testSocketCommandNormal, NULL) < 0)
         ret = -1;
     if (virtTestRun("Socket External Command /dev/does-not-exist", 1, testSocketCommandFail, NULL) < 0)
@@ -621,8 +621,8 @@ static int testTLSSessionInit(const void *opaque)
 
 
     /* Now the real part of the test, setup the sessions */
-    serverSess = virNetTLSSessionNew(serverCtxt, NULL);
-    clientSess = virNetTLSSessionNew(clientCtxt, data->hostname);
+    serverSess = virNetTLSSessionNew(serverCtxt, NULL, NULL);
+    clientSess = virNetTLSSessionNew(clientCtxt, data->hostname, NULL);
 
     if (!serverSess) {
         VIR_WARN("Unexpected failure using %s against %s",
@@ -735,6 +735,155 @@ cleanup:
 }
 
 
+# if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+/*
+ * Loop over the handshake of both ends of a session until both
+ * complete, then push a byte from server to client so that any
+ * session ticket sent after the handshake gets processed.
+ */
+static int testTLSSessionHandshakePair(virNetTLSSessionPtr serverSess,
+                                       virNetTLSSessionPtr clientSess)
+{
+    bool clientShake = false;
+    bool serverShake = false;
+    bool sent = false;
+    char c = 'x';
+
+    do {
+        int rv;
+        if (!serverShake) {
+            rv = virNetTLSSessionHandshake(serverSess);
+            if (rv < 0)
+                return -1;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                serverShake = true;
+        }
+        if (!clientShake) {
+            rv = virNetTLSSessionHandshake(clientSess);
+            if (rv < 0)
+                return -1;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                clientShake = true;
+        }
+    } while (!clientShake || !serverShake);
+
+    for (;;) {
+        if (!sent) {
+            if (virNetTLSSessionWrite(serverSess, &c, 1) == 1)
+                sent = true;
+            else if (errno != EAGAIN)
+                return -1;
+        }
+        if (virNetTLSSessionRead(clientSess, &c, 1) == 1)
+            return 0;
+        if (errno != EAGAIN)
+            return -1;
+    }
+}
+
+
+/*
+ * This tests that a client reconnecting to the same server
+ * resumes its previous session instead of doing a full
+ * handshake again
+ */
+static int testTLSSessionResume(const void *opaque)
+{
+    struct testTLSSessionData *data = (struct testTLSSessionData *)opaque;
+    virNetTLSContextPtr clientCtxt = NULL;
+    virNetTLSContextPtr serverCtxt = NULL;
+    virNetTLSSessionPtr clientSess = NULL;
+    virNetTLSSessionPtr serverSess = NULL;
+    int ret = -1;
+    int channel[2] = { -1, -1 };
+    int i;
+
+    testTLSGenerateCert(&data->careq);
+    data->serverreq.cacrt = data->careq.crt;
+    testTLSGenerateCert(&data->serverreq);
+    data->clientreq.cacrt = data->careq.crt;
+    testTLSGenerateCert(&data->clientreq);
+
+    serverCtxt = virNetTLSContextNewServer(data->careq.filename,
+                                           NULL,
+                                           data->serverreq.filename,
+                                           keyfile,
+                                           NULL,
+                                           false,
+                                           true);
+
+    clientCtxt = virNetTLSContextNewClient(data->careq.filename,
+                                           NULL,
+                                           data->clientreq.filename,
+                                           keyfile,
+                                           false,
+                                           true);
+
+    if (!serverCtxt || !clientCtxt) {
+        VIR_WARN("Unexpected failure creating TLS contexts");
+        goto cleanup;
+    }
+
+    /* The second session resumes the first, the third goes to
+     * another port of the same host and must not */
+    for (i = 0 ; i < 3 ; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+            abort();
+        ignore_value(virSetNonBlock(channel[0]));
+        ignore_value(virSetNonBlock(channel[1]));
+
+        serverSess = virNetTLSSessionNew(serverCtxt, NULL, NULL);
+        clientSess = virNetTLSSessionNew(clientCtxt, data->hostname,
+                                         i < 2 ? "16514" : "16515");
+        if (!serverSess || !clientSess) {
+            VIR_WARN("Unexpected failure creating TLS sessions");
+            goto cleanup;
+        }
+
+        virNetTLSSessionSetIOCallbacks(serverSess, testWrite, testRead, &channel[0]);
+        virNetTLSSessionSetIOCallbacks(clientSess, testWrite, testRead, &channel[1]);
+
+        if (testTLSSessionHandshakePair(serverSess, clientSess) < 0) {
+            VIR_WARN("Unexpected handshake failure");
+            goto cleanup;
+        }
+
+        if (virNetTLSSessionIsResumed(clientSess) != (i == 1)) {
+            VIR_WARN("Session %d unexpectedly %s", i,
+                     i == 1 ? "not resumed" : "resumed");
+            goto cleanup;
+        }
+
+        virNetTLSSessionFree(serverSess);
+        virNetTLSSessionFree(clientSess);
+        serverSess = clientSess = NULL;
+        VIR_FORCE_CLOSE(channel[0]);
+        VIR_FORCE_CLOSE(channel[1]);
+    }
+
+    ret = 0;
+
+cleanup:
+    virNetTLSSessionFree(serverSess);
+    virNetTLSSessionFree(clientSess);
+    virNetTLSContextFree(serverCtxt);
+    virNetTLSContextFree(clientCtxt);
+    gnutls_x509_crt_deinit(data->careq.crt);
+    gnutls_x509_crt_deinit(data->clientreq.crt);
+    gnutls_x509_crt_deinit(data->serverreq.crt);
+    data->careq.crt = data->clientreq.crt = data->serverreq.crt = NULL;
+
+    if (getenv("VIRT_TEST_DEBUG_CERTS") == NULL) {
+        unlink(data->careq.filename);
+        unlink(data->clientreq.filename);
+        unlink(data->serverreq.filename);
+    }
+    VIR_FORCE_CLOSE(channel[0]);
+    VIR_FORCE_CLOSE(channel[1]);
+    return ret;
+}
+# endif
+
 static int
 mymain(void)
 {
@@ -1257,6 +1406,16 @@ mymain(void)
     DO_SESS_TEST(cacertreq, servercertreq, clientcertreq, false, false, "libvirt.org", wildcards5);
     DO_SESS_TEST(cacertreq, servercertreq, clientcertreq, false, false, "libvirt.org", wildcards6);
 
+# if HAVE_GNUTLS_SESSION_TICKET_ENABLE_SERVER
+    static struct testTLSSessionData resumedata;
+    resumedata.careq = cacertreq;
+    resumedata.serverreq = servercertreq;
+    resumedata.clientreq = clientcertreq;
+    resumedata.hostname = "libvirt.org";
+    if (virtTestRun("TLS Session Resume", 1, testTLSSessionResume, &resumedata) < 0)
+        ret = -1;
+# endif
+
     unlink(keyfile);
 
     asn1_delete_structure(&pkix_asn1);
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library;  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "testutils.h"
+#include "threadpool.h"
+#include "threads.h"
+
+struct testPoolData {
+    virMutex lock;
+    virCond cond;
+    size_t done;
+    size_t expected;
+
+    /* Set for the job which blocks a regular worker */
+    bool blocked;
+    bool release;
+};
+
+static void testPoolJob(void *jobdata, void *opaque)
+{
+    struct testPoolData *data = opaque;
+
+    virMutexLock(&data->lock);
+    if (jobdata) {
+        /* Block the worker until the test releases it */
+        data->blocked = true;
+        virCondBroadcast(&data->cond);
+        while (!data->release)
+            ignore_value(virCondWait(&data->cond, &data->lock));
+    }
+    data->done++;
+    virCondBroadcast(&data->cond);
+    virMutexUnlock(&data->lock);
+}
+
+static int testPoolDataInit(struct testPoolData *data, size_t expected)
+{
+    memset(data, 0, sizeof(*data));
+    data->expected = expected;
+    if (virMutexInit(&data->lock) < 0)
+        return -1;
+    if (virCondInit(&data->cond) < 0) {
+        virMutexDestroy(&data->lock);
+        return -1;
+    }
+    return 0;
+}
+
+static void testPoolDataClear(struct testPoolData *data)
+{
+    virMutexDestroy(&data->lock);
+    ignore_value(virCondDestroy(&data->cond));
+}
+
+static void testPoolWaitDone(struct testPoolData *data)
+{
+    virMutexLock(&data->lock);
+    while (data->done < data->expected)
+        ignore_value(virCondWait(&data->cond, &data->lock));
+    virMutexUnlock(&data->lock);
+}
+
+static unsigned long long
+testPoolHistogramTotal(const unsigned long long *histogram)
+{
+    unsigned long long total = 0;
+    size_t i;
+
+    for (i = 0 ; i < VIR_THREAD_POOL_HISTOGRAM_BUCKETS ; i++)
+        total += histogram[i];
+    return total;
+}
+
+
+static int testPoolJobs(const void *opaque ATTRIBUTE_UNUSED)
+{
+    struct testPoolData data;
+    virThreadPoolPtr pool = NULL;
+    size_t njobs = 1000;
+    size_t i;
+    int ret = -1;
+
+    if (testPoolDataInit(&data, njobs) < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(2, 4, 1, testPoolJob, &data)))
+        goto cleanup;
+
+    for (i = 0 ; i < njobs ; i++) {
+        if (virThreadPoolSendJob(pool, i % 10 == 0, NULL) < 0)
+            goto cleanup;
+    }
+
+    testPoolWaitDone(&data);
+
+    if (data.done != njobs)
+        goto cleanup;
+
+    ret = 0;
+
+cleanup:
+    virThreadPoolFree(pool);
+    testPoolDataClear(&data);
+    return ret;
+}
+
+
+static int testPoolStats(const void *opaque ATTRIBUTE_UNUSED)
+{
+    struct testPoolData data;
+    virThreadPoolPtr pool = NULL;
+    virThreadPoolStats stats;
+    size_t njobs = 100;
+    size_t i;
+    int ret = -1;
+
+    if (testPoolDataInit(&data, njobs + 1) < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 0, testPoolJob, &data)))
+        goto cleanup;
+
+    for (i = 0 ; i < njobs ; i++) {
+        if (virThreadPoolSendJob(pool, 0, NULL) < 0)
+            goto cleanup;
+    }
+
+    /* The single worker only starts this blocking job once it has
+     * accounted for all the previous ones */
+    if (virThreadPoolSendJob(pool, 0, &data) < 0)
+        goto cleanup;
+
+    virMutexLock(&data.lock);
+    while (!data.blocked)
+        ignore_value(virCondWait(&data.cond, &data.lock));
+    virMutexUnlock(&data.lock);
+
+    virThreadPoolGetStats(pool, &stats);
+
+    if (stats.jobsQueued != njobs + 1 ||
+        stats.jobsDone != njobs ||
+        stats.jobQueueDepth != 0 ||
+        stats.prioJobQueueDepth != 0 ||
+        stats.nWorkers != 1 ||
+        testPoolHistogramTotal(stats.waitTime) != njobs + 1 ||
+        testPoolHistogramTotal(stats.serviceTime) != njobs) {
+        if (virTestGetDebug())
+            fprintf(stderr,
+                    "queued=%llu done=%llu depth=%zu/%zu workers=%zu\n",
+                    stats.jobsQueued, stats.jobsDone,
+                    stats.jobQueueDepth, stats.prioJobQueueDepth,
+                    stats.nWorkers);
+        goto release;
+    }
+
+    ret = 0;
+
+release:
+    virMutexLock(&data.lock);
+    data.release = true;
+    virCondBroadcast(&data.cond);
+    virMutexUnlock(&data.lock);
+    testPoolWaitDone(&data);
+
+cleanup:
+    virThreadPoolFree(pool);
+    testPoolDataClear(&data);
+    return ret;
+}
+
+
+/* A priority job must run even when all regular workers are busy */
+static int testPoolPriority(const void *opaque ATTRIBUTE_UNUSED)
+{
+    struct testPoolData data;
+    virThreadPoolPtr pool = NULL;
+    int ret = -1;
+
+    if (testPoolDataInit(&data, 2) < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(1, 1, 1, testPoolJob, &data)))
+        goto cleanup;
+
+    if (virThreadPoolSendJob(pool, 0, &data) < 0)
+        goto cleanup;
+
+    virMutexLock(&data.lock);
+    while (!data.blocked)
+        ignore_value(virCondWait(&data.cond, &data.lock));
+    virMutexUnlock(&data.lock);
+
+    if (virThreadPoolSendJob(pool, 1, NULL) < 0)
+        goto release;
+
+    virMutexLock(&data.lock);
+    while (data.done < 1)
+        ignore_value(virCondWait(&data.cond, &data.lock));
+    virMutexUnlock(&data.lock);
+
+    ret = 0;
+
+release:
+    virMutexLock(&data.lock);
+    data.release = true;
+    virCondBroadcast(&data.cond);
+    virMutexUnlock(&data.lock);
+    testPoolWaitDone(&data);
+
+cleanup:
+    virThreadPoolFree(pool);
+    testPoolDataClear(&data);
+    return ret;
+}
+
+
+/*
+ * Synthetic throughput benchmark: push many trivial jobs through the
+ * pool. Run in several loops so virtTestRun reports the average time
+ * per batch. Only run when VIR_TEST_EXPENSIVE is set.
+ */
+static int testPoolThroughput(const void *opaque ATTRIBUTE_UNUSED)
+{
+    struct testPoolData data;
+    virThreadPoolPtr pool = NULL;
+    size_t njobs = 20000;
+    size_t i;
+    int ret = -1;
+
+    if (testPoolDataInit(&data, njobs) < 0)
+        return -1;
+
+    if (!(pool = virThreadPoolNew(5, 20, 5, testPoolJob, &data)))
+        goto cleanup;
+
+    for (i = 0 ; i < njobs ; i++) {
+        if (virThreadPoolSendJob(pool, i % 100 == 0, NULL) < 0)
+            goto cleanup;
+    }
+    testPoolWaitDone(&data);
+
+    ret = 0;
+
+cleanup:
+    virThreadPoolFree(pool);
+    testPoolDataClear(&data);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virThreadInitialize() < 0)
+        return EXIT_FAILURE;
+
+    if (virtTestRun("Thread pool jobs", 1, testPoolJobs, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Thread pool stats", 1, testPoolStats, NULL) < 0)
+        ret = -1;
+    if (virtTestRun("Thread pool priority", 1, testPoolPriority, NULL) < 0)
+        ret = -1;
+    if (virTestGetExpensive() &&
+        virtTestRun("Thread pool throughput", 5, testPoolThroughput, NULL) < 0)
+        ret = -1;
+
+    return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIRT_TEST_MAIN(mymain)